@@ -16,6 +16,8 @@
 #include <algorithm>
 #include <array>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <vector>
 
 #include <thrift/compiler/generate/common.h>
@@ -59,6 +61,19 @@ bool is_cpp_ref_unique_either(const t_field* f) {
       cpp2::is_implicit_ref(f->get_type());
 }
 
+// cpp.lazy is honored on plain struct fields only; frozen code and
+// cpp.ref / optionals storage need the value type itself.
+bool is_lazy(
+    const t_field* f,
+    const std::map<std::string, std::string>& options) {
+  auto t = f->get_type()->get_true_type();
+  return f->annotations_.count("cpp.lazy") &&
+      (t->is_struct() || t->is_xception()) && !cpp2::is_cpp_ref(f) &&
+      !(f->get_req() == t_field::e_req::T_OPTIONAL &&
+        options.count("optionals")) &&
+      !options.count("frozen") && !options.count("frozen2");
+}
+
 bool same_types(const t_type* a, const t_type* b) {
   if (!a || !b) {
     return false;
@@ -429,6 +444,7 @@ class mstch_cpp2_field : public mstch_field {
             {"field:enum_has_value", &mstch_cpp2_field::enum_has_value},
             {"field:optionals?", &mstch_cpp2_field::optionals},
             {"field:terse_writes?", &mstch_cpp2_field::terse_writes},
+            {"field:lazy?", &mstch_cpp2_field::lazy},
         });
   }
   mstch::node cpp_name() {
@@ -486,6 +502,9 @@ class mstch_cpp2_field : public mstch_field {
         (is_cpp_ref_unique_either(field_) ||
          (!t->is_struct() && !t->is_xception()));
   }
+  mstch::node lazy() {
+    return is_lazy(field_, cache_->parsed_options_);
+  }
 };
 
 class mstch_cpp2_struct : public mstch_struct {
@@ -529,6 +548,8 @@ class mstch_cpp2_struct : public mstch_struct {
             {"struct:is_large?", &mstch_cpp2_struct::is_large},
             {"struct:no_getters_setters?",
              &mstch_cpp2_struct::no_getters_setters},
+            {"struct:packed_isset?", &mstch_cpp2_struct::packed_isset},
+            {"struct:packed_layout?", &mstch_cpp2_struct::packed_layout},
         });
   }
   mstch::node getters_setters() {
@@ -724,14 +745,36 @@ class mstch_cpp2_struct : public mstch_struct {
   mstch::node no_getters_setters() {
     return cache_->parsed_options_.count("no_getters_setters") != 0;
   }
+  // With the packed_layout option the __isset flags of non-optional fields
+  // are bitfields. optional_field_ref and frozen2 layouts bind the flags by
+  // reference, so optional fields, and every field with frozen2, keep plain
+  // bools.
+  mstch::node packed_isset() {
+    return cache_->parsed_options_.count("packed_layout") != 0 &&
+        cache_->parsed_options_.count("frozen2") == 0;
+  }
+  // Whether the struct is laid out by decreasing alignment under the
+  // packed_layout option, which the generated code checks with a
+  // static_assert. Structs with a base class or a vtable are left alone.
+  mstch::node packed_layout() {
+    if (cache_->parsed_options_.count("packed_layout") == 0 ||
+        strct_->is_union() || strct_->is_xception() ||
+        strct_->get_members().empty() ||
+        strct_->annotations_.count("cpp.virtual") ||
+        strct_->annotations_.count("cpp2.virtual")) {
+      return false;
+    }
+    get_members_in_layout_order();
+    return !fields_in_layout_order_.empty();
+  }
 
  protected:
   // Computes the alignment of field on the target platform.
   // Returns 0 if cannot compute the alignment.
-  static size_t compute_alignment(t_field const* field) {
-    auto const& annotations = field->annotations_;
-    if (annotations.find("cpp.ref_type") != annotations.end() ||
-        annotations.find("cpp2.ref_type") != annotations.end()) {
+  static size_t compute_alignment(
+      t_field const* field,
+      std::map<std::string, std::string> const& options) {
+    if (cpp2::is_cpp_ref(field) || is_lazy(field, options)) {
       return 8;
     }
     t_type const* type = field->get_type();
@@ -741,9 +784,11 @@ class mstch_cpp2_struct : public mstch_struct {
         return 1;
       case t_types::TypeValue::TYPE_I16:
         return 2;
+      case t_types::TypeValue::TYPE_ENUM:
+        // The underlying type may be overridden with cpp.enum_type.
+        return type->annotations_.count("cpp.enum_type") ? 0 : 4;
       case t_types::TypeValue::TYPE_I32:
       case t_types::TypeValue::TYPE_FLOAT:
-      case t_types::TypeValue::TYPE_ENUM:
         return 4;
       case t_types::TypeValue::TYPE_I64:
       case t_types::TypeValue::TYPE_DOUBLE:
@@ -753,11 +798,12 @@ class mstch_cpp2_struct : public mstch_struct {
       case t_types::TypeValue::TYPE_MAP:
         return 8;
       case t_types::TypeValue::TYPE_STRUCT: {
-        size_t align = 1;
         const size_t kMaxAlign = 8;
         t_struct const* strct = static_cast<t_struct const*>(type);
+        // Unions also store the int-sized type discriminator.
+        size_t align = strct->is_union() ? 4 : 1;
         for (auto const* member : strct->get_members()) {
-          size_t member_align = compute_alignment(member);
+          size_t member_align = compute_alignment(member, options);
           if (member_align == 0) {
             // Unknown alignment, bail out.
             return 0;
@@ -780,11 +826,13 @@ class mstch_cpp2_struct : public mstch_struct {
   }
 
   // Returns the struct members reordered to minimize padding if the
-  // cpp.minimize_padding annotation is specified.
+  // cpp.minimize_padding annotation or the packed_layout option is specified.
   const std::vector<t_field*>& get_members_in_layout_order() {
     auto const& members = strct_->get_members();
     if (strct_->annotations_.find("cpp.minimize_padding") ==
-        strct_->annotations_.end()) {
+            strct_->annotations_.end() &&
+        (cache_->parsed_options_.count("packed_layout") == 0 ||
+         strct_->is_union())) {
       return members;
     }
 
@@ -801,7 +849,7 @@ class mstch_cpp2_struct : public mstch_struct {
     std::vector<FieldAlign> field_alignments;
     field_alignments.reserve(members.size());
     for (t_field* member : members) {
-      auto align = compute_alignment(member);
+      auto align = compute_alignment(member, cache_->parsed_options_);
       if (align == 0) {
         // Unknown alignment, don't reorder anything.
         return members;
@@ -1051,6 +1099,9 @@ class mstch_cpp2_program : public mstch_program {
             {"program:indirection?", &mstch_cpp2_program::has_indirection},
             {"program:json?", &mstch_cpp2_program::json},
             {"program:optionals?", &mstch_cpp2_program::optionals},
+            {"program:field_projection?",
+             &mstch_cpp2_program::field_projection},
+            {"program:lazy_fields?", &mstch_cpp2_program::has_lazy_fields},
         });
   }
   virtual std::string get_program_namespace(t_program const* program) override {
@@ -1127,6 +1178,19 @@ class mstch_cpp2_program : public mstch_program {
   mstch::node optionals() {
     return cache_->parsed_options_.count("optionals") != 0;
   }
+  mstch::node field_projection() {
+    return cache_->parsed_options_.count("field_projection") != 0;
+  }
+  mstch::node has_lazy_fields() {
+    for (auto const* strct : program_->get_objects()) {
+      for (auto const* field : strct->get_members()) {
+        if (is_lazy(field, cache_->parsed_options_)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
 };
 
 class enum_cpp2_generator : public enum_generator {
@@ -1300,6 +1364,22 @@ void t_mstch_cpp2_generator::generate_program() {
   auto const* program = get_program();
   set_mstch_generators();
 
+  // Reflection refers to the members by their declared type, which lazy
+  // fields replace with a LazyField.
+  if (cache_->parsed_options_.count("reflection")) {
+    for (auto const* strct : program->get_objects()) {
+      for (auto const* field : strct->get_members()) {
+        if (is_lazy(field, cache_->parsed_options_)) {
+          std::ostringstream err;
+          err << "cpp.lazy field " << strct->get_name() << "."
+              << field->get_name()
+              << " is not supported with the 'reflection' option";
+          throw std::runtime_error{err.str()};
+        }
+      }
+    }
+  }
+
   generate_structs(program);
   generate_constants(program);
   for (const auto* service : program->get_services()) {
@@ -1386,6 +1466,16 @@ void t_mstch_cpp2_generator::generate_service(t_service const* service) {
       cache_->services_[service_id],
       "types_custom_protocol.h",
       name + "_custom_protocol.h");
+  if (cache_->parsed_options_.count("inprocess_client")) {
+    render_to_file(
+        cache_->services_[service_id],
+        "ServiceInProcessClient.h",
+        name + "InProcessClient.h");
+    render_to_file(
+        cache_->services_[service_id],
+        "ServiceInProcessClient.cpp",
+        name + "InProcessClient.cpp");
+  }
 
   std::vector<std::array<std::string, 3>> protocols = {
       {{"binary", "BinaryProtocol", "T_BINARY_PROTOCOL"}},
@@ -25,6 +25,7 @@
 #include <initializer_list>
 #include <utility>
 
+#include <cstddef>
 #include <cstdint>
 
 namespace apache { namespace thrift {
@@ -47,8 +48,35 @@ struct ComparisonOperators {
   friend bool operator >=(const T& x, const T& y) { return !(x < y); }
 };
 
+struct member_layout {
+  std::size_t size;
+  std::size_t align;
+};
+
+/**
+ *  Size of a struct with members of the given sizes and alignments, stored
+ *  in that order.
+ */
+constexpr std::size_t layout_size(std::initializer_list<member_layout> ms) {
+  std::size_t offset = 0;
+  std::size_t align = 1;
+  for (auto const& m : ms) {
+    offset = (offset + m.align - 1) / m.align * m.align + m.size;
+    align = align < m.align ? m.align : align;
+  }
+  return (offset + align - 1) / align * align;
+}
+
 }}
 
+/**
+ *  Size report of a struct generated with the packed_layout option: size()
+ *  is its sizeof, and declaredOrderSize() what it would take without the
+ *  option, with its members in declared order and a bool per __isset flag.
+ */
+template <typename T>
+struct PackedLayoutReport;
+
 namespace detail {
 
 template <typename T>
@@ -20,10 +20,17 @@
  */
 #include <thrift/lib/cpp2/async/AsyncProcessor.h>
 
+DEFINE_bool(
+    thrift_server_presize_responses,
+    false,
+    "Compute the serialized size of responses before writing them, so that "
+    "each response is written into a single exactly-sized buffer");
+
 namespace apache {
 namespace thrift {
 
 constexpr std::chrono::seconds ServerInterface::BlockingThreadManager::kTimeout;
+constexpr size_t GeneratedAsyncProcessor::kResponseInitialBufferSize;
 thread_local Cpp2RequestContext* ServerInterface::reqCtx_;
 thread_local concurrency::ThreadManager* ServerInterface::tm_;
 thread_local folly::EventBase* ServerInterface::eb_;
@@ -32,6 +39,9 @@ void HandlerCallbackBase::sendReply(
     folly::IOBufQueue queue,
     apache::thrift::Stream<folly::IOBufQueue>&& stream) {
   transform(queue);
+  if (reqCtx_) {
+    reqCtx_->getTimings().markSerializeEnd();
+  }
   auto stream_ =
       std::move(stream).map([](auto&& value) mutable { return value.move(); });
   if (getEventBase()->isInEventBaseThread()) {
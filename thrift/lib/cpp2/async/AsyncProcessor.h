@@ -20,6 +20,7 @@
 #include <folly/String.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
 #include <thrift/lib/cpp/TApplicationException.h>
 #include <thrift/lib/cpp/TProcessor.h>
 #include <thrift/lib/cpp/concurrency/Thread.h>
@@ -31,9 +32,12 @@
 #include <thrift/lib/cpp2/async/ResponseChannel.h>
 #include <thrift/lib/cpp2/protocol/Protocol.h>
 #include <thrift/lib/cpp2/server/Cpp2ConnContext.h>
+#include <thrift/lib/cpp2/util/IOBufPool.h>
 #include <thrift/lib/thrift/gen-cpp2/RpcMetadata_types.h>
 #include <wangle/deprecated/rx/Observer.h>
 
+DECLARE_bool(thrift_server_presize_responses);
+
 namespace apache {
 namespace thrift {
 
@@ -140,6 +144,9 @@ class GeneratedAsyncProcessor : public AsyncProcessor {
   using ProcessMap = std::unordered_map<std::string, ProcessFunc>;
 
  protected:
+  // Leave some room for the IOBuf overhead.
+  static constexpr size_t kResponseInitialBufferSize = (1 << 12) - 64;
+
   virtual folly::Optional<std::string> getCacheKey(
       folly::IOBuf* buf,
       apache::thrift::protocol::PROTOCOL_TYPES protType) = 0;
@@ -168,9 +175,19 @@ class GeneratedAsyncProcessor : public AsyncProcessor {
       apache::thrift::ContextStack* ctx,
       const Result& result) {
     folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
-    size_t bufSize = detail::serializedResponseBodySizeZC(prot, &result);
-    bufSize += prot->serializedMessageSize(method);
-    prot->setOutput(&queue, bufSize);
+    if (FLAGS_thrift_server_presize_responses) {
+      size_t bufSize = detail::serializedResponseBodySizeZC(prot, &result);
+      bufSize += prot->serializedMessageSize(method);
+      IOBufPool::reserve(queue, bufSize, bufSize);
+      prot->setOutput(&queue, bufSize);
+    } else {
+      // Serialize in a single pass instead of walking result once more to
+      // size it: small responses fit in the first buffer, larger ones grow
+      // in the writer's 16KB chunks.
+      IOBufPool::reserve(
+          queue, kResponseInitialBufferSize, kResponseInitialBufferSize);
+      prot->setOutput(&queue);
+    }
     ctx->preWrite();
     prot->writeMessageBegin(method, apache::thrift::T_REPLY, protoSeqId);
     detail::serializeResponseBody(prot, &result);
@@ -488,6 +505,7 @@ class HandlerCallbackBase {
     if (req_ == nullptr) {
       LOG(ERROR) << ew.what();
     } else {
+      markHandlerEnd();
       callExceptionInEventBaseThread(ewp_, ew);
     }
   }
@@ -512,8 +530,18 @@ class HandlerCallbackBase {
     }
   }
 
+  // Called right before the handler's result or exception is serialized.
+  void markHandlerEnd() {
+    if (reqCtx_) {
+      reqCtx_->getTimings().markHandlerEnd();
+    }
+  }
+
   void sendReply(folly::IOBufQueue queue) {
     transform(queue);
+    if (reqCtx_) {
+      reqCtx_->getTimings().markSerializeEnd();
+    }
     if (getEventBase()->isInEventBaseThread()) {
       req_->sendReply(queue.move());
     } else {
@@ -654,6 +682,7 @@ class HandlerCallback : public HandlerCallbackBase {
  protected:
   virtual void doResult(const ResultType& r) {
     assert(cp_);
+    markHandlerEnd();
     auto queue = cp_(this->protoSeqId_, this->ctx_.get(), r);
     this->ctx_.reset();
     sendReply(std::move(queue));
@@ -727,6 +756,7 @@ class HandlerCallback<ResponseAndStream<Response, StreamItem>>
  protected:
   void doResult(ResultType r) {
     assert(cp_);
+    markHandlerEnd();
     auto responseAndStream =
         cp_(this->protoSeqId_, this->ctx_.get(), std::move(r));
     this->ctx_.reset();
@@ -802,6 +832,7 @@ class HandlerCallback<Stream<StreamItem>> : public HandlerCallbackBase {
  protected:
   void doResult(ResultType r) {
     assert(cp_);
+    markHandlerEnd();
     auto responseAndStream =
         cp_(this->protoSeqId_, this->ctx_.get(), std::move(r));
     this->ctx_.reset();
@@ -881,6 +912,7 @@ class HandlerCallback<void> : public HandlerCallbackBase {
  protected:
   virtual void doDone() {
     assert(cp_);
+    markHandlerEnd();
     auto queue = cp_(this->protoSeqId_, this->ctx_.get());
     this->ctx_.reset();
     sendReply(std::move(queue));
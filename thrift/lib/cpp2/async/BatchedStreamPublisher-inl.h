@@ -0,0 +1,312 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include <folly/concurrency/UnboundedQueue.h>
+#include <thrift/lib/cpp2/transport/rsocket/YarplStreamImpl.h>
+
+#include <yarpl/Flowable.h>
+
+namespace apache {
+namespace thrift {
+namespace detail {
+
+/**
+ * Shared state between the publisher and the subscriber side.
+ *
+ * Producers (any thread) only touch queue_, queued_, credits_ (read) and
+ * drainScheduled_. Everything else, including subscriber_ and the credit
+ * accounting, is owned by the SequencedExecutor.
+ */
+template <typename T>
+class BatchedStreamPublisherState
+    : public std::enable_shared_from_this<BatchedStreamPublisherState<T>> {
+ public:
+  BatchedStreamPublisherState(
+      folly::Executor::KeepAlive<> executor,
+      folly::Function<void()> onCompleteOrCanceled,
+      size_t bufferSizeLimit,
+      size_t maxBatchSize)
+      : executor_(std::move(executor)),
+        onCompleteOrCanceled_(std::move(onCompleteOrCanceled)),
+        bufferSizeLimit_(bufferSizeLimit),
+        maxBatchSize_(std::max<size_t>(maxBatchSize, 1)) {}
+
+  // Producer side
+
+  template <typename U>
+  void next(U&& value) {
+    if (canceled_.load(std::memory_order_relaxed) ||
+        overflowed_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    auto queued = queued_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (bufferSizeLimit_ != 0 && queued > bufferSizeLimit_) {
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      overflowed_.store(true, std::memory_order_relaxed);
+      scheduleDrain();
+      return;
+    }
+    queue_.enqueue(std::forward<U>(value));
+    // Pairs with the fence in onRequest(): either we see the new credits, or
+    // the drain triggered by the request sees our element.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (credits_.load(std::memory_order_relaxed) > 0) {
+      scheduleDrain();
+    }
+  }
+
+  void complete(folly::exception_wrapper e) {
+    error_ = std::move(e);
+    completed_.store(true, std::memory_order_release);
+    scheduleDrain();
+  }
+
+  void release() {
+    if (!completed_.load(std::memory_order_relaxed) &&
+        !canceled_.load(std::memory_order_relaxed)) {
+      LOG(FATAL) << "BatchedStreamPublisher has to be completed or canceled.";
+    }
+  }
+
+  // Subscriber side, always called on the executor
+
+  void subscribe(std::shared_ptr<yarpl::flowable::Subscriber<T>> subscriber) {
+    DCHECK(!subscriber_);
+    subscriber_ = std::move(subscriber);
+    subscriber_->onSubscribe(
+        std::make_shared<Subscription>(this->shared_from_this()));
+    drain();
+  }
+
+  void onRequest(int64_t n) {
+    if (!subscriber_ || n <= 0) {
+      return;
+    }
+    auto credits = credits_.load(std::memory_order_relaxed);
+    credits = credits > std::numeric_limits<int64_t>::max() - n
+        ? std::numeric_limits<int64_t>::max()
+        : credits + n;
+    credits_.store(credits, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    drain();
+  }
+
+  void onCancel() {
+    if (canceled_.exchange(true)) {
+      return;
+    }
+    subscriber_ = nullptr;
+    T discarded;
+    while (queue_.try_dequeue(discarded)) {
+    }
+    finish();
+  }
+
+  // The stream was dropped before anybody subscribed to it.
+  void onAbandoned() {
+    executor_->add([self = this->shared_from_this()] { self->onCancel(); });
+  }
+
+ private:
+  class Subscription : public yarpl::flowable::Subscription {
+   public:
+    explicit Subscription(std::shared_ptr<BatchedStreamPublisherState> state)
+        : state_(std::move(state)) {}
+
+    void request(int64_t n) override {
+      if (state_) {
+        state_->onRequest(n);
+      }
+    }
+
+    void cancel() override {
+      if (auto state = std::move(state_)) {
+        state->onCancel();
+      }
+    }
+
+   private:
+    std::shared_ptr<BatchedStreamPublisherState> state_;
+  };
+
+  void scheduleDrain() {
+    if (!drainScheduled_.exchange(true, std::memory_order_acq_rel)) {
+      executor_->add([self = this->shared_from_this()] {
+        self->drainScheduled_.store(false, std::memory_order_seq_cst);
+        self->drain();
+      });
+    }
+  }
+
+  void drain() {
+    if (!subscriber_) {
+      // Nobody to deliver to yet. Elements stay queued until subscribe().
+      return;
+    }
+    auto credits = credits_.load(std::memory_order_relaxed);
+    size_t delivered = 0;
+    T value;
+    while (credits > 0 && delivered < maxBatchSize_ &&
+           queue_.try_dequeue(value)) {
+      --credits;
+      ++delivered;
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      subscriber_->onNext(std::move(value));
+      if (!subscriber_) {
+        // Canceled from within onNext.
+        return;
+      }
+    }
+    credits_.store(credits, std::memory_order_relaxed);
+
+    if (delivered == maxBatchSize_) {
+      // More may be pending; yield the executor between batches.
+      scheduleDrain();
+      return;
+    }
+
+    if (overflowed_.load(std::memory_order_relaxed) && queue_.empty()) {
+      // Elements accepted before the overflow are delivered first, as for
+      // complete().
+      deliverTerminal(folly::make_exception_wrapper<std::runtime_error>(
+          "BatchedStreamPublisher buffer size limit exceeded"));
+      return;
+    }
+
+    if (completed_.load(std::memory_order_acquire) && queue_.empty()) {
+      deliverTerminal(std::move(error_));
+    }
+  }
+
+  void deliverTerminal(folly::exception_wrapper e) {
+    auto subscriber = std::exchange(subscriber_, nullptr);
+    canceled_.store(true, std::memory_order_relaxed);
+    if (e) {
+      subscriber->onError(std::move(e));
+    } else {
+      subscriber->onComplete();
+    }
+    finish();
+  }
+
+  void finish() {
+    if (onCompleteOrCanceled_) {
+      std::exchange(onCompleteOrCanceled_, nullptr)();
+    }
+  }
+
+  folly::Executor::KeepAlive<> executor_;
+  folly::UMPSCQueue<T, false /* MayBlock */> queue_;
+  std::atomic<size_t> queued_{0};
+  std::atomic<int64_t> credits_{0};
+  std::atomic<bool> drainScheduled_{false};
+  std::atomic<bool> completed_{false};
+  std::atomic<bool> canceled_{false};
+  std::atomic<bool> overflowed_{false};
+  folly::exception_wrapper error_;
+
+  std::shared_ptr<yarpl::flowable::Subscriber<T>> subscriber_;
+  folly::Function<void()> onCompleteOrCanceled_;
+  const size_t bufferSizeLimit_;
+  const size_t maxBatchSize_;
+};
+
+template <typename T>
+class BatchedStreamPublisherFlowable : public yarpl::flowable::Flowable<T> {
+ public:
+  explicit BatchedStreamPublisherFlowable(
+      std::shared_ptr<BatchedStreamPublisherState<T>> state)
+      : state_(std::move(state)) {}
+
+  ~BatchedStreamPublisherFlowable() {
+    if (auto state = std::move(state_)) {
+      state->onAbandoned();
+    }
+  }
+
+  void subscribe(
+      std::shared_ptr<yarpl::flowable::Subscriber<T>> subscriber) override {
+    auto state = std::move(state_);
+    DCHECK(state) << "BatchedStreamPublisher supports a single subscriber";
+    state->subscribe(std::move(subscriber));
+  }
+
+ private:
+  std::shared_ptr<BatchedStreamPublisherState<T>> state_;
+};
+} // namespace detail
+
+template <typename T>
+BatchedStreamPublisher<T>::~BatchedStreamPublisher() {
+  if (sharedState_) {
+    sharedState_->release();
+  }
+}
+
+template <typename T>
+std::pair<Stream<T>, BatchedStreamPublisher<T>>
+BatchedStreamPublisher<T>::create(
+    folly::Executor::KeepAlive<folly::SequencedExecutor> executor,
+    folly::Function<void()> onCompleteOrCanceled,
+    size_t bufferSizeLimit,
+    size_t maxBatchSize) {
+  auto state = std::make_shared<detail::BatchedStreamPublisherState<T>>(
+      folly::getKeepAliveToken(executor.get()),
+      std::move(onCompleteOrCanceled),
+      bufferSizeLimit,
+      maxBatchSize);
+  auto flowable =
+      std::make_shared<detail::BatchedStreamPublisherFlowable<T>>(state);
+  return {toStream<T>(std::move(flowable), std::move(executor)),
+          BatchedStreamPublisher<T>(std::move(state))};
+}
+
+template <typename T>
+void BatchedStreamPublisher<T>::next(T&& value) const {
+  if (sharedState_) {
+    sharedState_->next(std::move(value));
+  }
+}
+
+template <typename T>
+void BatchedStreamPublisher<T>::next(const T& value) const {
+  if (sharedState_) {
+    sharedState_->next(value);
+  }
+}
+
+template <typename T>
+void BatchedStreamPublisher<T>::complete(folly::exception_wrapper e) && {
+  auto sharedState = std::exchange(sharedState_, nullptr);
+  sharedState->complete(std::move(e));
+}
+
+template <typename T>
+void BatchedStreamPublisher<T>::complete() && {
+  auto sharedState = std::exchange(sharedState_, nullptr);
+  sharedState->complete(folly::exception_wrapper());
+}
+
+template <typename T>
+BatchedStreamPublisher<T>::BatchedStreamPublisher(
+    std::shared_ptr<detail::BatchedStreamPublisherState<T>> sharedState)
+    : sharedState_(std::move(sharedState)) {}
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <thrift/lib/cpp2/async/Stream.h>
+
+namespace apache {
+namespace thrift {
+namespace detail {
+template <typename T>
+class BatchedStreamPublisherState;
+}
+
+/**
+ * Drop-in alternative to StreamPublisher for high-rate publishers.
+ *
+ * next() pushes onto a lock-free MPSC queue and only hops to the executor
+ * when no drain is already scheduled, so a burst of elements costs one
+ * executor task. The drain delivers up to maxBatchSize elements per task,
+ * bounded by the credits the subscriber has requested.
+ *
+ * Unlike StreamPublisher, complete() never blocks: the terminal signal is
+ * queued behind the pending elements and onCompleteOrCanceled runs on the
+ * executor once it has been delivered (or the subscriber canceled).
+ *
+ * Once more than bufferSizeLimit elements are pending, further elements are
+ * dropped and the stream fails with an error after the pending ones have
+ * been delivered.
+ */
+template <typename T>
+class BatchedStreamPublisher {
+ public:
+  static constexpr size_t kNoLimit = 0;
+  static constexpr size_t kDefaultMaxBatchSize = 64;
+
+  ~BatchedStreamPublisher();
+
+  BatchedStreamPublisher(const BatchedStreamPublisher&) = delete;
+  BatchedStreamPublisher(BatchedStreamPublisher&&) = default;
+
+  static std::pair<Stream<T>, BatchedStreamPublisher<T>> create(
+      folly::Executor::KeepAlive<folly::SequencedExecutor> executor,
+      folly::Function<void()> onCompleteOrCanceled,
+      size_t bufferSizeLimit = kNoLimit,
+      size_t maxBatchSize = kDefaultMaxBatchSize);
+
+  void next(const T&) const;
+  void next(T&&) const;
+  // Completes the stream once all elements passed to next() have been
+  // delivered. Does not block.
+  void complete(folly::exception_wrapper) &&;
+  void complete() &&;
+
+ private:
+  explicit BatchedStreamPublisher(
+      std::shared_ptr<detail::BatchedStreamPublisherState<T>> sharedState);
+
+  std::shared_ptr<detail::BatchedStreamPublisherState<T>> sharedState_;
+};
+
+} // namespace thrift
+} // namespace apache
+
+#include <thrift/lib/cpp2/async/BatchedStreamPublisher-inl.h>
@@ -0,0 +1,377 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <thrift/lib/cpp2/async/ConcurrencyLimitingRequestChannel.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/io/async/Request.h>
+#include <thrift/lib/cpp/TApplicationException.h>
+#include <thrift/lib/cpp/transport/THeader.h>
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/async/ResponseChannel.h>
+
+namespace apache {
+namespace thrift {
+
+using apache::thrift::transport::TTransportException;
+
+namespace {
+folly::exception_wrapper rejection(const char* reason) {
+  return folly::make_exception_wrapper<TApplicationException>(
+      TApplicationException::TApplicationExceptionType::LOADSHEDDING, reason);
+}
+
+enum class Reply { Handled, Overloaded, Failed };
+
+// Replies to requests the server did not handle carry an "ex" header. Those
+// say nothing about the time requests take to handle, and some of them mean
+// that the server sheds load.
+Reply classify(const ClientReceiveState& state) {
+  auto header = state.header();
+  if (!header) {
+    return Reply::Handled;
+  }
+  const auto& headers = header->getHeaders();
+  auto ex = headers.find("ex");
+  if (ex == headers.end()) {
+    return Reply::Handled;
+  }
+  if (ex->second == kOverloadedErrorCode ||
+      ex->second == kQueueOverloadedErrorCode ||
+      ex->second == kTaskExpiredErrorCode ||
+      ex->second == kServerQueueTimeoutErrorCode) {
+    return Reply::Overloaded;
+  }
+  return Reply::Failed;
+}
+} // namespace
+
+class ConcurrencyLimitingRequestChannel::RequestCallback
+    : public apache::thrift::RequestCallback {
+ public:
+  RequestCallback(
+      ConcurrencyLimitingRequestChannel& channel,
+      bool oneway,
+      std::unique_ptr<apache::thrift::RequestCallback> cob)
+      : guard_(&channel),
+        channel_(channel),
+        oneway_(oneway),
+        start_(Clock::now()),
+        cob_(std::move(cob)) {}
+
+  void requestSent() override {
+    if (oneway_ && !done_) {
+      done(folly::none, false);
+    }
+    if (cob_) {
+      cob_->requestSent();
+    }
+  }
+
+  void replyReceived(apache::thrift::ClientReceiveState&& state) override {
+    if (!done_) {
+      auto reply = classify(state);
+      done(
+          reply == Reply::Handled
+              ? folly::make_optional(Clock::now() - start_)
+              : folly::none,
+          reply == Reply::Overloaded);
+    }
+    cob_->replyReceived(std::move(state));
+  }
+
+  void requestError(apache::thrift::ClientReceiveState&& state) override {
+    if (!done_) {
+      bool timedOut = false;
+      if (state.isException()) {
+        state.exception().with_exception([&](const TTransportException& ex) {
+          timedOut = ex.getType() == TTransportException::TIMED_OUT;
+        });
+      }
+      done(folly::none, timedOut);
+    }
+    if (cob_) {
+      cob_->requestError(std::move(state));
+    }
+  }
+
+ private:
+  void done(folly::Optional<Clock::duration> rtt, bool timedOut) {
+    done_ = true;
+    channel_.onComplete(rtt, timedOut);
+  }
+
+  // Keeps the channel alive until the last request is counted.
+  folly::DelayedDestruction::DestructorGuard guard_;
+  ConcurrencyLimitingRequestChannel& channel_;
+  const bool oneway_;
+  bool done_{false};
+  const Clock::time_point start_;
+  std::unique_ptr<apache::thrift::RequestCallback> cob_;
+};
+
+ConcurrencyLimitingRequestChannel::ConcurrencyLimitingRequestChannel(
+    ImplPtr impl,
+    Options options)
+    : impl_(std::move(impl)),
+      options_(std::move(options)),
+      limit_(options_.initialLimit) {
+  CHECK(impl_);
+  CHECK_GE(options_.minLimit, 1);
+  CHECK_LE(options_.minLimit, options_.maxLimit);
+  CHECK_GT(options_.longWindow, 0);
+  CHECK_GT(options_.shortWindow, 0);
+  limit_ = std::min(std::max(limit_, options_.minLimit), options_.maxLimit);
+}
+
+ConcurrencyLimitingRequestChannel::~ConcurrencyLimitingRequestChannel() {
+  queueTimeout_.reset();
+  auto queue = std::move(queue_);
+  for (auto& pending : queue) {
+    pending.dispatch(folly::make_exception_wrapper<TTransportException>(
+        TTransportException::NOT_OPEN, "Channel destroyed"));
+  }
+}
+
+uint32_t ConcurrencyLimitingRequestChannel::sendRequest(
+    apache::thrift::RpcOptions& options,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    std::unique_ptr<apache::thrift::ContextStack> ctx,
+    std::unique_ptr<folly::IOBuf> buf,
+    std::shared_ptr<apache::thrift::transport::THeader> header) {
+  return send(
+      false,
+      std::move(cob),
+      [this,
+       options,
+       ctx = std::move(ctx),
+       buf = std::move(buf),
+       header = std::move(header)](
+          std::unique_ptr<apache::thrift::RequestCallback> wrapped,
+          folly::exception_wrapper&& ex) mutable -> uint32_t {
+        if (ex) {
+          wrapped->requestError(
+              ClientReceiveState(std::move(ex), std::move(ctx)));
+          return 0;
+        }
+        return impl_->sendRequest(
+            options,
+            std::move(wrapped),
+            std::move(ctx),
+            std::move(buf),
+            std::move(header));
+      });
+}
+
+uint32_t ConcurrencyLimitingRequestChannel::sendOnewayRequest(
+    apache::thrift::RpcOptions& options,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    std::unique_ptr<apache::thrift::ContextStack> ctx,
+    std::unique_ptr<folly::IOBuf> buf,
+    std::shared_ptr<apache::thrift::transport::THeader> header) {
+  return send(
+      true,
+      std::move(cob),
+      [this,
+       options,
+       ctx = std::move(ctx),
+       buf = std::move(buf),
+       header = std::move(header)](
+          std::unique_ptr<apache::thrift::RequestCallback> wrapped,
+          folly::exception_wrapper&& ex) mutable -> uint32_t {
+        if (ex) {
+          if (wrapped) {
+            wrapped->requestError(
+                ClientReceiveState(std::move(ex), std::move(ctx)));
+          }
+          return 0;
+        }
+        return impl_->sendOnewayRequest(
+            options,
+            std::move(wrapped),
+            std::move(ctx),
+            std::move(buf),
+            std::move(header));
+      });
+}
+
+uint32_t ConcurrencyLimitingRequestChannel::sendStreamRequest(
+    apache::thrift::RpcOptions& options,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    std::unique_ptr<apache::thrift::ContextStack> ctx,
+    std::unique_ptr<folly::IOBuf> buf,
+    std::shared_ptr<apache::thrift::transport::THeader> header) {
+  return send(
+      false,
+      std::move(cob),
+      [this,
+       options,
+       ctx = std::move(ctx),
+       buf = std::move(buf),
+       header = std::move(header)](
+          std::unique_ptr<apache::thrift::RequestCallback> wrapped,
+          folly::exception_wrapper&& ex) mutable -> uint32_t {
+        if (ex) {
+          wrapped->requestError(
+              ClientReceiveState(std::move(ex), std::move(ctx)));
+          return 0;
+        }
+        return impl_->sendStreamRequest(
+            options,
+            std::move(wrapped),
+            std::move(ctx),
+            std::move(buf),
+            std::move(header));
+      });
+}
+
+template <typename Send>
+uint32_t ConcurrencyLimitingRequestChannel::send(
+    bool oneway,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    Send&& sendFn) {
+  DCHECK(getEventBase()->isInEventBaseThread());
+  if (queue_.empty() && inflight_ < limit()) {
+    ++inflight_;
+    return sendFn(
+        std::make_unique<RequestCallback>(*this, oneway, std::move(cob)), {});
+  }
+  if (queue_.size() >= options_.maxQueueSize) {
+    ++rejected_;
+    return sendFn(std::move(cob), rejection("Client concurrency limit"));
+  }
+
+  // Send with the RequestContext of the caller once a slot frees up.
+  queue_.push_back(Pending{
+      Clock::now(),
+      [this,
+       oneway,
+       cob = std::move(cob),
+       sendFn = std::forward<Send>(sendFn),
+       rctx = folly::RequestContext::saveContext()](
+          folly::exception_wrapper&& ex) mutable {
+        folly::RequestContextScopeGuard guard(std::move(rctx));
+        if (ex) {
+          sendFn(std::move(cob), std::move(ex));
+          return;
+        }
+        ++inflight_;
+        sendFn(
+            std::make_unique<RequestCallback>(*this, oneway, std::move(cob)),
+            {});
+      }});
+  if (queue_.size() == 1) {
+    scheduleQueueTimeout();
+  }
+  return 0;
+}
+
+ConcurrencyLimitingRequestChannel::Stats
+ConcurrencyLimitingRequestChannel::getStats() const {
+  return {limit(), inflight_, queue_.size(), rejected_};
+}
+
+void ConcurrencyLimitingRequestChannel::onComplete(
+    folly::Optional<Clock::duration> rtt,
+    bool timedOut) {
+  if (timedOut) {
+    limit_ = std::max(limit_ * options_.backoffRatio, options_.minLimit);
+  } else if (rtt) {
+    updateLimit(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(*rtt).count());
+  }
+  DCHECK_GT(inflight_, 0);
+  --inflight_;
+  drainQueue();
+}
+
+void ConcurrencyLimitingRequestChannel::updateLimit(double rttNs) {
+  if (longRttNs_ == 0) {
+    longRttNs_ = shortRttNs_ = rttNs;
+  } else {
+    longRttNs_ += (rttNs - longRttNs_) / options_.longWindow;
+    shortRttNs_ += (rttNs - shortRttNs_) / options_.shortWindow;
+  }
+  // Once the RTT drops again after a long period of queueing, the long-term
+  // average comes down faster than its window would allow.
+  if (longRttNs_ > 2 * shortRttNs_) {
+    longRttNs_ *= 0.95;
+  }
+
+  auto gradient = std::min(
+      std::max(options_.rttTolerance * longRttNs_ / shortRttNs_, 0.5), 1.0);
+  // Some headroom above the estimate, to detect an increase in capacity.
+  auto estimate = limit_ * gradient + std::sqrt(limit_);
+  // A limit the callers don't use says nothing about the server.
+  if (estimate > limit_ && inflight_ < limit_ / 2) {
+    return;
+  }
+  limit_ = limit_ * (1 - options_.smoothing) + estimate * options_.smoothing;
+  limit_ = std::min(std::max(limit_, options_.minLimit), options_.maxLimit);
+}
+
+void ConcurrencyLimitingRequestChannel::drainQueue() {
+  // A request may fail while it is sent, and complete from within this loop.
+  if (draining_) {
+    return;
+  }
+  folly::DelayedDestruction::DestructorGuard dg(this);
+  draining_ = true;
+  auto now = Clock::now();
+  while (!queue_.empty()) {
+    if (now - queue_.front().enqueued >= options_.maxQueueTime) {
+      auto pending = std::move(queue_.front());
+      queue_.pop_front();
+      ++rejected_;
+      pending.dispatch(rejection("Queued for too long"));
+    } else if (inflight_ < limit()) {
+      auto pending = std::move(queue_.front());
+      queue_.pop_front();
+      pending.dispatch({});
+    } else {
+      break;
+    }
+  }
+  draining_ = false;
+  scheduleQueueTimeout();
+}
+
+void ConcurrencyLimitingRequestChannel::scheduleQueueTimeout() {
+  if (queue_.empty()) {
+    if (queueTimeout_) {
+      queueTimeout_->cancelTimeout();
+    }
+    return;
+  }
+  if (!queueTimeout_) {
+    queueTimeout_ = folly::AsyncTimeout::make(
+        *getEventBase(), [this]() noexcept { drainQueue(); });
+  }
+  auto waited = Clock::now() - queue_.front().enqueued;
+  // Rounded up, so that the request has expired when the timeout fires.
+  auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       options_.maxQueueTime - waited) +
+      std::chrono::milliseconds(1);
+  queueTimeout_->scheduleTimeout(
+      std::max(remaining, std::chrono::milliseconds(0)));
+}
+
+size_t ConcurrencyLimitingRequestChannel::limit() const {
+  return static_cast<size_t>(limit_);
+}
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <memory>
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/Function.h>
+#include <folly/Optional.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <thrift/lib/cpp2/async/RequestChannel.h>
+
+namespace apache {
+namespace thrift {
+
+// RequestChannel wrapper that caps the requests in flight to one destination,
+// and adapts the cap to the round trip times it observes (a gradient
+// algorithm): the limit grows while the RTT stays close to its long-term
+// average, and shrinks in proportion when the RTT rises above it, i.e. when
+// requests start to queue on the server. A timed out request, or one the
+// server fails as overloaded, cuts the limit by a constant factor; other
+// errors don't count as RTT samples.
+//
+// Requests above the limit wait in a local queue, or fail at once with a
+// TApplicationException of type LOADSHEDDING when the queue is full or
+// disabled, without reaching the server.
+//
+// Use from the EventBase thread of the wrapped channel only. Wrap the channel
+// of each destination separately, e.g. in the ImplCreator of a
+// LoadBalancingRequestChannel, to get a limit per destination.
+class ConcurrencyLimitingRequestChannel
+    : public apache::thrift::RequestChannel {
+ public:
+  using Impl = apache::thrift::RequestChannel;
+  using ImplPtr = std::shared_ptr<Impl>;
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    double initialLimit{20};
+    double minLimit{1};
+    double maxLimit{1000};
+    // Requests which wait for a slot when the limit is reached; 0 fails them
+    // right away.
+    size_t maxQueueSize{0};
+    // Queued requests still waiting after this long fail, whether or not
+    // another request completes in the meantime.
+    std::chrono::milliseconds maxQueueTime{1000};
+    // The limit only shrinks once the short-term RTT exceeds the long-term
+    // one by this factor.
+    double rttTolerance{1.5};
+    // Number of samples averaged by the long-term and the short-term RTT.
+    size_t longWindow{500};
+    size_t shortWindow{10};
+    // Weight of each new estimate in the limit.
+    double smoothing{0.2};
+    // Factor applied to the limit on a timeout.
+    double backoffRatio{0.9};
+  };
+
+  struct Stats {
+    size_t limit;
+    size_t inflight;
+    size_t queued;
+    uint64_t rejected;
+  };
+
+  using UniquePtr = std::unique_ptr<
+      ConcurrencyLimitingRequestChannel,
+      folly::DelayedDestruction::Destructor>;
+
+  static UniquePtr newChannel(ImplPtr impl, Options options = Options()) {
+    return {new ConcurrencyLimitingRequestChannel(
+                std::move(impl), std::move(options)),
+            {}};
+  }
+
+  uint32_t sendRequest(
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) override;
+
+  uint32_t sendOnewayRequest(
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) override;
+
+  uint32_t sendStreamRequest(
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) override;
+
+  void setCloseCallback(apache::thrift::CloseCallback* cb) override {
+    impl_->setCloseCallback(cb);
+  }
+
+  folly::EventBase* getEventBase() const override {
+    return impl_->getEventBase();
+  }
+
+  uint16_t getProtocolId() override {
+    return impl_->getProtocolId();
+  }
+
+  // The current limit, the requests in flight and queued, and the number of
+  // requests failed locally so far.
+  Stats getStats() const;
+
+ protected:
+  ~ConcurrencyLimitingRequestChannel() override;
+
+ private:
+  ConcurrencyLimitingRequestChannel(ImplPtr impl, Options options);
+
+  class RequestCallback;
+
+  struct Pending {
+    Clock::time_point enqueued;
+    // Sends the request, or fails it with the exception if there is one.
+    folly::Function<void(folly::exception_wrapper&&)> dispatch;
+  };
+
+  // Sends the request through "sendFn" if the limit allows it, or queues it.
+  // sendFn is called with the wrapped callback, or with the original one and
+  // an exception to fail the request with.
+  template <typename Send>
+  uint32_t send(
+      bool oneway,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      Send&& sendFn);
+
+  void onComplete(folly::Optional<Clock::duration> rtt, bool timedOut);
+  void updateLimit(double rttNs);
+  void drainQueue();
+  // Arms queueTimeout_ for the deadline of the oldest queued request.
+  void scheduleQueueTimeout();
+  size_t limit() const;
+
+  ImplPtr impl_;
+  const Options options_;
+  double limit_;
+  double longRttNs_{0};
+  double shortRttNs_{0};
+  size_t inflight_{0};
+  uint64_t rejected_{0};
+  std::deque<Pending> queue_;
+  bool draining_{false};
+  std::unique_ptr<folly::AsyncTimeout> queueTimeout_;
+};
+} // namespace thrift
+} // namespace apache
@@ -103,6 +103,10 @@ void Cpp2Channel::detachEventBase() {
   transportHandler_->detachEventBase();
 }
 
+bool Cpp2Channel::isDetachable() {
+  return sendCallbacks_.empty() && transport_->isDetachable();
+}
+
 EventBase* Cpp2Channel::getEventBase() {
   return transport_->getEventBase();
 }
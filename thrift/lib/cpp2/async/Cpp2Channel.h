@@ -115,6 +115,8 @@ class Cpp2Channel
   virtual void attachEventBase(folly::EventBase*);
   virtual void detachEventBase();
   folly::EventBase* getEventBase();
+  // True if there are no writes in flight and the transport can be detached
+  bool isDetachable();
 
   // Queued sends feature - optimizes by minimizing syscalls in high-QPS
   // loads for greater throughput, but at the expense of some
@@ -126,6 +128,18 @@ class Cpp2Channel
     }
   }
 
+  // Writes the messages queued by setQueueSends() now, instead of at the
+  // end of the loop.
+  void flushQueuedSends() {
+    if (pipeline_) {
+      auto handler = pipeline_->getHandler<wangle::OutputBufferingHandler>(1);
+      if (handler->isLoopCallbackScheduled()) {
+        handler->cancelLoopCallback();
+        handler->runLoopCallback();
+      }
+    }
+  }
+
   /**
    * Set read buffer size.
    *
@@ -61,10 +61,18 @@ void HeaderClientChannel::setTimeout(uint32_t ms) {
 }
 
 void HeaderClientChannel::closeNow() {
+  if (!onewayBatch_.empty()) {
+    failOnewayBatch(folly::make_exception_wrapper<TTransportException>(
+        TTransportException::NOT_OPEN, "Channel closed"));
+  }
   cpp2Channel_->closeNow();
 }
 
 void HeaderClientChannel::destroy() {
+  // Oneway requests the caller has sent are written before the connection
+  // closes, as they would be without batching.
+  flushOnewayBatch();
+  cpp2Channel_->flushQueuedSends();
   closeNow();
   folly::DelayedDestruction::destroy();
 }
@@ -86,11 +94,14 @@ void HeaderClientChannel::attachEventBase(EventBase* eventBase) {
 }
 
 void HeaderClientChannel::detachEventBase() {
+  DCHECK(onewayBatch_.empty());
+  onewayBatchTimeout_.reset();
   cpp2Channel_->detachEventBase();
 }
 
 bool HeaderClientChannel::isDetachable() {
-  return getTransport()->isDetachable() && recvCallbacks_.empty();
+  return getTransport()->isDetachable() && recvCallbacks_.empty() &&
+      onewayBatch_.empty();
 }
 
 bool HeaderClientChannel::clientSupportHeader() {
@@ -109,6 +120,14 @@ uint32_t HeaderClientChannel::sendOnewayRequest(
   setRequestHeaderOptions(header.get());
   addRpcOptionHeaders(header.get(), rpcOptions);
 
+  if (onewayBatching_) {
+    batchOnewayRequest(
+        cb ? new OnewayCallback(std::move(cb), std::move(ctx)) : nullptr,
+        std::move(buf),
+        std::move(header));
+    return ResponseChannel::ONEWAY_REQUEST_ID;
+  }
+
   // Both cb and buf are allowed to be null.
   uint32_t oldSeqId = sendSeqId_;
   sendSeqId_ = ResponseChannel::ONEWAY_REQUEST_ID;
@@ -125,6 +144,75 @@ uint32_t HeaderClientChannel::sendOnewayRequest(
   return ResponseChannel::ONEWAY_REQUEST_ID;
 }
 
+void HeaderClientChannel::setOnewayBatching(
+    folly::Optional<OnewayBatchingOptions> options) {
+  flushOnewayBatch();
+  if (options) {
+    CHECK_GT(options->maxMessages, 0);
+  }
+  onewayBatching_ = std::move(options);
+  // Turning this off again could reorder writes still queued in Cpp2Channel.
+  if (onewayBatching_) {
+    cpp2Channel_->setQueueSends(true);
+  }
+}
+
+void HeaderClientChannel::batchOnewayRequest(
+    OnewayCallback* callback,
+    std::unique_ptr<IOBuf> buf,
+    std::shared_ptr<THeader> header) {
+  onewayBatchBytes_ += buf ? buf->computeChainDataLength() : 0;
+  onewayBatch_.push_back({callback, std::move(buf), std::move(header)});
+
+  if (onewayBatch_.size() >= onewayBatching_->maxMessages ||
+      onewayBatchBytes_ >= onewayBatching_->maxBytes) {
+    flushOnewayBatch();
+  } else if (onewayBatch_.size() == 1) {
+    if (!onewayBatchTimeout_) {
+      onewayBatchTimeout_ = folly::AsyncTimeout::make(
+          *getEventBase(), [this]() noexcept { flushOnewayBatch(); });
+    }
+    onewayBatchTimeout_->scheduleTimeoutHighRes(onewayBatching_->maxDelay);
+  }
+}
+
+void HeaderClientChannel::flushOnewayBatch() {
+  if (onewayBatch_.empty()) {
+    return;
+  }
+  DestructorGuard dg(this);
+  if (onewayBatchTimeout_) {
+    onewayBatchTimeout_->cancelTimeout();
+  }
+  auto batch = std::move(onewayBatch_);
+  onewayBatch_.clear();
+  onewayBatchBytes_ = 0;
+
+  // Cpp2Channel queues the frames, and writes them all at the end of the
+  // loop.
+  uint32_t oldSeqId = sendSeqId_;
+  sendSeqId_ = ResponseChannel::ONEWAY_REQUEST_ID;
+  for (auto& oneway : batch) {
+    sendMessage(oneway.callback, std::move(oneway.buf), oneway.header.get());
+  }
+  sendSeqId_ = oldSeqId;
+}
+
+void HeaderClientChannel::failOnewayBatch(folly::exception_wrapper ex) {
+  DestructorGuard dg(this);
+  if (onewayBatchTimeout_) {
+    onewayBatchTimeout_->cancelTimeout();
+  }
+  auto batch = std::move(onewayBatch_);
+  onewayBatch_.clear();
+  onewayBatchBytes_ = 0;
+  for (auto& oneway : batch) {
+    if (oneway.callback) {
+      oneway.callback->messageSendError(folly::exception_wrapper(ex));
+    }
+  }
+}
+
 void HeaderClientChannel::setCloseCallback(CloseCallback* cb) {
   closeCallback_ = cb;
   setBaseReceivedCallback();
@@ -164,6 +252,9 @@ uint32_t HeaderClientChannel::sendRequest(
 
   DestructorGuard dg(this);
 
+  // Keep the requests in order on the connection.
+  flushOnewayBatch();
+
   // Oneway requests use a special sequence id.
   // Make sure this non-oneway request doesn't use
   // the oneway request ID.
@@ -303,6 +394,9 @@ void HeaderClientChannel::messageReceiveErrorWrapped(
     folly::exception_wrapper&& ex) {
   DestructorGuard dg(this);
 
+  if (!onewayBatch_.empty()) {
+    failOnewayBatch(ex);
+  }
   while (!recvCallbacks_.empty()) {
     auto cb = recvCallbacks_.begin()->second;
     recvCallbacks_.erase(recvCallbacks_.begin());
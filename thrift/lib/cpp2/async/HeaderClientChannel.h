@@ -17,11 +17,15 @@
 #ifndef THRIFT_ASYNC_THEADERCLIENTCHANNEL_H_
 #define THRIFT_ASYNC_THEADERCLIENTCHANNEL_H_ 1
 
+#include <chrono>
 #include <deque>
 #include <limits>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
+#include <folly/Optional.h>
+#include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/DelayedDestruction.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/Request.h>
@@ -134,6 +138,31 @@ class HeaderClientChannel : public ClientChannel,
     return keepRegisteredForClose_;
   }
 
+  struct OnewayBatchingOptions {
+    // A batch is written once it holds this many messages, or this many
+    // bytes of (unframed) payload, or once its first message has waited
+    // for maxDelay.
+    size_t maxMessages{64};
+    size_t maxBytes{64 * 1024};
+    std::chrono::microseconds maxDelay{1000};
+  };
+
+  /**
+   * Hold oneway requests back, and write them to the socket together (in
+   * a single vectored write) according to the options. folly::none, the
+   * default, sends each oneway request on its own.
+   *
+   * Enabling batching also coalesces all writes once per loop, as with
+   * Cpp2Channel::setQueueSends(), from then on. A twoway request first
+   * flushes the pending batch, so requests keep their order on the
+   * connection. destroy() writes the oneway requests still pending before
+   * closing the connection; closeNow() and connection errors fail them.
+   */
+  void setOnewayBatching(folly::Optional<OnewayBatchingOptions> options);
+
+  // Write the pending oneway requests now.
+  void flushOnewayBatch();
+
   folly::EventBase* getEventBase() const override {
     return cpp2Channel_->getEventBase();
   }
@@ -193,6 +222,12 @@ class HeaderClientChannel : public ClientChannel,
  private:
   void setRequestHeaderOptions(apache::thrift::transport::THeader* header);
 
+  void batchOnewayRequest(
+      OnewayCallback* callback,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header);
+  void failOnewayBatch(folly::exception_wrapper ex);
+
   std::shared_ptr<apache::thrift::util::THttpClientParser> httpClientParser_;
 
   // Set the base class callback based on current state.
@@ -213,6 +248,16 @@ class HeaderClientChannel : public ClientChannel,
 
   uint16_t protocolId_;
   uint16_t userProtocolId_;
+
+  struct BatchedOneway {
+    OnewayCallback* callback;
+    std::unique_ptr<folly::IOBuf> buf;
+    std::shared_ptr<apache::thrift::transport::THeader> header;
+  };
+  folly::Optional<OnewayBatchingOptions> onewayBatching_;
+  std::vector<BatchedOneway> onewayBatch_;
+  size_t onewayBatchBytes_{0};
+  std::unique_ptr<folly::AsyncTimeout> onewayBatchTimeout_;
 };
 
 } // namespace thrift
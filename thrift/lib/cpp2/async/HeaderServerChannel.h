@@ -209,6 +209,20 @@ class HeaderServerChannel : public ServerChannel,
     cpp2Channel_->closeNow();
   }
 
+  // Used to move an idle connection to another IO thread. The callback
+  // should be unset before detaching and set again after attaching.
+  void attachEventBase(folly::EventBase* eventBase) {
+    cpp2Channel_->attachEventBase(eventBase);
+  }
+
+  void detachEventBase() {
+    cpp2Channel_->detachEventBase();
+  }
+
+  bool isDetachable() {
+    return cpp2Channel_->isDetachable();
+  }
+
   class ServerFramingHandler : public FramingHandler {
    public:
     explicit ServerFramingHandler(HeaderServerChannel& channel)
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/async/InProcessClient.h>
+
+#include <glog/logging.h>
+
+namespace apache {
+namespace thrift {
+
+InProcessClientBase::InProcessClientBase(
+    std::shared_ptr<ServerInterface> handler,
+    std::shared_ptr<concurrency::ThreadManager> threadManager,
+    const server::ServerConfigs& serverConfigs)
+    : state_(std::make_shared<detail::InProcessClientState>(
+          std::move(handler),
+          std::move(threadManager))),
+      serverConfigs_(serverConfigs) {
+  CHECK(state_->handler);
+  CHECK(state_->threadManager);
+}
+
+std::shared_ptr<detail::InProcessRequest> InProcessClientBase::newRequest(
+    const RpcOptions& rpcOptions) {
+  auto request = std::make_shared<detail::InProcessRequest>(state_);
+  request->observer = serverConfigs_.getObserver();
+  if (rpcOptions.getPriority() != concurrency::N_PRIORITIES) {
+    request->header.setCallPriority(rpcOptions.getPriority());
+  }
+  request->header.setClientTimeout(rpcOptions.getTimeout());
+  request->header.setClientQueueTimeout(rpcOptions.getQueueTimeout());
+
+  // The same timeouts Cpp2Connection schedules for a request off the wire,
+  // oneway or not.
+  std::chrono::milliseconds queueTimeout;
+  std::chrono::milliseconds taskTimeout;
+  auto differentTimeouts = serverConfigs_.getTaskExpireTimeForRequest(
+      rpcOptions.getQueueTimeout(),
+      rpcOptions.getTimeout(),
+      queueTimeout,
+      taskTimeout);
+  auto now = std::chrono::steady_clock::now();
+  if (differentTimeouts && queueTimeout > std::chrono::milliseconds(0)) {
+    request->queueDeadline = now + queueTimeout;
+  }
+  if (taskTimeout > std::chrono::milliseconds(0)) {
+    request->taskDeadline = now + taskTimeout;
+  }
+  request->context.setRequestTimeout(taskTimeout);
+  return request;
+}
+
+namespace detail {
+
+folly::exception_wrapper InProcessRequest::start() {
+  using Clock = std::chrono::steady_clock;
+  auto now = Clock::now();
+  if (queueDeadline != Clock::time_point() && now >= queueDeadline) {
+    if (observer) {
+      observer->queueTimeout();
+    }
+    return folly::make_exception_wrapper<TApplicationException>(
+        TApplicationException::TApplicationExceptionType::TIMEOUT,
+        "Queue Timeout");
+  }
+  if (taskDeadline != Clock::time_point() && now >= taskDeadline) {
+    if (observer) {
+      observer->taskTimeout();
+    }
+    return folly::make_exception_wrapper<TApplicationException>(
+        TApplicationException::TApplicationExceptionType::TIMEOUT,
+        "Task expired");
+  }
+
+  context.setStartedProcessing();
+  client->handler->setThreadManager(client->threadManager.get());
+  client->handler->setConnectionContext(&context);
+  return folly::exception_wrapper();
+}
+
+} // namespace detail
+
+bool InProcessClientBase::enqueue(
+    detail::InProcessRequest& request,
+    concurrency::PRIORITY priority,
+    folly::Function<void()> task) {
+  auto pri = state_->handler->getRequestPriority(&request.context, priority);
+  try {
+    state_->threadManager->add(
+        std::make_shared<PriorityEventTask>(
+            pri, std::move(task), nullptr, nullptr, true),
+        0, // timeout
+        0, // expiration
+        true, // cancellable
+        true); // numa
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+folly::exception_wrapper InProcessClientBase::overloaded() {
+  if (const auto& observer = serverConfigs_.getObserver()) {
+    observer->serverOverloaded();
+  }
+  return folly::make_exception_wrapper<TApplicationException>(
+      TApplicationException::TApplicationExceptionType::LOADSHEDDING,
+      "Failed to add task to queue, too full");
+}
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/Function.h>
+#include <folly/futures/Future.h>
+#include <thrift/lib/cpp/TApplicationException.h>
+#include <thrift/lib/cpp/concurrency/ThreadManager.h>
+#include <thrift/lib/cpp/server/TServerObserver.h>
+#include <thrift/lib/cpp/transport/THeader.h>
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/async/AsyncProcessor.h>
+#include <thrift/lib/cpp2/async/RequestChannel.h>
+#include <thrift/lib/cpp2/server/Cpp2ConnContext.h>
+#include <thrift/lib/cpp2/server/ServerConfigs.h>
+
+namespace apache {
+namespace thrift {
+
+namespace detail {
+
+// What the calls of one InProcessClientBase share. Queued calls keep it
+// alive, so the client may be destroyed before they run.
+struct InProcessClientState {
+  InProcessClientState(
+      std::shared_ptr<ServerInterface> handler,
+      std::shared_ptr<concurrency::ThreadManager> threadManager)
+      : handler(std::move(handler)), threadManager(std::move(threadManager)) {}
+
+  std::shared_ptr<ServerInterface> handler;
+  std::shared_ptr<concurrency::ThreadManager> threadManager;
+  Cpp2ConnContext connContext;
+};
+
+// The state of one in-process call, kept alive until its handler is done.
+struct InProcessRequest {
+  explicit InProcessRequest(std::shared_ptr<InProcessClientState> client)
+      : client(std::move(client)),
+        context(&this->client->connContext, &header) {}
+
+  // Prepares the handler for the request, on the thread manager. Returns
+  // the timeout to fail the request with if it expired in the queue.
+  folly::exception_wrapper start();
+
+  std::shared_ptr<InProcessClientState> client;
+  std::shared_ptr<server::TServerObserver> observer;
+  transport::THeader header;
+  Cpp2RequestContext context;
+  std::chrono::steady_clock::time_point queueDeadline;
+  std::chrono::steady_clock::time_point taskDeadline;
+};
+
+} // namespace detail
+
+/**
+ * Base class of the generated <Service>InProcessClient classes, which call
+ * the handler of a service in the same process without serializing the
+ * arguments or the result. The generator emits them with the
+ * "inprocess_client" option.
+ *
+ * Calls still go through the thread manager with the priority the server
+ * would use, and the server's queue and task timeouts apply to them. They
+ * reach the handler through its future_ methods, so handlers which only
+ * override the async_tm_ / async_eb_ forms are not supported. The returned
+ * futures complete on the thread which completed the handler's future.
+ *
+ * There is no IO thread, so getEventBase() returns null in the handler.
+ *
+ * Calls which are still queued when the client is destroyed run as usual:
+ * they keep the handler and the thread manager alive. The server configs
+ * are only read on the calling thread, so they need to outlive the client,
+ * but not its calls.
+ */
+class InProcessClientBase {
+ public:
+  InProcessClientBase(
+      std::shared_ptr<ServerInterface> handler,
+      std::shared_ptr<concurrency::ThreadManager> threadManager,
+      const server::ServerConfigs& serverConfigs);
+
+  virtual ~InProcessClientBase() = default;
+
+  InProcessClientBase(const InProcessClientBase&) = delete;
+  InProcessClientBase& operator=(const InProcessClientBase&) = delete;
+
+ protected:
+  // Runs "func", which calls a future_ method of the handler, on the thread
+  // manager, and returns its result.
+  template <typename T, typename F>
+  folly::Future<T> call(
+      const RpcOptions& rpcOptions,
+      concurrency::PRIORITY priority,
+      F&& func);
+
+  // Like call(), for oneway methods: the future completes once the request
+  // is queued, and the handler's result is dropped.
+  template <typename F>
+  folly::Future<folly::Unit> callOneway(
+      const RpcOptions& rpcOptions,
+      concurrency::PRIORITY priority,
+      F&& func);
+
+ private:
+  std::shared_ptr<detail::InProcessRequest> newRequest(
+      const RpcOptions& rpcOptions);
+
+  // Adds "task" to the thread manager with the priority the handler picks.
+  // Returns false if the thread manager doesn't take it.
+  bool enqueue(
+      detail::InProcessRequest& request,
+      concurrency::PRIORITY priority,
+      folly::Function<void()> task);
+
+  folly::exception_wrapper overloaded();
+
+  std::shared_ptr<detail::InProcessClientState> state_;
+  const server::ServerConfigs& serverConfigs_;
+};
+
+template <typename T, typename F>
+folly::Future<T> InProcessClientBase::call(
+    const RpcOptions& rpcOptions,
+    concurrency::PRIORITY priority,
+    F&& func) {
+  auto request = newRequest(rpcOptions);
+  folly::Promise<T> promise;
+  auto future = promise.getFuture();
+  auto task = [request,
+               promise = std::move(promise),
+               func = std::forward<F>(func)]() mutable {
+    if (auto ex = request->start()) {
+      promise.setException(std::move(ex));
+      return;
+    }
+    auto result = folly::makeFutureWith(std::move(func));
+    if (request->taskDeadline != std::chrono::steady_clock::time_point()) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          request->taskDeadline - std::chrono::steady_clock::now());
+      result = std::move(result).within(
+          std::max(remaining, std::chrono::milliseconds(1)),
+          TApplicationException(
+              TApplicationException::TApplicationExceptionType::TIMEOUT,
+              "Task expired"));
+    }
+    std::move(result).thenTry(
+        [request, promise = std::move(promise)](folly::Try<T>&& t) mutable {
+          promise.setTry(std::move(t));
+        });
+  };
+  if (!enqueue(*request, priority, std::move(task))) {
+    return folly::makeFuture<T>(overloaded());
+  }
+  if (rpcOptions.getTimeout() > std::chrono::milliseconds(0)) {
+    return std::move(future).within(
+        rpcOptions.getTimeout(),
+        transport::TTransportException(
+            transport::TTransportException::TIMED_OUT, "Timed Out"));
+  }
+  return future;
+}
+
+template <typename F>
+folly::Future<folly::Unit> InProcessClientBase::callOneway(
+    const RpcOptions& rpcOptions,
+    concurrency::PRIORITY priority,
+    F&& func) {
+  auto request = newRequest(rpcOptions);
+  auto task = [request, func = std::forward<F>(func)]() mutable {
+    if (request->start()) {
+      // Expired in the queue; there is no one to tell.
+      return;
+    }
+    folly::makeFutureWith(std::move(func))
+        .thenTry([request](folly::Try<folly::Unit>&&) {});
+  };
+  if (!enqueue(*request, priority, std::move(task))) {
+    return folly::makeFuture<folly::Unit>(overloaded());
+  }
+  return folly::makeFuture();
+}
+
+} // namespace thrift
+} // namespace apache
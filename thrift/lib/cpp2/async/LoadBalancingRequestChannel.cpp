@@ -0,0 +1,347 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <thrift/lib/cpp2/async/LoadBalancingRequestChannel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <folly/Optional.h>
+#include <folly/Random.h>
+#include <folly/io/async/AsyncSocketException.h>
+
+namespace apache {
+namespace thrift {
+
+struct LoadBalancingRequestChannel::Connection {
+  explicit Connection(size_t destination_) : destination(destination_) {}
+
+  const size_t destination;
+  ImplPtr impl;
+  Clock::time_point connected;
+  size_t outstanding{0};
+  uint64_t requests{0};
+  // In nanoseconds, starting from the first sample.
+  folly::Optional<Ewma<Clock>> latency;
+  Clock::time_point lastSample;
+  // Transport exceptions since the last response, and until when the
+  // connection is not re-created after the last one.
+  uint32_t failures{0};
+  Clock::time_point retryAfter;
+};
+
+class LoadBalancingRequestChannel::RequestCallback
+    : public apache::thrift::RequestCallback {
+ public:
+  RequestCallback(
+      LoadBalancingRequestChannel& channel,
+      std::shared_ptr<Connection> conn,
+      bool oneway,
+      std::unique_ptr<apache::thrift::RequestCallback> cob)
+      : guard_(&channel),
+        channel_(channel),
+        conn_(std::move(conn)),
+        impl_(conn_->impl),
+        oneway_(oneway),
+        start_(Clock::now()),
+        cob_(std::move(cob)) {}
+
+  void requestSent() override {
+    if (oneway_ && !done_) {
+      done();
+    }
+    if (cob_) {
+      cob_->requestSent();
+    }
+  }
+
+  void replyReceived(apache::thrift::ClientReceiveState&& state) override {
+    handleResponse(state);
+    if (cob_) {
+      cob_->replyReceived(std::move(state));
+    }
+  }
+
+  void requestError(apache::thrift::ClientReceiveState&& state) override {
+    handleResponse(state);
+    if (cob_) {
+      cob_->requestError(std::move(state));
+    }
+  }
+
+ private:
+  void handleResponse(apache::thrift::ClientReceiveState& state) {
+    if (done_) {
+      return;
+    }
+    done();
+    if (state.isException() &&
+        state.exception()
+            .is_compatible_with<
+                apache::thrift::transport::TTransportException>()) {
+      channel_.onTransportError(*conn_, impl_);
+      return;
+    }
+    conn_->failures = 0;
+    if (!oneway_) {
+      channel_.onResponse(*conn_, Clock::now() - start_);
+    }
+  }
+
+  void done() {
+    DCHECK(!done_);
+    done_ = true;
+    --conn_->outstanding;
+  }
+
+  // Keeps the channel alive until the last response is counted.
+  folly::DelayedDestruction::DestructorGuard guard_;
+  LoadBalancingRequestChannel& channel_;
+  std::shared_ptr<Connection> conn_;
+  ImplPtr impl_;
+  const bool oneway_;
+  bool done_{false};
+  const Clock::time_point start_;
+  std::unique_ptr<apache::thrift::RequestCallback> cob_;
+};
+
+LoadBalancingRequestChannel::LoadBalancingRequestChannel(
+    folly::EventBase& evb,
+    ImplCreator implCreator,
+    Options options)
+    : implCreator_(std::move(implCreator)),
+      options_(std::move(options)),
+      evb_(evb) {
+  CHECK_GT(options_.numDestinations, 0);
+  CHECK_GT(options_.connectionsPerDestination, 0);
+  // Interleave the destinations, so that round-robin and ties alternate
+  // between them.
+  for (size_t i = 0; i < options_.connectionsPerDestination; ++i) {
+    for (size_t d = 0; d < options_.numDestinations; ++d) {
+      connections_.push_back(std::make_shared<Connection>(d));
+    }
+  }
+}
+
+uint32_t LoadBalancingRequestChannel::sendRequest(
+    apache::thrift::RpcOptions& options,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    std::unique_ptr<apache::thrift::ContextStack> ctx,
+    std::unique_ptr<folly::IOBuf> buf,
+    std::shared_ptr<apache::thrift::transport::THeader> header) {
+  return send(false, std::move(cob), [&](Impl& impl, auto wrapped) {
+    return impl.sendRequest(
+        options,
+        std::move(wrapped),
+        std::move(ctx),
+        std::move(buf),
+        std::move(header));
+  });
+}
+
+uint32_t LoadBalancingRequestChannel::sendOnewayRequest(
+    apache::thrift::RpcOptions& options,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    std::unique_ptr<apache::thrift::ContextStack> ctx,
+    std::unique_ptr<folly::IOBuf> buf,
+    std::shared_ptr<apache::thrift::transport::THeader> header) {
+  return send(true, std::move(cob), [&](Impl& impl, auto wrapped) {
+    return impl.sendOnewayRequest(
+        options,
+        std::move(wrapped),
+        std::move(ctx),
+        std::move(buf),
+        std::move(header));
+  });
+}
+
+uint32_t LoadBalancingRequestChannel::sendStreamRequest(
+    apache::thrift::RpcOptions& options,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    std::unique_ptr<apache::thrift::ContextStack> ctx,
+    std::unique_ptr<folly::IOBuf> buf,
+    std::shared_ptr<apache::thrift::transport::THeader> header) {
+  return send(false, std::move(cob), [&](Impl& impl, auto wrapped) {
+    return impl.sendStreamRequest(
+        options,
+        std::move(wrapped),
+        std::move(ctx),
+        std::move(buf),
+        std::move(header));
+  });
+}
+
+template <typename Send>
+uint32_t LoadBalancingRequestChannel::send(
+    bool oneway,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    Send&& sendFn) {
+  DCHECK(evb_.isInEventBaseThread());
+  auto& conn = pick();
+  auto& channel = impl(*conn);
+  ++conn->outstanding;
+  ++conn->requests;
+  return sendFn(
+      channel,
+      std::unique_ptr<apache::thrift::RequestCallback>(
+          std::make_unique<RequestCallback>(
+              *this, conn, oneway, std::move(cob))));
+}
+
+uint16_t LoadBalancingRequestChannel::getProtocolId() {
+  return impl(*connections_.front()).getProtocolId();
+}
+
+std::vector<uint64_t> LoadBalancingRequestChannel::getRequestCounts() const {
+  std::vector<uint64_t> counts(options_.numDestinations);
+  for (const auto& conn : connections_) {
+    counts[conn->destination] += conn->requests;
+  }
+  return counts;
+}
+
+const std::shared_ptr<LoadBalancingRequestChannel::Connection>&
+LoadBalancingRequestChannel::pick() {
+  auto size = connections_.size();
+  if (options_.policy == Policy::ROUND_ROBIN || size == 1) {
+    return connections_[nextRoundRobin_++ % size];
+  }
+
+  auto now = Clock::now();
+  if (options_.policy == Policy::POWER_OF_TWO_EWMA) {
+    double fastest = std::numeric_limits<double>::infinity();
+    for (const auto& conn : connections_) {
+      if (conn->latency) {
+        fastest = std::min(fastest, conn->latency->estimate());
+      }
+    }
+    if (std::isinf(fastest)) {
+      fastest = 1;
+    }
+
+    auto a = folly::Random::rand32(size);
+    auto b = folly::Random::rand32(size - 1);
+    if (b >= a) {
+      ++b;
+    }
+    return cost(*connections_[a], now, fastest) <=
+            cost(*connections_[b], now, fastest)
+        ? connections_[a]
+        : connections_[b];
+  }
+
+  // Start where the last scan left off, so that ties are spread evenly.
+  auto start = nextRoundRobin_++ % size;
+  auto best = start;
+  auto bestCost = cost(*connections_[start], now, 0);
+  for (size_t i = 1; i < size; ++i) {
+    auto idx = (start + i) % size;
+    auto c = cost(*connections_[idx], now, 0);
+    if (c < bestCost) {
+      best = idx;
+      bestCost = c;
+    }
+  }
+  return connections_[best];
+}
+
+double LoadBalancingRequestChannel::cost(
+    const Connection& conn,
+    Clock::time_point now,
+    double fastest) const {
+  double load = conn.outstanding + 1;
+
+  if (!conn.impl && now < conn.retryAfter) {
+    // Backing off after a transport exception.
+    return std::numeric_limits<double>::infinity();
+  }
+
+  if (options_.warmup.count() > 0) {
+    // A connection that is yet to be (re)created starts warming up with it.
+    double weight = 0;
+    if (conn.impl) {
+      std::chrono::duration<double> elapsed = now - conn.connected;
+      weight = elapsed / options_.warmup;
+    }
+    if (weight < 1) {
+      load /= std::max(weight, options_.minWarmupWeight);
+    }
+  }
+
+  if (options_.policy != Policy::POWER_OF_TWO_EWMA) {
+    return load;
+  }
+
+  // A connection without samples gets a probe request first, and is then
+  // assumed to be as fast as the fastest one. The estimate of an idle
+  // connection drifts towards the fastest one, so that a destination which
+  // was slow gets probed again.
+  double latency = conn.outstanding == 0 ? 0 : fastest;
+  if (conn.latency) {
+    double idle = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      now - conn.lastSample)
+                      .count();
+    double w = std::exp(-idle / conn.latency->getWindowNs());
+    latency = conn.latency->estimate() * w + fastest * (1 - w);
+  }
+  return latency * load;
+}
+
+LoadBalancingRequestChannel::Impl& LoadBalancingRequestChannel::impl(
+    Connection& conn) {
+  if (!conn.impl) {
+    conn.impl = implCreator_(evb_, conn.destination);
+    conn.connected = Clock::now();
+  }
+
+  return *conn.impl;
+}
+
+void LoadBalancingRequestChannel::onResponse(
+    Connection& conn,
+    Clock::duration latency) {
+  double ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+  if (conn.latency) {
+    conn.latency->add(ns);
+  } else {
+    conn.latency.emplace(options_.latencyWindow, ns);
+  }
+  conn.lastSample = Clock::now();
+}
+
+void LoadBalancingRequestChannel::onTransportError(
+    Connection& conn,
+    const ImplPtr& impl) {
+  // Only the first error of a connection counts; reconnect on the next
+  // request to it, unless that already happened.
+  if (conn.impl != impl) {
+    return;
+  }
+  conn.impl.reset();
+
+  // A destination that fails fast has no outstanding requests and no
+  // latency samples, which would make it the first choice of every policy.
+  // Back off before using it again, and count the error as a slow response.
+  auto backoff =
+      options_.reconnectBackoff * (1 << std::min(conn.failures, 16u));
+  conn.retryAfter =
+      Clock::now() + std::min(backoff, options_.maxReconnectBackoff);
+  ++conn.failures;
+  onResponse(conn, options_.errorPenalty);
+}
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <thrift/lib/cpp2/async/RequestChannel.h>
+#include <thrift/lib/cpp2/util/Ewma.h>
+
+namespace apache {
+namespace thrift {
+
+// RequestChannel wrapper that keeps several connections to each of one or
+// more destinations, all on the same EventBase, and sends every request on
+// the least loaded one. Connections are created lazily and re-created after a
+// transport exception and a backoff; a new connection takes a growing share
+// of the load during its warm-up period.
+//
+// Use from the EventBase thread only. To spread the connections over several
+// IO threads, create one per EventBase with PooledRequestChannel.
+class LoadBalancingRequestChannel : public apache::thrift::RequestChannel {
+ public:
+  using Impl = apache::thrift::RequestChannel;
+  using ImplPtr = std::shared_ptr<Impl>;
+  // Creates a connection to the destination with the given index.
+  using ImplCreator =
+      folly::Function<ImplPtr(folly::EventBase&, size_t destination)>;
+  using Clock = std::chrono::steady_clock;
+
+  enum class Policy {
+    // Cycle through the connections, ignoring their load. For comparison.
+    ROUND_ROBIN,
+    // The connection with the fewest outstanding requests.
+    LEAST_OUTSTANDING,
+    // The cheaper of two random connections, where the cost is the EWMA of
+    // the latency times the outstanding requests plus one.
+    POWER_OF_TWO_EWMA,
+  };
+
+  struct Options {
+    size_t numDestinations{1};
+    size_t connectionsPerDestination{4};
+    Policy policy{Policy::LEAST_OUTSTANDING};
+    // Window of the latency EWMA. An idle connection's estimate decays over
+    // the same window, so that a destination which was slow is tried again.
+    std::chrono::milliseconds latencyWindow{1000};
+    // A new connection counts as (elapsed / warmup) of a connection when
+    // comparing loads, but at least minWarmupWeight.
+    std::chrono::milliseconds warmup{0};
+    double minWarmupWeight{0.1};
+    // After a transport exception a connection is not picked (except by
+    // ROUND_ROBIN, or when all of them are backing off) for
+    // reconnectBackoff, doubling with each consecutive exception up to
+    // maxReconnectBackoff. The exception also counts as a response that
+    // took errorPenalty.
+    std::chrono::milliseconds reconnectBackoff{100};
+    std::chrono::milliseconds maxReconnectBackoff{5000};
+    std::chrono::milliseconds errorPenalty{1000};
+  };
+
+  using UniquePtr = std::unique_ptr<
+      LoadBalancingRequestChannel,
+      folly::DelayedDestruction::Destructor>;
+
+  static UniquePtr
+  newChannel(folly::EventBase& evb, ImplCreator implCreator, Options options) {
+    return {new LoadBalancingRequestChannel(
+                evb, std::move(implCreator), std::move(options)),
+            {}};
+  }
+
+  uint32_t sendRequest(
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) override;
+
+  uint32_t sendOnewayRequest(
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) override;
+
+  uint32_t sendStreamRequest(
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) override;
+
+  void setCloseCallback(apache::thrift::CloseCallback*) override {
+    LOG(FATAL) << "Not supported";
+  }
+
+  folly::EventBase* getEventBase() const override {
+    return &evb_;
+  }
+
+  uint16_t getProtocolId() override;
+
+  // Number of requests sent to each destination so far.
+  std::vector<uint64_t> getRequestCounts() const;
+
+ protected:
+  ~LoadBalancingRequestChannel() override = default;
+
+ private:
+  LoadBalancingRequestChannel(
+      folly::EventBase& evb,
+      ImplCreator implCreator,
+      Options options);
+
+  struct Connection;
+  class RequestCallback;
+
+  template <typename Send>
+  uint32_t send(
+      bool oneway,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      Send&& sendFn);
+
+  const std::shared_ptr<Connection>& pick();
+  double cost(const Connection& conn, Clock::time_point now, double fastest)
+      const;
+  Impl& impl(Connection& conn);
+  void onResponse(Connection& conn, Clock::duration latency);
+  void onTransportError(Connection& conn, const ImplPtr& impl);
+
+  ImplCreator implCreator_;
+  const Options options_;
+  folly::EventBase& evb_;
+  std::vector<std::shared_ptr<Connection>> connections_;
+  size_t nextRoundRobin_{0};
+};
+} // namespace thrift
+} // namespace apache
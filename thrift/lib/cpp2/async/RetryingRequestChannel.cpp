@@ -15,6 +15,9 @@
  */
 #include <thrift/lib/cpp2/async/RetryingRequestChannel.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include <folly/io/async/AsyncSocketException.h>
 
 namespace apache {
@@ -102,16 +105,242 @@ class RetryingRequestChannel::RequestCallback
   std::shared_ptr<apache::thrift::transport::THeader> header_;
 };
 
+// State shared by the primary and the backup attempt of a hedged request.
+// Whichever attempt succeeds first completes the request; the reply of the
+// other one is dropped, as the Header protocol can't cancel a request.
+class RetryingRequestChannel::HedgedRequest
+    : public std::enable_shared_from_this<HedgedRequest> {
+ public:
+  HedgedRequest(
+      RetryingRequestChannel& channel,
+      apache::thrift::RpcOptions options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      const std::shared_ptr<apache::thrift::transport::THeader>& header)
+      : guard_(&channel),
+        channel_(channel),
+        options_(options),
+        cob_(std::move(cob)),
+        ctx_(std::move(ctx)),
+        method_(ctx_->getMethod()),
+        buf_(std::move(buf)) {
+    // The primary attempt may consume the header, so keep what a new one
+    // needs for the backup.
+    if (header) {
+      protocolId_ = header->getProtocolId();
+      writeHeaders_ = header->getWriteHeaders();
+      transforms_ = header->getWriteTransforms();
+    }
+  }
+
+  uint32_t start(
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) {
+    auto threshold = channel_.latencies_[method_].percentile(
+        channel_.hedging_->percentile, channel_.hedging_->minSamples);
+    if (threshold) {
+      auto delay = std::max(
+          std::chrono::milliseconds(1),
+          std::chrono::ceil<std::chrono::milliseconds>(*threshold));
+      std::weak_ptr<HedgedRequest> weak = shared_from_this();
+      channel_.evb_.runAfterDelay(
+          [weak] {
+            if (auto self = weak.lock()) {
+              self->hedge();
+            }
+          },
+          delay.count());
+    }
+    return send(
+        channel_.impl_,
+        true,
+        options,
+        std::move(buf),
+        std::move(header));
+  }
+
+  void requestSent(bool primary) {
+    if (primary && cob_) {
+      cob_->requestSent();
+    }
+  }
+
+  void replyReceived(
+      apache::thrift::ClientReceiveState&& state,
+      std::chrono::steady_clock::duration latency) {
+    --pending_;
+    if (!state.isException()) {
+      channel_.latencies_[method_].add(
+          std::chrono::duration_cast<std::chrono::microseconds>(latency),
+          channel_.hedging_->windowSize);
+    }
+    if (done_) {
+      return;
+    }
+    done_ = true;
+    cob_->replyReceived(std::move(state));
+  }
+
+  void requestError(apache::thrift::ClientReceiveState&& state) {
+    --pending_;
+    // Wait for the other attempt, unless there is none.
+    if (done_ || pending_ > 0) {
+      return;
+    }
+    done_ = true;
+    cob_->requestError(std::move(state));
+  }
+
+ private:
+  class AttemptCallback;
+
+  void hedge() {
+    if (done_ || channel_.hedgeBudget_ < 1) {
+      return;
+    }
+    channel_.hedgeBudget_ -= 1;
+    ++channel_.hedgeCount_;
+
+    auto header = std::make_shared<apache::thrift::transport::THeader>(
+        apache::thrift::transport::THeader::ALLOW_BIG_FRAMES);
+    header->setProtocolId(protocolId_);
+    header->setHeaders(std::move(writeHeaders_));
+    header->setTransforms(transforms_);
+    send(
+        channel_.backup_,
+        false,
+        options_,
+        std::move(buf_),
+        std::move(header));
+  }
+
+  uint32_t send(
+      const ImplPtr& impl,
+      bool primary,
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header) {
+    ++pending_;
+    return channel_.sendAttempt(
+        impl,
+        options,
+        std::make_unique<AttemptCallback>(shared_from_this(), primary),
+        std::make_unique<apache::thrift::ContextStack>(method_.c_str()),
+        std::move(buf),
+        std::move(header));
+  }
+
+  // Keeps the channel alive until the last attempt completes.
+  folly::DelayedDestruction::DestructorGuard guard_;
+  RetryingRequestChannel& channel_;
+  apache::thrift::RpcOptions options_;
+  std::unique_ptr<apache::thrift::RequestCallback> cob_;
+  std::unique_ptr<apache::thrift::ContextStack> ctx_;
+  const std::string method_;
+  // For the backup attempt.
+  std::unique_ptr<folly::IOBuf> buf_;
+  uint16_t protocolId_{0};
+  apache::thrift::transport::THeader::StringToStringMap writeHeaders_;
+  std::vector<uint16_t> transforms_;
+  size_t pending_{0};
+  bool done_{false};
+};
+
+class RetryingRequestChannel::HedgedRequest::AttemptCallback
+    : public apache::thrift::RequestCallback {
+ public:
+  AttemptCallback(std::shared_ptr<HedgedRequest> request, bool primary)
+      : request_(std::move(request)),
+        primary_(primary),
+        start_(std::chrono::steady_clock::now()) {}
+
+  void requestSent() override {
+    request_->requestSent(primary_);
+  }
+
+  void replyReceived(apache::thrift::ClientReceiveState&& state) override {
+    request_->replyReceived(
+        std::move(state), std::chrono::steady_clock::now() - start_);
+  }
+
+  void requestError(apache::thrift::ClientReceiveState&& state) override {
+    request_->requestError(std::move(state));
+  }
+
+ private:
+  std::shared_ptr<HedgedRequest> request_;
+  const bool primary_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+void RetryingRequestChannel::LatencyWindow::add(
+    std::chrono::microseconds latency,
+    size_t windowSize) {
+  if (samples_.size() < windowSize) {
+    samples_.push_back(latency.count());
+  } else {
+    samples_[next_] = latency.count();
+    next_ = (next_ + 1) % samples_.size();
+  }
+  ++sinceCached_;
+}
+
+folly::Optional<std::chrono::microseconds>
+RetryingRequestChannel::LatencyWindow::percentile(
+    double percentile,
+    size_t minSamples) {
+  if (samples_.empty() || samples_.size() < minSamples) {
+    return folly::none;
+  }
+  if (!cached_ || sinceCached_ * 10 >= samples_.size()) {
+    auto sorted = samples_;
+    // The nearest-rank sample, with rank in [1, size].
+    auto rank = static_cast<size_t>(std::ceil(percentile * sorted.size()));
+    auto idx = std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    cached_ = std::chrono::microseconds(sorted[idx]);
+    sinceCached_ = 0;
+  }
+  return cached_;
+}
+
 uint32_t RetryingRequestChannel::sendRequest(
     apache::thrift::RpcOptions& options,
     std::unique_ptr<apache::thrift::RequestCallback> cob,
     std::unique_ptr<apache::thrift::ContextStack> ctx,
     std::unique_ptr<folly::IOBuf> buf,
     std::shared_ptr<apache::thrift::transport::THeader> header) {
+  if (!backup_ || !hedging_->methods.count(ctx->getMethod())) {
+    return sendAttempt(
+        impl_,
+        options,
+        std::move(cob),
+        std::move(ctx),
+        std::move(buf),
+        std::move(header));
+  }
+
+  DCHECK(evb_.isInEventBaseThread());
+  hedgeBudget_ =
+      std::min(hedgeBudget_ + hedging_->budget, hedging_->maxBurst);
+  auto request = std::make_shared<HedgedRequest>(
+      *this, options, std::move(cob), std::move(ctx), buf->clone(), header);
+  return request->start(options, std::move(buf), std::move(header));
+}
+
+uint32_t RetryingRequestChannel::sendAttempt(
+    const ImplPtr& impl,
+    apache::thrift::RpcOptions& options,
+    std::unique_ptr<apache::thrift::RequestCallback> cob,
+    std::unique_ptr<apache::thrift::ContextStack> ctx,
+    std::unique_ptr<folly::IOBuf> buf,
+    std::shared_ptr<apache::thrift::transport::THeader> header) {
   auto fakeCtx =
       std::make_unique<apache::thrift::ContextStack>(ctx->getMethod());
   cob = std::make_unique<RequestCallback>(
-      impl_,
+      impl,
       numRetries_,
       options,
       std::move(cob),
@@ -119,7 +348,7 @@ uint32_t RetryingRequestChannel::sendRequest(
       buf->clone(),
       header);
 
-  return impl_->sendRequest(
+  return impl->sendRequest(
       options,
       std::move(cob),
       std::move(fakeCtx),
@@ -15,7 +15,14 @@
  */
 #pragma once
 
+#include <chrono>
 #include <future>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/Optional.h>
 
 #include <thrift/lib/cpp2/async/RequestChannel.h>
 
@@ -24,6 +31,12 @@ namespace thrift {
 
 // Simple RequestChannel wrapper, which automatically retries requests if they
 // fail with a TTransportException.
+//
+// It can also hedge requests: if a request has not completed after a
+// percentile of the recent latency of its method, a backup request is sent
+// on a second channel and the first reply wins. The other reply is dropped
+// when it arrives. Only the methods listed in HedgingOptions are hedged,
+// which should be idempotent ones.
 class RetryingRequestChannel : public apache::thrift::RequestChannel {
  public:
   using Impl = apache::thrift::RequestChannel;
@@ -31,11 +44,42 @@ class RetryingRequestChannel : public apache::thrift::RequestChannel {
   using UniquePtr = std::
       unique_ptr<RetryingRequestChannel, folly::DelayedDestruction::Destructor>;
 
+  struct HedgingOptions {
+    // The methods to hedge, as "Service.method". Requests of any other
+    // method are only retried. None are hedged by default.
+    std::unordered_set<std::string> methods;
+    // Percentile of the recent latency of a method after which to hedge.
+    double percentile{0.95};
+    // Number of recent latencies kept per method, and how many are needed
+    // before its requests are hedged.
+    size_t windowSize{1000};
+    size_t minSamples{100};
+    // Hedges are capped at this fraction of the requests, in bursts of at
+    // most maxBurst hedges.
+    double budget{0.05};
+    double maxBurst{10};
+  };
+
   static UniquePtr
   newChannel(folly::EventBase& evb, int numRetries, ImplPtr impl) {
     return {new RetryingRequestChannel(evb, numRetries, std::move(impl)), {}};
   }
 
+  // backup may be the same channel as impl, but a connection to another
+  // replica avoids the slow one.
+  static UniquePtr newHedgingChannel(
+      folly::EventBase& evb,
+      int numRetries,
+      ImplPtr impl,
+      ImplPtr backup,
+      HedgingOptions options) {
+    UniquePtr channel(
+        new RetryingRequestChannel(evb, numRetries, std::move(impl)));
+    channel->backup_ = std::move(backup);
+    channel->hedging_ = std::move(options);
+    return channel;
+  }
+
   uint32_t sendRequest(
       apache::thrift::RpcOptions& options,
       std::unique_ptr<apache::thrift::RequestCallback> cob,
@@ -64,6 +108,11 @@ class RetryingRequestChannel : public apache::thrift::RequestChannel {
     return impl_->getProtocolId();
   }
 
+  // Number of backup requests sent so far.
+  uint64_t getHedgeCount() const {
+    return hedgeCount_;
+  }
+
  protected:
   ~RetryingRequestChannel() override = default;
 
@@ -71,10 +120,41 @@ class RetryingRequestChannel : public apache::thrift::RequestChannel {
       : impl_(std::move(impl)), numRetries_(numRetries), evb_(evb) {}
 
   class RequestCallback;
+  class HedgedRequest;
+
+  // The most recent latencies of a method.
+  class LatencyWindow {
+   public:
+    void add(std::chrono::microseconds latency, size_t windowSize);
+    folly::Optional<std::chrono::microseconds> percentile(
+        double percentile,
+        size_t minSamples);
+
+   private:
+    std::vector<int64_t> samples_;
+    size_t next_{0};
+    // Recomputed after a tenth of the window has been replaced.
+    folly::Optional<std::chrono::microseconds> cached_;
+    size_t sinceCached_{0};
+  };
+
+  uint32_t sendAttempt(
+      const ImplPtr& impl,
+      apache::thrift::RpcOptions& options,
+      std::unique_ptr<apache::thrift::RequestCallback> cob,
+      std::unique_ptr<apache::thrift::ContextStack> ctx,
+      std::unique_ptr<folly::IOBuf> buf,
+      std::shared_ptr<apache::thrift::transport::THeader> header);
 
   ImplPtr impl_;
   int numRetries_;
   folly::EventBase& evb_;
+
+  ImplPtr backup_;
+  folly::Optional<HedgingOptions> hedging_;
+  std::unordered_map<std::string, LatencyWindow> latencies_;
+  double hedgeBudget_{0};
+  uint64_t hedgeCount_{0};
 };
 } // namespace thrift
 } // namespace apache
@@ -339,6 +339,14 @@ ClientChannel::SaturationStatus RocketClientChannel::getSaturationStatus() {
       inflightState_->maxInflightRequests());
 }
 
+void RocketClientChannel::setWriteBatching(
+    folly::Optional<rocket::WriteBatchingOptions> options) {
+  DCHECK(!evb_ || evb_->isInEventBaseThread());
+  if (rclient_) {
+    rclient_->setWriteBatching(std::move(options));
+  }
+}
+
 void RocketClientChannel::closeNow() {
   DCHECK(!evb_ || evb_->isInEventBaseThread());
   if (rclient_) {
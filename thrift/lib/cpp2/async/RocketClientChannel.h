@@ -20,6 +20,7 @@
 #include <limits>
 #include <memory>
 
+#include <folly/Optional.h>
 #include <folly/fibers/FiberManagerMap.h>
 #include <folly/io/async/DelayedDestruction.h>
 
@@ -28,6 +29,7 @@
 
 #include "thrift/lib/cpp/async/TAsyncTransport.h"
 #include "thrift/lib/cpp2/async/ClientChannel.h"
+#include "thrift/lib/cpp2/transport/rocket/Types.h"
 #include "thrift/lib/thrift/gen-cpp2/RpcMetadata_types.h"
 
 namespace folly {
@@ -44,7 +46,6 @@ class RpcOptions;
 class ThriftClientCallback;
 
 namespace rocket {
-class Payload;
 class RocketClient;
 } // namespace rocket
 
@@ -111,6 +112,15 @@ class RocketClientChannel final : public ClientChannel {
     return THRIFT_HTTP_CLIENT_TYPE;
   }
 
+  /**
+   * Write the requests sent during one loop, e.g. a burst of oneway
+   * requests, to the socket together, within the limits of the options.
+   * folly::none, the default, writes each request on its own. This is the
+   * rocket counterpart of HeaderClientChannel::setOnewayBatching(); rocket
+   * already defers writes to the end of the loop, so there is no delay.
+   */
+  void setWriteBatching(folly::Optional<rocket::WriteBatchingOptions> options);
+
   void setMaxPendingRequests(uint32_t n) {
     inflightState_->setMaxInflightRequests(n);
   }
@@ -22,6 +22,7 @@
 #include <folly/io/async/EventBaseManager.h>
 #include <thrift/lib/cpp/async/TAsyncTransport.h>
 #include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/util/IOBufPool.h>
 #include <wangle/channel/Handler.h>
 
 namespace apache {
@@ -110,6 +111,8 @@ class TAsyncTransportHandler : public wangle::BytesToBytesHandler,
 
   void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
     const auto readBufferSettings = getContext()->getReadBufferSettings();
+    IOBufPool::reserve(
+        bufQueue_, readBufferSettings.first, readBufferSettings.second);
     const auto ret = bufQueue_.preallocate(
         readBufferSettings.first, readBufferSettings.second);
     *bufReturn = ret.first;
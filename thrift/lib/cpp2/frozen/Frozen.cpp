@@ -15,6 +15,14 @@
  */
 #include <thrift/lib/cpp2/frozen/Frozen.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+#include <folly/executors/GlobalExecutor.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 
@@ -97,6 +105,131 @@ void ByteRangeFreezer::doAppendBytes(
 
 namespace detail {
 
+namespace {
+
+// Chunks frozen concurrently are separated by a whole chunk, which must span
+// more than the 16 bytes a packed integer write may read and write back.
+constexpr size_t kMinChunkItems = 256;
+constexpr size_t kChunksPerThread = 8;
+
+/**
+ * Tasks shared by the calling thread and its helpers. A helper may start after
+ * the caller has returned; it then finds no task left, and only touches this
+ * state, which it keeps alive.
+ */
+struct TaskState {
+  TaskState(size_t count, const std::function<void(size_t)>& f)
+      : tasks(count), fn(&f) {}
+
+  // Claims and runs tasks until none are left.
+  void work() {
+    for (size_t task; (task = next.fetch_add(1)) < tasks;) {
+      try {
+        (*fn)(task);
+      } catch (const OutOfLineItem&) {
+        std::lock_guard<std::mutex> guard(lock);
+        outOfLine = true;
+        next = tasks;
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = tasks;
+      }
+    }
+  }
+
+  void help() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      ++helping;
+    }
+    work();
+    std::lock_guard<std::mutex> guard(lock);
+    if (--helping == 0) {
+      idle.notify_all();
+    }
+  }
+
+  const size_t tasks;
+  // Only called for a claimed task, i.e. while the caller waits.
+  const std::function<void(size_t)>* const fn;
+  std::atomic<size_t> next{0};
+
+  std::mutex lock;
+  std::condition_variable idle;
+  size_t helping{0};
+  bool outOfLine{false};
+  std::exception_ptr error;
+};
+
+/**
+ * Runs fn(task) for every task in [0, tasks) on the calling thread and on up
+ * to threads - 1 tasks added to the executor. Returns false if a task threw
+ * OutOfLineItem.
+ */
+bool runTasks(
+    const ParallelFreezeOptions& options,
+    size_t tasks,
+    const std::function<void(size_t)>& fn) {
+  auto state = std::make_shared<TaskState>(tasks, fn);
+  std::shared_ptr<folly::Executor> global;
+  auto* executor = options.executor;
+  if (!executor) {
+    global = folly::getCPUExecutor();
+    executor = global.get();
+  }
+  for (size_t i = 1; i < std::min(options.threads, tasks); ++i) {
+    executor->add([state] { state->help(); });
+  }
+  state->work();
+
+  // Every task is claimed; wait for the helpers still running one.
+  std::unique_lock<std::mutex> guard(state->lock);
+  state->idle.wait(guard, [&] { return state->helping == 0; });
+  if (state->outOfLine) {
+    // The serial fallback reports errors in item order.
+    return false;
+  }
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+  return true;
+}
+
+} // namespace
+
+size_t chunkCount(const ParallelFreezeOptions& options, size_t count) {
+  return std::max<size_t>(
+      1,
+      std::min(options.threads * kChunksPerThread, count / kMinChunkItems));
+}
+
+bool runChunks(
+    const ParallelFreezeOptions& options,
+    size_t count,
+    bool alternate,
+    const std::function<void(size_t, size_t, size_t)>& fn) {
+  size_t chunks = chunkCount(options, count);
+  auto runChunk = [&](size_t chunk) {
+    fn(chunk, count * chunk / chunks, count * (chunk + 1) / chunks);
+  };
+  if (!alternate) {
+    return runTasks(options, chunks, runChunk);
+  }
+  for (size_t parity = 0; parity < 2; ++parity) {
+    bool inlined =
+        runTasks(options, (chunks + 1 - parity) / 2, [&](size_t task) {
+          runChunk(task * 2 + parity);
+        });
+    if (!inlined) {
+      return false;
+    }
+  }
+  return true;
+}
+
 FieldPosition BlockLayout::maximize() {
   FieldPosition pos = startFieldPosition();
   FROZEN_MAXIMIZE_FIELD(mask);
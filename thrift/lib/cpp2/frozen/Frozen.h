@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <iosfwd>
 #include <iterator>
 #include <map>
@@ -30,6 +32,7 @@
 #include <vector>
 
 #include <folly/Demangle.h>
+#include <folly/Executor.h>
 #include <folly/MapUtil.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
@@ -38,7 +41,9 @@
 #include <folly/container/F14Set-fwd.h>
 #include <folly/experimental/Bits.h>
 #include <folly/hash/Hash.h>
+#include <folly/hash/SpookyHashV2.h>
 #include <folly/lang/Bits.h>
+#include <thrift/lib/cpp/DistinctTable.h>
 #include <thrift/lib/cpp2/frozen/FrozenMacros.h>
 #include <thrift/lib/cpp2/frozen/Traits.h>
 #include <thrift/lib/cpp2/frozen/schema/MemorySchema.h>
@@ -497,12 +502,123 @@ Layout<T> maximumLayout() {
   return layout;
 }
 
+/**
+ * Counts of what ParallelFreezeOptions did, summed over all layout passes.
+ */
+struct ParallelFreezeStats {
+  // Ranges whose items were laid out, or frozen, on several threads.
+  size_t parallelLayouts = 0;
+  size_t parallelFreezes = 0;
+  // Large ranges laid out or frozen serially after all, because an item had
+  // data outside of its slot.
+  size_t serialFallbacks = 0;
+};
+
+/**
+ * Options for laying out and freezing large ranges on several threads. The
+ * frozen bytes are identical to those of a serial freeze.
+ *
+ * Only ranges whose items are stored entirely in their slot (numbers,
+ * bools, enums, and structs and pairs of those) are laid out and frozen in
+ * parallel. Items with data of their own, such as non-empty strings and
+ * nested containers, are placed by a single sequential cursor, so those
+ * ranges fall back to the serial loops; hash tables of them still hash their
+ * keys in parallel.
+ */
+struct ParallelFreezeOptions {
+  // Number of threads to use, including the calling thread: each large range
+  // adds up to threads - 1 tasks to 'executor'. Freezing is serial if this
+  // is 0 or 1.
+  size_t threads = 0;
+  // Ranges with fewer items are laid out and frozen serially.
+  size_t minItems = size_t(1) << 16;
+  // Runs the helper tasks; folly::getCPUExecutor() if null. The calling
+  // thread works through the chunks too, so the freeze completes even if
+  // the executor never gets to them.
+  folly::Executor* executor = nullptr;
+  // If set, updated by the calling thread.
+  ParallelFreezeStats* stats = nullptr;
+};
+
+namespace detail {
+
+/**
+ * Thrown by the per-chunk roots when an item needs storage outside of its
+ * range slot. Such ranges are laid out and frozen serially, since the
+ * position of each item's data depends on all the items before it.
+ */
+struct OutOfLineItem {};
+
+/**
+ * Splits [0, count) into chunks and calls fn(chunk, begin, end) for each of
+ * them on the calling thread and up to options.threads - 1 executor tasks.
+ * With 'alternate', chunks of even and odd index run in two separate rounds,
+ * so that the bit-packed writes at the edge of a chunk never race with the
+ * neighbouring chunk. Returns false if an item threw OutOfLineItem; other
+ * exceptions are rethrown.
+ */
+bool runChunks(
+    const ParallelFreezeOptions& options,
+    size_t count,
+    bool alternate,
+    const std::function<void(size_t, size_t, size_t)>& fn);
+
+size_t chunkCount(const ParallelFreezeOptions& options, size_t count);
+
+inline bool parallelizes(const ParallelFreezeOptions& options, size_t count) {
+  return options.threads > 1 && count >= options.minItems;
+}
+
+template <class T>
+struct DistinctBytesPolicy : BaseDistinctTablePolicy<T> {
+  struct Hash {
+    size_t operator()(folly::ByteRange bytes) const {
+      return folly::hash::SpookyHashV2::Hash64(bytes.data(), bytes.size(), 0);
+    }
+  };
+};
+
+/**
+ * Remembers where each distinct byte range was placed, so that equal values
+ * can share a single copy. The ranges are not copied and must outlive this.
+ */
+template <class Position>
+class DistinctBytes {
+ public:
+  DistinctBytes() : table_(&values_) {}
+
+  /**
+   * Returns the position of an equal range placed before, or the position
+   * returned by place() if 'bytes' is new.
+   */
+  template <class Place>
+  Position place(folly::ByteRange bytes, Place&& place) {
+    size_t index = table_.add(bytes);
+    if (index == positions_.size()) {
+      positions_.push_back(place());
+    }
+    return positions_[index];
+  }
+
+ private:
+  std::vector<folly::ByteRange> values_;
+  std::vector<Position> positions_;
+  DistinctTable<folly::ByteRange, DistinctBytesPolicy> table_;
+};
+
+} // namespace detail
+
 /**
  * LayoutRoot calculates the layout necessary to store a given object,
  * recursively. The logic of layout should closely match that of freezing.
  */
 class LayoutRoot {
+ protected:
   LayoutRoot() {}
+  explicit LayoutRoot(const ParallelFreezeOptions& parallel)
+      : parallel_(parallel) {}
+
+ private:
   /**
    * Lays out a given object from the root, repeatedly running layout until a
    * fixed point is reached.
@@ -512,6 +628,7 @@ class LayoutRoot {
     for (resizes = 0; resizes < 1000; ++resizes) {
       resized_ = false;
       cursor_ = _layout.size;
+      distinct_.reset();
       auto after = _layout.layout(*this, root, {0, 0});
       resized_ = _layout.resize(after, false) || resized_;
       if (!resized_) {
@@ -542,6 +659,18 @@ class LayoutRoot {
     return LayoutRoot().doLayout(root, layout, resizes);
   }
 
+  /**
+   * As above, laying out large ranges on several threads.
+   */
+  template <class T>
+  static size_t layout(
+      const T& root,
+      Layout<T>& layout,
+      const ParallelFreezeOptions& parallel) {
+    size_t resizes;
+    return LayoutRoot(parallel).doLayout(root, layout, resizes);
+  }
+
   /**
    * Adjust 'layout' so it is sufficient for freezing root, providing upper
    * bound storage size estimate and indication of whether the layout changed.
@@ -631,11 +760,60 @@ class LayoutRoot {
     return worstCaseDistance;
   }
 
+  /**
+   * Like layoutBytesDistance(), but simulates appending each distinct byte
+   * range only once. The returned distance is negative if an equal range was
+   * placed before 'origin'.
+   */
+  int64_t layoutDistinctBytesDistance(size_t origin, folly::ByteRange bytes) {
+    if (!distinct_) {
+      distinct_ = std::make_unique<detail::DistinctBytes<size_t>>();
+    }
+    size_t start = distinct_->place(bytes, [&] {
+      return origin + layoutBytesDistance(origin, bytes.size(), 1);
+    });
+    return int64_t(start) - int64_t(origin);
+  }
+
+  const ParallelFreezeOptions& parallel() const {
+    return parallel_;
+  }
+
  protected:
   bool resized_;
   size_t cursor_;
+  ParallelFreezeOptions parallel_;
+  std::unique_ptr<detail::DistinctBytes<size_t>> distinct_;
 };
 
+namespace detail {
+
+/**
+ * Lays out the items of one chunk of a range on a worker thread, recording
+ * whether an item grew the chunk's copy of the item layout.
+ */
+class ChunkLayoutRoot : public LayoutRoot {
+ public:
+  ChunkLayoutRoot() {
+    resized_ = false;
+    cursor_ = 0;
+  }
+
+  // Returns whether the last item grew the layout, and resets the flag.
+  bool takeResized() {
+    bool resized = resized_;
+    resized_ = false;
+    return resized;
+  }
+
+  // Whether an item needed storage outside of its slot.
+  bool appended() const {
+    return cursor_ != 0;
+  }
+};
+
+} // namespace detail
+
 /**
  * LayoutException is thrown if freezing is attempted without a sufficient
  * layout
@@ -680,6 +858,14 @@ class FreezeRoot {
  public:
   virtual ~FreezeRoot() {}
 
+  const ParallelFreezeOptions& parallel() const {
+    return parallel_;
+  }
+
+  void setParallel(const ParallelFreezeOptions& parallel) {
+    parallel_ = parallel;
+  }
+
   /**
    * Internal utility for recursing into child fields.
    *
@@ -719,6 +905,25 @@ class FreezeRoot {
     doAppendBytes(origin, n, range, distance, align);
   }
 
+  /**
+   * Appends a copy of 'bytes' to the store unless an equal range was appended
+   * through this method before, returning the signed distance of the stored
+   * copy from 'origin'.
+   */
+  int64_t appendDistinctBytes(byte* origin, folly::ByteRange bytes) {
+    if (!distinct_) {
+      distinct_ = std::make_unique<detail::DistinctBytes<const byte*>>();
+    }
+    const byte* start = distinct_->place(bytes, [&] {
+      folly::MutableByteRange range;
+      size_t distance;
+      appendBytes(origin, bytes.size(), range, distance, 1);
+      std::copy(bytes.begin(), bytes.end(), range.begin());
+      return range.begin();
+    });
+    return doDistanceBetween(origin, start);
+  }
+
  private:
   virtual void doAppendBytes(
       byte* origin,
@@ -726,8 +931,43 @@ class FreezeRoot {
       folly::MutableByteRange& range,
       size_t& distance,
       size_t align) = 0;
+
+  /**
+   * Returns the signed distance between two positions in the store.
+   */
+  virtual int64_t doDistanceBetween(const byte* origin, const byte* target)
+      const {
+    return target - origin;
+  }
+
+  ParallelFreezeOptions parallel_;
+  std::unique_ptr<detail::DistinctBytes<const byte*>> distinct_;
 };
 
+namespace detail {
+
+/**
+ * Freezes the items of one chunk of a range on a worker thread. Items may
+ * only write to their own slot.
+ */
+class ChunkFreezeRoot final : public FreezeRoot {
+ private:
+  void doAppendBytes(
+      byte* /* origin */,
+      size_t n,
+      folly::MutableByteRange& range,
+      size_t& distance,
+      size_t /* align */) override {
+    if (n) {
+      throw OutOfLineItem();
+    }
+    distance = 0;
+    range.reset(nullptr, 0);
+  }
+};
+
+} // namespace detail
+
 inline size_t alignBy(size_t start, size_t alignment) {
   return ((start - 1) | (alignment - 1)) + 1;
 }
@@ -735,7 +975,7 @@ inline size_t alignBy(size_t start, size_t alignment) {
 /**
  * A FreezeRoot that writes to a given ByteRange
  */
-class ByteRangeFreezer final : public FreezeRoot {
+class ByteRangeFreezer : public FreezeRoot {
  protected:
   explicit ByteRangeFreezer(folly::MutableByteRange& write) : write_(write) {}
 
@@ -744,8 +984,10 @@ class ByteRangeFreezer final : public FreezeRoot {
   static typename Layout<T>::View freeze(
       const Layout<T>& layout,
       const T& root,
-      folly::MutableByteRange& write) {
+      folly::MutableByteRange& write,
+      const ParallelFreezeOptions& parallel = ParallelFreezeOptions()) {
     ByteRangeFreezer freezer(write);
+    freezer.setParallel(parallel);
     auto view = freezer.doFreeze(layout, root);
     return view;
   }
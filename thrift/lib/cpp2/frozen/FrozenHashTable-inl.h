@@ -78,6 +78,7 @@ struct HashTableLayout : public ArrayLayout<T, Item> {
   typedef ArrayLayout<T, Item> Base;
   Field<std::vector<Block>> sparseTableField;
   typedef Layout<Key> KeyLayout;
+  typedef KeyExtractor Extractor;
   typedef HashTableLayout LayoutSelf;
 
   HashTableLayout()
@@ -108,47 +109,107 @@ struct HashTableLayout : public ArrayLayout<T, Item> {
     }
   }
 
+  /**
+   * Walks the probe sequence for a key hash until 'place' accepts a bucket.
+   */
+  template <class Place>
+  static void probe(size_t h, size_t buckets, Place&& place) {
+    h *= 5; // spread out clumped hash values
+    for (size_t p = 0;; h += ++p) { // quadratic probing
+      if (place(h % buckets)) {
+        return;
+      }
+      if (p == buckets) {
+        throw std::out_of_range("All buckets full!");
+      }
+    }
+  }
+
+  /**
+   * Fills in the offset of each block once all masks are set.
+   */
+  static void computeBlockOffsets(std::vector<Block>& sparseTable) {
+    size_t count = 0;
+    for (auto& block : sparseTable) {
+      block.offset = count;
+      count += folly::popcount(block.mask);
+    }
+  }
+
+  /**
+   * Places 'item', whose key hashes to 'h', in the first free bucket of its
+   * probe sequence.
+   */
+  static void placeItem(
+      const Item& item,
+      size_t h,
+      std::vector<const Item*>& index,
+      std::vector<Block>& sparseTable) {
+    const typename KeyExtractor::KeyType* itemKey = &KeyExtractor::getKey(item);
+    probe(h, index.size(), [&](size_t bucket) {
+      const Item** slot = &index[bucket];
+      if (*slot) {
+        if (*itemKey == KeyExtractor::getKey(**slot)) {
+          throw std::domain_error("Input collection is not distinct");
+        }
+        return false;
+      }
+      *slot = KeyExtractor::getPointer(item);
+      sparseTable[bucket / Block::bits].mask |= uint64_t(1)
+          << (bucket % Block::bits);
+      return true;
+    });
+  }
+
   static void buildIndex(
       const T& coll,
       std::vector<const Item*>& index,
       std::vector<Block>& sparseTable) {
     auto blocks = blockCount(coll.size());
-    size_t buckets = blocks * Block::bits;
     sparseTable.resize(blocks);
-    index.resize(buckets);
+    index.resize(blocks * Block::bits);
     for (auto& item : coll) {
-      const typename KeyExtractor::KeyType* itemKey =
-          &KeyExtractor::getKey(item);
-      size_t h = KeyLayout::hash(*itemKey);
-      h *= 5; // spread out clumped hash values
-      for (size_t p = 0;; h += ++p) { // quadratic probing
-        size_t bucket = h % buckets;
-        const Item** slot = &index[bucket];
-        if (*slot) {
-          if (p == buckets) {
-            throw std::out_of_range("All buckets full!");
-          }
-          if (*itemKey == KeyExtractor::getKey(**slot)) {
-            throw std::domain_error("Input collection is not distinct");
-          }
-          continue;
-        } else {
-          *slot = KeyExtractor::getPointer(item);
-          break;
-        }
-      }
+      placeItem(
+          item,
+          KeyLayout::hash(KeyExtractor::getKey(item)),
+          index,
+          sparseTable);
     }
-    size_t count = 0;
-    for (size_t blockIndex = 0; blockIndex < blocks; ++blockIndex) {
-      Block& block = sparseTable[blockIndex];
-      block.offset = count;
-      for (size_t offset = 0; offset < Block::bits; ++offset) {
-        if (index[blockIndex * Block::bits + offset]) {
-          block.mask |= uint64_t(1) << offset;
-          ++count;
-        }
+    computeBlockOffsets(sparseTable);
+  }
+
+  /**
+   * As above, hashing the keys of large collections on several threads.
+   * Buckets are still assigned in iteration order, so the index is the same.
+   */
+  static void buildIndex(
+      const T& coll,
+      std::vector<const Item*>& index,
+      std::vector<Block>& sparseTable,
+      const ParallelFreezeOptions& options) {
+    if (!parallelizes(options, coll.size())) {
+      buildIndex(coll, index, sparseTable);
+      return;
+    }
+    std::vector<const Item*> items;
+    items.reserve(coll.size());
+    for (auto& item : coll) {
+      items.push_back(KeyExtractor::getPointer(item));
+    }
+    std::vector<size_t> hashes(items.size());
+    runChunks(options, items.size(), false, [&](size_t, size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) {
+        hashes[i] = KeyLayout::hash(KeyExtractor::getKey(*items[i]));
       }
+    });
+
+    auto blocks = blockCount(coll.size());
+    sparseTable.resize(blocks);
+    index.resize(blocks * Block::bits);
+    for (size_t i = 0; i < items.size(); ++i) {
+      placeItem(*items[i], hashes[i], index, sparseTable);
     }
+    computeBlockOffsets(sparseTable);
   }
 
   FieldPosition layoutItems(
@@ -160,10 +221,19 @@ struct HashTableLayout : public ArrayLayout<T, Item> {
       FieldPosition writeStep) final {
     std::vector<const Item*> index;
     std::vector<Block> sparseTable;
-    buildIndex(coll, index, sparseTable);
+    buildIndex(coll, index, sparseTable, root.parallel());
 
     pos = root.layoutField(self, pos, this->sparseTableField, sparseTable);
 
+    if (parallelizes(root.parallel(), coll.size())) {
+      auto items = placedItems(index, coll.size());
+      auto getItem = [&](size_t i) -> const Item& { return *items[i]; };
+      if (this->layoutItemsInParallel(
+              root, items.size(), write, writeStep, getItem)) {
+        return pos;
+      }
+    }
+
     FieldPosition noField; // not really used
     for (auto& it : index) {
       if (it) {
@@ -183,11 +253,20 @@ struct HashTableLayout : public ArrayLayout<T, Item> {
       FieldPosition writeStep) const final {
     std::vector<const Item*> index;
     std::vector<Block> sparseTable;
-    buildIndex(coll, index, sparseTable);
+    buildIndex(coll, index, sparseTable, root.parallel());
 
     assert(index.empty() == sparseTable.empty());
     root.freezeField(self, this->sparseTableField, sparseTable);
 
+    if (parallelizes(root.parallel(), coll.size())) {
+      auto items = placedItems(index, coll.size());
+      auto getItem = [&](size_t i) -> const Item& { return *items[i]; };
+      if (this->freezeItemsInParallel(
+              root, items.size(), write, writeStep, getItem)) {
+        return;
+      }
+    }
+
     FieldPosition noField; // not really used
     for (auto& it : index) {
       if (it) {
@@ -197,6 +276,22 @@ struct HashTableLayout : public ArrayLayout<T, Item> {
     }
   }
 
+  /**
+   * The items of 'index' in bucket order, which is the order they are stored.
+   */
+  static std::vector<const Item*> placedItems(
+      const std::vector<const Item*>& index,
+      size_t count) {
+    std::vector<const Item*> items;
+    items.reserve(count);
+    for (auto it : index) {
+      if (it) {
+        items.push_back(it);
+      }
+    }
+    return items;
+  }
+
   void thaw(ViewPosition self, T& out) const {
     out.clear();
     auto v = view(self);
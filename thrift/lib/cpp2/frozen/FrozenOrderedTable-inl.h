@@ -53,6 +53,17 @@ struct SortedTableLayout : public ArrayLayout<T, Item> {
     });
   }
 
+  // fill in the index of an already sorted collection, for random access
+  static void orderedItems(const T& coll, std::vector<const Item*>& index) {
+    if (!index.empty()) {
+      return;
+    }
+    index.reserve(coll.size());
+    for (auto& item : coll) {
+      index.push_back(KeyExtractor::getPointer(item));
+    }
+  }
+
   static void ensureDistinctKeys(
       const typename KeyExtractor::KeyType& key1,
       const typename KeyExtractor::KeyType& key2) {
@@ -71,6 +82,20 @@ struct SortedTableLayout : public ArrayLayout<T, Item> {
     std::vector<const Item*> index;
     maybeIndex(coll, index);
 
+    if (parallelizes(root.parallel(), coll.size())) {
+      orderedItems(coll, index);
+      for (size_t i = 1; i < index.size(); ++i) {
+        ensureDistinctKeys(
+            KeyExtractor::getKey(*index[i - 1]),
+            KeyExtractor::getKey(*index[i]));
+      }
+      auto getItem = [&](size_t i) -> const Item& { return *index[i]; };
+      if (this->layoutItemsInParallel(
+              root, index.size(), write, writeStep, getItem)) {
+        return pos;
+      }
+    }
+
     FieldPosition noField; // not really used
     const typename KeyExtractor::KeyType* lastKey = nullptr;
     if (index.empty()) {
@@ -111,6 +136,15 @@ struct SortedTableLayout : public ArrayLayout<T, Item> {
     std::vector<const Item*> index;
     maybeIndex(coll, index);
 
+    if (parallelizes(root.parallel(), coll.size())) {
+      orderedItems(coll, index);
+      auto getItem = [&](size_t i) -> const Item& { return *index[i]; };
+      if (this->freezeItemsInParallel(
+              root, index.size(), write, writeStep, getItem)) {
+        return;
+      }
+    }
+
     FieldPosition noField; // not really used
     if (index.empty()) {
       // either the collection was already sorted or it's empty
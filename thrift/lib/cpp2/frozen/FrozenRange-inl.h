@@ -46,6 +46,12 @@ struct ArrayLayout : public LayoutBase {
     return pos;
   }
 
+  typedef std::is_base_of<
+      std::random_access_iterator_tag,
+      typename std::iterator_traits<
+          typename T::const_iterator>::iterator_category>
+      RandomAccess;
+
   FieldPosition layout(LayoutRoot& root, const T& coll, LayoutPosition self) {
     FieldPosition pos = startFieldPosition();
     size_t n = coll.size();
@@ -74,6 +80,9 @@ struct ArrayLayout : public LayoutBase {
       FieldPosition pos,
       LayoutPosition write,
       FieldPosition writeStep) {
+    if (layoutRangeInParallel(root, coll, write, writeStep, RandomAccess())) {
+      return pos;
+    }
     FieldPosition noField; // not really used
     for (const auto& it : coll) {
       root.layoutField(write, noField, this->itemField, it);
@@ -115,12 +124,156 @@ struct ArrayLayout : public LayoutBase {
       FreezePosition /* self */,
       FreezePosition write,
       FieldPosition writeStep) const {
+    if (freezeRangeInParallel(root, coll, write, writeStep, RandomAccess())) {
+      return;
+    }
     for (const auto& it : coll) {
       root.freezeField(write, itemField, it);
       write = write(writeStep);
     }
   }
 
+  /**
+   * Returns the position of the i-th item of a range starting at 'write'.
+   */
+  template <class Position>
+  static Position itemPosition(Position write, FieldPosition step, size_t i) {
+    return Position{write.start + i * size_t(step.offset),
+                    write.bitOffset + i * size_t(step.bitOffset)};
+  }
+
+  /**
+   * Lays out the 'n' items given by getItem(i) on several threads, if the
+   * range is large enough. Each chunk is laid out on its own copy of the item
+   * layout, and the items which grew it are then laid out again, in order, on
+   * the shared one. Returns false if the caller must lay out the items
+   * serially, because the range is small or its items need storage of their
+   * own.
+   */
+  template <class GetItem>
+  bool layoutItemsInParallel(
+      LayoutRoot& root,
+      size_t n,
+      LayoutPosition write,
+      FieldPosition writeStep,
+      const GetItem& getItem) {
+    const auto& options = root.parallel();
+    if (!parallelizes(options, n)) {
+      return false;
+    }
+    std::vector<std::vector<size_t>> grown(chunkCount(options, n));
+    bool inlined = runChunks(
+        options, n, false, [&](size_t chunk, size_t begin, size_t end) {
+          ChunkLayoutRoot chunkRoot;
+          auto chunkField = itemField;
+          FieldPosition noField; // not really used
+          for (size_t i = begin; i < end; ++i) {
+            chunkRoot.layoutField(
+                itemPosition(write, writeStep, i),
+                noField,
+                chunkField,
+                getItem(i));
+            if (chunkRoot.appended()) {
+              throw OutOfLineItem();
+            }
+            if (chunkRoot.takeResized()) {
+              grown[chunk].push_back(i);
+            }
+          }
+        });
+    countRange(options, inlined, &ParallelFreezeStats::parallelLayouts);
+    if (!inlined) {
+      return false;
+    }
+    FieldPosition noField; // not really used
+    for (const auto& items : grown) {
+      for (size_t i : items) {
+        root.layoutField(
+            itemPosition(write, writeStep, i), noField, itemField, getItem(i));
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Freezes the 'n' items given by getItem(i) on several threads, if the range
+   * is large enough. Returns false if the caller must freeze the items
+   * serially; items already written are then simply written again.
+   */
+  template <class GetItem>
+  bool freezeItemsInParallel(
+      FreezeRoot& root,
+      size_t n,
+      FreezePosition write,
+      FieldPosition writeStep,
+      const GetItem& getItem) const {
+    const auto& options = root.parallel();
+    if (!parallelizes(options, n)) {
+      return false;
+    }
+    bool inlined =
+        runChunks(options, n, true, [&](size_t, size_t begin, size_t end) {
+          ChunkFreezeRoot chunkRoot;
+          for (size_t i = begin; i < end; ++i) {
+            chunkRoot.freezeField(
+                itemPosition(write, writeStep, i), itemField, getItem(i));
+          }
+        });
+    countRange(options, inlined, &ParallelFreezeStats::parallelFreezes);
+    return inlined;
+  }
+
+  static void countRange(
+      const ParallelFreezeOptions& options,
+      bool inlined,
+      size_t ParallelFreezeStats::*parallel) {
+    if (options.stats) {
+      ++(inlined ? options.stats->*parallel : options.stats->serialFallbacks);
+    }
+  }
+
+  bool layoutRangeInParallel(
+      LayoutRoot& root,
+      const T& coll,
+      LayoutPosition write,
+      FieldPosition writeStep,
+      std::true_type) {
+    return layoutItemsInParallel(
+        root, coll.size(), write, writeStep, [&](size_t i) -> decltype(auto) {
+          return coll[i];
+        });
+  }
+
+  bool layoutRangeInParallel(
+      LayoutRoot&,
+      const T&,
+      LayoutPosition,
+      FieldPosition,
+      std::false_type) {
+    return false;
+  }
+
+  bool freezeRangeInParallel(
+      FreezeRoot& root,
+      const T& coll,
+      FreezePosition write,
+      FieldPosition writeStep,
+      std::true_type) const {
+    return freezeItemsInParallel(
+        root, coll.size(), write, writeStep, [&](size_t i) -> decltype(auto) {
+          return coll[i];
+        });
+  }
+
+  bool freezeRangeInParallel(
+      FreezeRoot&,
+      const T&,
+      FreezePosition,
+      FieldPosition,
+      std::false_type) const {
+    return false;
+  }
+
   void thaw(ViewPosition self, T& out) const {
     out.clear();
     auto outIt = std::back_inserter(out);
@@ -138,12 +138,106 @@ struct StringLayout : public LayoutBase {
   }
 };
 
+/**
+ * for strings frozen once per distinct value. Occurrences after the first
+ * refer back to the first copy, so the distance may be negative.
+ */
+template <class T>
+struct DistinctStringLayout : public LayoutBase {
+  typedef LayoutBase Base;
+  typedef BufferHelpers<T> Helper;
+  typedef typename Helper::Item Item;
+  Field<int64_t> distanceField;
+  Field<size_t> countField;
+
+  DistinctStringLayout()
+      : LayoutBase(typeid(T)),
+        distanceField(1, "distance"),
+        countField(2, "count") {}
+
+  static folly::ByteRange bytes(const T& o) {
+    return folly::ByteRange(
+        reinterpret_cast<const byte*>(o.data()),
+        Helper::size(o) * sizeof(Item));
+  }
+
+  FieldPosition maximize() {
+    FieldPosition pos = startFieldPosition();
+    FROZEN_MAXIMIZE_FIELD(distance);
+    FROZEN_MAXIMIZE_FIELD(count);
+    return pos;
+  }
+
+  FieldPosition layout(LayoutRoot& root, const T& o, LayoutPosition self) {
+    FieldPosition pos = startFieldPosition();
+    size_t n = Helper::size(o);
+    if (!n) {
+      return pos;
+    }
+    int64_t dist = root.layoutDistinctBytesDistance(self.start, bytes(o));
+    pos = root.layoutField(self, pos, distanceField, dist);
+    pos = root.layoutField(self, pos, countField, n);
+    return pos;
+  }
+
+  void freeze(FreezeRoot& root, const T& o, FreezePosition self) const {
+    size_t n = Helper::size(o);
+    int64_t dist = n ? root.appendDistinctBytes(self.start, bytes(o)) : 0;
+    root.freezeField(self, distanceField, dist);
+    root.freezeField(self, countField, n);
+  }
+
+  void thaw(ViewPosition self, T& out) const {
+    Helper::thawTo(view(self), out);
+  }
+
+  typedef folly::Range<const Item*> View;
+
+  View view(ViewPosition self) const {
+    View range;
+    int64_t dist;
+    size_t n;
+    thawField(self, countField, n);
+    if (n) {
+      thawField(self, distanceField, dist);
+      const byte* read = self.start + dist;
+      range.reset(reinterpret_cast<const Item*>(read), n);
+    }
+    return range;
+  }
+
+  void print(std::ostream& os, int level) const override {
+    LayoutBase::print(os, level);
+    os << "distinct string of " << folly::demangle(type.name());
+    distanceField.print(os, level + 1);
+    countField.print(os, level + 1);
+  }
+
+  void clear() final {
+    LayoutBase::clear();
+    distanceField.clear();
+    countField.clear();
+  }
+
+  FROZEN_SAVE_INLINE(FROZEN_SAVE_FIELD(distance) FROZEN_SAVE_FIELD(count))
+
+  FROZEN_LOAD_INLINE(FROZEN_LOAD_FIELD(distance, 1) FROZEN_LOAD_FIELD(count, 2))
+
+  static size_t hash(const View& v) {
+    return folly::hash::fnv64_buf(v.begin(), sizeof(Item) * v.size());
+  }
+};
+
 } // namespace detail
 
 template <class T>
 struct Layout<T, typename std::enable_if<IsString<T>::value>::type>
     : detail::StringLayout<typename std::decay<T>::type> {};
 
+template <class T>
+struct Layout<T, typename std::enable_if<IsDistinctString<T>::value>::type>
+    : detail::DistinctStringLayout<typename std::decay<T>::type> {};
+
 } // namespace frozen
 } // namespace thrift
 } // namespace apache
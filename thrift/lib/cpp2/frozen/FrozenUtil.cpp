@@ -105,6 +105,12 @@ void MallocFreezer::doAppendBytes(
   range = appendBuffer(padding + n);
   range.advance(padding);
 }
+
+int64_t MallocFreezer::doDistanceBetween(
+    const byte* origin,
+    const byte* target) const {
+  return int64_t(distanceToEnd(origin)) - int64_t(distanceToEnd(target));
+}
 } // namespace frozen
 } // namespace thrift
 } // namespace apache
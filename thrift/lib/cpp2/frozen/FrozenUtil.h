@@ -77,6 +77,9 @@ class MallocFreezer final : public FreezeRoot {
       size_t& distance,
       size_t alignment) override;
 
+  int64_t doDistanceBetween(const byte* origin, const byte* target)
+      const override;
+
   struct Segment {
     explicit Segment(size_t size);
     Segment(Segment&& other) : size(other.size), buffer(other.buffer) {
@@ -149,11 +152,18 @@ void deserializeRootLayout(folly::ByteRange& range, Layout<T>& layoutOut) {
   range.advance(schemaSize);
 }
 
+/**
+ * Freezes 'x' into 'file'. Large ranges are laid out and frozen on
+ * 'parallel.threads' threads, producing the same file.
+ */
 template <class T>
-void freezeToFile(const T& x, folly::File file) {
+void freezeToFile(
+    const T& x,
+    folly::File file,
+    const ParallelFreezeOptions& parallel = ParallelFreezeOptions()) {
   std::string schemaStr;
   auto layout = std::make_unique<Layout<T>>();
-  auto contentSize = LayoutRoot::layout(x, *layout);
+  auto contentSize = LayoutRoot::layout(x, *layout, parallel);
 
   serializeRootLayout(*layout, schemaStr);
 
@@ -164,16 +174,19 @@ void freezeToFile(const T& x, folly::File file) {
   auto writeRange = mapping.writableRange();
   std::copy(schemaStr.begin(), schemaStr.end(), writeRange.begin());
   writeRange.advance(schemaStr.size());
-  ByteRangeFreezer::freeze(*layout, x, writeRange);
+  ByteRangeFreezer::freeze(*layout, x, writeRange, parallel);
   size_t finalBufferSize = writeRange.begin() - mappingRange.begin();
   ftruncate(file.fd(), finalBufferSize);
 }
 
 template <class T>
-void freezeToString(const T& x, std::string& out) {
+void freezeToString(
+    const T& x,
+    std::string& out,
+    const ParallelFreezeOptions& parallel = ParallelFreezeOptions()) {
   out.clear();
   Layout<T> layout;
-  size_t contentSize = LayoutRoot::layout(x, layout);
+  size_t contentSize = LayoutRoot::layout(x, layout, parallel);
   serializeRootLayout(layout, out);
 
   size_t schemaSize = out.size();
@@ -181,7 +194,7 @@ void freezeToString(const T& x, std::string& out) {
   out.resize(bufferSize, 0);
   folly::MutableByteRange writeRange(
       reinterpret_cast<byte*>(&out[schemaSize]), contentSize);
-  ByteRangeFreezer::freeze(layout, x, writeRange);
+  ByteRangeFreezer::freeze(layout, x, writeRange, parallel);
   out.resize(out.size() - writeRange.size());
 }
 
@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -44,7 +45,33 @@ class VectorUnpacked : public std::vector<T> {
       "Unpacked storage is only available for simple item types");
   using std::vector<T>::vector;
 };
+
+/*
+ * For strings that repeat many times within a frozen object, such as country
+ * codes or category names. Each distinct value is stored once, and every
+ * occurrence refers to that copy. Views are plain StringPieces, as for
+ * std::string.
+ *
+ * Use this in Thrift IDL like:
+ *
+ *   cpp_include "thrift/lib/cpp2/frozen/HintTypes.h"
+ *
+ *   typedef string
+ *       (cpp.type = "apache::thrift::frozen::DistinctString")
+ *       DistinctString
+ *
+ *   struct MyStruct {
+ *     3: DistinctString country,
+ *   }
+ */
+class DistinctString : public std::string {
+ public:
+  using std::string::string;
+  DistinctString() = default;
+  /* implicit */ DistinctString(std::string s) : std::string(std::move(s)) {}
+};
 } // namespace frozen
 } // namespace thrift
 } // namespace apache
 THRIFT_DECLARE_TRAIT_TEMPLATE(IsString, apache::thrift::frozen::VectorUnpacked)
+THRIFT_DECLARE_TRAIT(IsDistinctString, apache::thrift::frozen::DistinctString)
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <thrift/lib/cpp2/frozen/StreamingFreezer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/portability/Unistd.h>
+
+namespace apache {
+namespace thrift {
+namespace frozen {
+namespace detail {
+
+namespace {
+
+constexpr size_t kSpillBufferSize = 1 << 20;
+
+// Each record is its key and size followed by its bytes.
+struct RecordHeader {
+  uint64_t key;
+  uint64_t size;
+};
+
+class SpillWriter {
+ public:
+  explicit SpillWriter(folly::File& file) : file_(file) {
+    buffer_.reserve(kSpillBufferSize);
+  }
+
+  void write(uint64_t key, folly::ByteRange data) {
+    RecordHeader header{key, data.size()};
+    append(&header, sizeof(header));
+    append(data.data(), data.size());
+  }
+
+  void flush() {
+    if (buffer_.empty()) {
+      return;
+    }
+    auto written = folly::writeFull(file_.fd(), buffer_.data(), buffer_.size());
+    folly::checkUnixError(written, "Failed to write frozen spill file");
+    buffer_.clear();
+  }
+
+ private:
+  void append(const void* data, size_t size) {
+    if (buffer_.size() + size > kSpillBufferSize) {
+      flush();
+    }
+    buffer_.append(static_cast<const char*>(data), size);
+  }
+
+  folly::File& file_;
+  std::string buffer_;
+};
+
+} // namespace
+
+bool SpillSorter::Reader::pull(void* out, size_t n) {
+  auto dest = static_cast<char*>(out);
+  size_t copied = 0;
+  while (copied < n) {
+    if (pos_ == buffer_.size()) {
+      buffer_.resize(kSpillBufferSize);
+      auto got = folly::preadFull(
+          file_->fd(), &buffer_[0], buffer_.size(), offset_);
+      folly::checkUnixError(got, "Failed to read frozen spill file");
+      buffer_.resize(got);
+      offset_ += got;
+      pos_ = 0;
+      if (got == 0) {
+        if (copied == 0) {
+          return false;
+        }
+        throw std::runtime_error("Truncated frozen spill file");
+      }
+    }
+    size_t chunk = std::min(n - copied, buffer_.size() - pos_);
+    std::memcpy(dest + copied, buffer_.data() + pos_, chunk);
+    pos_ += chunk;
+    copied += chunk;
+  }
+  return true;
+}
+
+bool SpillSorter::Reader::next(uint64_t& key, std::string& data) {
+  RecordHeader header;
+  if (!pull(&header, sizeof(header))) {
+    return false;
+  }
+  key = header.key;
+  data.resize(header.size);
+  if (header.size && !pull(&data[0], header.size)) {
+    throw std::runtime_error("Truncated frozen spill file");
+  }
+  return true;
+}
+
+SpillSorter::SpillSorter(size_t memoryLimit, std::string tempDir)
+    : memoryLimit_(memoryLimit), tempDir_(std::move(tempDir)) {}
+
+folly::File SpillSorter::tempFile() const {
+  if (tempDir_.empty()) {
+    return folly::File::temporary();
+  }
+  std::string path = tempDir_ + "/frozen-spill-XXXXXX";
+  int fd = mkstemp(&path[0]);
+  folly::checkUnixError(fd, "Failed to create frozen spill file in ", tempDir_);
+  unlink(path.c_str());
+  return folly::File(fd, true);
+}
+
+void SpillSorter::add(uint64_t key, folly::ByteRange data) {
+  if (finished_) {
+    throw std::logic_error("SpillSorter is finished");
+  }
+  entries_.push_back(Entry{key, arena_.size(), data.size()});
+  arena_.append(reinterpret_cast<const char*>(data.data()), data.size());
+  if (arena_.size() + entries_.size() * sizeof(Entry) >= memoryLimit_) {
+    spillRun();
+  }
+}
+
+void SpillSorter::writeSorted(folly::File& file) {
+  std::stable_sort(
+      entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+        return a.key < b.key;
+      });
+  SpillWriter writer(file);
+  for (const auto& entry : entries_) {
+    writer.write(
+        entry.key,
+        folly::ByteRange(
+            reinterpret_cast<const uint8_t*>(arena_.data()) + entry.offset,
+            entry.size));
+  }
+  writer.flush();
+  entries_.clear();
+  arena_.clear();
+}
+
+void SpillSorter::spillRun() {
+  if (entries_.empty()) {
+    return;
+  }
+  runs_.push_back(tempFile());
+  writeSorted(runs_.back());
+}
+
+void SpillSorter::merge() {
+  struct Head {
+    uint64_t key;
+    size_t run;
+    std::string data;
+  };
+  auto later = [](const Head& a, const Head& b) {
+    return a.key != b.key ? a.key > b.key : a.run > b.run;
+  };
+  std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+
+  std::vector<Reader> readers;
+  readers.reserve(runs_.size());
+  for (size_t run = 0; run < runs_.size(); ++run) {
+    readers.push_back(Reader(runs_[run]));
+    Head head{0, run, std::string()};
+    if (readers.back().next(head.key, head.data)) {
+      heads.push(std::move(head));
+    }
+  }
+
+  SpillWriter writer(sorted_);
+  while (!heads.empty()) {
+    Head head = std::move(const_cast<Head&>(heads.top()));
+    heads.pop();
+    writer.write(head.key, folly::StringPiece(head.data));
+    if (readers[head.run].next(head.key, head.data)) {
+      heads.push(std::move(head));
+    }
+  }
+  writer.flush();
+  runs_.clear();
+}
+
+void SpillSorter::finish() {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  if (runs_.empty()) {
+    sorted_ = tempFile();
+    writeSorted(sorted_);
+    return;
+  }
+  spillRun();
+  if (runs_.size() == 1) {
+    sorted_ = std::move(runs_.front());
+    runs_.clear();
+    return;
+  }
+  sorted_ = tempFile();
+  merge();
+}
+
+SpillSorter::Reader SpillSorter::read() const {
+  if (!finished_) {
+    throw std::logic_error("SpillSorter is not finished");
+  }
+  return Reader(sorted_);
+}
+
+} // namespace detail
+} // namespace frozen
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,420 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/File.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/system/MemoryMapping.h>
+#include <thrift/lib/cpp2/frozen/FrozenUtil.h>
+
+namespace apache {
+namespace thrift {
+namespace frozen {
+
+struct StreamingFreezeOptions {
+  // Bytes of frozen items buffered in memory before a sorted run is spilled.
+  size_t sortBufferBytes = size_t(256) << 20;
+  // Directory for spill files. Uses the system temporary directory if empty.
+  std::string tempDir;
+};
+
+namespace detail {
+
+/**
+ * Stores (key, bytes) records in unlinked temporary files and returns them in
+ * key order, using at most a fixed amount of memory for sorting.
+ */
+class SpillSorter {
+ public:
+  /**
+   * Reads the sorted records from the start. Several readers may be used one
+   * after another.
+   */
+  class Reader {
+   public:
+    bool next(uint64_t& key, std::string& data);
+
+   private:
+    friend class SpillSorter;
+    explicit Reader(const folly::File& file) : file_(&file) {}
+
+    bool pull(void* out, size_t n);
+
+    const folly::File* file_;
+    off_t offset_{0};
+    std::string buffer_;
+    size_t pos_{0};
+  };
+
+  SpillSorter(size_t memoryLimit, std::string tempDir);
+
+  void add(uint64_t key, folly::ByteRange data);
+
+  /**
+   * Sorts all added records into a single file. No records may be added after.
+   */
+  void finish();
+
+  Reader read() const;
+
+ private:
+  struct Entry {
+    uint64_t key;
+    size_t offset;
+    size_t size;
+  };
+
+  folly::File tempFile() const;
+  void writeSorted(folly::File& file);
+  void spillRun();
+  void merge();
+
+  size_t memoryLimit_;
+  std::string tempDir_;
+  std::vector<Entry> entries_;
+  std::string arena_;
+  std::vector<folly::File> runs_;
+  folly::File sorted_;
+  bool finished_{false};
+};
+
+/**
+ * A LayoutRoot driven one item at a time instead of from a whole object.
+ */
+class StreamingLayoutRoot : public LayoutRoot {
+ public:
+  // Starts a layout pass, like LayoutRoot::doLayout().
+  void begin(size_t rootSize) {
+    resized_ = false;
+    cursor_ = rootSize;
+    distinct_.reset();
+  }
+
+  void noteResize(bool resized) {
+    resized_ = resized || resized_;
+  }
+
+  bool resized() const {
+    return resized_;
+  }
+
+  size_t size() const {
+    return cursor_ + kPaddingBytes;
+  }
+};
+
+/**
+ * A ByteRangeFreezer whose root is frozen piecewise by the caller.
+ */
+class StreamingByteRangeFreezer : public ByteRangeFreezer {
+ public:
+  explicit StreamingByteRangeFreezer(folly::MutableByteRange& write)
+      : ByteRangeFreezer(write) {}
+
+  template <class F>
+  void freezeRoot(const LayoutBase& layout, F&& freezeFields) {
+    folly::MutableByteRange range, tail;
+    size_t dist;
+    appendBytes(nullptr, layout.size, range, dist, 1);
+    freezeFields(FreezePosition{range.begin(), 0});
+    appendBytes(range.end(), LayoutRoot::kPaddingBytes, tail, dist, 1);
+  }
+};
+
+} // namespace detail
+
+/**
+ * Freezes a vector, hash map or hash set to a file without materializing it.
+ *
+ * Items are added one at a time and spilled to temporary files, frozen with
+ * the maximum item layout. For hash tables the index is built as items
+ * arrive, so the memory used is the sparse table (about 5 bits per item of
+ * the size hint) plus the sort buffer; the output file is written through a
+ * memory mapping like freezeToFile(). The file is readable with mapFrozen<T>.
+ *
+ * The size hint must be an upper bound on the number of items of a hash
+ * table, since it fixes the number of buckets; it is unused for vectors.
+ * Hash table keys must be distinct, which is not checked.
+ */
+template <class T>
+class StreamingFreezer {
+  using Item = typename T::value_type;
+  static constexpr bool kHashed = IsHashMap<T>::value || IsHashSet<T>::value;
+  static_assert(
+      kHashed || IsList<T>::value,
+      "StreamingFreezer supports vectors, hash maps and hash sets");
+
+ public:
+  explicit StreamingFreezer(
+      size_t sizeHint,
+      StreamingFreezeOptions options = StreamingFreezeOptions())
+      : sizeHint_(sizeHint),
+        itemLayout_(maximumLayout<Item>()),
+        spill_(options.sortBufferBytes, std::move(options.tempDir)) {
+    // Items frozen on their own need at least one byte even if they only
+    // take a few bits.
+    if (!itemLayout_.size) {
+      itemLayout_.resize(FieldPosition((itemLayout_.bits + 7) / 8, 0), false);
+    }
+    initIndex(std::integral_constant<bool, kHashed>());
+  }
+
+  void add(const Item& item) {
+    auto key = place(item, std::integral_constant<bool, kHashed>());
+    auto frozen = freezeDataToString(item, itemLayout_);
+    spill_.add(key, folly::StringPiece(frozen));
+    ++count_;
+  }
+
+  size_t size() const {
+    return count_;
+  }
+
+  /**
+   * Writes the schema and the frozen collection to file.
+   */
+  void freezeToFile(folly::File file) {
+    spill_.finish();
+    finishIndex(std::integral_constant<bool, kHashed>());
+
+    Layout<T> layout;
+    detail::StreamingLayoutRoot layoutRoot;
+    do {
+      layoutRoot.begin(layout.size);
+      auto after = layoutFields(layoutRoot, layout);
+      layoutRoot.noteResize(layout.resize(after, false));
+    } while (layoutRoot.resized());
+
+    std::string schemaStr;
+    serializeRootLayout(layout, schemaStr);
+    size_t initialBufferSize = layoutRoot.size() + schemaStr.size();
+    folly::MemoryMapping mapping(
+        file.dup(), 0, initialBufferSize, folly::MemoryMapping::writable());
+    auto mappingRange = mapping.writableRange();
+    auto writeRange = mapping.writableRange();
+    std::copy(schemaStr.begin(), schemaStr.end(), writeRange.begin());
+    writeRange.advance(schemaStr.size());
+    detail::StreamingByteRangeFreezer freezer(writeRange);
+    freezer.freezeRoot(layout, [&](FreezePosition self) {
+      freezeFields(freezer, layout, self);
+    });
+    size_t finalBufferSize = writeRange.begin() - mappingRange.begin();
+    ftruncate(file.fd(), finalBufferSize);
+  }
+
+ private:
+  uint64_t place(const Item&, std::false_type) {
+    return count_;
+  }
+
+  // Claims the item's bucket in the sparse table; items are later written in
+  // bucket order, which is the order HashTableLayout lays them out in.
+  uint64_t place(const Item& item, std::true_type) {
+    using TableLayout = Layout<T>;
+    using Extractor = typename TableLayout::Extractor;
+    if (count_ == sizeHint_) {
+      throw std::out_of_range("More items than the size hint");
+    }
+    size_t buckets = sparseTable_.size() * detail::Block::bits;
+    uint64_t placed = 0;
+    TableLayout::probe(
+        TableLayout::KeyLayout::hash(Extractor::getKey(item)),
+        buckets,
+        [&](size_t bucket) {
+          auto& block = sparseTable_[bucket / detail::Block::bits];
+          auto bit = uint64_t(1) << (bucket % detail::Block::bits);
+          if (block.mask & bit) {
+            return false;
+          }
+          block.mask |= bit;
+          placed = bucket;
+          return true;
+        });
+    return placed;
+  }
+
+  void initIndex(std::false_type) {}
+
+  void initIndex(std::true_type) {
+    sparseTable_.resize(Layout<T>::blockCount(sizeHint_));
+  }
+
+  void finishIndex(std::false_type) {}
+
+  void finishIndex(std::true_type) {
+    Layout<T>::computeBlockOffsets(sparseTable_);
+  }
+
+  FieldPosition layoutIndex(
+      LayoutRoot&,
+      Layout<T>&,
+      LayoutPosition,
+      FieldPosition pos,
+      std::false_type) {
+    return pos;
+  }
+
+  FieldPosition layoutIndex(
+      LayoutRoot& root,
+      Layout<T>& layout,
+      LayoutPosition self,
+      FieldPosition pos,
+      std::true_type) {
+    return root.layoutField(self, pos, layout.sparseTableField, sparseTable_);
+  }
+
+  void freezeIndex(
+      FreezeRoot&,
+      const Layout<T>&,
+      FreezePosition,
+      std::false_type) const {}
+
+  void freezeIndex(
+      FreezeRoot& root,
+      const Layout<T>& layout,
+      FreezePosition self,
+      std::true_type) const {
+    root.freezeField(self, layout.sparseTableField, sparseTable_);
+  }
+
+  size_t itemsBytes(const Layout<T>& layout) const {
+    size_t itemBytes = layout.itemField.layout.size;
+    size_t itemBits = itemBytes ? 0 : layout.itemField.layout.bits;
+    return itemBits ? (count_ * itemBits + 7) / 8 : count_ * itemBytes;
+  }
+
+  FieldPosition itemStep(const Layout<T>& layout) const {
+    size_t itemBytes = layout.itemField.layout.size;
+    size_t itemBits = itemBytes ? 0 : layout.itemField.layout.bits;
+    return FieldPosition(itemBytes, itemBits);
+  }
+
+  static constexpr size_t itemAlignment() {
+    return detail::IsBlitType<Item>::value ? alignof(Item) : 1;
+  }
+
+  // Mirrors ArrayLayout::layout and HashTableLayout::layoutItems.
+  FieldPosition layoutFields(LayoutRoot& root, Layout<T>& layout) {
+    LayoutPosition self{0, 0};
+    FieldPosition pos = layout.startFieldPosition();
+    pos = root.layoutField(self, pos, layout.countField, count_);
+    if (!count_) {
+      return root.layoutField(self, pos, layout.distanceField, 0);
+    }
+    size_t dist = root.layoutBytesDistance(
+        self.start, itemsBytes(layout), itemAlignment());
+    pos = root.layoutField(self, pos, layout.distanceField, dist);
+    pos = layoutIndex(
+        root, layout, self, pos, std::integral_constant<bool, kHashed>());
+
+    LayoutPosition write{self.start + dist, 0};
+    FieldPosition writeStep = itemStep(layout);
+    FieldPosition noField; // not really used
+    forEachItem([&](const Item& item) {
+      root.layoutField(write, noField, layout.itemField, item);
+      write = write(writeStep);
+    });
+    return pos;
+  }
+
+  // Mirrors ArrayLayout::freeze and HashTableLayout::freezeItems.
+  void freezeFields(
+      FreezeRoot& root,
+      const Layout<T>& layout,
+      FreezePosition self) const {
+    root.freezeField(self, layout.countField, count_);
+    if (!count_) {
+      root.freezeField(self, layout.distanceField, 0);
+      return;
+    }
+    folly::MutableByteRange range;
+    size_t dist;
+    root.appendBytes(
+        self.start, itemsBytes(layout), range, dist, itemAlignment());
+    root.freezeField(self, layout.distanceField, dist);
+    freezeIndex(root, layout, self, std::integral_constant<bool, kHashed>());
+
+    FreezePosition write{range.begin(), 0};
+    FieldPosition writeStep = itemStep(layout);
+    forEachItem([&](const Item& item) {
+      root.freezeField(write, layout.itemField, item);
+      write = write(writeStep);
+    });
+  }
+
+  template <class F>
+  void forEachItem(F&& f) const {
+    auto reader = spill_.read();
+    uint64_t key;
+    std::string frozen;
+    while (reader.next(key, frozen)) {
+      Item item;
+      itemLayout_.thaw(
+          ViewPosition{reinterpret_cast<const byte*>(frozen.data()), 0}, item);
+      f(static_cast<const Item&>(item));
+    }
+  }
+
+  size_t sizeHint_;
+  size_t count_{0};
+  Layout<Item> itemLayout_;
+  std::vector<detail::Block> sparseTable_;
+  detail::SpillSorter spill_;
+};
+
+/**
+ * Freezes the items in [begin, end) to file with a StreamingFreezer.
+ */
+template <class T, class Iterator>
+void freezeToFileStreaming(
+    Iterator begin,
+    Iterator end,
+    size_t sizeHint,
+    folly::File file,
+    StreamingFreezeOptions options = StreamingFreezeOptions()) {
+  StreamingFreezer<T> freezer(sizeHint, std::move(options));
+  for (; begin != end; ++begin) {
+    freezer.add(*begin);
+  }
+  freezer.freezeToFile(std::move(file));
+}
+
+/**
+ * Freezes the items returned by next() to file with a StreamingFreezer,
+ * until it returns folly::none.
+ */
+template <class T, class Generator>
+void freezeToFileStreaming(
+    Generator&& next,
+    size_t sizeHint,
+    folly::File file,
+    StreamingFreezeOptions options = StreamingFreezeOptions()) {
+  StreamingFreezer<T> freezer(sizeHint, std::move(options));
+  while (folly::Optional<typename T::value_type> item = next()) {
+    freezer.add(*item);
+  }
+  freezer.freezeToFile(std::move(file));
+}
+
+} // namespace frozen
+} // namespace thrift
+} // namespace apache
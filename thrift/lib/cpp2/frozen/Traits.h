@@ -22,6 +22,8 @@ namespace thrift {
 template <class>
 struct IsString : std::false_type {};
 template <class>
+struct IsDistinctString : std::false_type {};
+template <class>
 struct IsHashMap : std::false_type {};
 template <class>
 struct IsHashSet : std::false_type {};
@@ -32,6 +32,44 @@ TEST(FrozenVectorTypes, Unpacked) {
   const int* raw = fiu.begin();
   EXPECT_EQ(raw[3], 7);
 }
+
+TEST(FrozenStringTypes, Distinct) {
+  const char* countries[] = {"United States", "Brazil", "India", "Germany"};
+  std::vector<std::string> plain;
+  std::vector<DistinctString> distinct;
+  for (int i = 0; i < 1000; ++i) {
+    plain.push_back(countries[i % 4]);
+    distinct.push_back(countries[i % 4]);
+  }
+  plain.push_back("");
+  distinct.push_back("");
+  EXPECT_LT(frozenSize(distinct) * 3, frozenSize(plain));
+
+  auto fd = freeze(distinct);
+  EXPECT_EQ(fd[5], "Brazil");
+  EXPECT_EQ(fd[1000], "");
+  EXPECT_EQ(fd[2].begin(), fd[998].begin());
+  EXPECT_EQ(distinct, fd.thaw());
+
+  std::string str, malloced;
+  freezeToString(distinct, str);
+  freezeToStringMalloc(distinct, malloced);
+  for (auto* frozen : {&str, &malloced}) {
+    auto mapped = mapFrozen<std::vector<DistinctString>>(std::move(*frozen));
+    EXPECT_EQ(distinct, mapped.thaw());
+  }
+}
+
+TEST(FrozenStringTypes, DistinctValues) {
+  std::unordered_map<int32_t, DistinctString> map;
+  for (int32_t i = 0; i < 500; ++i) {
+    map[i] = i % 2 ? "odd" : "even";
+  }
+  auto fm = freeze(map);
+  EXPECT_EQ(fm.at(3), "odd");
+  EXPECT_EQ(fm.at(4), "even");
+  EXPECT_EQ(fm.at(1).begin(), fm.at(499).begin());
+}
 } // namespace frozen
 } // namespace thrift
 } // namespace apache
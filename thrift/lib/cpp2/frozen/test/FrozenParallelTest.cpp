@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp2/frozen/FrozenUtil.h>
+
+using namespace apache::thrift;
+using namespace frozen;
+
+namespace {
+
+class CountingExecutor : public folly::Executor {
+ public:
+  void add(folly::Func func) override {
+    ++added;
+    pool_.add(std::move(func));
+  }
+
+  std::atomic<size_t> added{0};
+
+ private:
+  folly::CPUThreadPoolExecutor pool_{3};
+};
+
+// Keeps its tasks until run() is called.
+class DeferredExecutor : public folly::Executor {
+ public:
+  void add(folly::Func func) override {
+    funcs_.push_back(std::move(func));
+  }
+
+  size_t run() {
+    auto funcs = std::move(funcs_);
+    for (auto& func : funcs) {
+      func();
+    }
+    return funcs.size();
+  }
+
+ private:
+  std::vector<folly::Func> funcs_;
+};
+
+ParallelFreezeOptions fourThreads(
+    folly::Executor* executor,
+    ParallelFreezeStats* stats) {
+  ParallelFreezeOptions options;
+  options.threads = 4;
+  options.minItems = 1000;
+  options.executor = executor;
+  options.stats = stats;
+  return options;
+}
+
+template <class T>
+ParallelFreezeStats expectSameFreeze(const T& value) {
+  std::string serial, parallel;
+  freezeToString(value, serial);
+  CountingExecutor executor;
+  ParallelFreezeStats stats;
+  freezeToString(value, parallel, fourThreads(&executor, &stats));
+  EXPECT_EQ(serial, parallel);
+  EXPECT_EQ(value, mapFrozen<T>(std::move(parallel)).thaw());
+  EXPECT_LT(0, executor.added);
+  return stats;
+}
+
+void expectParallel(const ParallelFreezeStats& stats) {
+  EXPECT_LT(0, stats.parallelLayouts);
+  EXPECT_LT(0, stats.parallelFreezes);
+  EXPECT_EQ(0, stats.serialFallbacks);
+}
+
+} // namespace
+
+TEST(FrozenParallel, Vector) {
+  std::vector<int64_t> value;
+  for (int64_t i = 0; i < 100000; ++i) {
+    // a few late outliers widen the packed items
+    value.push_back(i % 40000 == 39999 ? -i * i : i % 1000);
+  }
+  expectParallel(expectSameFreeze(value));
+}
+
+TEST(FrozenParallel, Pairs) {
+  std::vector<std::pair<int32_t, int16_t>> value;
+  for (int32_t i = 0; i < 20000; ++i) {
+    value.emplace_back(i * 31, i % 7);
+  }
+  expectParallel(expectSameFreeze(value));
+}
+
+TEST(FrozenParallel, HashMap) {
+  std::unordered_map<int64_t, int32_t> value;
+  for (int32_t i = 0; i < 30000; ++i) {
+    value[int64_t(i) * 7919] = i;
+  }
+  expectParallel(expectSameFreeze(value));
+}
+
+TEST(FrozenParallel, HashSetOfStrings) {
+  std::unordered_set<std::string> value;
+  for (int i = 0; i < 10000; ++i) {
+    value.insert(folly::to<std::string>("key", i));
+  }
+  // Only the keys are hashed in parallel: strings have out-of-line data.
+  auto stats = expectSameFreeze(value);
+  EXPECT_EQ(0, stats.parallelLayouts);
+  EXPECT_EQ(0, stats.parallelFreezes);
+  EXPECT_LT(0, stats.serialFallbacks);
+}
+
+TEST(FrozenParallel, SortedMap) {
+  std::map<int32_t, int64_t> value;
+  for (int32_t i = 0; i < 20000; ++i) {
+    value[i * 3] = int64_t(i) << (i % 40);
+  }
+  expectParallel(expectSameFreeze(value));
+}
+
+TEST(FrozenParallel, OutOfLineItems) {
+  std::vector<std::string> value;
+  for (int i = 0; i < 10000; ++i) {
+    value.push_back(i % 100 ? "" : folly::to<std::string>(i));
+  }
+  auto stats = expectSameFreeze(value);
+  EXPECT_EQ(0, stats.parallelFreezes);
+  EXPECT_LT(0, stats.serialFallbacks);
+}
+
+TEST(FrozenParallel, IdleExecutor) {
+  // The calling thread freezes every chunk if no helper gets to run; helpers
+  // started afterwards find nothing left to do.
+  std::vector<int32_t> value(5000);
+  for (int32_t i = 0; i < 5000; ++i) {
+    value[i] = i;
+  }
+  std::string serial, parallel;
+  freezeToString(value, serial);
+  DeferredExecutor executor;
+  ParallelFreezeStats stats;
+  freezeToString(value, parallel, fourThreads(&executor, &stats));
+  EXPECT_EQ(serial, parallel);
+  expectParallel(stats);
+  EXPECT_LT(0, executor.run());
+}
@@ -111,6 +111,67 @@ BENCHMARK_RELATIVE(FrozenThaw, iters) {
   folly::doNotOptimizeAway(s);
 }
 
+BENCHMARK_DRAW_LINE();
+
+const std::vector<int64_t>& bigVector() {
+  static const auto vec = [] {
+    std::vector<int64_t> v(size_t(1) << 23);
+    for (size_t i = 0; i < v.size(); ++i) {
+      v[i] = int64_t(i * 2654435761) % 1000000007;
+    }
+    return v;
+  }();
+  return vec;
+}
+
+const std::unordered_map<int64_t, int32_t>& bigHashMap() {
+  static const auto map = [] {
+    std::unordered_map<int64_t, int32_t> m;
+    for (int32_t i = 0; i < (1 << 21); ++i) {
+      m[int64_t(i) * 7919] = i;
+    }
+    return m;
+  }();
+  return map;
+}
+
+template <class T>
+void freezeWithThreads(size_t iters, const T& value, size_t threads) {
+  size_t s = 0;
+  ParallelFreezeOptions options;
+  options.threads = threads;
+  while (iters--) {
+    std::string out;
+    freezeToString(value, out, options);
+    s += out.size();
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+void freezeVector(size_t iters, size_t threads) {
+  folly::BenchmarkSuspender setup;
+  const auto& value = bigVector();
+  setup.dismiss();
+  freezeWithThreads(iters, value, threads);
+}
+
+void freezeHashMap(size_t iters, size_t threads) {
+  folly::BenchmarkSuspender setup;
+  const auto& value = bigHashMap();
+  setup.dismiss();
+  freezeWithThreads(iters, value, threads);
+}
+
+BENCHMARK_NAMED_PARAM(freezeVector, 1_thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(freezeVector, 2_threads, 2)
+BENCHMARK_RELATIVE_NAMED_PARAM(freezeVector, 4_threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(freezeVector, 8_threads, 8)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(freezeHashMap, 1_thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(freezeHashMap, 2_threads, 2)
+BENCHMARK_RELATIVE_NAMED_PARAM(freezeHashMap, 4_threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(freezeHashMap, 8_threads, 8)
+
 #if 0
 ============================================================================
                                                 relative  time/iter  iters/s
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/stat.h>
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <folly/Conv.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp2/frozen/HintTypes.h>
+#include <thrift/lib/cpp2/frozen/StreamingFreezer.h>
+
+using namespace apache::thrift;
+using namespace frozen;
+
+namespace {
+
+StreamingFreezeOptions smallRuns() {
+  // Forces several sorted runs to be merged.
+  StreamingFreezeOptions options;
+  options.sortBufferBytes = 4096;
+  return options;
+}
+
+} // namespace
+
+TEST(StreamingFreezer, HashMap) {
+  using Map = std::unordered_map<int64_t, std::string>;
+  Map original;
+  for (int64_t i = 0; i < 5000; ++i) {
+    original[i * 7919] = folly::to<std::string>("value", i);
+  }
+
+  folly::test::TemporaryFile tmp;
+  freezeToFileStreaming<Map>(
+      original.begin(),
+      original.end(),
+      original.size(),
+      folly::File(tmp.fd()),
+      smallRuns());
+
+  auto mapped = mapFrozen<Map>(folly::File(tmp.fd()));
+  EXPECT_EQ(original.size(), mapped.size());
+  for (const auto& kv : original) {
+    auto found = mapped.find(kv.first);
+    ASSERT_NE(found, mapped.end());
+    EXPECT_EQ(kv.second, found->second());
+  }
+  EXPECT_EQ(mapped.find(1), mapped.end());
+  EXPECT_EQ(original, mapped.thaw());
+}
+
+TEST(StreamingFreezer, HashSetFromGenerator) {
+  using Set = std::unordered_set<std::string>;
+  Set original;
+  for (int i = 0; i < 1000; ++i) {
+    original.insert(folly::to<std::string>(i * i));
+  }
+
+  folly::test::TemporaryFile streamed;
+  int i = 0;
+  freezeToFileStreaming<Set>(
+      [&]() -> folly::Optional<std::string> {
+        if (i == 1000) {
+          return folly::none;
+        }
+        auto s = folly::to<std::string>(i * i);
+        ++i;
+        return s;
+      },
+      2000,
+      folly::File(streamed.fd()),
+      smallRuns());
+
+  auto mapped = mapFrozen<Set>(folly::File(streamed.fd()));
+  EXPECT_EQ(original.size(), mapped.size());
+  for (const auto& s : original) {
+    EXPECT_EQ(1, mapped.count(s));
+  }
+  EXPECT_EQ(0, mapped.count("2"));
+}
+
+TEST(StreamingFreezer, Vector) {
+  std::vector<int32_t> original;
+  for (int32_t i = 0; i < 10000; ++i) {
+    original.push_back(i % 3 ? i : -i);
+  }
+
+  folly::test::TemporaryFile tmp;
+  freezeToFileStreaming<std::vector<int32_t>>(
+      original.begin(),
+      original.end(),
+      0,
+      folly::File(tmp.fd()),
+      smallRuns());
+
+  auto mapped = mapFrozen<std::vector<int32_t>>(folly::File(tmp.fd()));
+  EXPECT_EQ(original, mapped.thaw());
+}
+
+TEST(StreamingFreezer, VectorOfDistinctStrings) {
+  std::vector<DistinctString> original;
+  for (int i = 0; i < 5000; ++i) {
+    original.push_back(folly::to<std::string>("repeated value ", i % 10));
+  }
+
+  folly::test::TemporaryFile tmp;
+  freezeToFileStreaming<std::vector<DistinctString>>(
+      original.begin(),
+      original.end(),
+      0,
+      folly::File(tmp.fd()),
+      smallRuns());
+
+  auto mapped = mapFrozen<std::vector<DistinctString>>(folly::File(tmp.fd()));
+  EXPECT_EQ(original, mapped.thaw());
+  // Each distinct value is stored once.
+  struct stat st;
+  ASSERT_EQ(0, ::fstat(tmp.fd(), &st));
+  EXPECT_LT(st.st_size, 5000 * 16);
+}
+
+TEST(StreamingFreezer, Empty) {
+  using Map = std::unordered_map<std::string, int32_t>;
+  folly::test::TemporaryFile tmp;
+  StreamingFreezer<Map> freezer(0);
+  freezer.freezeToFile(folly::File(tmp.fd()));
+
+  auto mapped = mapFrozen<Map>(folly::File(tmp.fd()));
+  EXPECT_TRUE(mapped.empty());
+  EXPECT_EQ(mapped.find("missing"), mapped.end());
+}
+
+TEST(StreamingFreezer, SizeHintExceeded) {
+  StreamingFreezer<std::unordered_set<int64_t>> freezer(2);
+  freezer.add(1);
+  freezer.add(2);
+  EXPECT_THROW(freezer.add(3), std::out_of_range);
+}
@@ -543,6 +543,88 @@ void BinaryProtocolReader::readBinary(folly::IOBuf& str) {
   }
 }
 
+size_t BinaryProtocolReader::fixedSizeInContainer(TType type) {
+  switch (type) {
+    case TType::T_BOOL:
+    case TType::T_BYTE:
+      return 1;
+    case TType::T_I16:
+      return 2;
+    case TType::T_I32:
+    case TType::T_FLOAT:
+      return 4;
+    case TType::T_I64:
+    case TType::T_DOUBLE:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+void BinaryProtocolReader::skip(TType type) {
+  switch (type) {
+    case TType::T_BOOL:
+    case TType::T_BYTE:
+    case TType::T_I16:
+    case TType::T_I32:
+    case TType::T_I64:
+    case TType::T_DOUBLE:
+    case TType::T_FLOAT:
+      in_.skip(fixedSizeInContainer(type));
+      return;
+    case TType::T_STRING: {
+      int32_t size;
+      readI32(size);
+      checkStringSize(size);
+      in_.skip(size);
+      return;
+    }
+    case TType::T_STRUCT: {
+      while (true) {
+        auto fieldType = static_cast<TType>(in_.read<int8_t>());
+        if (fieldType == TType::T_STOP) {
+          return;
+        }
+        in_.skip(sizeof(int16_t)); // field id
+        skip(fieldType);
+      }
+    }
+    case TType::T_MAP: {
+      TType keyType;
+      TType valType;
+      uint32_t size;
+      readMapBegin(keyType, valType, size);
+      auto keySize = fixedSizeInContainer(keyType);
+      auto valSize = fixedSizeInContainer(valType);
+      if (keySize && valSize) {
+        in_.skip(size * (keySize + valSize));
+        return;
+      }
+      for (uint32_t i = 0; i < size; i++) {
+        skip(keyType);
+        skip(valType);
+      }
+      return;
+    }
+    case TType::T_SET:
+    case TType::T_LIST: {
+      TType elemType;
+      uint32_t size;
+      readListBegin(elemType, size);
+      if (auto elemSize = fixedSizeInContainer(elemType)) {
+        in_.skip(size * elemSize);
+        return;
+      }
+      for (uint32_t i = 0; i < size; i++) {
+        skip(elemType);
+      }
+      return;
+    }
+    default:
+      return;
+  }
+}
+
 template <typename StrType>
 void BinaryProtocolReader::readStringBody(StrType& str, int32_t size) {
   checkStringSize(size);
@@ -257,9 +257,10 @@ class BinaryProtocolReader {
     return false;
   }
 
-  void skip(TType type) {
-    apache::thrift::skip(*this, type);
-  }
+  // Advances past a value of the given type without materializing it.
+  // Strings and containers of fixed-width elements are jumped over by their
+  // encoded length.
+  inline void skip(TType type);
 
   const Cursor& getCurrentPosition() const {
     return in_;
@@ -314,6 +315,9 @@ class BinaryProtocolReader {
   inline void checkStringSize(int32_t size);
   inline void checkContainerSize(int32_t size);
 
+  // Encoded size of a value of type, or 0 if it is not fixed-width.
+  static inline size_t fixedSizeInContainer(TType type);
+
   [[noreturn]] static void throwBadVersionIdentifier(int32_t sz);
   [[noreturn]] static void throwMissingVersionIdentifier(int32_t sz);
 
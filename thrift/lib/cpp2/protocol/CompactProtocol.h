@@ -163,10 +163,7 @@ class CompactProtocolWriter {
   inline uint32_t writeBinary(const std::unique_ptr<IOBuf>& str);
   inline uint32_t writeBinary(const IOBuf& str);
   inline uint32_t writeSerializedData(
-      const std::unique_ptr<folly::IOBuf>& /*data*/) {
-    // TODO
-    return 0;
-  }
+      const std::unique_ptr<folly::IOBuf>& data);
 
   /**
    * Functions that return the serialized size
@@ -202,10 +199,7 @@ class CompactProtocolWriter {
       std::unique_ptr<IOBuf> const& /*v*/) const;
   inline uint32_t serializedSizeZCBinary(IOBuf const& /*v*/) const;
   inline uint32_t serializedSizeSerializedData(
-      std::unique_ptr<folly::IOBuf> const& /*data*/) const {
-    // TODO (kek)
-    return 0;
-  }
+      std::unique_ptr<folly::IOBuf> const& data) const;
 
  protected:
   /**
@@ -314,9 +308,10 @@ class CompactProtocolReader {
   inline void readBinary(StrType& str);
   inline void readBinary(std::unique_ptr<IOBuf>& str);
   inline void readBinary(IOBuf& str);
-  void skip(TType type) {
-    apache::thrift::skip(*this, type);
-  }
+  // Advances past a value of the given type without materializing it.
+  // Strings and containers of fixed-width elements are jumped over by their
+  // encoded length, varints are stepped over without being decoded.
+  inline void skip(TType type);
   bool peekMap() {
     return false;
   }
@@ -332,11 +327,8 @@ class CompactProtocolReader {
   }
 
   inline uint32_t readFromPositionAndAppend(
-      Cursor& /*cursor*/,
-      std::unique_ptr<folly::IOBuf>& /*ser*/) {
-    // TODO
-    return 0;
-  }
+      Cursor& cursor,
+      std::unique_ptr<folly::IOBuf>& ser);
 
   struct StructReadState {
     int16_t fieldId;
@@ -381,6 +373,12 @@ class CompactProtocolReader {
 
   inline TType getType(int8_t type);
 
+  inline void skipValue(TType type);
+  inline void skipVarints(uint32_t count);
+  // Encoded size of a container element of type, or 0 if it is not
+  // fixed-width.
+  static inline size_t fixedSizeInContainer(TType type);
+
   inline void readStructBeginWithState(StructReadState& state);
   inline void readFieldBeginWithState(StructReadState& state);
   FOLLY_NOINLINE void readFieldBeginWithStateMediumSlow(
@@ -329,6 +329,30 @@ uint32_t CompactProtocolWriter::writeBinary(const folly::IOBuf& str) {
   return result + size;
 }
 
+uint32_t CompactProtocolWriter::writeSerializedData(
+    const std::unique_ptr<IOBuf>& buf) {
+  if (!buf) {
+    return 0;
+  }
+  // The data holds one complete value. A nested struct carries its own
+  // field id deltas, so lastFieldId_ stays valid for the enclosing struct.
+  if (UNLIKELY(booleanField_.name != nullptr)) {
+    // The value of a bool field is encoded in the pending field header, so
+    // it can't be spliced.
+    Cursor cursor(buf.get());
+    return writeBool(
+        cursor.read<int8_t>() == detail::compact::CT_BOOLEAN_TRUE);
+  }
+  // Like writeBinary(), chains the data instead of copying it into the
+  // preallocated output buffer.
+  auto clone = buf->clone();
+  if (sharing_ != SHARE_EXTERNAL_BUFFER) {
+    clone->makeManaged();
+  }
+  out_.insert(std::move(clone));
+  return buf->computeChainDataLength();
+}
+
 /**
  * Functions that return the serialized size
  */
@@ -467,6 +491,13 @@ uint32_t CompactProtocolWriter::serializedSizeZCBinary(
   return serializedSizeI32();
 }
 
+uint32_t CompactProtocolWriter::serializedSizeSerializedData(
+    std::unique_ptr<IOBuf> const& /*data*/) const {
+  // writeSerializedData's implementation just chains IOBufs together. Thus
+  // we don't expect external buffer space for it.
+  return 0;
+}
+
 /**
  * Reading functions
  */
@@ -721,6 +752,27 @@ void CompactProtocolReader::readBinary(folly::IOBuf& str) {
   }
 }
 
+uint32_t CompactProtocolReader::readFromPositionAndAppend(
+    Cursor& snapshot,
+    std::unique_ptr<IOBuf>& ser) {
+  int32_t size = folly::io::Cursor(in_) - snapshot;
+
+  std::unique_ptr<IOBuf> newBuf;
+  snapshot.clone(newBuf, size);
+  if (sharing_ != SHARE_EXTERNAL_BUFFER) {
+    newBuf->makeManaged();
+  }
+  if (ser) {
+    // IOBuf are circular, so prependChain called on head is the same as
+    // appending the whole chain at the tail.
+    ser->prependChain(std::move(newBuf));
+  } else {
+    ser = std::move(newBuf);
+  }
+
+  return (uint32_t)size;
+}
+
 TType CompactProtocolReader::getType(int8_t type) {
   using detail::compact::CTypeToTType;
   if (LIKELY(
@@ -731,6 +783,125 @@ TType CompactProtocolReader::getType(int8_t type) {
   throwBadType(type);
 }
 
+size_t CompactProtocolReader::fixedSizeInContainer(TType type) {
+  switch (type) {
+    case TType::T_BOOL:
+    case TType::T_BYTE:
+      return 1;
+    case TType::T_FLOAT:
+      return 4;
+    case TType::T_DOUBLE:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+void CompactProtocolReader::skipVarints(uint32_t count) {
+  // Every varint ends with the first byte that has the MSB clear, so there is
+  // no need to decode them.
+  while (count > 0) {
+    auto data = in_.peekBytes();
+    if (data.empty()) {
+      TProtocolException::throwExceededSizeLimit();
+    }
+    size_t i = 0;
+    while (i < data.size() && count > 0) {
+      if (!(data[i++] & 0x80)) {
+        --count;
+      }
+    }
+    in_.skipNoAdvance(i);
+  }
+}
+
+void CompactProtocolReader::skip(TType type) {
+  // A bool field's value lives in the field header read by readFieldBegin.
+  if (type == TType::T_BOOL && boolValue_.hasBoolValue) {
+    boolValue_.hasBoolValue = false;
+    return;
+  }
+  skipValue(type);
+}
+
+void CompactProtocolReader::skipValue(TType type) {
+  switch (type) {
+    case TType::T_BOOL:
+    case TType::T_BYTE:
+    case TType::T_DOUBLE:
+    case TType::T_FLOAT:
+      in_.skip(fixedSizeInContainer(type));
+      return;
+    case TType::T_I16:
+    case TType::T_I32:
+    case TType::T_I64:
+      skipVarints(1);
+      return;
+    case TType::T_STRING: {
+      int32_t size = 0;
+      readStringSize(size);
+      in_.skip(size);
+      return;
+    }
+    case TType::T_STRUCT: {
+      // Field id deltas only matter to readers of the fields, so the struct
+      // can be walked without touching lastField_.
+      while (true) {
+        auto byte = in_.read<uint8_t>();
+        uint8_t ctype = byte & 0x0f;
+        if (ctype == detail::compact::CT_STOP) {
+          return;
+        }
+        if ((byte & 0xf0) == 0) {
+          skipVarints(1); // field id
+        }
+        if (ctype == detail::compact::CT_BOOLEAN_TRUE ||
+            ctype == detail::compact::CT_BOOLEAN_FALSE) {
+          continue;
+        }
+        skipValue(getType(ctype));
+      }
+    }
+    case TType::T_MAP: {
+      TType keyType;
+      TType valType;
+      uint32_t size;
+      readMapBegin(keyType, valType, size);
+      auto keySize = fixedSizeInContainer(keyType);
+      auto valSize = fixedSizeInContainer(valType);
+      if (keySize && valSize) {
+        in_.skip(size * (keySize + valSize));
+        return;
+      }
+      for (uint32_t i = 0; i < size; i++) {
+        skipValue(keyType);
+        skipValue(valType);
+      }
+      return;
+    }
+    case TType::T_SET:
+    case TType::T_LIST: {
+      TType elemType;
+      uint32_t size;
+      readListBegin(elemType, size);
+      if (auto elemSize = fixedSizeInContainer(elemType)) {
+        in_.skip(size * elemSize);
+      } else if (
+          elemType == TType::T_I16 || elemType == TType::T_I32 ||
+          elemType == TType::T_I64) {
+        skipVarints(size);
+      } else {
+        for (uint32_t i = 0; i < size; i++) {
+          skipValue(elemType);
+        }
+      }
+      return;
+    }
+    default:
+      return;
+  }
+}
+
 FOLLY_ALWAYS_INLINE bool
 CompactProtocolReader::matchTypeHeader(uint8_t byte, TType type, uint8_t diff) {
   if (type == TType::T_BOOL) {
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+#include <thrift/lib/cpp2/protocol/Cpp2Ops.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * Set of field paths to deserialize with the generated readProjected()
+ * (thrift compiled with `mstch_cpp2:field_projection`).
+ *
+ * A path is a list of field ids, one per level of nesting: {3} selects all of
+ * field 3, {3, 1} selects only field 1 of the struct stored in field 3.
+ * Fields that are not selected are skipped on the wire and left untouched.
+ *
+ *   FieldMask mask{{1}, {7, 2}};
+ *   CompactSerializer::deserializeProjected(buf, obj, mask);
+ */
+class FieldMask {
+ public:
+  FieldMask() = default;
+  FieldMask(std::initializer_list<std::initializer_list<int16_t>> paths) {
+    for (auto path : paths) {
+      add(folly::range(path.begin(), path.end()));
+    }
+  }
+
+  FieldMask(FieldMask&&) = default;
+  FieldMask& operator=(FieldMask&&) = default;
+  FieldMask(const FieldMask& other) {
+    *this = other;
+  }
+  FieldMask& operator=(const FieldMask& other) {
+    fields_.clear();
+    fields_.reserve(other.fields_.size());
+    for (const auto& field : other.fields_) {
+      fields_.emplace_back(
+          field.first,
+          field.second ? std::make_unique<FieldMask>(*field.second) : nullptr);
+    }
+    return *this;
+  }
+
+  FieldMask& add(folly::Range<const int16_t*> path) {
+    if (path.empty()) {
+      return *this;
+    }
+    auto it = std::lower_bound(
+        fields_.begin(), fields_.end(), path.front(), [](auto& f, int16_t id) {
+          return f.first < id;
+        });
+    if (it == fields_.end() || it->first != path.front()) {
+      // A new field, selected as a whole unless the path goes deeper.
+      it = fields_.emplace(
+          it,
+          path.front(),
+          path.size() > 1 ? std::make_unique<FieldMask>() : nullptr);
+    } else if (!it->second) {
+      // Already selected as a whole.
+      return *this;
+    } else if (path.size() == 1) {
+      it->second = nullptr;
+      return *this;
+    }
+    if (it->second) {
+      it->second->add(path.subpiece(1));
+    }
+    return *this;
+  }
+
+  FieldMask& add(std::initializer_list<int16_t> path) {
+    return add(folly::range(path.begin(), path.end()));
+  }
+
+  bool empty() const {
+    return fields_.empty();
+  }
+
+  /**
+   * Returns whether fieldId is selected. If it is, nested is set to the mask
+   * of its sub-fields, or to nullptr if the field is selected as a whole.
+   */
+  bool select(int16_t fieldId, const FieldMask*& nested) const {
+    // Masks are typically a handful of fields; a linear scan beats a binary
+    // search at that size.
+    for (const auto& field : fields_) {
+      if (field.first >= fieldId) {
+        if (field.first != fieldId) {
+          return false;
+        }
+        nested = field.second.get();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool selects(int16_t fieldId) const {
+    const FieldMask* nested;
+    return select(fieldId, nested);
+  }
+
+ private:
+  // Sorted by field id.
+  std::vector<std::pair<int16_t, std::unique_ptr<FieldMask>>> fields_;
+};
+
+namespace detail {
+
+template <class T, class Protocol, class = void>
+struct HasReadProjected : std::false_type {};
+
+template <class T, class Protocol>
+struct HasReadProjected<
+    T,
+    Protocol,
+    decltype(std::declval<T&>().readProjected(
+        std::declval<Protocol*>(),
+        std::declval<const FieldMask&>()))> : std::true_type {};
+
+/**
+ * Reads a nested struct field through its own readProjected() when the mask
+ * goes deeper and the type was generated with projection support, and reads
+ * it whole otherwise.
+ */
+template <class Protocol, class T>
+typename std::enable_if<HasReadProjected<T, Protocol>::value>::type
+readProjected(Protocol* iprot, T& obj, const FieldMask* nested) {
+  if (nested) {
+    obj.readProjected(iprot, *nested);
+  } else {
+    Cpp2Ops<T>::read(iprot, &obj);
+  }
+}
+
+template <class Protocol, class T>
+typename std::enable_if<!HasReadProjected<T, Protocol>::value>::type
+readProjected(Protocol* iprot, T& obj, const FieldMask* /* nested */) {
+  Cpp2Ops<T>::read(iprot, &obj);
+}
+
+} // namespace detail
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/Likely.h>
+#include <folly/io/IOBuf.h>
+#include <folly/synchronization/SaturatingSemaphore.h>
+#include <thrift/lib/cpp2/protocol/BinaryProtocol.h>
+#include <thrift/lib/cpp2/protocol/CompactProtocol.h>
+#include <thrift/lib/cpp2/protocol/Cpp2Ops.h>
+
+namespace apache {
+namespace thrift {
+
+namespace detail {
+
+// Protocols whose serialized struct values LazyField can capture and splice
+// back verbatim. Other protocols, including CompactV1 which shares Compact's
+// protocol id, read and write the value eagerly.
+template <class Protocol>
+struct LazyFieldProtocol : std::integral_constant<int, -1> {};
+
+template <>
+struct LazyFieldProtocol<BinaryProtocolReader>
+    : std::integral_constant<int, protocol::T_BINARY_PROTOCOL> {};
+template <>
+struct LazyFieldProtocol<BinaryProtocolWriter>
+    : std::integral_constant<int, protocol::T_BINARY_PROTOCOL> {};
+template <>
+struct LazyFieldProtocol<CompactProtocolReader>
+    : std::integral_constant<int, protocol::T_COMPACT_PROTOCOL> {};
+template <>
+struct LazyFieldProtocol<CompactProtocolWriter>
+    : std::integral_constant<int, protocol::T_COMPACT_PROTOCOL> {};
+
+} // namespace detail
+
+/**
+ * Storage for struct fields annotated with `cpp.lazy`.
+ *
+ * read() only records the serialized bytes of the value, sharing the input
+ * IOBuf, and the value is deserialized on first access. As long as it is not
+ * accessed mutably, write() to the same protocol splices the recorded bytes
+ * back verbatim, which makes forwarding a struct nearly free.
+ *
+ * Concurrent const access is safe: one caller of value() deserializes and
+ * the others wait for it. If the recorded bytes do not deserialize, value()
+ * throws the same error on every call until the field is assigned or
+ * cleared, and write() still splices the bytes back.
+ */
+template <class T>
+class LazyField {
+ public:
+  LazyField() = default;
+  explicit LazyField(T value) : value_(std::move(value)) {}
+
+  LazyField(const LazyField& other) {
+    auto state = other.settle();
+    value_ = other.value_;
+    if (other.serialized_) {
+      serialized_ = other.serialized_->clone();
+    }
+    protocol_ = other.protocol_;
+    error_ = other.error_;
+    state_.store(state, std::memory_order_relaxed);
+  }
+
+  LazyField(LazyField&& other) noexcept
+      : value_(std::move(other.value_)),
+        serialized_(std::move(other.serialized_)),
+        protocol_(other.protocol_),
+        error_(std::move(other.error_)),
+        state_(other.state_.load(std::memory_order_relaxed)) {
+    other.state_.store(kReady, std::memory_order_relaxed);
+  }
+
+  LazyField& operator=(const LazyField& other) {
+    if (this != &other) {
+      LazyField tmp(other);
+      *this = std::move(tmp);
+    }
+    return *this;
+  }
+
+  LazyField& operator=(LazyField&& other) noexcept {
+    value_ = std::move(other.value_);
+    serialized_ = std::move(other.serialized_);
+    protocol_ = other.protocol_;
+    error_ = std::move(other.error_);
+    state_.store(
+        other.state_.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    decoded_.reset();
+    other.state_.store(kReady, std::memory_order_relaxed);
+    return *this;
+  }
+
+  // Replaces the value, without deserializing the recorded one.
+  template <
+      class U,
+      class = typename std::enable_if<
+          !std::is_same<typename std::decay<U>::type, LazyField>::value>::type>
+  LazyField& operator=(U&& value) {
+    value_ = std::forward<U>(value);
+    serialized_.reset();
+    error_ = folly::exception_wrapper();
+    state_.store(kReady, std::memory_order_relaxed);
+    return *this;
+  }
+
+  const T& value() const {
+    if (UNLIKELY(state_.load(std::memory_order_acquire) != kReady)) {
+      materialize();
+    }
+    return value_;
+  }
+
+  // Deserializes the value if needed and forgets the recorded bytes, since
+  // the caller may change it.
+  T& mutable_value() {
+    value();
+    serialized_.reset();
+    return value_;
+  }
+
+  // Whether the value is still only held in serialized form.
+  bool isPending() const {
+    return state_.load(std::memory_order_acquire) == kPending;
+  }
+
+  void clear() {
+    Cpp2Ops<T>::clear(&value_);
+    serialized_.reset();
+    error_ = folly::exception_wrapper();
+    state_.store(kReady, std::memory_order_relaxed);
+  }
+
+  template <class Protocol>
+  void read(Protocol* iprot) {
+    readImpl(
+        iprot,
+        std::integral_constant<
+            bool,
+            detail::LazyFieldProtocol<Protocol>::value >= 0>());
+  }
+
+  template <class Protocol>
+  uint32_t write(Protocol* prot) const {
+    if (canSplice<Protocol>()) {
+      return prot->writeSerializedData(serialized_);
+    }
+    return Cpp2Ops<T>::write(prot, &value());
+  }
+
+  template <class Protocol>
+  uint32_t serializedSize(Protocol const* prot) const {
+    if (canSplice<Protocol>()) {
+      return serialized_->computeChainDataLength();
+    }
+    return Cpp2Ops<T>::serializedSize(prot, &value());
+  }
+
+  template <class Protocol>
+  uint32_t serializedSizeZC(Protocol const* prot) const {
+    if (canSplice<Protocol>()) {
+      return prot->serializedSizeSerializedData(serialized_);
+    }
+    return Cpp2Ops<T>::serializedSizeZC(prot, &value());
+  }
+
+ private:
+  // value_ is valid in kReady only. Readers move a field from kPending to
+  // kDecoding, and from there to kReady or kFailed; anything else is a
+  // mutation, which is not concurrent with readers.
+  enum State : uint8_t { kReady, kPending, kDecoding, kFailed };
+
+  template <class Protocol>
+  bool canSplice() const {
+    return serialized_ &&
+        detail::LazyFieldProtocol<Protocol>::value == protocol_;
+  }
+
+  template <class Protocol>
+  void readImpl(Protocol* iprot, std::true_type) {
+    auto snapshot = iprot->getCurrentPosition();
+    iprot->skip(Cpp2Ops<T>::thriftType());
+    serialized_.reset();
+    iprot->readFromPositionAndAppend(snapshot, serialized_);
+    protocol_ = detail::LazyFieldProtocol<Protocol>::value;
+    error_ = folly::exception_wrapper();
+    decoded_.reset();
+    state_.store(kPending, std::memory_order_release);
+  }
+
+  template <class Protocol>
+  void readImpl(Protocol* iprot, std::false_type) {
+    if (state_.load(std::memory_order_relaxed) != kReady) {
+      // The previous value was never deserialized.
+      clear();
+    }
+    serialized_.reset();
+    Cpp2Ops<T>::read(iprot, &value_);
+  }
+
+  template <class Reader>
+  void deserializeWith() const {
+    Reader reader;
+    reader.setInput(serialized_.get());
+    Cpp2Ops<T>::read(&reader, &value_);
+  }
+
+  // Waits for a concurrent deserialization, and returns the final state.
+  State settle() const {
+    auto state = state_.load(std::memory_order_acquire);
+    if (state == kDecoding) {
+      decoded_.wait();
+      state = state_.load(std::memory_order_acquire);
+    }
+    return state;
+  }
+
+  void materialize() const {
+    auto expected = kPending;
+    if (state_.compare_exchange_strong(
+            expected, kDecoding, std::memory_order_acquire)) {
+      try {
+        if (protocol_ == protocol::T_BINARY_PROTOCOL) {
+          deserializeWith<BinaryProtocolReader>();
+        } else {
+          deserializeWith<CompactProtocolReader>();
+        }
+      } catch (...) {
+        Cpp2Ops<T>::clear(&value_);
+        error_ = folly::exception_wrapper(std::current_exception());
+        state_.store(kFailed, std::memory_order_release);
+        decoded_.post();
+        throw;
+      }
+      state_.store(kReady, std::memory_order_release);
+      decoded_.post();
+      return;
+    }
+    if (settle() == kFailed) {
+      error_.throw_exception();
+    }
+  }
+
+  mutable T value_{};
+  // The value as read from the wire, kept while the value is unchanged.
+  std::unique_ptr<folly::IOBuf> serialized_;
+  int protocol_{-1};
+  // Why the recorded bytes did not deserialize, in kFailed.
+  mutable folly::exception_wrapper error_;
+  mutable std::atomic<State> state_{kReady};
+  // Posted when a reader leaves kDecoding, for the readers waiting on it.
+  mutable folly::SaturatingSemaphore<true> decoded_;
+};
+
+template <class T>
+bool operator==(const LazyField<T>& lhs, const LazyField<T>& rhs) {
+  return lhs.value() == rhs.value();
+}
+
+template <class T>
+bool operator!=(const LazyField<T>& lhs, const LazyField<T>& rhs) {
+  return !(lhs == rhs);
+}
+
+template <class T>
+bool operator<(const LazyField<T>& lhs, const LazyField<T>& rhs) {
+  return lhs.value() < rhs.value();
+}
+
+template <class T>
+void swap(LazyField<T>& a, LazyField<T>& b) {
+  LazyField<T> tmp(std::move(a));
+  a = std::move(b);
+  b = std::move(tmp);
+}
+
+} // namespace thrift
+} // namespace apache
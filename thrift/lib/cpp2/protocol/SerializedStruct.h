@@ -0,0 +1,203 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <thrift/lib/cpp2/protocol/Cpp2Ops.h>
+#include <thrift/lib/cpp2/protocol/LazyField.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * A struct of type T held as its Binary or Compact serialization, e.g. as
+ * kept in a cache.
+ *
+ * Writing it to the protocol it was serialized with splices the bytes into
+ * the output by reference, without copying or re-serializing them. Other
+ * protocols deserialize and write the value. Reading it with the Binary or
+ * Compact protocol records the bytes of the struct without deserializing
+ * them.
+ *
+ * Use it in place of T through a typedef, e.g. as a method's return type:
+ *
+ *   typedef Value (cpp.type = "apache::thrift::SerializedStruct<Value>")
+ *       CachedValue
+ *
+ * T may be incomplete where SerializedStruct<T> is declared.
+ */
+template <class T>
+class SerializedStruct {
+ public:
+  SerializedStruct() = default;
+
+  // Takes the bytes of a T serialized with the given protocol.
+  explicit SerializedStruct(
+      std::unique_ptr<folly::IOBuf> data,
+      protocol::PROTOCOL_TYPES protocol = protocol::T_COMPACT_PROTOCOL)
+      : data_(std::move(data)), protocol_(protocol) {}
+
+  SerializedStruct(const SerializedStruct& other)
+      : data_(other.data_ ? other.data_->clone() : nullptr),
+        protocol_(other.protocol_) {}
+  SerializedStruct(SerializedStruct&&) = default;
+
+  SerializedStruct& operator=(const SerializedStruct& other) {
+    SerializedStruct tmp(other);
+    return *this = std::move(tmp);
+  }
+  SerializedStruct& operator=(SerializedStruct&&) = default;
+
+  template <class ProtocolWriter = CompactProtocolWriter>
+  static SerializedStruct serialize(const T& value) {
+    static_assert(
+        detail::LazyFieldProtocol<ProtocolWriter>::value >= 0,
+        "SerializedStruct only holds Binary or Compact data");
+    folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+    ProtocolWriter writer;
+    writer.setOutput(&queue);
+    Cpp2Ops<T>::write(&writer, &value);
+    return SerializedStruct(
+        queue.move(),
+        static_cast<protocol::PROTOCOL_TYPES>(
+            detail::LazyFieldProtocol<ProtocolWriter>::value));
+  }
+
+  T deserialize() const {
+    T value;
+    if (data_) {
+      if (protocol_ == protocol::T_BINARY_PROTOCOL) {
+        deserializeWith<BinaryProtocolReader>(value);
+      } else {
+        deserializeWith<CompactProtocolReader>(value);
+      }
+    }
+    return value;
+  }
+
+  // Null if default constructed, which stands for a default T.
+  const std::unique_ptr<folly::IOBuf>& data() const {
+    return data_;
+  }
+
+  protocol::PROTOCOL_TYPES protocol() const {
+    return protocol_;
+  }
+
+  template <class Protocol>
+  uint32_t write(Protocol* prot) const {
+    if (canSplice<Protocol>()) {
+      return prot->writeSerializedData(data_);
+    }
+    auto value = deserialize();
+    return Cpp2Ops<T>::write(prot, &value);
+  }
+
+  template <class Protocol>
+  void read(Protocol* iprot) {
+    readImpl(
+        iprot,
+        std::integral_constant<
+            bool,
+            detail::LazyFieldProtocol<Protocol>::value >= 0>());
+  }
+
+  template <class Protocol>
+  uint32_t serializedSize(Protocol const* prot) const {
+    if (canSplice<Protocol>()) {
+      return data_->computeChainDataLength();
+    }
+    auto value = deserialize();
+    return Cpp2Ops<T>::serializedSize(prot, &value);
+  }
+
+  template <class Protocol>
+  uint32_t serializedSizeZC(Protocol const* prot) const {
+    if (canSplice<Protocol>()) {
+      return prot->serializedSizeSerializedData(data_);
+    }
+    auto value = deserialize();
+    return Cpp2Ops<T>::serializedSizeZC(prot, &value);
+  }
+
+ private:
+  template <class Protocol>
+  bool canSplice() const {
+    return data_ && detail::LazyFieldProtocol<Protocol>::value == protocol_;
+  }
+
+  template <class Protocol>
+  void readImpl(Protocol* iprot, std::true_type) {
+    auto snapshot = iprot->getCurrentPosition();
+    iprot->skip(protocol::T_STRUCT);
+    data_.reset();
+    iprot->readFromPositionAndAppend(snapshot, data_);
+    protocol_ = static_cast<protocol::PROTOCOL_TYPES>(
+        detail::LazyFieldProtocol<Protocol>::value);
+  }
+
+  template <class Protocol>
+  void readImpl(Protocol* iprot, std::false_type) {
+    T value;
+    Cpp2Ops<T>::read(iprot, &value);
+    *this = serialize(value);
+  }
+
+  template <class Reader>
+  void deserializeWith(T& value) const {
+    Reader reader;
+    reader.setInput(data_.get());
+    Cpp2Ops<T>::read(&reader, &value);
+  }
+
+  std::unique_ptr<folly::IOBuf> data_;
+  protocol::PROTOCOL_TYPES protocol_{protocol::T_COMPACT_PROTOCOL};
+};
+
+template <class T>
+class Cpp2Ops<SerializedStruct<T>> {
+ public:
+  typedef SerializedStruct<T> Type;
+  static constexpr protocol::TType thriftType() {
+    return protocol::T_STRUCT;
+  }
+  static void clear(Type* value) {
+    *value = Type();
+  }
+  template <class Protocol>
+  static uint32_t write(Protocol* prot, const Type* value) {
+    return value->write(prot);
+  }
+  template <class Protocol>
+  static void read(Protocol* prot, Type* value) {
+    value->read(prot);
+  }
+  template <class Protocol>
+  static uint32_t serializedSize(Protocol* prot, const Type* value) {
+    return value->serializedSize(prot);
+  }
+  template <class Protocol>
+  static uint32_t serializedSizeZC(Protocol* prot, const Type* value) {
+    return value->serializedSizeZC(prot);
+  }
+};
+
+} // namespace thrift
+} // namespace apache
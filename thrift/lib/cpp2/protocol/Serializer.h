@@ -26,6 +26,7 @@
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/BinaryProtocol.h>
 #include <thrift/lib/cpp2/protocol/CompactProtocol.h>
+#include <thrift/lib/cpp2/protocol/FieldMask.h>
 #include <thrift/lib/cpp2/protocol/JSONProtocol.h>
 #include <thrift/lib/cpp2/protocol/Protocol.h>
 #include <thrift/lib/cpp2/protocol/SimpleJSONProtocol.h>
@@ -59,6 +60,22 @@ struct Serializer {
         .getCurrentPosition();
   }
 
+  /**
+   * Deserializes only the fields of obj selected by mask, skipping the rest.
+   * T must be generated with the `field_projection` option.
+   */
+  template <class T>
+  static size_t deserializeProjected(
+      const folly::IOBuf* buf,
+      T& obj,
+      const FieldMask& mask,
+      ExternalBufferSharing sharing = COPY_EXTERNAL_BUFFER) {
+    Reader reader(sharing);
+    reader.setInput(buf);
+    obj.readProjected(&reader, mask);
+    return reader.getCurrentPosition().getCurrentPosition();
+  }
+
   template <class T>
   static size_t deserialize(
       folly::ByteRange range,
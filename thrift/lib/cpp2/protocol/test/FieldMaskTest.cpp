@@ -0,0 +1,70 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp2/protocol/FieldMask.h>
+
+using apache::thrift::FieldMask;
+
+TEST(FieldMaskTest, emptyMaskSelectsNothing) {
+  FieldMask mask;
+  EXPECT_TRUE(mask.empty());
+  EXPECT_FALSE(mask.selects(1));
+}
+
+TEST(FieldMaskTest, selectsWholeFields) {
+  FieldMask mask{{3}, {1}, {-2}};
+  const FieldMask* nested = &mask;
+  for (int16_t id : {-2, 1, 3}) {
+    EXPECT_TRUE(mask.select(id, nested));
+    EXPECT_EQ(nullptr, nested);
+  }
+  for (int16_t id : {-1, 0, 2, 4}) {
+    EXPECT_FALSE(mask.selects(id));
+  }
+}
+
+TEST(FieldMaskTest, selectsNestedFields) {
+  FieldMask mask{{7, 2}, {7, 5, 1}};
+  const FieldMask* nested = nullptr;
+  ASSERT_TRUE(mask.select(7, nested));
+  ASSERT_NE(nullptr, nested);
+  EXPECT_TRUE(nested->selects(2));
+  EXPECT_FALSE(nested->selects(1));
+
+  const FieldMask* inner = nullptr;
+  ASSERT_TRUE(nested->select(5, inner));
+  ASSERT_NE(nullptr, inner);
+  EXPECT_TRUE(inner->selects(1));
+}
+
+TEST(FieldMaskTest, shorterPathSelectsWholeField) {
+  FieldMask mask{{7, 2}, {7}, {7, 3}};
+  const FieldMask* nested = &mask;
+  EXPECT_TRUE(mask.select(7, nested));
+  EXPECT_EQ(nullptr, nested);
+}
+
+TEST(FieldMaskTest, copyIsDeep) {
+  FieldMask mask{{7, 2}};
+  FieldMask copy = mask;
+  mask.add({7});
+  const FieldMask* nested = nullptr;
+  ASSERT_TRUE(copy.select(7, nested));
+  ASSERT_NE(nullptr, nested);
+  EXPECT_TRUE(nested->selects(2));
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits>
+
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp2/protocol/BinaryProtocol.h>
+#include <thrift/lib/cpp2/protocol/CompactProtocol.h>
+#include <thrift/lib/cpp2/protocol/CompactV1Protocol.h>
+
+using namespace folly;
+using namespace apache::thrift;
+using namespace apache::thrift::protocol;
+
+namespace {
+
+constexpr int32_t kSentinel = 0x5a5a5a5a;
+
+template <typename Writer>
+void writeNested(Writer& writer) {
+  writer.writeStructBegin("Nested");
+  writer.writeFieldBegin("flag", TType::T_BOOL, 1);
+  writer.writeBool(false);
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("id", TType::T_I64, 2);
+  writer.writeI64(-1);
+  writer.writeFieldEnd();
+  writer.writeFieldStop();
+  writer.writeStructEnd();
+}
+
+// Exercises every branch of skip(): delta and long field ids, bool fields,
+// varints of every width, fixed-width and variable-width containers and
+// empty containers.
+template <typename Writer>
+void writeEverything(Writer& writer) {
+  writer.writeStructBegin("Everything");
+  writer.writeFieldBegin("flag", TType::T_BOOL, 1);
+  writer.writeBool(true);
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("byte", TType::T_BYTE, 2);
+  writer.writeByte(-7);
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("i16", TType::T_I16, 3);
+  writer.writeI16(-1017);
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("i64", TType::T_I64, 4);
+  writer.writeI64(-5000000017);
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("double", TType::T_DOUBLE, 5);
+  writer.writeDouble(5.25);
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("float", TType::T_FLOAT, 6);
+  writer.writeFloat(5.25f);
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("str", TType::T_STRING, 100);
+  writer.writeString(std::string(300, 'x'));
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("ints", TType::T_LIST, 101);
+  writer.writeListBegin(TType::T_I32, 100);
+  for (int32_t i = 0; i < 100; ++i) {
+    writer.writeI32(i * 100003 - 5000000);
+  }
+  writer.writeListEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("doubles", TType::T_LIST, 102);
+  writer.writeListBegin(TType::T_DOUBLE, 20);
+  for (int i = 0; i < 20; ++i) {
+    writer.writeDouble(i * 0.5);
+  }
+  writer.writeListEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("flags", TType::T_SET, 103);
+  writer.writeSetBegin(TType::T_BOOL, 2);
+  writer.writeBool(false);
+  writer.writeBool(true);
+  writer.writeSetEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("fixedMap", TType::T_MAP, 104);
+  writer.writeMapBegin(TType::T_BYTE, TType::T_FLOAT, 5);
+  for (int8_t i = 0; i < 5; ++i) {
+    writer.writeByte(i);
+    writer.writeFloat(i * 1.5f);
+  }
+  writer.writeMapEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("map", TType::T_MAP, 105);
+  writer.writeMapBegin(TType::T_STRING, TType::T_I64, 3);
+  for (auto key : {"foo", "bar", "baz"}) {
+    writer.writeString(key);
+    writer.writeI64(std::numeric_limits<int64_t>::min());
+  }
+  writer.writeMapEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("structs", TType::T_LIST, 106);
+  writer.writeListBegin(TType::T_STRUCT, 3);
+  for (int i = 0; i < 3; ++i) {
+    writeNested(writer);
+  }
+  writer.writeListEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("emptyMap", TType::T_MAP, 107);
+  writer.writeMapBegin(TType::T_STRING, TType::T_STRING, 0);
+  writer.writeMapEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("emptyList", TType::T_LIST, 108);
+  writer.writeListBegin(TType::T_STRING, 0);
+  writer.writeListEnd();
+  writer.writeFieldEnd();
+  writer.writeFieldBegin("nested", TType::T_STRUCT, -1);
+  writeNested(writer);
+  writer.writeFieldEnd();
+  writer.writeFieldStop();
+  writer.writeStructEnd();
+}
+
+// Copies buf into a chain of chunkSize-byte IOBufs.
+std::unique_ptr<IOBuf> fragment(const IOBuf& buf, size_t chunkSize) {
+  auto data = buf.cloneCoalescedAsValue();
+  std::unique_ptr<IOBuf> chain;
+  for (size_t pos = 0; pos < data.length(); pos += chunkSize) {
+    auto chunk = IOBuf::copyBuffer(
+        data.data() + pos, std::min(chunkSize, data.length() - pos));
+    if (chain) {
+      chain->prependChain(std::move(chunk));
+    } else {
+      chain = std::move(chunk);
+    }
+  }
+  return chain;
+}
+
+template <typename Reader>
+class SkipTest : public testing::Test {
+ protected:
+  std::unique_ptr<IOBuf> serialize() {
+    IOBufQueue queue(IOBufQueue::cacheChainLength());
+    typename Reader::ProtocolWriter writer;
+    writer.setOutput(&queue);
+    writeEverything(writer);
+    writer.writeI32(kSentinel);
+    return queue.move();
+  }
+
+  void expectSkipsEverything(const IOBuf* buf) {
+    Reader reader;
+    reader.setInput(buf);
+    reader.skip(TType::T_STRUCT);
+    int32_t sentinel;
+    reader.readI32(sentinel);
+    EXPECT_EQ(kSentinel, sentinel);
+    EXPECT_TRUE(reader.getCurrentPosition().isAtEnd());
+  }
+};
+
+using Readers = testing::
+    Types<BinaryProtocolReader, CompactProtocolReader, CompactV1ProtocolReader>;
+
+} // namespace
+
+TYPED_TEST_CASE(SkipTest, Readers);
+
+TYPED_TEST(SkipTest, skipsWholeStruct) {
+  auto buf = this->serialize();
+  this->expectSkipsEverything(buf.get());
+}
+
+TYPED_TEST(SkipTest, skipsAcrossBufferBoundaries) {
+  auto buf = this->serialize();
+  for (size_t chunkSize : {1, 3, 7, 64}) {
+    SCOPED_TRACE(chunkSize);
+    auto chain = fragment(*buf, chunkSize);
+    this->expectSkipsEverything(chain.get());
+  }
+}
+
+TYPED_TEST(SkipTest, matchesGenericSkip) {
+  auto buf = this->serialize();
+  TypeParam reader;
+  reader.setInput(buf.get());
+  apache::thrift::skip(reader, TType::T_STRUCT);
+  auto genericSkipped = buf->computeChainDataLength() -
+      reader.getCurrentPosition().totalLength();
+
+  reader.setInput(buf.get());
+  reader.skip(TType::T_STRUCT);
+  EXPECT_EQ(
+      genericSkipped,
+      buf->computeChainDataLength() -
+          reader.getCurrentPosition().totalLength());
+}
+
+TYPED_TEST(SkipTest, skipsFieldsOneByOne) {
+  // What generated code does for unknown fields: readFieldBegin, then skip.
+  auto buf = this->serialize();
+  TypeParam reader;
+  reader.setInput(buf.get());
+  std::string name;
+  TType fieldType;
+  int16_t fieldId;
+  size_t fields = 0;
+  reader.readStructBegin(name);
+  while (true) {
+    reader.readFieldBegin(name, fieldType, fieldId);
+    if (fieldType == TType::T_STOP) {
+      break;
+    }
+    ++fields;
+    reader.skip(fieldType);
+    reader.readFieldEnd();
+  }
+  reader.readStructEnd();
+  EXPECT_EQ(16, fields);
+  int32_t sentinel;
+  reader.readI32(sentinel);
+  EXPECT_EQ(kSentinel, sentinel);
+}
+
+TYPED_TEST(SkipTest, truncatedInputThrows) {
+  auto buf = this->serialize();
+  auto data = buf->cloneCoalescedAsValue();
+  // Cut in the middle of the long string and of the list of ints.
+  for (size_t length : {size_t(50), size_t(400)}) {
+    auto truncated = IOBuf::wrapBufferAsValue(data.data(), length);
+    TypeParam reader;
+    reader.setInput(&truncated);
+    EXPECT_ANY_THROW(reader.skip(TType::T_STRUCT));
+  }
+}
@@ -0,0 +1,533 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+namespace apache {
+namespace thrift {
+namespace patch_detail {
+
+template <typename TypeClass>
+struct is_patchable : std::false_type {};
+template <>
+struct is_patchable<type_class::structure> : std::true_type {};
+template <typename ValueTypeClass>
+struct is_patchable<type_class::list<ValueTypeClass>> : std::true_type {};
+template <typename ValueTypeClass>
+struct is_patchable<type_class::set<ValueTypeClass>> : std::true_type {};
+template <typename KeyTypeClass, typename MappedTypeClass>
+struct is_patchable<type_class::map<KeyTypeClass, MappedTypeClass>>
+    : std::true_type {};
+
+[[noreturn]] inline void throw_bad_patch(const char* what) {
+  throw protocol::TProtocolException(
+      protocol::TProtocolException::INVALID_DATA, what);
+}
+
+template <typename TypeClass>
+struct equal_to {
+  template <typename T>
+  bool operator()(const T& lhs, const T& rhs) const {
+    return lhs == rhs;
+  }
+};
+
+template <>
+struct equal_to<type_class::binary> {
+  template <typename T>
+  bool operator()(const T& lhs, const T& rhs) const {
+    return StringTraits<T>::isEqual(lhs, rhs);
+  }
+};
+
+template <typename Writer>
+void write_op(Writer& writer, patch_op op) {
+  writer.writeByte(static_cast<std::int8_t>(op));
+}
+
+template <typename Reader>
+patch_op read_op(Reader& reader) {
+  std::int8_t op;
+  reader.readByte(op);
+  return static_cast<patch_op>(op);
+}
+
+template <typename Writer>
+void write_size(Writer& writer, std::size_t size) {
+  writer.writeI32(static_cast<std::int32_t>(size));
+}
+
+template <typename Reader>
+std::size_t read_size(Reader& reader) {
+  std::int32_t size;
+  reader.readI32(size);
+  if (size < 0) {
+    throw_bad_patch("negative size in patch");
+  }
+  return static_cast<std::size_t>(size);
+}
+
+template <typename TypeClass, typename T, typename Writer>
+void write_value(Writer& writer, const T& value) {
+  protocol_methods<TypeClass, T>::write(writer, value);
+}
+
+template <typename TypeClass, typename T, typename Reader>
+T read_value(Reader& reader) {
+  T value;
+  protocol_methods<TypeClass, T>::read(reader, value);
+  return value;
+}
+
+// Values that are not patchable are replaced whole when they change.
+template <typename TypeClass, bool = is_patchable<TypeClass>::value>
+struct change {
+  static constexpr patch_op op = patch_op::assign;
+
+  template <typename Writer, typename T>
+  static void write(Writer& writer, const T& /* from */, const T& to) {
+    write_value<TypeClass>(writer, to);
+  }
+
+  template <typename Reader, typename T>
+  static void patch(Reader& /* reader */, T&& /* value */) {
+    throw_bad_patch("value cannot be patched");
+  }
+};
+
+template <typename TypeClass>
+struct change<TypeClass, true> {
+  static constexpr patch_op op = patch_op::patch;
+
+  template <typename Writer, typename T>
+  static void write(Writer& writer, const T& from, const T& to) {
+    patch_impl<TypeClass>::write(writer, from, to);
+  }
+
+  template <typename Reader, typename T>
+  static void patch(Reader& reader, T& value) {
+    patch_impl<TypeClass>::apply(reader, value);
+  }
+};
+
+// Writes how a value changed: the op, then the new value or a nested patch.
+template <typename TypeClass, typename T, typename Writer>
+void write_change(Writer& writer, const T& from, const T& to) {
+  write_op(writer, change<TypeClass>::op);
+  change<TypeClass>::write(writer, from, to);
+}
+
+template <typename TypeClass, typename T, typename Reader>
+void apply_change(Reader& reader, patch_op op, T& value) {
+  switch (op) {
+    case patch_op::assign:
+      value = read_value<TypeClass, T>(reader);
+      return;
+    case patch_op::patch:
+      change<TypeClass>::patch(reader, value);
+      return;
+    default:
+      throw_bad_patch("unexpected op in patch");
+  }
+}
+
+template <typename TypeClass, typename T, typename Enable = void>
+struct field_patch {
+  template <typename Writer>
+  static void write(
+      Writer& writer,
+      field_id_t id,
+      bool was_set,
+      const T& from,
+      const T& to) {
+    if (!was_set) {
+      write_op(writer, patch_op::assign);
+      writer.writeI16(id);
+      write_value<TypeClass>(writer, to);
+    } else if (!equal_to<TypeClass>()(from, to)) {
+      write_op(writer, change<TypeClass>::op);
+      writer.writeI16(id);
+      change<TypeClass>::write(writer, from, to);
+    }
+  }
+
+  template <typename Reader>
+  static void apply(Reader& reader, patch_op op, T& value) {
+    apply_change<TypeClass>(reader, op, value);
+  }
+
+  static void clear(T& value) {
+    value = T();
+  }
+};
+
+// cpp.ref fields are replaced whole, since shared ones may not be mutated
+template <typename TypeClass, typename PtrType>
+struct field_patch<
+    TypeClass,
+    PtrType,
+    detail::enable_if_smart_pointer<PtrType>> {
+  using element_type =
+      typename std::remove_const<typename PtrType::element_type>::type;
+
+  template <typename Writer>
+  static void write(
+      Writer& writer,
+      field_id_t id,
+      bool was_set,
+      const PtrType& from,
+      const PtrType& to) {
+    if (was_set &&
+        (from == to ||
+         (from && to && equal_to<TypeClass>()(*from, *to)))) {
+      return;
+    }
+    if (!to) {
+      write_op(writer, patch_op::clear);
+      writer.writeI16(id);
+      return;
+    }
+    write_op(writer, patch_op::assign);
+    writer.writeI16(id);
+    write_value<TypeClass, element_type>(writer, *to);
+  }
+
+  template <typename Reader>
+  static void apply(Reader& reader, patch_op op, PtrType& value) {
+    if (op != patch_op::assign) {
+      throw_bad_patch("unexpected op in patch");
+    }
+    protocol_methods<TypeClass, element_type>::read(
+        reader, detail::deref<PtrType>::clear_and_get(value));
+  }
+
+  static void clear(PtrType& value) {
+    value = nullptr;
+  }
+};
+
+template <>
+struct patch_impl<type_class::structure> {
+  template <typename T>
+  using members = typename reflect_struct<T>::members;
+
+  struct write_member {
+    template <
+        typename MemberInfo,
+        std::size_t Index,
+        typename T,
+        typename Writer>
+    void operator()(
+        fatal::indexed<MemberInfo, Index>,
+        const T& from,
+        const T& to,
+        Writer& writer) const {
+      using getter = typename MemberInfo::getter;
+      using member_type = folly::remove_cvref_t<decltype(getter::ref(to))>;
+      using impl = field_patch<typename MemberInfo::type_class, member_type>;
+      constexpr auto optional =
+          MemberInfo::optional::value == optionality::optional;
+      if (optional && !MemberInfo::is_set(to)) {
+        if (MemberInfo::is_set(from)) {
+          write_op(writer, patch_op::clear);
+          writer.writeI16(MemberInfo::id::value);
+        }
+        return;
+      }
+      impl::write(
+          writer,
+          MemberInfo::id::value,
+          !optional || MemberInfo::is_set(from),
+          getter::ref(from),
+          getter::ref(to));
+    }
+  };
+
+  struct apply_member {
+    template <typename Fid, std::size_t Index, typename Reader, typename T>
+    void operator()(
+        fatal::indexed<Fid, Index>,
+        patch_op op,
+        Reader& reader,
+        T& value) const {
+      using member = fatal::get<members<T>, Fid, fatal::get_type::id>;
+      using getter = typename member::getter;
+      using member_type = folly::remove_cvref_t<decltype(getter::ref(value))>;
+      using impl = field_patch<typename member::type_class, member_type>;
+      if (op == patch_op::clear) {
+        impl::clear(getter::ref(value));
+        if (member::optional::value == optionality::optional) {
+          member::mark_set(value, false);
+        }
+        return;
+      }
+      impl::apply(reader, op, getter::ref(value));
+      member::mark_set(value, true);
+    }
+  };
+
+  template <typename Writer, typename T>
+  static void write(Writer& writer, const T& from, const T& to) {
+    fatal::foreach<members<T>>(write_member(), from, to, writer);
+    write_op(writer, patch_op::stop);
+  }
+
+  template <typename Reader, typename T>
+  static void apply(Reader& reader, T& value) {
+    using sorted_ids =
+        fatal::sort<fatal::transform<members<T>, fatal::get_type::id>>;
+    while (true) {
+      auto op = read_op(reader);
+      if (op == patch_op::stop) {
+        return;
+      }
+      std::int16_t id;
+      reader.readI16(id);
+      if (!fatal::sorted_search<sorted_ids>(
+              id, apply_member(), op, reader, value)) {
+        throw_bad_patch("unknown field in patch");
+      }
+    }
+  }
+};
+
+template <typename ValueTypeClass>
+struct patch_impl<type_class::list<ValueTypeClass>> {
+  template <typename Writer, typename T>
+  static void write(Writer& writer, const T& from, const T& to) {
+    equal_to<ValueTypeClass> equal;
+    if (from.size() == to.size()) {
+      std::vector<std::size_t> changed;
+      for (std::size_t i = 0; i < to.size(); ++i) {
+        if (!equal(from[i], to[i])) {
+          changed.push_back(i);
+        }
+      }
+      writer.writeByte(static_cast<std::int8_t>(list_patch::elements));
+      write_size(writer, changed.size());
+      for (auto i : changed) {
+        write_size(writer, i);
+        write_change<ValueTypeClass>(writer, from[i], to[i]);
+      }
+      return;
+    }
+
+    // replace what lies between the common prefix and suffix
+    auto common = std::min(from.size(), to.size());
+    std::size_t prefix = 0;
+    while (prefix < common && equal(from[prefix], to[prefix])) {
+      ++prefix;
+    }
+    std::size_t suffix = 0;
+    while (suffix < common - prefix &&
+           equal(from[from.size() - 1 - suffix], to[to.size() - 1 - suffix])) {
+      ++suffix;
+    }
+    writer.writeByte(static_cast<std::int8_t>(list_patch::splice));
+    write_size(writer, prefix);
+    write_size(writer, from.size() - prefix - suffix);
+    write_size(writer, to.size() - prefix - suffix);
+    for (auto i = prefix; i < to.size() - suffix; ++i) {
+      write_value<ValueTypeClass>(writer, to[i]);
+    }
+  }
+
+  template <typename Reader, typename T>
+  static void apply(Reader& reader, T& value) {
+    using E = typename T::value_type;
+    std::int8_t mode;
+    reader.readByte(mode);
+    if (mode == static_cast<std::int8_t>(list_patch::elements)) {
+      for (auto n = read_size(reader); n--;) {
+        auto i = read_size(reader);
+        if (i >= value.size()) {
+          throw_bad_patch("list index out of range in patch");
+        }
+        auto op = read_op(reader);
+        if (op == patch_op::assign) {
+          value[i] = read_value<ValueTypeClass, E>(reader);
+        } else if (op == patch_op::patch) {
+          change<ValueTypeClass>::patch(reader, value[i]);
+        } else {
+          throw_bad_patch("unexpected op in patch");
+        }
+      }
+      return;
+    }
+    if (mode != static_cast<std::int8_t>(list_patch::splice)) {
+      throw_bad_patch("unknown list patch");
+    }
+    auto prefix = read_size(reader);
+    auto removed = read_size(reader);
+    auto inserted = read_size(reader);
+    if (prefix + removed > value.size()) {
+      throw_bad_patch("list range out of range in patch");
+    }
+    std::vector<E> items;
+    items.reserve(inserted);
+    while (inserted--) {
+      items.push_back(read_value<ValueTypeClass, E>(reader));
+    }
+    auto pos = value.erase(
+        value.begin() + prefix, value.begin() + prefix + removed);
+    value.insert(
+        pos,
+        std::make_move_iterator(items.begin()),
+        std::make_move_iterator(items.end()));
+  }
+};
+
+template <typename ValueTypeClass>
+struct patch_impl<type_class::set<ValueTypeClass>> {
+  template <typename Writer, typename T>
+  static void write(Writer& writer, const T& from, const T& to) {
+    using E = typename T::value_type;
+    std::vector<const E*> removed;
+    for (const auto& e : from) {
+      if (!to.count(e)) {
+        removed.push_back(&e);
+      }
+    }
+    std::vector<const E*> added;
+    for (const auto& e : to) {
+      if (!from.count(e)) {
+        added.push_back(&e);
+      }
+    }
+    write_size(writer, removed.size());
+    for (auto e : removed) {
+      write_value<ValueTypeClass>(writer, *e);
+    }
+    write_size(writer, added.size());
+    for (auto e : added) {
+      write_value<ValueTypeClass>(writer, *e);
+    }
+  }
+
+  template <typename Reader, typename T>
+  static void apply(Reader& reader, T& value) {
+    using E = typename T::value_type;
+    for (auto n = read_size(reader); n--;) {
+      value.erase(read_value<ValueTypeClass, E>(reader));
+    }
+    for (auto n = read_size(reader); n--;) {
+      value.insert(read_value<ValueTypeClass, E>(reader));
+    }
+  }
+};
+
+template <typename KeyTypeClass, typename MappedTypeClass>
+struct patch_impl<type_class::map<KeyTypeClass, MappedTypeClass>> {
+  template <typename Writer, typename T>
+  static void write(Writer& writer, const T& from, const T& to) {
+    using K = typename T::key_type;
+    using M = typename T::mapped_type;
+    std::vector<const K*> removed;
+    for (const auto& kv : from) {
+      if (!to.count(kv.first)) {
+        removed.push_back(&kv.first);
+      }
+    }
+    // entries of 'to' with the value they had in 'from', if any
+    std::vector<std::pair<const typename T::value_type*, const M*>> changed;
+    equal_to<MappedTypeClass> equal;
+    for (const auto& kv : to) {
+      auto found = from.find(kv.first);
+      if (found == from.end()) {
+        changed.emplace_back(&kv, nullptr);
+      } else if (!equal(found->second, kv.second)) {
+        changed.emplace_back(&kv, &found->second);
+      }
+    }
+
+    write_size(writer, removed.size());
+    for (auto key : removed) {
+      write_value<KeyTypeClass>(writer, *key);
+    }
+    write_size(writer, changed.size());
+    for (const auto& entry : changed) {
+      write_value<KeyTypeClass>(writer, entry.first->first);
+      if (entry.second) {
+        write_change<MappedTypeClass>(
+            writer, *entry.second, entry.first->second);
+      } else {
+        write_op(writer, patch_op::assign);
+        write_value<MappedTypeClass>(writer, entry.first->second);
+      }
+    }
+  }
+
+  template <typename Reader, typename T>
+  static void apply(Reader& reader, T& value) {
+    using K = typename T::key_type;
+    for (auto n = read_size(reader); n--;) {
+      value.erase(read_value<KeyTypeClass, K>(reader));
+    }
+    for (auto n = read_size(reader); n--;) {
+      auto key = read_value<KeyTypeClass, K>(reader);
+      auto op = read_op(reader);
+      apply_change<MappedTypeClass>(reader, op, value[key]);
+    }
+  }
+};
+
+template <typename T>
+struct check_patchable {
+  static_assert(
+      !std::is_same<reflect_type_class<T>, type_class::unknown>::value,
+      "patch: missing reflection metadata");
+  static_assert(
+      std::is_same<reflect_type_class<T>, type_class::structure>::value,
+      "patch: only structs can be patched");
+};
+
+} // namespace patch_detail
+} // namespace thrift
+} // namespace apache
+
+namespace apache {
+namespace thrift {
+
+template <typename T, typename Writer>
+void write_patch(const T& from, const T& to, Writer& writer) {
+  patch_detail::check_patchable<T>();
+  patch_detail::patch_impl<type_class::structure>::write(writer, from, to);
+}
+
+template <typename T, typename Reader>
+void read_patch(Reader& reader, T& value) {
+  patch_detail::check_patchable<T>();
+  patch_detail::patch_impl<type_class::structure>::apply(reader, value);
+}
+
+template <typename T, typename Writer>
+std::unique_ptr<folly::IOBuf> make_patch(const T& from, const T& to) {
+  folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+  Writer writer;
+  writer.setOutput(&queue);
+  write_patch(from, to, writer);
+  return queue.move();
+}
+
+template <typename T, typename Reader>
+void apply_patch(const folly::IOBuf& patch, T& value) {
+  Reader reader;
+  reader.setInput(&patch);
+  read_patch(reader, value);
+}
+
+} // namespace thrift
+} // namespace apache
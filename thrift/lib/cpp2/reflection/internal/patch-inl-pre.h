@@ -0,0 +1,43 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+namespace apache {
+namespace thrift {
+namespace patch_detail {
+
+// How a value changes. Struct fields are written as the op, the field id,
+// then the new value or a nested patch; a stop op ends the struct patch.
+enum class patch_op : std::int8_t {
+  stop = 0,
+  assign = 1,
+  clear = 2,
+  patch = 3,
+};
+
+// How a list changes.
+enum class list_patch : std::int8_t {
+  elements = 1,
+  splice = 2,
+};
+
+template <typename TypeClass>
+struct patch_impl;
+
+} // namespace patch_detail
+} // namespace thrift
+} // namespace apache
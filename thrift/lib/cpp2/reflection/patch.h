@@ -0,0 +1,99 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fatal/type/search.h>
+#include <fatal/type/sort.h>
+#include <fatal/type/transform.h>
+#include <folly/Traits.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <thrift/lib/cpp/protocol/TProtocolException.h>
+#include <thrift/lib/cpp2/protocol/CompactProtocol.h>
+#include <thrift/lib/cpp2/protocol/Protocol.h>
+#include <thrift/lib/cpp2/reflection/reflection.h>
+#include <thrift/lib/cpp2/reflection/serializer.h>
+
+#include <thrift/lib/cpp2/reflection/internal/patch-inl-pre.h>
+
+namespace apache {
+namespace thrift {
+
+/***
+ *  Writes a patch which turns `from` into `to` using Thrift's static
+ *  reflection support.
+ *
+ *  Only the fields that differ are written. Struct fields are patched
+ *  recursively. Lists are patched element by element if their size is
+ *  unchanged, or else by replacing the range between their common prefix and
+ *  suffix. Sets and maps record removed and added elements, and maps patch
+ *  the values of common keys recursively. Other values, as well as unions and
+ *  cpp.ref fields, are written whole when they change.
+ *
+ *  The patch uses the primitives of the given protocol writer, but is not
+ *  itself a serialized Thrift struct. It can only be applied to a value equal
+ *  to `from`, using the matching protocol reader.
+ *
+ *  The documentation in thrift/lib/cpp2/reflection/reflection.h describes the
+ *  steps required in order to make static reflection metadata available for
+ *  your thrift types. Be sure to read it. The metadata is not available by
+ *  default.
+ *
+ *  Usage example:
+ *
+ *    MyStruct before = //...
+ *    MyStruct after = //...
+ *    auto patch = apache::thrift::make_patch(before, after);
+ *
+ *    // on the subscriber, which has a copy of `before`
+ *    apache::thrift::apply_patch(*patch, before);
+ */
+template <typename T, typename Writer>
+void write_patch(const T& from, const T& to, Writer& writer);
+
+/***
+ *  Reads a patch written by `write_patch()` and applies it to `value` in
+ *  place.
+ *
+ *  Throws `TProtocolException` if the patch does not match `value`.
+ */
+template <typename T, typename Reader>
+void read_patch(Reader& reader, T& value);
+
+/***
+ *  Returns the patch which turns `from` into `to`, written with the Compact
+ *  protocol by default.
+ */
+template <typename T, typename Writer = CompactProtocolWriter>
+std::unique_ptr<folly::IOBuf> make_patch(const T& from, const T& to);
+
+/***
+ *  Applies a patch returned by `make_patch()` to `value`.
+ */
+template <typename T, typename Reader = CompactProtocolReader>
+void apply_patch(const folly::IOBuf& patch, T& value);
+
+} // namespace thrift
+} // namespace apache
+
+#include <thrift/lib/cpp2/reflection/internal/patch-inl-post.h>
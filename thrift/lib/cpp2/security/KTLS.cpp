@@ -0,0 +1,291 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <thrift/lib/cpp2/security/KTLS.h>
+
+#include <cstring>
+
+#include <glog/logging.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
+#include <folly/portability/Sockets.h>
+
+#ifdef __linux__
+#include <netinet/tcp.h>
+#endif
+
+#ifdef HAVE_FB_KTLS
+#include <openssl/ssl_fb.h>
+#elif defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#endif
+#endif
+
+#if !defined(HAVE_FB_KTLS) && defined(TLS_TX) && defined(TLS_RX) && \
+    OPENSSL_VERSION_NUMBER >= 0x10100000L
+#define THRIFT_KTLS_INSTALL_KEYS 1
+#include <openssl/kdf.h>
+#endif
+
+// Older libc headers lack these.
+#if defined(__linux__) && !defined(TCP_ULP)
+#define TCP_ULP 31
+#endif
+#if defined(THRIFT_KTLS_INSTALL_KEYS) && !defined(SOL_TLS)
+#define SOL_TLS 282
+#endif
+
+namespace apache {
+namespace thrift {
+
+#ifdef THRIFT_KTLS_INSTALL_KEYS
+namespace {
+
+// The kernel structures of both AES-GCM ciphers only differ in key size.
+constexpr size_t kMaxKeySize = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+constexpr size_t kSaltSize = TLS_CIPHER_AES_GCM_128_SALT_SIZE;
+constexpr size_t kRandomSize = SSL3_RANDOM_SIZE;
+
+struct Cipher {
+  uint16_t kernelCipher;
+  size_t keySize;
+  const EVP_MD* (*prfDigest)();
+};
+
+// TLS 1.2 AES-GCM suites use SHA-256 for the PRF with 128 bit keys and
+// SHA-384 with 256 bit keys.
+const Cipher* getCipher(const SSL* ssl) {
+  static const Cipher kAes128Gcm{
+      TLS_CIPHER_AES_GCM_128, TLS_CIPHER_AES_GCM_128_KEY_SIZE, EVP_sha256};
+  static const Cipher kAes256Gcm{
+      TLS_CIPHER_AES_GCM_256, TLS_CIPHER_AES_GCM_256_KEY_SIZE, EVP_sha384};
+
+  if (SSL_version(ssl) != TLS1_2_VERSION) {
+    return nullptr;
+  }
+  auto cipher = SSL_get_current_cipher(ssl);
+  if (!cipher) {
+    return nullptr;
+  }
+  switch (SSL_CIPHER_get_cipher_nid(cipher)) {
+    case NID_aes_128_gcm:
+      return &kAes128Gcm;
+    case NID_aes_256_gcm:
+      return &kAes256Gcm;
+    default:
+      return nullptr;
+  }
+}
+
+// The key block of a TLS 1.2 AEAD suite, see RFC 5246 section 6.3 and
+// RFC 5288 section 3.
+struct KeyBlock {
+  uint8_t clientKey[kMaxKeySize];
+  uint8_t serverKey[kMaxKeySize];
+  uint8_t clientSalt[kSaltSize];
+  uint8_t serverSalt[kSaltSize];
+};
+
+bool deriveKeyBlock(const SSL* ssl, const Cipher& cipher, KeyBlock& block) {
+  auto session = SSL_get_session(ssl);
+  if (!session) {
+    return false;
+  }
+  uint8_t master[SSL_MAX_MASTER_KEY_LENGTH];
+  size_t masterSize =
+      SSL_SESSION_get_master_key(session, master, sizeof(master));
+  uint8_t seed[2 * kRandomSize];
+  SSL_get_server_random(ssl, seed, kRandomSize);
+  SSL_get_client_random(ssl, seed + kRandomSize, kRandomSize);
+  SCOPE_EXIT {
+    OPENSSL_cleanse(master, sizeof(master));
+  };
+
+  auto ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+  if (!ctx) {
+    return false;
+  }
+  SCOPE_EXIT {
+    EVP_PKEY_CTX_free(ctx);
+  };
+  static const unsigned char kLabel[] = "key expansion";
+  uint8_t out[2 * kMaxKeySize + 2 * kSaltSize];
+  size_t outSize = 2 * cipher.keySize + 2 * kSaltSize;
+  if (EVP_PKEY_derive_init(ctx) <= 0 ||
+      EVP_PKEY_CTX_set_tls1_prf_md(ctx, cipher.prfDigest()) <= 0 ||
+      EVP_PKEY_CTX_set1_tls1_prf_secret(ctx, master, masterSize) <= 0 ||
+      EVP_PKEY_CTX_add1_tls1_prf_seed(ctx, kLabel, sizeof(kLabel) - 1) <= 0 ||
+      EVP_PKEY_CTX_add1_tls1_prf_seed(ctx, seed, sizeof(seed)) <= 0 ||
+      EVP_PKEY_derive(ctx, out, &outSize) <= 0) {
+    return false;
+  }
+
+  // AEAD suites have no MAC keys: client key, server key, client salt,
+  // server salt.
+  auto p = out;
+  std::memcpy(block.clientKey, p, cipher.keySize);
+  p += cipher.keySize;
+  std::memcpy(block.serverKey, p, cipher.keySize);
+  p += cipher.keySize;
+  std::memcpy(block.clientSalt, p, kSaltSize);
+  p += kSaltSize;
+  std::memcpy(block.serverSalt, p, kSaltSize);
+  OPENSSL_cleanse(out, sizeof(out));
+  return true;
+}
+
+bool installKeys(
+    int fd,
+    int direction,
+    const Cipher& cipher,
+    const uint8_t* key,
+    const uint8_t* salt) {
+  // The Finished message is the only record sent in either direction
+  // under the new keys when the handshake completes, so both sequence
+  // numbers are 1. OpenSSL uses the sequence number as the explicit nonce.
+  uint8_t seq[TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+  int rc;
+  if (cipher.kernelCipher == TLS_CIPHER_AES_GCM_128) {
+    tls12_crypto_info_aes_gcm_128 info;
+    std::memset(&info, 0, sizeof(info));
+    info.info.version = TLS_1_2_VERSION;
+    info.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+    std::memcpy(info.key, key, sizeof(info.key));
+    std::memcpy(info.salt, salt, sizeof(info.salt));
+    std::memcpy(info.iv, seq, sizeof(info.iv));
+    std::memcpy(info.rec_seq, seq, sizeof(info.rec_seq));
+    rc = setsockopt(fd, SOL_TLS, direction, &info, sizeof(info));
+    OPENSSL_cleanse(&info, sizeof(info));
+  } else {
+    tls12_crypto_info_aes_gcm_256 info;
+    std::memset(&info, 0, sizeof(info));
+    info.info.version = TLS_1_2_VERSION;
+    info.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+    std::memcpy(info.key, key, sizeof(info.key));
+    std::memcpy(info.salt, salt, sizeof(info.salt));
+    std::memcpy(info.iv, seq, sizeof(info.iv));
+    std::memcpy(info.rec_seq, seq, sizeof(info.rec_seq));
+    rc = setsockopt(fd, SOL_TLS, direction, &info, sizeof(info));
+    OPENSSL_cleanse(&info, sizeof(info));
+  }
+  return rc == 0;
+}
+
+} // namespace
+#endif
+
+bool KTLS::isEligible(const SSL* ssl) {
+#ifdef HAVE_FB_KTLS
+  return ssl != nullptr && SSL_pending(ssl) == 0;
+#elif defined(THRIFT_KTLS_INSTALL_KEYS)
+  return ssl != nullptr && SSL_is_init_finished(ssl) && getCipher(ssl) &&
+      !SSL_has_pending(ssl);
+#else
+  (void)ssl;
+  return false;
+#endif
+}
+
+bool KTLS::hasTlsUlp(int fd) {
+#ifdef __linux__
+  char name[16] = {};
+  socklen_t len = sizeof(name) - 1;
+  return getsockopt(fd, IPPROTO_TCP, TCP_ULP, name, &len) == 0 &&
+      std::strcmp(name, "tls") == 0;
+#else
+  (void)fd;
+  return false;
+#endif
+}
+
+folly::AsyncSocket::UniquePtr KTLS::offload(folly::AsyncSSLSocket& sock) {
+  auto ssl = const_cast<SSL*>(sock.getSSL());
+  if (!isEligible(ssl)) {
+    return nullptr;
+  }
+
+#ifdef HAVE_FB_KTLS
+  int rc = SSL_fb_configure_ktls(ssl);
+  if (rc != 1) {
+    LOG(ERROR) << "SSL_fb_configure_ktls failure: return code " << rc;
+    return nullptr;
+  }
+#elif defined(THRIFT_KTLS_INSTALL_KEYS)
+  auto cipher = getCipher(ssl);
+  KeyBlock block;
+  if (!deriveKeyBlock(ssl, *cipher, block)) {
+    LOG(ERROR) << "Failed to derive the TLS key block for kTLS";
+    return nullptr;
+  }
+  SCOPE_EXIT {
+    OPENSSL_cleanse(&block, sizeof(block));
+  };
+  bool server = SSL_is_server(ssl);
+  auto fd = sock.getFd();
+  // Until keys are installed a socket with the tls ULP behaves as before.
+  if (setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+    VLOG(4) << "kTLS is not available: " << folly::errnoStr(errno);
+    return nullptr;
+  }
+  // The receive keys go first: kernels before 4.17 only support TLS_TX, and
+  // refusing TLS_RX there leaves the connection to OpenSSL as it was.
+  if (!installKeys(
+          fd,
+          TLS_RX,
+          *cipher,
+          server ? block.clientKey : block.serverKey,
+          server ? block.clientSalt : block.serverSalt)) {
+    VLOG(4) << "kTLS refused the receive keys: " << folly::errnoStr(errno);
+    return nullptr;
+  }
+  if (!installKeys(
+          fd,
+          TLS_TX,
+          *cipher,
+          server ? block.serverKey : block.clientKey,
+          server ? block.serverSalt : block.clientSalt)) {
+    LOG(ERROR) << "kTLS refused the transmit keys, closing the connection: "
+               << folly::errnoStr(errno);
+    sock.closeNow();
+    return nullptr;
+  }
+#endif
+
+  auto evb = sock.getEventBase();
+  auto zc = sock.getZeroCopyBufId();
+  return folly::AsyncSocket::UniquePtr(
+      new folly::AsyncSocket(evb, sock.detachFd(), zc));
+}
+
+std::shared_ptr<async::TAsyncSocket> KTLS::offloadClient(
+    std::shared_ptr<async::TAsyncSSLSocket> sock) {
+  if (auto plain = offload(*sock)) {
+    return std::shared_ptr<async::TAsyncSocket>(
+        new async::TAsyncSocket(std::move(plain)),
+        folly::DelayedDestruction::Destructor());
+  }
+  if (!sock->good()) {
+    return nullptr;
+  }
+  return sock;
+}
+
+} // namespace thrift
+} // namespace apache
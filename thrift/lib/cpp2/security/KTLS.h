@@ -0,0 +1,84 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <thrift/lib/cpp/async/TAsyncSSLSocket.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * Kernel TLS (kTLS) offload of established OpenSSL connections.
+ *
+ * Once the handshake is done, the session keys can be handed to the Linux
+ * kernel, which then encrypts and decrypts the records itself. The
+ * connection continues on a plain folly::AsyncSocket over the same fd that
+ * reads and writes plaintext, so IOBufs go to sendmsg without being copied
+ * into OpenSSL buffers first. The bytes on the wire do not change, so only
+ * one of the peers needs to offload.
+ *
+ * With a stock OpenSSL the keys are installed for TLS 1.2 sessions using
+ * AES-128-GCM or AES-256-GCM; other sessions (TLS 1.3, CBC or ChaCha20
+ * suites) stay in userspace. The kernel needs the 'tls' module, and TLS_RX
+ * (4.17 or later). Post-handshake messages such as renegotiation are not
+ * supported on an offloaded connection, and make reads fail.
+ *
+ * Only ThriftServer (setUseKtls()) offloads by itself:
+ * client channels use the transport they are given. Clients offload by
+ * passing their connected socket through offloadClient() before building
+ * the channel on the result.
+ */
+class KTLS {
+ public:
+  /**
+   * Whether the session of ssl could be offloaded: the negotiated version
+   * and cipher are supported, and no record data is buffered in OpenSSL.
+   */
+  static bool isEligible(const SSL* ssl);
+
+  /**
+   * Offloads the connection of sock, which must have finished its
+   * handshake, and returns the plain socket to use instead of sock. Returns
+   * nullptr and leaves sock in use if the session is not eligible or the
+   * kernel refuses the keys. If the kernel accepts the receive keys but
+   * not the transmit ones, neither socket can be used anymore: sock is
+   * closed (so !sock.good()) and nullptr is returned, and the caller has to
+   * drop the connection.
+   */
+  static folly::AsyncSocket::UniquePtr offload(folly::AsyncSSLSocket& sock);
+
+  /**
+   * offload() for clients: returns the transport to build the client
+   * channel on, once the handshake of sock is done. That is the offloaded
+   * plain socket, or sock itself if the session stays in userspace, or
+   * nullptr if sock had to be closed.
+   */
+  static std::shared_ptr<async::TAsyncSocket> offloadClient(
+      std::shared_ptr<async::TAsyncSSLSocket> sock);
+
+  /**
+   * Whether the kernel tls ULP is attached to the TCP socket fd, i.e. the
+   * kernel has kTLS support and offload() got as far as installing keys.
+   */
+  static bool hasTlsUlp(int fd);
+};
+
+} // namespace thrift
+} // namespace apache
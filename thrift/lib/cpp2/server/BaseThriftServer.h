@@ -33,6 +33,7 @@
 #include <thrift/lib/cpp/transport/THeader.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/async/AsyncProcessor.h>
+#include <thrift/lib/cpp2/server/MethodStats.h>
 #include <thrift/lib/cpp2/server/ServerAttribute.h>
 #include <thrift/lib/cpp2/server/ServerConfigs.h>
 
@@ -201,6 +202,15 @@ class BaseThriftServer : public apache::thrift::concurrency::Runnable,
   // Admission strategy use for accepting new requests
   ServerAttribute<std::shared_ptr<AdmissionStrategy>> admissionStrategy_;
 
+  // Record per-method latency and size histograms for every request
+  ServerAttribute<bool> methodStatsEnabled_{true};
+
+  // Also sample thread CPU time around the handler. This costs two
+  // clock_gettime(CLOCK_THREAD_CPUTIME_ID) calls per request.
+  ServerAttribute<bool> methodStatsCpuTimeEnabled_{false};
+
+  ServerMethodStats methodStats_;
+
  protected:
   //! The server's listening address
   folly::SocketAddress address_;
@@ -465,6 +475,51 @@ class BaseThriftServer : public apache::thrift::concurrency::Runnable,
     return observer_;
   }
 
+  /**
+   * Enable or disable the always-on per-method stats (queue, handler and
+   * serialization time, request and response sizes). Enabled by default.
+   * Covers header and RSocket connections; HTTP/2 requests are not
+   * recorded.
+   */
+  void setMethodStatsEnabled(
+      bool enabled,
+      AttributeSource source = AttributeSource::OVERRIDE) {
+    methodStatsEnabled_.set(enabled, source);
+  }
+
+  bool getMethodStatsEnabled() const {
+    return methodStatsEnabled_.get();
+  }
+
+  /**
+   * Additionally record the thread CPU time spent in the handler and
+   * serialization. Disabled by default since it needs a syscall pair per
+   * request.
+   */
+  void setMethodStatsCpuTimeEnabled(
+      bool enabled,
+      AttributeSource source = AttributeSource::OVERRIDE) {
+    methodStatsCpuTimeEnabled_.set(enabled, source);
+  }
+
+  bool getMethodStatsCpuTimeEnabled() const {
+    return methodStatsCpuTimeEnabled_.get();
+  }
+
+  /**
+   * Aggregate the per-IO-thread method stats into one snapshot per method
+   * name. Calls to methods the processor doesn't know are reported under
+   * ThreadMethodStats::kUnknownMethod. This is not meant to be called on
+   * the request path.
+   */
+  std::map<std::string, MethodStatsSnapshot> getMethodStats() const {
+    return methodStats_.aggregate();
+  }
+
+  ServerMethodStats& getMethodStatsRegistry() {
+    return methodStats_;
+  }
+
   std::unique_ptr<apache::thrift::AsyncProcessor> getCpp2Processor() {
     return cpp2Pfac_->getProcessor();
   }
@@ -23,6 +23,7 @@
 #include <thrift/lib/cpp/concurrency/ThreadManager.h>
 #include <thrift/lib/cpp/server/TConnectionContext.h>
 #include <thrift/lib/cpp/transport/THeader.h>
+#include <thrift/lib/cpp2/server/MethodStats.h>
 #include <wangle/ssl/SSLUtil.h>
 
 using apache::thrift::concurrency::PriorityThreadManager;
@@ -210,6 +211,11 @@ class Cpp2RequestContext : public apache::thrift::server::TConnectionContext {
 
   void setStartedProcessing() {
     startedProcessing_ = true;
+    timings_.markProcessBegin();
+  }
+
+  RequestTimings& getTimings() {
+    return timings_;
   }
 
   std::chrono::milliseconds getRequestTimeout() const {
@@ -253,7 +259,7 @@ class Cpp2RequestContext : public apache::thrift::server::TConnectionContext {
   apache::thrift::transport::THeader* header_;
   bool startedProcessing_ = false;
   std::chrono::milliseconds requestTimeout_{0};
-  folly::Optional<std::chrono::steady_clock::time_point> processingStartTime_;
+  RequestTimings timings_;
   std::string methodName_;
   int32_t protoSeqId_{0};
   uint32_t messageBeginSize_{0};
@@ -127,6 +127,45 @@ void Cpp2Connection::stop() {
   this_.reset();
 }
 
+bool Cpp2Connection::isDetachable() {
+  return channel_ && transport_ && !duplexChannel_ &&
+      activeRequests_.empty() && channel_->isDetachable();
+}
+
+void Cpp2Connection::migrateTo(std::shared_ptr<Cpp2Worker> target) {
+  DCHECK(isDetachable());
+  auto self = this_;
+  if (auto manager = getConnectionManager()) {
+    manager->removeConnection(this);
+  }
+  channel_->setCallback(nullptr);
+  channel_->detachEventBase();
+
+  auto evb = target->getEventBase();
+  evb->runInEventBaseThread(
+      [self = std::move(self), target = std::move(target)]() mutable {
+        // If the target went away while we were in flight there is no IO
+        // thread left to take this connection, so just drop it.
+        bool drop = target->stopping_;
+        self->worker_ = std::move(target);
+        try {
+          self->channel_->attachEventBase(self->worker_->getEventBase());
+          if (!drop) {
+            self->channel_->setCallback(self.get());
+          }
+        } catch (const std::exception& ex) {
+          // Most likely the socket was closed while we were in flight.
+          VLOG(2) << "Failed to migrate connection: " << ex.what();
+          drop = true;
+        }
+        if (drop) {
+          self->stop();
+          return;
+        }
+        self->worker_->addConnection(self.get());
+      });
+}
+
 void Cpp2Connection::timeoutExpired() noexcept {
   // Only disconnect if there are no active requests. No need to set another
   // timeout here because it's going to be set when all the requests are
@@ -368,6 +407,7 @@ void Cpp2Connection::requestReceived(unique_ptr<ResponseChannelRequest>&& req) {
   auto up2r = std::unique_ptr<ResponseChannelRequest>(t2r);
   activeRequests_.insert(t2r);
   ++worker_->activeRequests_;
+  ++requestsSinceSample_;
 
   if (observer) {
     observer->receivedRequest();
@@ -389,6 +429,13 @@ void Cpp2Connection::requestReceived(unique_ptr<ResponseChannelRequest>&& req) {
   auto reqContext = t2r->getContext();
   reqContext->setRequestTimeout(taskTimeout);
 
+  if (server->getMethodStatsEnabled()) {
+    auto& timings = reqContext->getTimings();
+    timings.received = std::chrono::steady_clock::now();
+    timings.bytesIn = buf->computeChainDataLength();
+    timings.trackCpuTime = server->getMethodStatsCpuTimeEnabled();
+  }
+
   try {
     if (!apache::thrift::detail::ap::deserializeMessageBegin(
             protoId, up2r, buf.get(), reqContext, worker_->getEventBase())) {
@@ -465,6 +512,7 @@ void Cpp2Connection::Cpp2Request::sendReply(
         connection_->getWorker()->getServer()->getMaxResponseSize();
     if (maxResponseSize != 0 &&
         buf->computeChainDataLength() > maxResponseSize) {
+      recordMethodStats(0, true);
       req_->sendErrorWrapped(
           folly::make_exception_wrapper<TApplicationException>(
               TApplicationException::TApplicationExceptionType::INTERNAL_ERROR,
@@ -474,6 +522,7 @@ void Cpp2Connection::Cpp2Request::sendReply(
           reqContext_.getProtoSeqId(),
           prepareSendCallback(sendCallback, observer));
     } else {
+      recordMethodStats(buf ? buf->computeChainDataLength() : 0, false);
       req_->sendReply(
           std::move(buf), prepareSendCallback(sendCallback, observer));
     }
@@ -492,6 +541,12 @@ void Cpp2Connection::Cpp2Request::sendErrorWrapped(
     setServerHeaders();
     markProcessEnd();
     auto observer = connection_->getWorker()->getServer()->getObserver().get();
+    bool unknownMethod = false;
+    ew.with_exception([&](const TApplicationException& ex) {
+      unknownMethod = ex.getType() ==
+          TApplicationException::TApplicationExceptionType::UNKNOWN_METHOD;
+    });
+    recordMethodStats(0, true, unknownMethod);
     req_->sendErrorWrapped(
         std::move(ew),
         std::move(exCode),
@@ -508,6 +563,7 @@ void Cpp2Connection::Cpp2Request::sendTimeoutResponse(
   std::map<std::string, std::string> headers;
   setServerHeaders();
   markProcessEnd(&headers);
+  recordMethodStats(0, true);
   req_->sendTimeoutResponse(
       reqContext_.getMethodName(),
       reqContext_.getProtoSeqId(),
@@ -547,6 +603,21 @@ void Cpp2Connection::Cpp2Request::markProcessEnd(
   }
 }
 
+void Cpp2Connection::Cpp2Request::recordMethodStats(
+    uint64_t bytesOut,
+    bool error,
+    bool unknownMethod) {
+  const auto& timings = reqContext_.getTimings();
+  if (!timings.enabled() || reqContext_.getMethodName().empty()) {
+    return;
+  }
+  auto& stats = connection_->getWorker()->methodStats_;
+  auto& method = unknownMethod
+      ? stats->get(ThreadMethodStats::kUnknownMethod)
+      : stats->get(reqContext_.getMethodName());
+  method.record(timings.toCallStats(bytesOut, error));
+}
+
 void Cpp2Connection::Cpp2Request::setLatencyHeaders(
     const apache::thrift::server::TServerObserver::CallTimestamps& timestamps,
     std::map<std::string, std::string>* newHeaders) const {
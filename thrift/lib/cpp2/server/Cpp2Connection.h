@@ -104,6 +104,30 @@ class Cpp2Connection : public ResponseChannel::Callback,
     this_ = conn;
   }
 
+  /**
+   * Whether the connection is idle between requests and can be moved to
+   * another worker with migrateTo().
+   */
+  bool isDetachable();
+
+  /**
+   * Move this connection to target's IO thread. Must be called on the
+   * current worker's IO thread, and only if isDetachable().
+   */
+  void migrateTo(std::shared_ptr<Cpp2Worker> target);
+
+  /**
+   * Number of requests received between the two most recent calls to
+   * sampleRequests(). Used by the connection rebalancer.
+   */
+  uint64_t getSampledRequests() const {
+    return sampledRequests_;
+  }
+
+  void sampleRequests() {
+    sampledRequests_ = std::exchange(requestsSinceSample_, 0);
+  }
+
  protected:
   std::unique_ptr<apache::thrift::AsyncProcessor> processor_;
   std::unique_ptr<DuplexChannel> duplexChannel_;
@@ -209,6 +233,14 @@ class Cpp2Connection : public ResponseChannel::Callback,
     void setServerHeaders();
     void markProcessEnd(
         std::map<std::string, std::string>* newHeaders = nullptr);
+    // Feed this request's timings into the worker's per-method stats. Must
+    // be called on the IO thread.
+    // Calls to methods the processor doesn't know are all recorded under
+    // ThreadMethodStats::kUnknownMethod.
+    void recordMethodStats(
+        uint64_t bytesOut,
+        bool error,
+        bool unknownMethod = false);
     void setLatencyHeaders(
         const apache::thrift::server::TServerObserver::CallTimestamps&,
         std::map<std::string, std::string>* newHeaders = nullptr) const;
@@ -238,6 +270,9 @@ class Cpp2Connection : public ResponseChannel::Callback,
 
   std::unordered_set<Cpp2Request*> activeRequests_;
 
+  uint64_t requestsSinceSample_{0};
+  uint64_t sampledRequests_{0};
+
   void removeRequest(Cpp2Request* req);
   void killRequest(
       ResponseChannelRequest& req,
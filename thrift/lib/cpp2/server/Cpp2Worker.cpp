@@ -16,6 +16,9 @@
 
 #include <thrift/lib/cpp2/server/Cpp2Worker.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include <glog/logging.h>
 
 #include <folly/String.h>
@@ -24,6 +27,7 @@
 #include <thrift/lib/cpp/async/TAsyncSSLSocket.h>
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 #include <thrift/lib/cpp/concurrency/Util.h>
+#include <thrift/lib/cpp2/security/KTLS.h>
 #include <thrift/lib/cpp2/server/Cpp2Connection.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 #include <thrift/lib/cpp2/server/peeking/PeekingManager.h>
@@ -31,10 +35,6 @@
 #include <wangle/acceptor/SSLAcceptorHandshakeHelper.h>
 #include <wangle/acceptor/UnencryptedAcceptorHandshakeHelper.h>
 
-#ifdef HAVE_FB_KTLS
-#include <openssl/ssl_fb.h>
-#endif
-
 DEFINE_int32(pending_interval, 0, "Pending count interval in ms");
 
 namespace apache {
@@ -164,28 +164,24 @@ void Cpp2Worker::sslConnectionReady(
     const std::string& nextProtocol,
     wangle::SecureTransportType secureTransportType,
     wangle::TransportInfo& tinfo) {
-#ifdef HAVE_FB_KTLS
-    if (server_->useKtls_) {
-      auto sslSocket =
-          sock->getUnderlyingTransport<folly::AsyncSSLSocket>();
-      CHECK(sslSocket) << "Underlying socket in sslConnectionReady should be folly::AsyncSSLSocket()";
-      SSL* s = const_cast<SSL*>(sslSocket->getSSL());
-      int rc = SSL_fb_configure_ktls(s);
-      if (rc != 1) {
-        LOG(ERROR) << "SSL_fb_configure_ktls failure: return code " << rc;
-      } else {
-        LOG_EVERY_N(INFO, 1000) << "(sampled) configured ktls successfully on client "
-                                << clientAddr.getAddressStr();
-        auto evb = sslSocket->getEventBase();
-        auto zc = sslSocket->getZeroCopyBufId();
-        auto fd = sslSocket->detachFd();
-        sock.reset(new TAsyncSocket(folly::AsyncSocket::UniquePtr(
-            new folly::AsyncSocket(evb, fd, zc))));
+  if (server_->useKtls_) {
+    // Fizz connections and sessions the kernel can't take stay in userspace.
+    auto sslSocket = sock->getUnderlyingTransport<folly::AsyncSSLSocket>();
+    if (sslSocket) {
+      if (auto plain = KTLS::offload(*sslSocket)) {
+        VLOG(4) << "Offloaded TLS to the kernel for client "
+                << clientAddr.getAddressStr();
+        sock.reset(new TAsyncSocket(std::move(plain)));
+      } else if (!sslSocket->good()) {
+        // Half offloaded and closed, see KTLS::offload().
+        VLOG(4) << "Dropping connection from " << clientAddr.getAddressStr()
+                << " after a kTLS failure";
+        return;
       }
     }
-#endif
-    wangle::Acceptor::sslConnectionReady(
-        std::move(sock), clientAddr, nextProtocol, secureTransportType, tinfo);
+  }
+  wangle::Acceptor::sslConnectionReady(
+      std::move(sock), clientAddr, nextProtocol, secureTransportType, tinfo);
 }
 
 void Cpp2Worker::plaintextConnectionReady(
@@ -256,6 +252,92 @@ int Cpp2Worker::getPendingCount() const {
   return pendingCount_;
 }
 
+void Cpp2Worker::sampleLoad() {
+  getEventBase()->dcheckIsInEventBaseThread();
+
+  auto now = std::chrono::steady_clock::now();
+  auto cpuTime = RequestTimings::currentThreadCpuTime();
+  double utilization = getUtilization();
+  if (lastLoadSampleTime_ != std::chrono::steady_clock::time_point()) {
+    auto wall = now - lastLoadSampleTime_;
+    if (wall.count() > 0) {
+      utilization = double((cpuTime - lastLoadSampleCpuTime_).count()) /
+          std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count();
+    }
+  }
+  lastLoadSampleTime_ = now;
+  lastLoadSampleCpuTime_ = cpuTime;
+  sampleLoad(utilization);
+}
+
+void Cpp2Worker::sampleLoad(double utilization) {
+  getEventBase()->dcheckIsInEventBaseThread();
+
+  utilization_.store(
+      std::min(std::max(utilization, 0.0), 1.0), std::memory_order_relaxed);
+  Acceptor::getConnectionManager()->iterateConns(
+      [](wangle::ManagedConnection* connection) {
+        if (auto conn = dynamic_cast<Cpp2Connection*>(connection)) {
+          conn->sampleRequests();
+        }
+      });
+}
+
+bool Cpp2Worker::migrateConnectionTo(
+    std::shared_ptr<Cpp2Worker> target,
+    double targetUtilization) {
+  getEventBase()->dcheckIsInEventBaseThread();
+  if (stopping_) {
+    return false;
+  }
+
+  const double utilization = getUtilization();
+  const double gap = utilization - targetUtilization;
+  if (gap <= 0) {
+    return false;
+  }
+
+  uint64_t totalRequests = 0;
+  Acceptor::getConnectionManager()->iterateConns(
+      [&](wangle::ManagedConnection* connection) {
+        if (auto conn = dynamic_cast<Cpp2Connection*>(connection)) {
+          totalRequests += conn->getSampledRequests();
+        }
+      });
+  if (totalRequests == 0) {
+    return false;
+  }
+
+  // Moving a connection carrying `share` of the load changes the gap to
+  // |gap - 2 * share|, so the ideal candidate carries half of the gap. Only
+  // candidates that actually shrink the gap are considered.
+  Cpp2Connection* best = nullptr;
+  double bestDistance = gap / 2;
+  Acceptor::getConnectionManager()->iterateConns(
+      [&](wangle::ManagedConnection* connection) {
+        auto conn = dynamic_cast<Cpp2Connection*>(connection);
+        if (!conn || conn->getSampledRequests() == 0 ||
+            !conn->isDetachable()) {
+          return;
+        }
+        double share =
+            utilization * conn->getSampledRequests() / totalRequests;
+        double distance = std::abs(share - gap / 2);
+        if (distance < bestDistance) {
+          best = conn;
+          bestDistance = distance;
+        }
+      });
+  if (!best) {
+    return false;
+  }
+
+  VLOG(4) << "Cpp2Worker: migrating connection to another IO thread, "
+          << "utilization " << utilization << " vs " << targetUtilization;
+  best->migrateTo(std::move(target));
+  return true;
+}
+
 void Cpp2Worker::updateSSLStats(
     const folly::AsyncTransportWrapper* sock,
     std::chrono::milliseconds /* acceptLatency */,
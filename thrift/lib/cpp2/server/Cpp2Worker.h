@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <unordered_set>
 
 #include <folly/io/async/AsyncServerSocket.h>
@@ -92,6 +94,14 @@ class Cpp2Worker : public wangle::Acceptor,
     return server_;
   }
 
+  /**
+   * Per-method stats of this worker's IO thread. Only write to them from
+   * that thread.
+   */
+  const std::shared_ptr<ThreadMethodStats>& getMethodStats() const {
+    return methodStats_;
+  }
+
   /**
    * Count the number of pending fds. Used for overload detection.
    * Not thread-safe.
@@ -115,6 +125,36 @@ class Cpp2Worker : public wangle::Acceptor,
       folly::AsyncTransportWrapper::UniquePtr sock,
       const folly::SocketAddress* addr);
 
+  /**
+   * Sample the utilization of this worker's IO thread (its CPU time over the
+   * wall time since the previous sample) and the number of requests each
+   * connection received in that window. Must be called on the IO thread.
+   */
+  void sampleLoad();
+
+  /**
+   * As sampleLoad(), with the given utilization instead of a measured one.
+   */
+  void sampleLoad(double utilization);
+
+  /**
+   * Utilization computed by the last sampleLoad(), in [0, 1]. Thread-safe.
+   */
+  double getUtilization() const {
+    return utilization_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Move at most one connection that is idle between requests to target.
+   * Picks the connection whose share of this worker's sampled load best
+   * halves the gap to targetUtilization. Must be called on the IO thread.
+   *
+   * @returns whether a connection was migrated
+   */
+  bool migrateConnectionTo(
+      std::shared_ptr<Cpp2Worker> target,
+      double targetUtilization);
+
  protected:
   Cpp2Worker(
       ThriftServer* server,
@@ -122,6 +162,7 @@ class Cpp2Worker : public wangle::Acceptor,
       : Acceptor(server->getServerSocketConfig()),
         wangle::PeekingAcceptorHandshakeHelper::PeekCallback(kPeekCount),
         server_(server),
+        methodStats_(server->getMethodStatsRegistry().addThread()),
         activeRequests_(0),
         pendingCount_(0),
         pendingTime_(std::chrono::steady_clock::now()) {}
@@ -196,6 +237,9 @@ class Cpp2Worker : public wangle::Acceptor,
   /// The mother ship.
   ThriftServer* server_;
 
+  // Per-method stats written only from this worker's IO thread.
+  std::shared_ptr<ThreadMethodStats> methodStats_;
+
   FizzPeeker fizzPeeker_;
 
   // For DuplexChannel case, set only during shutdown so that we can extend the
@@ -236,6 +280,10 @@ class Cpp2Worker : public wangle::Acceptor,
   int pendingCount_;
   std::chrono::steady_clock::time_point pendingTime_;
 
+  std::chrono::steady_clock::time_point lastLoadSampleTime_;
+  std::chrono::nanoseconds lastLoadSampleCpuTime_{0};
+  std::atomic<double> utilization_{0};
+
   wangle::AcceptorHandshakeHelper::UniquePtr getHelper(
       const std::vector<uint8_t>& bytes,
       const folly::SocketAddress& clientAddr,
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/server/MethodStats.h>
+
+#include <cmath>
+#include <limits>
+
+namespace apache {
+namespace thrift {
+
+void StatsHistogramSnapshot::merge(const StatsHistogramSnapshot& other) {
+  count += other.count;
+  sum += other.sum;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    buckets[i] += other.buckets[i];
+  }
+}
+
+uint64_t StatsHistogramSnapshot::percentileUpperBound(double pct) const {
+  uint64_t total = 0;
+  for (auto b : buckets) {
+    total += b;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(total * pct / 100.0));
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return i == 0 ? 0 : (uint64_t(1) << i) - 1;
+    }
+  }
+  return std::numeric_limits<uint64_t>::max();
+}
+
+void StatsHistogram::snapshotInto(StatsHistogramSnapshot& snapshot) const {
+  StatsHistogramSnapshot mine;
+  mine.count = count_.load(std::memory_order_relaxed);
+  mine.sum = sum_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < StatsHistogramSnapshot::kNumBuckets; ++i) {
+    mine.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  snapshot.merge(mine);
+}
+
+void MethodStatsSnapshot::merge(const MethodStatsSnapshot& other) {
+  errors += other.errors;
+  queueTimeUs.merge(other.queueTimeUs);
+  handlerTimeUs.merge(other.handlerTimeUs);
+  serializationTimeUs.merge(other.serializationTimeUs);
+  cpuTimeUs.merge(other.cpuTimeUs);
+  bytesIn.merge(other.bytesIn);
+  bytesOut.merge(other.bytesOut);
+}
+
+void MethodStats::snapshotInto(MethodStatsSnapshot& snapshot) const {
+  snapshot.errors += errors_.load(std::memory_order_relaxed);
+  queueTimeUs_.snapshotInto(snapshot.queueTimeUs);
+  handlerTimeUs_.snapshotInto(snapshot.handlerTimeUs);
+  serializationTimeUs_.snapshotInto(snapshot.serializationTimeUs);
+  cpuTimeUs_.snapshotInto(snapshot.cpuTimeUs);
+  bytesIn_.snapshotInto(snapshot.bytesIn);
+  bytesOut_.snapshotInto(snapshot.bytesOut);
+}
+
+constexpr size_t ThreadMethodStats::kMaxMethods;
+const char* const ThreadMethodStats::kUnknownMethod = "<unknown>";
+
+MethodStats& ThreadMethodStats::get(const std::string& method) {
+  // Only the owning thread mutates methods_, so an unlocked lookup here
+  // cannot race with an insertion.
+  auto it = methods_.find(method);
+  if (it != methods_.end()) {
+    return *it->second;
+  }
+  if (methods_.size() >= kMaxMethods && method != kUnknownMethod) {
+    return get(kUnknownMethod);
+  }
+  std::unique_lock<folly::SharedMutex> lock(mutex_);
+  auto& stats = methods_[method];
+  stats = std::make_unique<MethodStats>();
+  return *stats;
+}
+
+void ThreadMethodStats::snapshotInto(
+    std::map<std::string, MethodStatsSnapshot>& out) const {
+  folly::SharedMutex::ReadHolder lock(mutex_);
+  for (const auto& entry : methods_) {
+    entry.second->snapshotInto(out[entry.first]);
+  }
+}
+
+ServerMethodStats::ServerMethodStats() : state_(std::make_shared<State>()) {}
+
+std::shared_ptr<ThreadMethodStats> ServerMethodStats::addThread() {
+  std::shared_ptr<ThreadMethodStats> stats(
+      new ThreadMethodStats(),
+      [weak = std::weak_ptr<State>(state_)](ThreadMethodStats* retiring) {
+        if (auto state = weak.lock()) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          retiring->snapshotInto(state->retired);
+          state->threads.erase(retiring);
+        }
+        delete retiring;
+      });
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->threads.insert(stats.get());
+  return stats;
+}
+
+std::map<std::string, MethodStatsSnapshot> ServerMethodStats::aggregate()
+    const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  auto result = state_->retired;
+  for (auto thread : state_->threads) {
+    thread->snapshotInto(result);
+  }
+  return result;
+}
+
+} // namespace thrift
+} // namespace apache
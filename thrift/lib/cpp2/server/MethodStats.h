@@ -0,0 +1,306 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/SharedMutex.h>
+#include <folly/lang/Bits.h>
+#include <folly/portability/Time.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * Point-in-time copy of a StatsHistogram. Buckets are powers of two: bucket
+ * 0 holds the value 0, bucket i (i > 0) holds values in [2^(i-1), 2^i).
+ */
+struct StatsHistogramSnapshot {
+  static constexpr size_t kNumBuckets = 64;
+
+  uint64_t count{0};
+  uint64_t sum{0};
+  std::array<uint64_t, kNumBuckets> buckets{};
+
+  void merge(const StatsHistogramSnapshot& other);
+
+  double average() const {
+    return count ? static_cast<double>(sum) / count : 0.0;
+  }
+
+  /**
+   * Upper bound of the bucket containing the given percentile (0-100).
+   * Returns 0 for an empty histogram.
+   */
+  uint64_t percentileUpperBound(double pct) const;
+};
+
+/**
+ * Log2-bucketed histogram with a single writer and any number of readers.
+ *
+ * The owning IO thread is the only writer, so updates are plain relaxed
+ * load/store pairs rather than locked read-modify-write instructions. Readers
+ * on other threads may observe a bucket update before the matching count or
+ * sum update, which is fine for monitoring purposes.
+ */
+class StatsHistogram {
+ public:
+  void addValue(uint64_t value) {
+    auto bucket = value == 0 ? 0 : folly::findLastSet(value);
+    if (bucket >= StatsHistogramSnapshot::kNumBuckets) {
+      bucket = StatsHistogramSnapshot::kNumBuckets - 1;
+    }
+    bump(buckets_[bucket], 1);
+    bump(count_, 1);
+    bump(sum_, value);
+  }
+
+  void snapshotInto(StatsHistogramSnapshot& snapshot) const;
+
+ private:
+  static void bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + delta,
+        std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::array<std::atomic<uint64_t>, StatsHistogramSnapshot::kNumBuckets>
+      buckets_{};
+};
+
+/**
+ * Timings and sizes of a single completed call, as recorded by the
+ * connection once the reply has been handed to the channel.
+ */
+struct CallStats {
+  std::chrono::microseconds queueTime{0};
+  std::chrono::microseconds handlerTime{0};
+  std::chrono::microseconds serializationTime{0};
+  std::chrono::microseconds cpuTime{0};
+  uint64_t bytesIn{0};
+  uint64_t bytesOut{0};
+  bool error{false};
+};
+
+/**
+ * Raw timestamps collected while a request moves through the server. The
+ * IO thread fills in `received`, the CPU thread fills in the rest before
+ * handing the reply back to the IO thread, which converts them to CallStats.
+ * A default-constructed `received` means stats are disabled for the request.
+ */
+struct RequestTimings {
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point received;
+  Clock::time_point processBegin;
+  Clock::time_point handlerEnd;
+  Clock::time_point serializeEnd;
+  std::chrono::nanoseconds cpuBegin{0};
+  std::chrono::nanoseconds cpuEnd{0};
+  std::thread::id cpuThread;
+  uint64_t bytesIn{0};
+  bool trackCpuTime{false};
+
+  bool enabled() const {
+    return received != Clock::time_point();
+  }
+
+  /**
+   * Thread CPU time needs a clock_gettime syscall on most kernels, so it is
+   * only sampled when trackCpuTime is set.
+   */
+  static std::chrono::nanoseconds currentThreadCpuTime() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+      return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::seconds(ts.tv_sec) +
+        std::chrono::nanoseconds(ts.tv_nsec);
+  }
+
+  void markProcessBegin() {
+    if (!enabled()) {
+      return;
+    }
+    processBegin = Clock::now();
+    if (trackCpuTime) {
+      cpuThread = std::this_thread::get_id();
+      cpuBegin = currentThreadCpuTime();
+    }
+  }
+
+  void markHandlerEnd() {
+    if (enabled()) {
+      handlerEnd = Clock::now();
+    }
+  }
+
+  void markSerializeEnd() {
+    if (!enabled()) {
+      return;
+    }
+    serializeEnd = Clock::now();
+    // Handlers that complete on a different thread than the one they
+    // started on have no meaningful thread CPU delta.
+    if (trackCpuTime && cpuThread == std::this_thread::get_id()) {
+      cpuEnd = currentThreadCpuTime();
+    }
+  }
+
+  CallStats toCallStats(uint64_t bytesOut, bool error) const {
+    CallStats call;
+    call.queueTime = between(received, processBegin);
+    call.handlerTime = between(processBegin, handlerEnd);
+    call.serializationTime = between(handlerEnd, serializeEnd);
+    if (cpuEnd > cpuBegin) {
+      call.cpuTime = std::chrono::duration_cast<std::chrono::microseconds>(
+          cpuEnd - cpuBegin);
+    }
+    call.bytesIn = bytesIn;
+    call.bytesOut = bytesOut;
+    call.error = error;
+    return call;
+  }
+
+ private:
+  static std::chrono::microseconds between(
+      Clock::time_point begin,
+      Clock::time_point end) {
+    if (begin == Clock::time_point() || end < begin) {
+      return std::chrono::microseconds(0);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+  }
+};
+
+struct MethodStatsSnapshot {
+  uint64_t errors{0};
+  StatsHistogramSnapshot queueTimeUs;
+  StatsHistogramSnapshot handlerTimeUs;
+  StatsHistogramSnapshot serializationTimeUs;
+  StatsHistogramSnapshot cpuTimeUs;
+  StatsHistogramSnapshot bytesIn;
+  StatsHistogramSnapshot bytesOut;
+
+  void merge(const MethodStatsSnapshot& other);
+};
+
+/**
+ * Per-method histograms owned by one IO thread.
+ */
+class MethodStats {
+ public:
+  void record(const CallStats& call) {
+    queueTimeUs_.addValue(call.queueTime.count());
+    handlerTimeUs_.addValue(call.handlerTime.count());
+    serializationTimeUs_.addValue(call.serializationTime.count());
+    if (call.cpuTime.count() > 0) {
+      cpuTimeUs_.addValue(call.cpuTime.count());
+    }
+    bytesIn_.addValue(call.bytesIn);
+    bytesOut_.addValue(call.bytesOut);
+    if (call.error) {
+      errors_.store(
+          errors_.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+    }
+  }
+
+  void snapshotInto(MethodStatsSnapshot& snapshot) const;
+
+ private:
+  std::atomic<uint64_t> errors_{0};
+  StatsHistogram queueTimeUs_;
+  StatsHistogram handlerTimeUs_;
+  StatsHistogram serializationTimeUs_;
+  StatsHistogram cpuTimeUs_;
+  StatsHistogram bytesIn_;
+  StatsHistogram bytesOut_;
+};
+
+/**
+ * All method stats written by one IO thread.
+ *
+ * Lookups happen on the owning thread without locking; the map is only
+ * mutated by that same thread, under an exclusive lock, the first time it
+ * sees a method. Aggregation from other threads takes the lock shared.
+ *
+ * Method names come from clients, so the map is bounded: once it holds
+ * kMaxMethods entries, calls to methods it hasn't seen yet are recorded
+ * under kUnknownMethod.
+ */
+class ThreadMethodStats {
+ public:
+  static constexpr size_t kMaxMethods = 1024;
+  static const char* const kUnknownMethod;
+
+  MethodStats& get(const std::string& method);
+
+  void snapshotInto(std::map<std::string, MethodStatsSnapshot>& out) const;
+
+ private:
+  mutable folly::SharedMutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<MethodStats>> methods_;
+};
+
+/**
+ * Registry of per-IO-thread method stats for a server. Each Cpp2Worker
+ * registers one ThreadMethodStats when it is constructed. When the last
+ * reference to it goes away (i.e. the worker is destroyed), its counts are
+ * folded into the server's totals and its entry is dropped, so totals
+ * survive worker restarts without the registry growing.
+ */
+class ServerMethodStats {
+ public:
+  ServerMethodStats();
+
+  std::shared_ptr<ThreadMethodStats> addThread();
+
+  /**
+   * Aggregate all threads' stats into one snapshot per method. This walks
+   * every thread's histograms and is meant to be called on demand (e.g. from
+   * a stats exporter), not on the request path.
+   */
+  std::map<std::string, MethodStatsSnapshot> aggregate() const;
+
+ private:
+  // Shared with the deleters of the ThreadMethodStats, which may outlive
+  // the registry.
+  struct State {
+    std::mutex mutex;
+    std::unordered_set<const ThreadMethodStats*> threads;
+    std::map<std::string, MethodStatsSnapshot> retired;
+  };
+
+  std::shared_ptr<State> state_;
+};
+
+} // namespace thrift
+} // namespace apache
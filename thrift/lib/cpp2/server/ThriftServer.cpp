@@ -18,6 +18,7 @@
 #include <fcntl.h>
 #include <signal.h>
 
+#include <algorithm>
 #include <iostream>
 #include <random>
 
@@ -201,6 +202,125 @@ void ThriftServer::touchRequestTimestamp() noexcept {
   }
 }
 
+ThriftServer::ConnectionRebalancer::ConnectionRebalancer(
+    ThriftServer& server,
+    folly::HHWheelTimer& timer,
+    std::chrono::milliseconds interval)
+    : server_(server), timer_(timer), interval_(interval) {
+  timer_.scheduleTimeout(this, interval_);
+}
+
+void ThriftServer::ConnectionRebalancer::timeoutExpired() noexcept {
+  try {
+    server_.rebalanceConnections();
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to rebalance connections: " << ex.what();
+  }
+  timer_.scheduleTimeout(this, interval_);
+}
+
+namespace {
+std::vector<std::shared_ptr<Cpp2Worker>> getCpp2Workers(
+    ThriftServer& server) {
+  std::vector<std::shared_ptr<Cpp2Worker>> workers;
+  server.forEachWorker([&](wangle::Acceptor* acceptor) {
+    if (auto worker = dynamic_cast<Cpp2Worker*>(acceptor)) {
+      workers.push_back(worker->shared_from_this());
+    }
+  });
+  return workers;
+}
+
+bool migrateFromBusiestWorker(
+    const std::vector<std::shared_ptr<Cpp2Worker>>& workers,
+    double threshold) {
+  if (workers.size() < 2) {
+    return false;
+  }
+
+  auto minmax = std::minmax_element(
+      workers.begin(), workers.end(), [](const auto& a, const auto& b) {
+        return a->getUtilization() < b->getUtilization();
+      });
+  auto idlest = *minmax.first;
+  auto busiest = *minmax.second;
+  const double busy = busiest->getUtilization();
+  const double idle = idlest->getUtilization();
+
+  // Ignore noise on mostly idle servers
+  constexpr double kMinUtilizationGap = 0.1;
+  if (busy - idle < kMinUtilizationGap || busy < idle * threshold) {
+    return false;
+  }
+
+  busiest->getEventBase()->runInEventBaseThread(
+      [busiest, idlest = std::move(idlest), idle]() mutable {
+        busiest->migrateConnectionTo(std::move(idlest), idle);
+      });
+  return true;
+}
+} // namespace
+
+void ThriftServer::rebalanceConnections() {
+  if (serverChannel_) {
+    // Duplex servers run on a single client event base
+    return;
+  }
+
+  auto workers = getCpp2Workers(*this);
+  if (workers.size() < 2) {
+    return;
+  }
+  // A worker that hasn't sampled the previous round yet is busy or stuck;
+  // skip this round rather than wait for it.
+  if (connectionRebalanceInFlight_->exchange(true)) {
+    VLOG(4) << "Skipping connection rebalancing, an IO thread is still busy";
+    return;
+  }
+
+  // The last worker to take its sample makes the decision, on its own IO
+  // thread, so that the acceptor never waits for the IO threads.
+  struct Round {
+    std::vector<std::shared_ptr<Cpp2Worker>> workers;
+    std::atomic<size_t> remaining;
+    double threshold;
+    std::shared_ptr<std::atomic<bool>> inFlight;
+  };
+  auto round = std::make_shared<Round>();
+  round->workers = std::move(workers);
+  round->remaining = round->workers.size();
+  round->threshold = connectionRebalanceThreshold_;
+  round->inFlight = connectionRebalanceInFlight_;
+
+  for (auto& worker : round->workers) {
+    worker->getEventBase()->runInEventBaseThread([round, worker] {
+      worker->sampleLoad();
+      if (round->remaining.fetch_sub(1) == 1) {
+        migrateFromBusiestWorker(round->workers, round->threshold);
+        round->inFlight->store(false);
+      }
+    });
+  }
+}
+
+bool ThriftServer::migrateSampledConnection() {
+  if (serverChannel_) {
+    return false;
+  }
+  return migrateFromBusiestWorker(
+      getCpp2Workers(*this), connectionRebalanceThreshold_);
+}
+
+std::vector<double> ThriftServer::getIOWorkerUtilization() const {
+  std::vector<double> utilization;
+  forEachWorker([&](wangle::Acceptor* acceptor) {
+    if (auto worker = dynamic_cast<Cpp2Worker*>(acceptor)) {
+      utilization.push_back(worker->getUtilization());
+    }
+  });
+  return utilization;
+}
+
 void ThriftServer::setup() {
   DCHECK_NOTNULL(getProcessorFactory().get());
   auto nWorkers = getNumIOWorkerThreads();
@@ -214,6 +334,12 @@ void ThriftServer::setup() {
     idleServer_.emplace(
         *this, serveEventBase_.load()->timer(), idleServerTimeout_);
   }
+  if (connectionRebalanceInterval_.count() > 0 && !serverChannel_) {
+    connectionRebalancer_.emplace(
+        *this,
+        serveEventBase_.load()->timer(),
+        connectionRebalanceInterval_);
+  }
   // Print some libevent stats
   VLOG(1) << "libevent " << folly::EventBase::getLibeventVersion() << " method "
           << folly::EventBase::getLibeventMethod();
@@ -414,6 +540,7 @@ void ThriftServer::cleanUp() {
   // It is users duty to make sure that setup() call
   // should have returned before doing this cleanup
   idleServer_.clear();
+  connectionRebalancer_.clear();
   serveEventBase_ = nullptr;
   stopListening();
 
@@ -507,6 +634,7 @@ void ThriftServer::handleSetupFailure(void) {
 
   // avoid crash on stop()
   idleServer_.clear();
+  connectionRebalancer_.clear();
   serveEventBase_ = nullptr;
 }
 
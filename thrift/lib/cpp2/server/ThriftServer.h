@@ -105,6 +105,26 @@ class ThriftServer : public apache::thrift::BaseThriftServer,
   std::atomic<folly::EventBase*> serveEventBase_{nullptr};
   folly::Optional<IdleServerAction> idleServer_;
   std::chrono::milliseconds idleServerTimeout_ = std::chrono::milliseconds(0);
+
+  struct ConnectionRebalancer : public folly::HHWheelTimer::Callback {
+    ConnectionRebalancer(
+        ThriftServer& server,
+        folly::HHWheelTimer& timer,
+        std::chrono::milliseconds interval);
+
+    void timeoutExpired() noexcept override;
+
+    ThriftServer& server_;
+    folly::HHWheelTimer& timer_;
+    std::chrono::milliseconds interval_;
+  };
+
+  folly::Optional<ConnectionRebalancer> connectionRebalancer_;
+  // Set while the IO threads sample their load for a rebalancing round.
+  std::shared_ptr<std::atomic<bool>> connectionRebalanceInFlight_{
+      std::make_shared<std::atomic<bool>>(false)};
+  std::chrono::milliseconds connectionRebalanceInterval_{0};
+  double connectionRebalanceThreshold_ = 1.5;
   folly::Optional<std::chrono::milliseconds> sslHandshakeTimeout_;
   std::atomic<std::chrono::steady_clock::duration::rep> lastRequestTime_;
 
@@ -290,11 +310,13 @@ class ThriftServer : public apache::thrift::BaseThriftServer,
     namedFactory->setNamePrefix(cpp2WorkerThreadName);
   }
 
-  // Experimental: Use kTLS if possible
+  /**
+   * Experimental: hand the keys of TLS connections to the kernel (kTLS)
+   * after the handshake, see KTLS.h. Sessions the kernel can't take,
+   * including Fizz ones, keep using userspace TLS.
+   */
   void setUseKtls(bool flag) {
-#ifdef HAVE_FB_KTLS
     useKtls_ = flag;
-#endif
   }
   /**
    * Number of connections that epoll says need attention but ThriftServer
@@ -371,6 +393,48 @@ class ThriftServer : public apache::thrift::BaseThriftServer,
     idleServerTimeout_ = timeout;
   }
 
+  /**
+   * Periodically move header connections that are idle between requests
+   * from the busiest IO thread to the least busy one. Load is the IO
+   * thread's CPU time over wall time during the last interval. 0 (the
+   * default) disables rebalancing.
+   */
+  void setConnectionRebalanceInterval(std::chrono::milliseconds interval) {
+    connectionRebalanceInterval_ = interval;
+  }
+
+  /**
+   * Only rebalance when the busiest IO thread is at least this many times
+   * as loaded as the least busy one.
+   */
+  void setConnectionRebalanceThreshold(double threshold) {
+    connectionRebalanceThreshold_ = threshold;
+  }
+
+  /**
+   * Ask every IO thread to sample its load and, once all of them have,
+   * migrate one connection if the load is skewed enough. Never blocks on
+   * the IO threads: a round is skipped while the previous one is still
+   * waiting for a sample. Called by the rebalance timer; the first round
+   * only establishes the baseline.
+   */
+  void rebalanceConnections();
+
+  /**
+   * Compare the utilization each IO worker recorded in its last
+   * Cpp2Worker::sampleLoad() and, if the busiest one is loaded enough more
+   * than the idlest one, have it migrate a connection to the idlest one.
+   * The migration itself runs on the IO threads.
+   *
+   * @returns whether a migration was scheduled
+   */
+  bool migrateSampledConnection();
+
+  /**
+   * Utilization of each IO thread as of the last rebalanceConnections().
+   */
+  std::vector<double> getIOWorkerUtilization() const;
+
   void updateTicketSeeds(wangle::TLSTicketKeySeeds seeds);
 
   void updateTLSCert();
@@ -197,6 +197,37 @@ BENCHMARK(CompactProtocolWriter_serialize_deep, kiters) {
   braces.rehire();
 }
 
+// About 100KB once serialized.
+const size_t kCachedTriplesz = 19;
+
+BENCHMARK(CompactProtocolWriter_serialize_cached_regular, kiters) {
+  BenchmarkSuspender braces;
+  size_t iters = kiters << kMultExp;
+  DeepResponse response;
+  response.value = makeDeep(kCachedTriplesz);
+  braces.dismiss();
+  while (iters--) {
+    CompactSerializer ser;
+    IOBufQueue bufq;
+    ser.serialize(response, &bufq);
+  }
+  braces.rehire();
+}
+
+BENCHMARK_RELATIVE(CompactProtocolWriter_serialize_cached_spliced, kiters) {
+  BenchmarkSuspender braces;
+  size_t iters = kiters << kMultExp;
+  CachedDeepResponse response;
+  response.value = SerializedStruct<Deep>::serialize(makeDeep(kCachedTriplesz));
+  braces.dismiss();
+  while (iters--) {
+    CompactSerializer ser;
+    IOBufQueue bufq;
+    ser.serialize(response, &bufq);
+  }
+  braces.rehire();
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   google::InitGoogleLogging(argv[0]);
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+cpp_include "<thrift/lib/cpp2/protocol/SerializedStruct.h>"
+
 struct Empty {
 }
 
@@ -33,3 +35,15 @@ struct Deep1 {
 struct Deep {
   1: list<Deep1> deeps;
 }
+
+typedef Deep (cpp.type = "::apache::thrift::SerializedStruct<::cpp2::Deep>")
+    CachedDeep
+
+// The same response, built from a Deep or from its cached serialization.
+struct DeepResponse {
+  1: Deep value;
+}
+
+struct CachedDeepResponse {
+  1: CachedDeep value;
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/async/ConcurrencyLimitingRequestChannel.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/EventBase.h>
+#include <thrift/lib/cpp/TApplicationException.h>
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/util/ScopedServerInterfaceThread.h>
+
+#include <folly/portability/GTest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::async::TAsyncSocket;
+
+namespace {
+// Serves every request after "delay", stretched in proportion once more
+// than "capacity" requests are in progress, like a server whose requests
+// share a fixed number of cores.
+class CapacityHandler : public TestServiceSvIf {
+ public:
+  folly::Future<int32_t> future_echoInt(int32_t req) override {
+    auto n = ++inflight;
+    auto peak = maxInflight.load();
+    while (n > peak && !maxInflight.compare_exchange_weak(peak, n)) {
+    }
+    auto factor = std::max(1.0, double(n) / capacity.load());
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+        baseDelay * factor);
+    auto start = std::chrono::steady_clock::now();
+    return folly::futures::sleep(delay).thenValue([this, req, start](auto&&) {
+      --inflight;
+      std::chrono::duration<double, std::milli> latency =
+          std::chrono::steady_clock::now() - start;
+      std::lock_guard<std::mutex> g(mutex);
+      latenciesMs.push_back(latency.count());
+      return req;
+    });
+  }
+
+  // The latencies of the requests served since the last call.
+  std::vector<double> takeLatencies() {
+    std::lock_guard<std::mutex> g(mutex);
+    return std::move(latenciesMs);
+  }
+
+  std::chrono::milliseconds baseDelay{5};
+  std::atomic<int> capacity{1000};
+  std::atomic<int> inflight{0};
+  std::atomic<int> maxInflight{0};
+  std::mutex mutex;
+  std::vector<double> latenciesMs;
+};
+
+double mean(const std::vector<double>& samples) {
+  return std::accumulate(samples.begin(), samples.end(), 0.0) /
+      samples.size();
+}
+
+double p99(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() * 99 / 100];
+}
+
+void expectLoadShedding(folly::Try<int32_t>& result) {
+  ASSERT_TRUE(result.hasException());
+  auto ex = result.tryGetExceptionObject<TApplicationException>();
+  ASSERT_NE(nullptr, ex);
+  EXPECT_EQ(TApplicationException::LOADSHEDDING, ex->getType());
+}
+} // namespace
+
+class ConcurrencyLimitingRequestChannelTest : public testing::Test {
+ public:
+  std::unique_ptr<TestServiceAsyncClient> newClient(
+      ConcurrencyLimitingRequestChannel::Options options) {
+    auto channel = ConcurrencyLimitingRequestChannel::newChannel(
+        HeaderClientChannel::newChannel(
+            TAsyncSocket::newSocket(eb, runner.getAddress())),
+        std::move(options));
+    limiter = channel.get();
+    return std::make_unique<TestServiceAsyncClient>(std::move(channel));
+  }
+
+  folly::EventBase* eb{folly::EventBaseManager::get()->getEventBase()};
+  std::shared_ptr<CapacityHandler> handler{
+      std::make_shared<CapacityHandler>()};
+  ScopedServerInterfaceThread runner{handler};
+  ConcurrencyLimitingRequestChannel* limiter{nullptr};
+};
+
+TEST_F(ConcurrencyLimitingRequestChannelTest, rejectsAboveLimit) {
+  handler->baseDelay = std::chrono::milliseconds(50);
+  ConcurrencyLimitingRequestChannel::Options options;
+  options.initialLimit = 2;
+  options.maxLimit = 2;
+  auto client = newClient(options);
+
+  std::vector<folly::Future<int32_t>> futures;
+  for (int i = 0; i < 5; ++i) {
+    futures.push_back(client->future_echoInt(i));
+  }
+  EXPECT_EQ(2, limiter->getStats().inflight);
+  EXPECT_EQ(3, limiter->getStats().rejected);
+
+  auto results = folly::collectAll(futures).getVia(eb);
+  EXPECT_EQ(0, results[0].value());
+  EXPECT_EQ(1, results[1].value());
+  for (int i = 2; i < 5; ++i) {
+    expectLoadShedding(results[i]);
+  }
+  EXPECT_EQ(2, handler->maxInflight);
+  EXPECT_EQ(0, limiter->getStats().inflight);
+}
+
+TEST_F(ConcurrencyLimitingRequestChannelTest, queuesAboveLimit) {
+  ConcurrencyLimitingRequestChannel::Options options;
+  options.initialLimit = 1;
+  options.maxLimit = 1;
+  options.maxQueueSize = 10;
+  auto client = newClient(options);
+
+  std::vector<folly::Future<int32_t>> futures;
+  for (int i = 0; i < 5; ++i) {
+    futures.push_back(client->future_echoInt(i));
+  }
+  EXPECT_EQ(1, limiter->getStats().inflight);
+  EXPECT_EQ(4, limiter->getStats().queued);
+
+  auto results = folly::collectAll(futures).getVia(eb);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(i, results[i].value());
+  }
+  EXPECT_EQ(1, handler->maxInflight);
+  EXPECT_EQ(0, limiter->getStats().rejected);
+}
+
+TEST_F(ConcurrencyLimitingRequestChannelTest, queueTimeout) {
+  handler->baseDelay = std::chrono::milliseconds(100);
+  ConcurrencyLimitingRequestChannel::Options options;
+  options.initialLimit = 1;
+  options.maxLimit = 1;
+  options.maxQueueSize = 10;
+  options.maxQueueTime = std::chrono::milliseconds(20);
+  auto client = newClient(options);
+
+  std::vector<folly::Future<int32_t>> futures;
+  for (int i = 0; i < 3; ++i) {
+    futures.push_back(client->future_echoInt(i));
+  }
+  auto results = folly::collectAll(futures).getVia(eb);
+  EXPECT_EQ(0, results[0].value());
+  expectLoadShedding(results[1]);
+  expectLoadShedding(results[2]);
+  EXPECT_EQ(2, limiter->getStats().rejected);
+}
+
+TEST_F(ConcurrencyLimitingRequestChannelTest, queueTimeoutWithoutCompletions) {
+  handler->baseDelay = std::chrono::seconds(2);
+  ConcurrencyLimitingRequestChannel::Options options;
+  options.initialLimit = 1;
+  options.maxLimit = 1;
+  options.maxQueueSize = 10;
+  options.maxQueueTime = std::chrono::milliseconds(20);
+  auto client = newClient(options);
+
+  auto first = client->future_echoInt(0);
+  auto start = std::chrono::steady_clock::now();
+  auto second = client->future_echoInt(1).getTryVia(eb);
+  // Failed by its own deadline, long before the first request completes.
+  EXPECT_LT(
+      std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+  expectLoadShedding(second);
+  EXPECT_FALSE(first.isReady());
+  EXPECT_EQ(0, limiter->getStats().queued);
+  EXPECT_EQ(0, std::move(first).getVia(eb));
+}
+
+TEST_F(ConcurrencyLimitingRequestChannelTest, overloadedRepliesShrinkLimit) {
+  std::atomic<bool> overloaded{true};
+  runner.getThriftServer().setIsOverloaded(
+      [&](const transport::THeader*, const std::string*) {
+        return overloaded.load();
+      });
+  ConcurrencyLimitingRequestChannel::Options options;
+  options.initialLimit = 100;
+  options.backoffRatio = 0.5;
+  auto client = newClient(options);
+
+  // Replies from a server shedding load are fast, and must not pass for a
+  // healthy RTT.
+  for (int i = 0; i < 3; ++i) {
+    auto result = client->future_echoInt(i).getTryVia(eb);
+    EXPECT_TRUE(result.hasException());
+  }
+  EXPECT_EQ(12, limiter->getStats().limit);
+
+  overloaded = false;
+  EXPECT_EQ(7, client->future_echoInt(7).getVia(eb));
+}
+
+// A closed loop of callers keeps the channel busy while the server loses
+// capacity: the limit must follow it down, and keep the server's queue (and
+// so its latency) short, instead of sending everything the callers issue.
+TEST_F(ConcurrencyLimitingRequestChannelTest, adaptsToCapacity) {
+  const int kCallers = 64;
+  handler->capacity = 32;
+  ConcurrencyLimitingRequestChannel::Options options;
+  options.initialLimit = 4;
+  options.maxQueueSize = kCallers;
+  options.maxQueueTime = std::chrono::seconds(10);
+  options.longWindow = 100;
+  auto client = newClient(options);
+
+  // Runs the callers for "duration", and returns the latencies the server
+  // served their requests with.
+  auto run = [&](std::chrono::milliseconds duration) {
+    auto deadline = std::chrono::steady_clock::now() + duration;
+    int running = kCallers;
+    std::function<void()> call = [&] {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        --running;
+        return;
+      }
+      client->future_echoInt(1).via(eb).thenTry(
+          [&](folly::Try<int32_t>&& result) {
+            EXPECT_TRUE(result.hasValue());
+            call();
+          });
+    };
+    for (int i = 0; i < kCallers; ++i) {
+      call();
+    }
+    while (running > 0) {
+      eb->loopOnce();
+    }
+    return handler->takeLatencies();
+  };
+
+  auto latenciesBefore = run(std::chrono::milliseconds(1000));
+  auto before = limiter->getStats().limit;
+  EXPECT_GE(before, 16);
+
+  handler->capacity = 4;
+  run(std::chrono::milliseconds(1000));
+  handler->maxInflight = 0;
+  auto latenciesAfter = run(std::chrono::milliseconds(500));
+  auto after = limiter->getStats().limit;
+  EXPECT_LT(after, before / 2);
+  // The server never sees the callers' full concurrency.
+  EXPECT_LT(handler->maxInflight, kCallers / 2);
+  EXPECT_EQ(0, limiter->getStats().rejected);
+
+  // All kCallers requests in flight would take 16 times baseDelay each. The
+  // limit keeps the server close to its capacity, and its latency close to
+  // what it was before.
+  ASSERT_FALSE(latenciesBefore.empty());
+  ASSERT_FALSE(latenciesAfter.empty());
+  auto baseline = mean(latenciesBefore);
+  EXPECT_LT(mean(latenciesAfter), 4 * baseline);
+  EXPECT_LT(p99(latenciesAfter), 8 * baseline);
+}
@@ -0,0 +1,25 @@
+namespace cpp2 apache.thrift.test
+
+struct Inner {
+  1: i32 id;
+  2: string name;
+  3: list<i64> values;
+}
+
+struct Outer {
+  1: i64 id;
+  2: string name;
+  3: Inner inner;
+  4: optional Inner extra;
+  5: map<string, i32> counts;
+}
+
+struct Checked {
+  1: required i32 key;
+  2: string value;
+}
+
+// Checked's wire format without the required field.
+struct Unchecked {
+  2: string value;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp/protocol/TProtocolException.h>
+#include <thrift/lib/cpp2/protocol/FieldMask.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/FieldProjection_types.h>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+
+namespace {
+
+Inner makeInner(const std::string& name) {
+  Inner inner;
+  inner.set_id(7);
+  inner.set_name(name);
+  inner.values = {1, 2, 3};
+  inner.__isset.values = true;
+  return inner;
+}
+
+Outer makeOuter() {
+  Outer outer;
+  outer.set_id(42);
+  outer.set_name("outer");
+  outer.set_inner(makeInner("inner"));
+  outer.set_extra(makeInner("extra"));
+  outer.counts = {{"a", 1}, {"b", 2}};
+  outer.__isset.counts = true;
+  return outer;
+}
+
+template <typename S>
+class FieldProjectionTest : public testing::Test {
+ protected:
+  template <typename T>
+  std::unique_ptr<folly::IOBuf> serialize(const T& obj) {
+    folly::IOBufQueue queue;
+    S::serialize(obj, &queue);
+    return queue.move();
+  }
+
+  template <typename T>
+  T project(const folly::IOBuf& buf, const FieldMask& mask) {
+    T obj;
+    S::deserializeProjected(&buf, obj, mask);
+    return obj;
+  }
+};
+
+using Serializers = testing::Types<CompactSerializer, BinarySerializer>;
+
+} // namespace
+
+TYPED_TEST_CASE(FieldProjectionTest, Serializers);
+
+TYPED_TEST(FieldProjectionTest, allFieldsRoundTrip) {
+  auto outer = makeOuter();
+  auto buf = this->serialize(outer);
+  EXPECT_EQ(
+      outer, this->template project<Outer>(*buf, {{1}, {2}, {3}, {4}, {5}}));
+}
+
+TYPED_TEST(FieldProjectionTest, skippedFieldsStayUnset) {
+  auto buf = this->serialize(makeOuter());
+  auto outer = this->template project<Outer>(*buf, {{2}, {5}});
+
+  EXPECT_EQ("outer", outer.get_name());
+  EXPECT_TRUE(outer.__isset.name);
+  EXPECT_EQ(
+      (std::map<std::string, int32_t>{{"a", 1}, {"b", 2}}), outer.get_counts());
+  EXPECT_TRUE(outer.__isset.counts);
+
+  EXPECT_EQ(0, outer.get_id());
+  EXPECT_FALSE(outer.__isset.id);
+  EXPECT_EQ(Inner(), outer.get_inner());
+  EXPECT_FALSE(outer.__isset.inner);
+  EXPECT_EQ(nullptr, outer.get_extra());
+}
+
+TYPED_TEST(FieldProjectionTest, nestedFields) {
+  auto buf = this->serialize(makeOuter());
+  auto outer = this->template project<Outer>(*buf, {{1}, {3, 2}, {4}});
+
+  EXPECT_EQ(42, outer.get_id());
+  EXPECT_TRUE(outer.__isset.inner);
+  EXPECT_EQ("inner", outer.get_inner().get_name());
+  EXPECT_TRUE(outer.get_inner().__isset.name);
+  EXPECT_EQ(0, outer.get_inner().get_id());
+  EXPECT_FALSE(outer.get_inner().__isset.id);
+  EXPECT_TRUE(outer.get_inner().get_values().empty());
+  EXPECT_FALSE(outer.get_inner().__isset.values);
+
+  // Selected as a whole.
+  ASSERT_NE(nullptr, outer.get_extra());
+  EXPECT_EQ(makeInner("extra"), *outer.get_extra());
+}
+
+TYPED_TEST(FieldProjectionTest, skippedFieldsLeftUntouched) {
+  auto buf = this->serialize(makeOuter());
+  Outer outer;
+  outer.set_id(1);
+  outer.set_name("before");
+  TypeParam::deserializeProjected(buf.get(), outer, {{1}});
+
+  EXPECT_EQ(42, outer.get_id());
+  EXPECT_EQ("before", outer.get_name());
+}
+
+TYPED_TEST(FieldProjectionTest, requiredOnlyWhenSelected) {
+  Unchecked unchecked;
+  unchecked.set_value("value");
+  auto buf = this->serialize(unchecked);
+
+  auto checked = this->template project<Checked>(*buf, {{2}});
+  EXPECT_EQ("value", checked.get_value());
+
+  EXPECT_THROW(
+      this->template project<Checked>(*buf, {{1}, {2}}),
+      protocol::TProtocolException);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/async/RetryingRequestChannel.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/util/ScopedServerInterfaceThread.h>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::async::TAsyncSocket;
+
+// Two replicas, each of which stalls a small fraction of the requests. Sends
+// requests one at a time, with and without hedging, and prints the latency
+// percentiles of both.
+DEFINE_int32(requests, 20000, "Requests per run");
+DEFINE_double(stall_probability, 0.01, "Fraction of stalled requests");
+DEFINE_int32(stall_ms, 50, "Duration of a stall");
+DEFINE_double(percentile, 0.95, "Latency percentile after which to hedge");
+DEFINE_double(budget, 0.05, "Maximum fraction of hedged requests");
+
+namespace {
+class StallingHandler : public TestServiceSvIf {
+ public:
+  int32_t echoInt(int32_t req) override {
+    if (folly::Random::randDouble01() < FLAGS_stall_probability) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_stall_ms));
+    }
+    return req;
+  }
+};
+
+void report(const char* name, std::vector<int64_t> us) {
+  std::sort(us.begin(), us.end());
+  auto at = [&](double p) {
+    return us[std::min(us.size() - 1, static_cast<size_t>(p * us.size()))];
+  };
+  std::cout << name << ": p50 " << at(0.5) << "us, p99 " << at(0.99)
+            << "us, p999 " << at(0.999) << "us, max " << us.back() << "us"
+            << std::endl;
+}
+
+std::vector<int64_t> run(TestServiceAsyncClient& client) {
+  std::vector<int64_t> us;
+  us.reserve(FLAGS_requests);
+  for (int i = 0; i < FLAGS_requests; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    client.sync_echoInt(i);
+    us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count());
+  }
+  return us;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv, true);
+  ScopedServerInterfaceThread primary(std::make_shared<StallingHandler>());
+  ScopedServerInterfaceThread backup(std::make_shared<StallingHandler>());
+  folly::EventBase eb;
+
+  {
+    TestServiceAsyncClient client(HeaderClientChannel::newChannel(
+        TAsyncSocket::newSocket(&eb, primary.getAddress())));
+    report("plain", run(client));
+  }
+
+  RetryingRequestChannel::HedgingOptions options;
+  options.percentile = FLAGS_percentile;
+  options.budget = FLAGS_budget;
+  auto channel = RetryingRequestChannel::newHedgingChannel(
+      eb,
+      0,
+      HeaderClientChannel::newChannel(
+          TAsyncSocket::newSocket(&eb, primary.getAddress())),
+      HeaderClientChannel::newChannel(
+          TAsyncSocket::newSocket(&eb, backup.getAddress())),
+      options);
+  auto* hedging = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+  report("hedged", run(client));
+  std::cout << "hedges: " << hedging->getHedgeCount() << std::endl;
+  return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/portability/GFlags.h>
+
+#include <thrift/lib/cpp2/util/IOBufPool.h>
+
+using namespace apache::thrift;
+
+// IOBuf::create() against IOBufPool::allocate(), with 64 buffers in flight
+// and the first 512 bytes of each written, as a read buffer would be.
+// The remote variants free every buffer on another thread, the way
+// responses serialized on a CPU worker are freed on the IO thread; the
+// hand-off costs the same with and without the pool.
+
+namespace {
+constexpr size_t kInFlight = 64;
+constexpr size_t kWritten = 512;
+
+template <typename Alloc>
+void run(size_t iters, size_t size, Alloc alloc) {
+  std::array<std::unique_ptr<folly::IOBuf>, kInFlight> bufs;
+  for (size_t i = 0; i < iters; ++i) {
+    auto& buf = bufs[i % kInFlight];
+    buf = alloc(size);
+    std::memset(buf->writableTail(), int(i), kWritten);
+    buf->append(kWritten);
+  }
+  folly::doNotOptimizeAway(bufs);
+}
+
+template <typename Alloc>
+void runRemote(size_t iters, size_t size, Alloc alloc) {
+  static folly::ScopedEventBaseThread remote;
+  std::vector<std::unique_ptr<folly::IOBuf>> bufs;
+  bufs.reserve(kInFlight);
+  while (iters) {
+    for (; iters && bufs.size() < kInFlight; --iters) {
+      bufs.push_back(alloc(size));
+      std::memset(bufs.back()->writableTail(), int(iters), kWritten);
+    }
+    remote.getEventBase()->runInEventBaseThreadAndWait(
+        [&] { bufs.clear(); });
+  }
+}
+
+std::unique_ptr<folly::IOBuf> create(size_t size) {
+  return folly::IOBuf::create(size);
+}
+
+std::unique_ptr<folly::IOBuf> pooled(size_t size) {
+  return IOBufPool::allocate(size);
+}
+} // namespace
+
+#define B(size) \
+  BENCHMARK(create_ ## size, iters) { \
+    run(iters, size, create); \
+  } \
+  BENCHMARK_RELATIVE(pooled_ ## size, iters) { \
+    run(iters, size, pooled); \
+  } \
+  BENCHMARK(createRemote_ ## size, iters) { \
+    runRemote(iters, size, create); \
+  } \
+  BENCHMARK_RELATIVE(pooledRemote_ ## size, iters) { \
+    runRemote(iters, size, pooled); \
+  }
+
+B(4096)
+B(16384)
+B(65536)
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv, true);
+  FLAGS_thrift_iobuf_pool = true;
+  folly::runBenchmarks();
+  return 0;
+}
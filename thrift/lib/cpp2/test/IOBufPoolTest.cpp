@@ -0,0 +1,167 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/util/IOBufPool.h>
+
+#include <thread>
+
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp2/protocol/CompactProtocol.h>
+
+using namespace apache::thrift;
+
+namespace {
+IOBufPool::Stats delta(
+    const IOBufPool::Stats& before,
+    const IOBufPool::Stats& after) {
+  IOBufPool::Stats stats;
+  stats.hits = after.hits - before.hits;
+  stats.misses = after.misses - before.misses;
+  stats.remoteFrees = after.remoteFrees - before.remoteFrees;
+  stats.oversized = after.oversized - before.oversized;
+  return stats;
+}
+} // namespace
+
+class IOBufPoolTest : public testing::Test {
+ public:
+  IOBufPoolTest() {
+    FLAGS_thrift_iobuf_pool = true;
+  }
+
+ private:
+  gflags::FlagSaver flagSaver_;
+};
+
+TEST_F(IOBufPoolTest, reusesFreedBuffers) {
+  // Runs on its own thread, so that other tests don't share the pool.
+  std::thread([] {
+    auto before = IOBufPool::getStats();
+    auto buf = IOBufPool::allocate(3000);
+    EXPECT_EQ(4096, buf->capacity());
+    EXPECT_EQ(0, buf->length());
+    auto data = buf->data();
+    buf.reset();
+
+    buf = IOBufPool::allocate(4096);
+    EXPECT_EQ(data, buf->data());
+    auto stats = delta(before, IOBufPool::getStats());
+    EXPECT_EQ(1, stats.misses);
+    EXPECT_EQ(1, stats.hits);
+  }).join();
+}
+
+TEST_F(IOBufPoolTest, sizeClasses) {
+  std::thread([] {
+    EXPECT_EQ(IOBufPool::kMinPooledSize, IOBufPool::allocate(1)->capacity());
+    EXPECT_EQ(16 * 1024, IOBufPool::allocate((1 << 14) - 64)->capacity());
+    EXPECT_EQ(
+        IOBufPool::kMaxPooledSize,
+        IOBufPool::allocate(IOBufPool::kMaxPooledSize)->capacity());
+
+    auto before = IOBufPool::getStats();
+    auto buf = IOBufPool::allocate(IOBufPool::kMaxPooledSize + 1);
+    EXPECT_GE(buf->capacity(), IOBufPool::kMaxPooledSize + 1);
+    EXPECT_EQ(1, delta(before, IOBufPool::getStats()).oversized);
+  }).join();
+}
+
+TEST_F(IOBufPoolTest, remoteFreeReturnsToOwner) {
+  std::thread([] {
+    auto buf = IOBufPool::allocate(8192);
+    auto data = buf->data();
+    auto before = IOBufPool::getStats();
+    std::thread([&] { buf.reset(); }).join();
+    EXPECT_EQ(1, delta(before, IOBufPool::getStats()).remoteFrees);
+
+    buf = IOBufPool::allocate(8192);
+    EXPECT_EQ(data, buf->data());
+    EXPECT_EQ(1, delta(before, IOBufPool::getStats()).hits);
+  }).join();
+}
+
+TEST_F(IOBufPoolTest, outlivesOwnerThread) {
+  std::unique_ptr<folly::IOBuf> buf;
+  std::thread([&] {
+    buf = IOBufPool::allocate(100);
+    buf->append(100);
+  }).join();
+  // The owner's pool is gone; the buffer stays valid, and is freed to the
+  // allocator.
+  EXPECT_EQ(100, buf->length());
+  buf.reset();
+}
+
+TEST_F(IOBufPoolTest, sharedBuffers) {
+  std::thread([] {
+    auto before = IOBufPool::getStats();
+    auto buf = IOBufPool::allocate(100);
+    auto clone = buf->clone();
+    buf.reset();
+    auto other = IOBufPool::allocate(100);
+    EXPECT_NE(clone->data(), other->data());
+    clone.reset();
+    auto stats = delta(before, IOBufPool::getStats());
+    EXPECT_EQ(2, stats.misses);
+    EXPECT_EQ(0, stats.hits);
+  }).join();
+}
+
+TEST_F(IOBufPoolTest, reserve) {
+  std::thread([] {
+    folly::IOBufQueue queue;
+    IOBufPool::reserve(queue, 100, 4096);
+    ASSERT_NE(nullptr, queue.front());
+    EXPECT_EQ(4096, queue.front()->tailroom());
+
+    // Enough room left already.
+    queue.append("x", 1);
+    IOBufPool::reserve(queue, 100, 4096);
+    EXPECT_FALSE(queue.front()->isChained());
+
+    IOBufPool::reserve(queue, 5000, 4096);
+    EXPECT_TRUE(queue.front()->isChained());
+    EXPECT_EQ(8192, queue.front()->prev()->tailroom());
+  }).join();
+}
+
+TEST_F(IOBufPoolTest, disabled) {
+  FLAGS_thrift_iobuf_pool = false;
+  std::thread([] {
+    auto before = IOBufPool::getStats();
+    auto buf = IOBufPool::allocate(100);
+    EXPECT_GE(buf->capacity(), 100);
+    auto stats = delta(before, IOBufPool::getStats());
+    EXPECT_EQ(0, stats.hits + stats.misses + stats.oversized);
+  }).join();
+}
+
+TEST(IOBufPoolDefaultTest, offByDefault) {
+  EXPECT_FALSE(FLAGS_thrift_iobuf_pool);
+}
+
+TEST_F(IOBufPoolTest, writersDontUsePool) {
+  std::thread([] {
+    auto before = IOBufPool::getStats();
+    folly::IOBufQueue queue;
+    CompactProtocolWriter writer;
+    writer.setOutput(&queue);
+    writer.writeI64(1);
+    auto stats = delta(before, IOBufPool::getStats());
+    EXPECT_EQ(0, stats.hits + stats.misses + stats.oversized);
+  }).join();
+}
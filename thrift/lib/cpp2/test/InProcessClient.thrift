@@ -0,0 +1,16 @@
+namespace cpp2 apache.thrift.test
+
+// Compiled with the inprocess_client option.
+exception Overflow {
+}
+
+service InProcessBase {
+  i32 add(1: i32 x, 2: i32 y) throws (1: Overflow e)
+}
+
+service InProcessService extends InProcessBase {
+  string echo(1: string text)
+  list<i64> sorted(1: list<i64> values)
+  void sleep(1: i32 ms)
+  oneway void notify(1: i32 value)
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/portability/GFlags.h>
+
+#include <thrift/lib/cpp2/server/BaseThriftServer.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/InProcessServiceInProcessClient.h>
+#include <thrift/lib/cpp2/transport/core/ThriftClient.h>
+#include <thrift/lib/cpp2/transport/core/testutil/ServerConfigsMock.h>
+#include <thrift/lib/cpp2/transport/inmemory/InMemoryConnection.h>
+
+#include <numeric>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+
+// Sequential calls to the same handler, through the generated in-process
+// client and through InMemoryConnection, which serializes the request and
+// the response with Compact.
+DEFINE_int32(list_size, 10000, "Elements in the list of the large calls");
+
+namespace {
+class Handler : public InProcessServiceSvIf {
+ public:
+  int32_t add(int32_t x, int32_t y) override {
+    return x + y;
+  }
+
+  void sorted(
+      std::vector<int64_t>& result,
+      std::unique_ptr<std::vector<int64_t>> values) override {
+    result = std::move(*values);
+  }
+};
+
+struct Clients {
+  Clients() {
+    threadManager->start();
+    inProcess = std::make_unique<InProcessServiceInProcessClient>(
+        handler, threadManager, serverConfigs);
+
+    auto connection = std::make_shared<InMemoryConnection>(
+        std::make_shared<ThriftServerAsyncProcessorFactory<Handler>>(handler),
+        serverConfigs);
+    auto thriftClient = ThriftClient::Ptr(new ThriftClient(connection));
+    thriftClient->setProtocolId(apache::thrift::protocol::T_COMPACT_PROTOCOL);
+    inMemory =
+        std::make_unique<InProcessServiceAsyncClient>(std::move(thriftClient));
+  }
+
+  std::shared_ptr<Handler> handler{std::make_shared<Handler>()};
+  std::shared_ptr<concurrency::ThreadManager> threadManager{
+      concurrency::PriorityThreadManager::newPriorityThreadManager(1)};
+  server::ServerConfigsMock serverConfigs;
+  std::unique_ptr<InProcessServiceInProcessClient> inProcess;
+  std::unique_ptr<InProcessServiceAsyncClient> inMemory;
+};
+
+Clients& getClients() {
+  static Clients clients;
+  return clients;
+}
+
+std::vector<int64_t> makeList() {
+  std::vector<int64_t> values(FLAGS_list_size);
+  std::iota(values.begin(), values.end(), 0);
+  return values;
+}
+} // namespace
+
+BENCHMARK(InMemorySmall, iters) {
+  auto& client = *getClients().inMemory;
+  while (iters--) {
+    folly::doNotOptimizeAway(client.future_add(1, 2).get());
+  }
+}
+
+BENCHMARK_RELATIVE(InProcessSmall, iters) {
+  auto& client = *getClients().inProcess;
+  while (iters--) {
+    folly::doNotOptimizeAway(client.future_add(1, 2).get());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(InMemoryLarge, iters) {
+  folly::BenchmarkSuspender braces;
+  auto& client = *getClients().inMemory;
+  auto values = makeList();
+  braces.dismissing([&] {
+    while (iters--) {
+      folly::doNotOptimizeAway(client.future_sorted(values).get());
+    }
+  });
+}
+
+BENCHMARK_RELATIVE(InProcessLarge, iters) {
+  folly::BenchmarkSuspender braces;
+  auto& client = *getClients().inProcess;
+  std::vector<std::unique_ptr<std::vector<int64_t>>> lists;
+  while (lists.size() < iters) {
+    lists.push_back(std::make_unique<std::vector<int64_t>>(makeList()));
+  }
+  braces.dismissing([&] {
+    for (auto& values : lists) {
+      folly::doNotOptimizeAway(client.future_sorted(std::move(values)).get());
+    }
+  });
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv, true);
+  getClients();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <thread>
+
+#include <folly/portability/GTest.h>
+
+#include <folly/synchronization/Baton.h>
+#include <thrift/lib/cpp/TApplicationException.h>
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/transport/core/testutil/ServerConfigsMock.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/InProcessServiceInProcessClient.h>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::concurrency::PriorityThreadManager;
+using apache::thrift::transport::TTransportException;
+
+namespace {
+
+class Handler : public InProcessServiceSvIf {
+ public:
+  int32_t add(int32_t x, int32_t y) override {
+    thread = std::this_thread::get_id();
+    if (x > std::numeric_limits<int32_t>::max() - y) {
+      throw Overflow();
+    }
+    return x + y;
+  }
+
+  folly::Future<std::unique_ptr<std::string>> future_echo(
+      std::unique_ptr<std::string> text) override {
+    received = text.get();
+    return folly::makeFuture(std::move(text));
+  }
+
+  void sorted(
+      std::vector<int64_t>& result,
+      std::unique_ptr<std::vector<int64_t>> values) override {
+    result = std::move(*values);
+    std::sort(result.begin(), result.end());
+  }
+
+  void sleep(int32_t ms) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+
+  void notify(int32_t value) override {
+    notified = value;
+    baton.post();
+  }
+
+  std::thread::id thread;
+  const std::string* received{nullptr};
+  int32_t notified{0};
+  folly::Baton<> baton;
+};
+
+class InProcessClientTest : public testing::Test {
+ public:
+  InProcessClientTest() {
+    threadManager->start();
+  }
+
+  ~InProcessClientTest() override {
+    threadManager->join();
+  }
+
+  std::shared_ptr<Handler> handler{std::make_shared<Handler>()};
+  std::shared_ptr<concurrency::ThreadManager> threadManager{
+      PriorityThreadManager::newPriorityThreadManager(1)};
+  server::ServerConfigsMock serverConfigs;
+};
+
+template <typename T>
+void expectTimeout(folly::Future<T> future, const std::string& message) {
+  try {
+    std::move(future).get();
+    ADD_FAILURE() << "Expected " << message;
+  } catch (const TApplicationException& ex) {
+    EXPECT_EQ(TApplicationException::TIMEOUT, ex.getType());
+    EXPECT_EQ(message, ex.what());
+  }
+}
+
+} // namespace
+
+TEST_F(InProcessClientTest, calls) {
+  InProcessServiceInProcessClient client(
+      handler, threadManager, serverConfigs);
+
+  EXPECT_EQ(3, client.future_add(1, 2).get());
+  EXPECT_NE(std::this_thread::get_id(), handler->thread);
+  EXPECT_THROW(
+      client.future_add(std::numeric_limits<int32_t>::max(), 1).get(),
+      Overflow);
+
+  auto sorted = client
+                    .semifuture_sorted(std::make_unique<std::vector<int64_t>>(
+                        std::vector<int64_t>{3, 1, 2}))
+                    .get();
+  EXPECT_EQ((std::vector<int64_t>{1, 2, 3}), *sorted);
+}
+
+TEST_F(InProcessClientTest, movesArgumentsAndResults) {
+  InProcessServiceInProcessClient client(
+      handler, threadManager, serverConfigs);
+
+  auto text = std::make_unique<std::string>(1 << 20, 'x');
+  auto sent = text.get();
+  auto result = client.future_echo(std::move(text)).get();
+  EXPECT_EQ(sent, handler->received);
+  EXPECT_EQ(sent, result.get());
+}
+
+TEST_F(InProcessClientTest, oneway) {
+  InProcessServiceInProcessClient client(
+      handler, threadManager, serverConfigs);
+
+  client.future_notify(7).get();
+  handler->baton.wait();
+  EXPECT_EQ(7, handler->notified);
+}
+
+TEST_F(InProcessClientTest, clientTimeout) {
+  InProcessServiceInProcessClient client(
+      handler, threadManager, serverConfigs);
+
+  RpcOptions rpcOptions;
+  rpcOptions.setTimeout(std::chrono::milliseconds(10));
+  try {
+    client.future_sleep(rpcOptions, 200).get();
+    ADD_FAILURE() << "Expected a timeout";
+  } catch (const TTransportException& ex) {
+    EXPECT_EQ(TTransportException::TIMED_OUT, ex.getType());
+  }
+}
+
+TEST_F(InProcessClientTest, serverTimeouts) {
+  serverConfigs.queueTimeout_ = std::chrono::milliseconds(50);
+  serverConfigs.taskTimeout_ = std::chrono::milliseconds(50);
+  InProcessServiceInProcessClient client(
+      handler, threadManager, serverConfigs);
+
+  // The only worker sleeps past the task timeout, so the second call
+  // expires in the queue.
+  auto slow = client.future_sleep(200);
+  auto queued = client.future_add(1, 2);
+  expectTimeout(std::move(slow), "Task expired");
+  expectTimeout(std::move(queued), "Queue Timeout");
+}
+
+TEST_F(InProcessClientTest, onewayExpiresInQueue) {
+  serverConfigs.queueTimeout_ = std::chrono::milliseconds(50);
+  InProcessServiceInProcessClient client(
+      handler, threadManager, serverConfigs);
+
+  auto slow = client.future_sleep(200);
+  client.future_notify(7).get();
+  std::move(slow).get();
+  // Queued behind the expired oneway, on the only worker.
+  EXPECT_EQ(3, client.future_add(1, 2).get());
+  EXPECT_EQ(0, handler->notified);
+}
+
+TEST_F(InProcessClientTest, callsOutliveClient) {
+  folly::Future<folly::Unit> slow = folly::makeFuture();
+  folly::Future<int32_t> queued = folly::makeFuture(0);
+  {
+    InProcessServiceInProcessClient client(
+        handler, threadManager, serverConfigs);
+    slow = client.future_sleep(100);
+    queued = client.future_add(1, 2);
+    client.future_notify(7).get();
+  }
+  std::move(slow).get();
+  EXPECT_EQ(3, std::move(queued).get());
+  handler->baton.wait();
+  EXPECT_EQ(7, handler->notified);
+}
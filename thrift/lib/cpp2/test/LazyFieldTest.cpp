@@ -0,0 +1,195 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp/protocol/TProtocolException.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/LazyFields_types.h>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::protocol::TProtocolException;
+
+namespace {
+
+Payload makePayload(const std::string& name) {
+  Payload payload;
+  payload.name = name;
+  for (int64_t i = 0; i < 100; ++i) {
+    payload.values.push_back(i * i);
+  }
+  payload.attributes["owner"] = "thrift";
+  return payload;
+}
+
+EagerEnvelope makeEager() {
+  EagerEnvelope eager;
+  eager.id = 42;
+  eager.payload = makePayload("payload");
+  eager.extra_ref() = makePayload("extra");
+  eager.trailer = "end";
+  return eager;
+}
+
+template <typename Serializer>
+class LazyFieldTest : public testing::Test {
+ protected:
+  std::string serializedEager() {
+    return Serializer::template serialize<std::string>(makeEager());
+  }
+};
+
+using Serializers = testing::Types<CompactSerializer, BinarySerializer>;
+
+} // namespace
+
+TYPED_TEST_CASE(LazyFieldTest, Serializers);
+
+TYPED_TEST(LazyFieldTest, readDefersDeserialization) {
+  auto envelope =
+      TypeParam::template deserialize<Envelope>(this->serializedEager());
+  EXPECT_EQ(42, envelope.id);
+  EXPECT_EQ("end", envelope.trailer);
+  EXPECT_TRUE(envelope.payload.isPending());
+  EXPECT_TRUE(envelope.extra.isPending());
+
+  EXPECT_EQ(makePayload("payload"), envelope.get_payload());
+  EXPECT_FALSE(envelope.payload.isPending());
+  EXPECT_EQ(makePayload("extra"), *envelope.get_extra());
+}
+
+TYPED_TEST(LazyFieldTest, unchangedFieldsAreWrittenVerbatim) {
+  auto serialized = this->serializedEager();
+  auto envelope = TypeParam::template deserialize<Envelope>(serialized);
+  EXPECT_EQ(serialized, TypeParam::template serialize<std::string>(envelope));
+
+  // Reading the value keeps the recorded bytes.
+  envelope.get_payload();
+  EXPECT_EQ(serialized, TypeParam::template serialize<std::string>(envelope));
+
+  // So does copying.
+  Envelope copy = envelope;
+  EXPECT_EQ(serialized, TypeParam::template serialize<std::string>(copy));
+  EXPECT_EQ(envelope, copy);
+}
+
+TYPED_TEST(LazyFieldTest, nonConstAccessKeepsBytes) {
+  auto serialized = this->serializedEager();
+  auto envelope = TypeParam::template deserialize<Envelope>(serialized);
+  EXPECT_EQ(makePayload("payload"), envelope.get_payload());
+  EXPECT_EQ(makePayload("extra"), *envelope.get_extra());
+  EXPECT_EQ(makePayload("extra"), *envelope.extra_ref());
+  EXPECT_EQ(serialized, TypeParam::template serialize<std::string>(envelope));
+}
+
+TYPED_TEST(LazyFieldTest, decodeErrorsAreSticky) {
+  auto serialized =
+      TypeParam::template serialize<std::string>(LooseEnvelope());
+  auto envelope = TypeParam::template deserialize<StrictEnvelope>(serialized);
+  EXPECT_TRUE(envelope.strict.isPending());
+
+  EXPECT_THROW(envelope.get_strict(), TProtocolException);
+  EXPECT_THROW(envelope.get_strict(), TProtocolException);
+  StrictEnvelope copy = envelope;
+  EXPECT_THROW(copy.get_strict(), TProtocolException);
+  // The recorded bytes are still forwarded.
+  EXPECT_EQ(serialized, TypeParam::template serialize<std::string>(envelope));
+
+  envelope.set_strict(Strict());
+  EXPECT_EQ(Strict(), envelope.get_strict());
+}
+
+TYPED_TEST(LazyFieldTest, changedFieldsAreReserialized) {
+  auto envelope =
+      TypeParam::template deserialize<Envelope>(this->serializedEager());
+  envelope.set_payload(makePayload("changed"));
+  envelope.extra.mutable_value().values.clear();
+
+  auto eager = makeEager();
+  eager.payload = makePayload("changed");
+  eager.extra_ref()->values.clear();
+  EXPECT_EQ(
+      TypeParam::template serialize<std::string>(eager),
+      TypeParam::template serialize<std::string>(envelope));
+}
+
+TYPED_TEST(LazyFieldTest, writesToOtherProtocols) {
+  auto envelope =
+      TypeParam::template deserialize<Envelope>(this->serializedEager());
+  auto json = JSONSerializer::serialize<std::string>(envelope);
+  EXPECT_EQ(JSONSerializer::serialize<std::string>(makeEager()), json);
+
+  // Protocols without lazy support read eagerly.
+  auto fromJson = JSONSerializer::deserialize<Envelope>(json);
+  EXPECT_FALSE(fromJson.payload.isPending());
+  EXPECT_EQ(makePayload("payload"), fromJson.get_payload());
+}
+
+TYPED_TEST(LazyFieldTest, clear) {
+  auto envelope =
+      TypeParam::template deserialize<Envelope>(this->serializedEager());
+  envelope.__clear();
+  EXPECT_FALSE(envelope.payload.isPending());
+  EXPECT_EQ(Payload(), envelope.get_payload());
+  EXPECT_EQ(
+      TypeParam::template serialize<std::string>(EagerEnvelope()),
+      TypeParam::template serialize<std::string>(envelope));
+}
+
+TEST(LazyFieldTest, sharesInputBuffer) {
+  auto buf = CompactSerializer::serialize<std::string>(makeEager());
+  auto iobuf = folly::IOBuf::copyBuffer(buf);
+  Envelope envelope;
+  CompactSerializer::deserialize(iobuf.get(), envelope, SHARE_EXTERNAL_BUFFER);
+
+  folly::IOBufQueue queue;
+  CompactSerializer::serialize(envelope, &queue, SHARE_EXTERNAL_BUFFER);
+  auto out = queue.move();
+  bool shared = false;
+  for (const auto& range : *out) {
+    shared |= range.begin() >= iobuf->data() && range.end() <= iobuf->tail();
+  }
+  EXPECT_TRUE(shared);
+}
+
+TEST(LazyFieldTest, concurrentFirstAccess) {
+  auto serialized = CompactSerializer::serialize<std::string>(makeEager());
+  const auto expected = makePayload("payload");
+  // Reading into the same envelope again makes readers wait afresh.
+  Envelope storage;
+  const Envelope& envelope = storage;
+  for (int round = 0; round < 100; ++round) {
+    CompactSerializer::deserialize(serialized, storage);
+    std::atomic<int> matches{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&] {
+        if (envelope.get_payload() == expected) {
+          ++matches;
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(4, matches);
+  }
+}
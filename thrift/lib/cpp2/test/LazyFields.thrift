@@ -0,0 +1,39 @@
+namespace cpp2 apache.thrift.test
+
+struct Payload {
+  1: string name;
+  2: list<i64> values;
+  3: map<string, string> attributes;
+}
+
+struct Envelope {
+  1: i64 id;
+  2: Payload payload (cpp.lazy = "true");
+  3: optional Payload extra (cpp.lazy = "true");
+  4: string trailer;
+}
+
+// Same wire format as Envelope, read eagerly.
+struct EagerEnvelope {
+  1: i64 id;
+  2: Payload payload;
+  3: optional Payload extra;
+  4: string trailer;
+}
+
+struct Strict {
+  1: required string name;
+}
+
+struct StrictEnvelope {
+  1: Strict strict (cpp.lazy = "true");
+}
+
+// Same wire format as StrictEnvelope, without the required field.
+struct Loose {
+  1: optional string name;
+}
+
+struct LooseEnvelope {
+  1: Loose strict;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/futures/Future.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/async/LoadBalancingRequestChannel.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/util/ScopedServerInterfaceThread.h>
+
+#include <thread>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::async::TAsyncSocket;
+
+// Three backends, one of which is artificially slow. Every iteration sends a
+// batch of concurrent requests and waits for all of them.
+DEFINE_int32(slow_ms, 5, "Delay of the slow backend per request");
+DEFINE_int32(batch, 32, "Concurrent requests per iteration");
+DEFINE_int32(connections, 2, "Connections per backend");
+
+namespace {
+class DelayedEchoHandler : public TestServiceSvIf {
+ public:
+  explicit DelayedEchoHandler(std::chrono::milliseconds delay)
+      : delay_(delay) {}
+
+  int32_t echoInt(int32_t req) override {
+    std::this_thread::sleep_for(delay_);
+    return req;
+  }
+
+ private:
+  std::chrono::milliseconds delay_;
+};
+
+struct Backends {
+  Backends() {
+    for (int i = 0; i < 3; ++i) {
+      std::chrono::milliseconds delay(i == 0 ? FLAGS_slow_ms : 0);
+      runners.push_back(std::make_unique<ScopedServerInterfaceThread>(
+          std::make_shared<DelayedEchoHandler>(delay)));
+      addrs.push_back(runners.back()->getAddress());
+    }
+  }
+
+  std::vector<std::unique_ptr<ScopedServerInterfaceThread>> runners;
+  std::vector<folly::SocketAddress> addrs;
+};
+
+const Backends& getBackends() {
+  static const Backends backends;
+  return backends;
+}
+
+void run(LoadBalancingRequestChannel::Policy policy, size_t iters) {
+  folly::BenchmarkSuspender braces;
+  folly::EventBase eb;
+  const auto& backends = getBackends();
+  LoadBalancingRequestChannel::Options options;
+  options.numDestinations = backends.addrs.size();
+  options.connectionsPerDestination = FLAGS_connections;
+  options.policy = policy;
+  auto channel = LoadBalancingRequestChannel::newChannel(
+      eb,
+      [&](folly::EventBase& evb, size_t destination) {
+        return HeaderClientChannel::newChannel(
+            TAsyncSocket::newSocket(&evb, backends.addrs[destination]));
+      },
+      options);
+  auto* lb = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+
+  braces.dismissing([&] {
+    while (iters--) {
+      std::vector<folly::Future<int32_t>> futures;
+      for (int i = 0; i < FLAGS_batch; ++i) {
+        futures.push_back(client.future_echoInt(i));
+      }
+      folly::collectAll(futures).getVia(&eb);
+    }
+  });
+
+  auto counts = lb->getRequestCounts();
+  uint64_t total = counts[0] + counts[1] + counts[2];
+  VLOG(1) << "slow backend share: " << 100.0 * counts[0] / total << "%";
+}
+} // namespace
+
+BENCHMARK(RoundRobin, iters) {
+  run(LoadBalancingRequestChannel::Policy::ROUND_ROBIN, iters);
+}
+
+BENCHMARK_RELATIVE(LeastOutstanding, iters) {
+  run(LoadBalancingRequestChannel::Policy::LEAST_OUTSTANDING, iters);
+}
+
+BENCHMARK_RELATIVE(PowerOfTwoEwma, iters) {
+  run(LoadBalancingRequestChannel::Policy::POWER_OF_TWO_EWMA, iters);
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv, true);
+  getBackends();
+  folly::runBenchmarks();
+  return 0;
+}
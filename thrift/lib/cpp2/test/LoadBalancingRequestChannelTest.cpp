@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/async/LoadBalancingRequestChannel.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/test/ScopedBoundPort.h>
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/util/ScopedServerInterfaceThread.h>
+
+#include <folly/portability/GTest.h>
+
+#include <thread>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::async::TAsyncSocket;
+using apache::thrift::transport::TTransportException;
+
+namespace {
+class DelayedEchoHandler : public TestServiceSvIf {
+ public:
+  explicit DelayedEchoHandler(std::chrono::milliseconds delay)
+      : delay_(delay) {}
+
+  int32_t echoInt(int32_t req) override {
+    std::this_thread::sleep_for(delay_);
+    return req;
+  }
+
+ private:
+  std::chrono::milliseconds delay_;
+};
+} // namespace
+
+class LoadBalancingRequestChannelTest : public testing::Test {
+ public:
+  LoadBalancingRequestChannel::UniquePtr newChannel(
+      LoadBalancingRequestChannel::Options options) {
+    options.numDestinations = addrs.size();
+    return LoadBalancingRequestChannel::newChannel(
+        *eb,
+        [this](folly::EventBase& evb, size_t destination) {
+          ++connectionCount;
+          return HeaderClientChannel::newChannel(
+              TAsyncSocket::newSocket(&evb, addrs[destination]));
+        },
+        std::move(options));
+  }
+
+  void addServer(std::chrono::milliseconds delay) {
+    runners.push_back(std::make_unique<ScopedServerInterfaceThread>(
+        std::make_shared<DelayedEchoHandler>(delay)));
+    addrs.push_back(runners.back()->getAddress());
+  }
+
+  folly::EventBase* eb{folly::EventBaseManager::get()->getEventBase()};
+  std::vector<std::unique_ptr<ScopedServerInterfaceThread>> runners;
+  std::vector<folly::SocketAddress> addrs;
+  int connectionCount{0};
+};
+
+TEST_F(LoadBalancingRequestChannelTest, leastOutstanding) {
+  addServer(std::chrono::milliseconds(0));
+  addServer(std::chrono::milliseconds(0));
+  LoadBalancingRequestChannel::Options options;
+  options.connectionsPerDestination = 2;
+  auto channel = newChannel(options);
+  auto* lb = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+
+  // No reply arrives before all are sent, so every connection gets a share.
+  std::vector<folly::Future<int32_t>> futures;
+  for (int i = 0; i < 100; ++i) {
+    futures.push_back(client.future_echoInt(i));
+  }
+  auto results = folly::collectAll(futures).getVia(eb);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, results[i].value());
+  }
+  EXPECT_EQ(4, connectionCount);
+  EXPECT_EQ(std::vector<uint64_t>({50, 50}), lb->getRequestCounts());
+}
+
+TEST_F(LoadBalancingRequestChannelTest, avoidsSlowDestination) {
+  addServer(std::chrono::milliseconds(20));
+  addServer(std::chrono::milliseconds(0));
+  LoadBalancingRequestChannel::Options options;
+  options.connectionsPerDestination = 1;
+  options.policy = LoadBalancingRequestChannel::Policy::POWER_OF_TWO_EWMA;
+  options.latencyWindow = std::chrono::seconds(10);
+  auto channel = newChannel(options);
+  auto* lb = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, client.sync_echoInt(i));
+  }
+  auto counts = lb->getRequestCounts();
+  EXPECT_EQ(100, counts[0] + counts[1]);
+  EXPECT_LT(counts[0], 5);
+}
+
+TEST_F(LoadBalancingRequestChannelTest, reconnect) {
+  folly::ScopedBoundPort bound;
+  addrs.push_back(bound.getAddress());
+  LoadBalancingRequestChannel::Options options;
+  options.connectionsPerDestination = 1;
+  auto channel = newChannel(options);
+  TestServiceAsyncClient client(std::move(channel));
+
+  EXPECT_THROW(client.sync_echoInt(1), TTransportException);
+  EXPECT_THROW(client.sync_echoInt(2), TTransportException);
+  EXPECT_EQ(2, connectionCount);
+}
+
+TEST_F(LoadBalancingRequestChannelTest, avoidsFailingDestination) {
+  for (auto policy : {LoadBalancingRequestChannel::Policy::LEAST_OUTSTANDING,
+                      LoadBalancingRequestChannel::Policy::POWER_OF_TWO_EWMA}) {
+    // Fails every request right away.
+    folly::ScopedBoundPort bound;
+    addrs = {bound.getAddress()};
+    runners.clear();
+    addServer(std::chrono::milliseconds(0));
+    LoadBalancingRequestChannel::Options options;
+    options.connectionsPerDestination = 1;
+    options.policy = policy;
+    options.reconnectBackoff = std::chrono::seconds(10);
+    auto channel = newChannel(options);
+    auto* lb = channel.get();
+    TestServiceAsyncClient client(std::move(channel));
+
+    int failures = 0;
+    for (int i = 0; i < 100; ++i) {
+      try {
+        EXPECT_EQ(i, client.sync_echoInt(i));
+      } catch (const TTransportException&) {
+        ++failures;
+      }
+    }
+    auto counts = lb->getRequestCounts();
+    EXPECT_EQ(100, counts[0] + counts[1]);
+    EXPECT_LE(counts[0], 1);
+    EXPECT_EQ(counts[0], failures);
+  }
+}
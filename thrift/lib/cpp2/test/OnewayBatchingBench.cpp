@@ -0,0 +1,123 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/futures/Future.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/SysResource.h>
+
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/util/ScopedServerInterfaceThread.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::async::TAsyncSocket;
+
+// Every iteration is one oneway request; a benchmark run waits until the
+// server has handled all of them, so iters/s is end to end messages per
+// second. The CPU time (user + system, client and server) per message of
+// the last run of each benchmark is printed at the end.
+DEFINE_int32(window, 1000, "Oneway requests sent per event loop iteration");
+DEFINE_int32(max_messages, 64, "OnewayBatchingOptions::maxMessages");
+DEFINE_int32(max_delay_us, 1000, "OnewayBatchingOptions::maxDelay");
+
+namespace {
+class CountingHandler : public TestServiceSvIf {
+ public:
+  void noResponse(int64_t) override {
+    ++received;
+  }
+
+  std::atomic<uint64_t> received{0};
+};
+
+std::chrono::microseconds cpuTime() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  auto toUs = [](const timeval& tv) {
+    return std::chrono::seconds(tv.tv_sec) +
+        std::chrono::microseconds(tv.tv_usec);
+  };
+  return toUs(usage.ru_utime) + toUs(usage.ru_stime);
+}
+
+std::map<std::string, double>& cpuPerMessage() {
+  static std::map<std::string, double> results;
+  return results;
+}
+
+void run(const std::string& name, bool batching, size_t iters) {
+  folly::BenchmarkSuspender braces;
+  static auto handler = std::make_shared<CountingHandler>();
+  static ScopedServerInterfaceThread runner(handler);
+  folly::EventBase eb;
+  auto channel = HeaderClientChannel::newChannel(
+      TAsyncSocket::newSocket(&eb, runner.getAddress()));
+  if (batching) {
+    HeaderClientChannel::OnewayBatchingOptions options;
+    options.maxMessages = FLAGS_max_messages;
+    options.maxDelay = std::chrono::microseconds(FLAGS_max_delay_us);
+    channel->setOnewayBatching(options);
+  }
+  TestServiceAsyncClient client(std::move(channel));
+  auto expected = handler->received + iters;
+  auto cpuStart = cpuTime();
+
+  braces.dismissing([&] {
+    size_t sent = 0;
+    while (sent < iters) {
+      std::vector<folly::Future<folly::Unit>> futures;
+      for (int i = 0; i < FLAGS_window && sent < iters; ++i, ++sent) {
+        futures.push_back(client.future_noResponse(0));
+      }
+      folly::collectAll(futures).getVia(&eb);
+    }
+    while (handler->received < expected) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+
+  auto cpu = cpuTime() - cpuStart;
+  cpuPerMessage()[name] = double(cpu.count()) * 1000 / iters;
+}
+} // namespace
+
+BENCHMARK(Unbatched, iters) {
+  run("Unbatched", false, iters);
+}
+
+BENCHMARK_RELATIVE(Batched, iters) {
+  run("Batched", true, iters);
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv, true);
+  folly::runBenchmarks();
+  for (const auto& result : cpuPerMessage()) {
+    LOG(INFO) << result.first << ": " << result.second
+              << " ns CPU per message";
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <folly/futures/Future.h>
+#include <folly/io/async/EventBase.h>
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/util/ScopedServerInterfaceThread.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+using apache::thrift::async::TAsyncSocket;
+using apache::thrift::transport::TTransportException;
+
+namespace {
+class CountingHandler : public TestServiceSvIf {
+ public:
+  void noResponse(int64_t size) override {
+    received += size;
+  }
+
+  int32_t echoInt(int32_t req) override {
+    return req;
+  }
+
+  std::atomic<int64_t> received{0};
+};
+} // namespace
+
+class OnewayBatchingTest : public testing::Test {
+ public:
+  std::unique_ptr<TestServiceAsyncClient> newClient(
+      HeaderClientChannel::OnewayBatchingOptions options) {
+    auto channel = HeaderClientChannel::newChannel(
+        TAsyncSocket::newSocket(eb, runner.getAddress()));
+    channel->setOnewayBatching(options);
+    this->channel = channel.get();
+    return std::make_unique<TestServiceAsyncClient>(std::move(channel));
+  }
+
+  void waitForReceived(int64_t expected) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (handler->received < expected &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(expected, handler->received);
+  }
+
+  folly::EventBase* eb{folly::EventBaseManager::get()->getEventBase()};
+  std::shared_ptr<CountingHandler> handler{
+      std::make_shared<CountingHandler>()};
+  ScopedServerInterfaceThread runner{handler};
+  HeaderClientChannel* channel{nullptr};
+};
+
+TEST_F(OnewayBatchingTest, flushesAtMaxMessages) {
+  HeaderClientChannel::OnewayBatchingOptions options;
+  options.maxMessages = 4;
+  options.maxDelay = std::chrono::seconds(10);
+  auto client = newClient(options);
+
+  std::vector<folly::Future<folly::Unit>> futures;
+  for (int i = 0; i < 3; ++i) {
+    futures.push_back(client->future_noResponse(1));
+  }
+  eb->loopOnce(EVLOOP_NONBLOCK);
+  for (auto& future : futures) {
+    EXPECT_FALSE(future.isReady());
+  }
+
+  futures.push_back(client->future_noResponse(1));
+  folly::collectAll(futures).getVia(eb);
+  waitForReceived(4);
+}
+
+TEST_F(OnewayBatchingTest, flushesAtMaxBytes) {
+  HeaderClientChannel::OnewayBatchingOptions options;
+  options.maxBytes = 1;
+  options.maxDelay = std::chrono::seconds(10);
+  auto client = newClient(options);
+
+  client->future_noResponse(1).getVia(eb);
+  waitForReceived(1);
+}
+
+TEST_F(OnewayBatchingTest, flushesAfterMaxDelay) {
+  HeaderClientChannel::OnewayBatchingOptions options;
+  options.maxDelay = std::chrono::microseconds(500);
+  auto client = newClient(options);
+
+  auto start = std::chrono::steady_clock::now();
+  client->future_noResponse(1).getVia(eb);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  waitForReceived(1);
+}
+
+TEST_F(OnewayBatchingTest, twowayFlushesBatch) {
+  HeaderClientChannel::OnewayBatchingOptions options;
+  options.maxDelay = std::chrono::seconds(10);
+  auto client = newClient(options);
+
+  auto oneway = client->future_noResponse(5);
+  EXPECT_EQ(7, client->future_echoInt(7).getVia(eb));
+  EXPECT_TRUE(oneway.isReady());
+  waitForReceived(5);
+}
+
+TEST_F(OnewayBatchingTest, closeFailsPendingBatch) {
+  HeaderClientChannel::OnewayBatchingOptions options;
+  options.maxDelay = std::chrono::seconds(10);
+  auto client = newClient(options);
+
+  auto oneway = client->future_noResponse(1);
+  channel->closeNow();
+  auto result = std::move(oneway).getTry();
+  ASSERT_TRUE(result.hasException());
+  EXPECT_TRUE(result.exception().with_exception(
+      [](const TTransportException& ex) {
+        EXPECT_EQ(TTransportException::NOT_OPEN, ex.getType());
+      }));
+}
+
+TEST_F(OnewayBatchingTest, destroyWritesPendingBatch) {
+  HeaderClientChannel::OnewayBatchingOptions options;
+  options.maxDelay = std::chrono::seconds(10);
+  auto client = newClient(options);
+
+  auto oneway = client->future_noResponse(3);
+  client.reset();
+  waitForReceived(3);
+  ASSERT_TRUE(oneway.isReady());
+  EXPECT_TRUE(oneway.hasValue());
+}
+
+TEST_F(OnewayBatchingTest, disable) {
+  HeaderClientChannel::OnewayBatchingOptions options;
+  options.maxDelay = std::chrono::seconds(10);
+  auto client = newClient(options);
+
+  auto batched = client->future_noResponse(1);
+  channel->setOnewayBatching(folly::none);
+  client->future_noResponse(2).getVia(eb);
+  EXPECT_TRUE(batched.isReady());
+  waitForReceived(3);
+}
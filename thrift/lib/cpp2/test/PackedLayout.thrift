@@ -0,0 +1,11 @@
+namespace cpp2 apache.thrift.test
+
+// Compiled with the packed_layout option.
+struct Packed {
+  1: byte small;
+  2: i64 big;
+  3: i16 medium;
+  4: i32 biggish;
+  5: optional bool flag;
+  6: string name;
+}
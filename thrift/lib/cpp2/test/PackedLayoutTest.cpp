@@ -0,0 +1,112 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/PackedLayout_types.h>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+
+namespace {
+
+Packed makePacked() {
+  Packed packed;
+  packed.set_small(1);
+  packed.set_big(2);
+  packed.set_medium(3);
+  packed.set_biggish(4);
+  packed.set_name("packed");
+  return packed;
+}
+
+} // namespace
+
+TEST(PackedLayoutTest, smallerThanDeclaredOrder) {
+  using Report = PackedLayoutReport<Packed>;
+  EXPECT_EQ(sizeof(Packed), Report::size());
+  EXPECT_LT(Report::size(), Report::declaredOrderSize());
+  // Five bits for the required flags, and a bool for the optional one.
+  EXPECT_EQ(2, sizeof(Packed::__isset));
+}
+
+TEST(PackedLayoutTest, layoutSize) {
+  using apache::thrift::detail::st::layout_size;
+  EXPECT_EQ(16, layout_size({{1, 1}, {8, 8}}));
+  EXPECT_EQ(16, layout_size({{8, 8}, {1, 1}}));
+  EXPECT_EQ(8, layout_size({{1, 1}, {2, 2}, {4, 4}}));
+  EXPECT_EQ(3, layout_size({{1, 1}, {1, 1}, {1, 1}}));
+}
+
+TEST(PackedLayoutTest, issetBits) {
+  Packed packed;
+  EXPECT_FALSE(packed.__isset.flag);
+  EXPECT_EQ(nullptr, packed.get_flag());
+  packed.set_flag(true);
+  EXPECT_TRUE(packed.__isset.flag);
+  EXPECT_FALSE(packed.__isset.name);
+  ASSERT_NE(nullptr, packed.get_flag());
+  EXPECT_TRUE(*packed.get_flag());
+  packed.__clear();
+  EXPECT_FALSE(packed.__isset.flag);
+}
+
+TEST(PackedLayoutTest, optionalRef) {
+  Packed packed;
+  EXPECT_FALSE(packed.flag_ref().has_value());
+  packed.flag_ref() = true;
+  EXPECT_TRUE(packed.__isset.flag);
+  EXPECT_TRUE(packed.flag_ref().value());
+  packed.flag_ref().reset();
+  EXPECT_FALSE(packed.__isset.flag);
+}
+
+TEST(PackedLayoutTest, serializesInDeclaredOrder) {
+  auto buf = CompactSerializer::serialize<std::string>(makePacked());
+
+  CompactProtocolReader reader;
+  folly::IOBuf wrapped(folly::IOBuf::WRAP_BUFFER, folly::StringPiece(buf));
+  reader.setInput(&wrapped);
+  std::string name;
+  reader.readStructBegin(name);
+  std::vector<int16_t> ids;
+  while (true) {
+    TType type;
+    int16_t id;
+    reader.readFieldBegin(name, type, id);
+    if (type == protocol::T_STOP) {
+      break;
+    }
+    ids.push_back(id);
+    reader.skip(type);
+    reader.readFieldEnd();
+  }
+  // The unset optional flag is not written.
+  EXPECT_EQ((std::vector<int16_t>{1, 2, 3, 4, 6}), ids);
+}
+
+TEST(PackedLayoutTest, roundTrip) {
+  auto packed = makePacked();
+  packed.set_flag(false);
+  auto buf = BinarySerializer::serialize<std::string>(packed);
+  auto copy = BinarySerializer::deserialize<Packed>(buf);
+  EXPECT_EQ(packed, copy);
+  EXPECT_TRUE(copy.__isset.flag);
+  EXPECT_FALSE(copy.flag);
+}
@@ -16,6 +16,7 @@
 
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 #include <thrift/lib/cpp2/test/gen-cpp2/ProtocolBenchData_types.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/WideBenchData_types.h>
 
 #include <folly/portability/GFlags.h>
 #include <glog/logging.h>
@@ -88,6 +89,10 @@ template <> LargeListMixed create<LargeListMixed>() {
   return LargeListMixed(FRAGILE, vector<Mixed>(1000000, create<Mixed>()));
 }
 
+template <> Wide create<Wide>() {
+  return Wide();
+}
+
 template <typename Serializer, typename Struct>
 void writeBench(size_t iters) {
   BenchmarkSuspender susp;
@@ -117,6 +122,80 @@ void readBench(size_t iters) {
   susp.rehire();
 }
 
+// Skipping a whole serialized struct, which is what happens to unknown
+// fields of evolving structs. genericSkip goes through the protocol-agnostic
+// apache::thrift::skip; skip through the reader's own implementation.
+template <typename Serializer, typename Reader, typename Struct, bool generic>
+void skipBench(size_t iters) {
+  BenchmarkSuspender susp;
+  auto strct = create<Struct>();
+  IOBufQueue q;
+  Serializer::serialize(strct, &q);
+  auto buf = q.move();
+  susp.dismiss();
+
+  while (iters--) {
+    Reader reader;
+    reader.setInput(buf.get());
+    if (generic) {
+      apache::thrift::skip(reader, protocol::T_STRUCT);
+    } else {
+      reader.skip(protocol::T_STRUCT);
+    }
+  }
+  susp.rehire();
+}
+
+// Serializing a response the way GeneratedAsyncProcessor::serializeResponse
+// does, either sized up front or in a single pass.
+template <typename Writer, typename Struct, bool presize>
+void responseBench(size_t iters) {
+  BenchmarkSuspender susp;
+  auto strct = create<Struct>();
+  susp.dismiss();
+
+  while (iters--) {
+    Writer prot;
+    IOBufQueue q(IOBufQueue::cacheChainLength());
+    if (presize) {
+      size_t bufSize = Cpp2Ops<Struct>::serializedSizeZC(&prot, &strct);
+      bufSize += prot.serializedMessageSize("method");
+      prot.setOutput(&q, bufSize);
+    } else {
+      q.preallocate((1 << 12) - 64, (1 << 12) - 64);
+      prot.setOutput(&q);
+    }
+    prot.writeMessageBegin("method", T_REPLY, 0);
+    Cpp2Ops<Struct>::write(&prot, &strct);
+    prot.writeMessageEnd();
+    doNotOptimizeAway(q.chainLength());
+  }
+  susp.rehire();
+}
+
+// Reading a wide struct in full, or a handful of its fields through
+// readProjected(). The target is built once and reused: constructing Wide's
+// 200 defaults would cost more than the projected reads themselves.
+template <typename Serializer>
+void wideBench(size_t iters, const FieldMask* mask) {
+  BenchmarkSuspender susp;
+  auto strct = create<Wide>();
+  IOBufQueue q;
+  Serializer::serialize(strct, &q);
+  auto buf = q.move();
+  Wide data;
+  susp.dismiss();
+
+  while (iters--) {
+    if (mask) {
+      Serializer::deserializeProjected(buf.get(), data, *mask);
+    } else {
+      Serializer::deserialize(buf.get(), data);
+    }
+  }
+  susp.rehire();
+}
+
 #define X1(proto, rdwr, bench) \
   BENCHMARK(proto ## Protocol_ ## rdwr ## _ ## bench, iters) { \
     rdwr ## Bench<proto##Serializer, bench>(iters); \
@@ -142,6 +221,63 @@ void readBench(size_t iters) {
 X(Binary)
 X(Compact)
 
+#define S2(proto, bench) \
+  BENCHMARK(proto ## Protocol_genericSkip_ ## bench, iters) { \
+    skipBench<proto##Serializer, proto##ProtocolReader, bench, true>(iters); \
+  } \
+  BENCHMARK_RELATIVE(proto ## Protocol_skip_ ## bench, iters) { \
+    skipBench<proto##Serializer, proto##ProtocolReader, bench, false>(iters); \
+  }
+
+#define S(proto) \
+  S2(proto, BigInt) \
+  S2(proto, BigString) \
+  S2(proto, LargeBinary) \
+  S2(proto, Mixed) \
+  S2(proto, BigListInt) \
+  S2(proto, BigListMixed) \
+  S2(proto, LargeListMixed) \
+
+S(Binary)
+S(Compact)
+
+const FieldMask kFirst3{{1}, {2}, {3}};
+const FieldMask kLast3{{198}, {199}, {200}};
+const FieldMask kNested{{1}, {5, 4}};
+
+#define P(proto) \
+  BENCHMARK(proto ## Protocol_read_Wide, iters) { \
+    wideBench<proto##Serializer>(iters, nullptr); \
+  } \
+  BENCHMARK_RELATIVE(proto ## Protocol_projectFirst3_Wide, iters) { \
+    wideBench<proto##Serializer>(iters, &kFirst3); \
+  } \
+  BENCHMARK_RELATIVE(proto ## Protocol_projectLast3_Wide, iters) { \
+    wideBench<proto##Serializer>(iters, &kLast3); \
+  } \
+  BENCHMARK_RELATIVE(proto ## Protocol_projectNested_Wide, iters) { \
+    wideBench<proto##Serializer>(iters, &kNested); \
+  }
+
+P(Binary)
+P(Compact)
+
+#define R2(proto, bench) \
+  BENCHMARK(proto ## Protocol_presizedResponse_ ## bench, iters) { \
+    responseBench<proto##ProtocolWriter, bench, true>(iters); \
+  } \
+  BENCHMARK_RELATIVE(proto ## Protocol_singlePassResponse_ ## bench, iters) { \
+    responseBench<proto##ProtocolWriter, bench, false>(iters); \
+  }
+
+#define R(proto) \
+  R2(proto, Mixed) \
+  R2(proto, BigListMixed) \
+  R2(proto, LargeListMixed) \
+
+R(Binary)
+R(Compact)
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   google::InitGoogleLogging(argv[0]);
@@ -25,6 +25,8 @@
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 
+#include <thread>
+
 using namespace testing;
 using namespace apache::thrift;
 using namespace apache::thrift::test;
@@ -36,6 +38,23 @@ class TestServiceServerMock : public TestServiceSvIf {
   MOCK_METHOD1(echoInt, int32_t(int32_t));
 };
 
+// Delays negative requests.
+class SlowNegativesHandler : public TestServiceSvIf {
+ public:
+  explicit SlowNegativesHandler(std::chrono::milliseconds delay)
+      : delay_(delay) {}
+
+  int32_t echoInt(int32_t req) override {
+    if (req < 0) {
+      std::this_thread::sleep_for(delay_);
+    }
+    return req;
+  }
+
+ private:
+  std::chrono::milliseconds delay_;
+};
+
 class RetryingRequestChannelTest : public Test {
  public:
   folly::EventBase* eb{folly::EventBaseManager::get()->getEventBase()};
@@ -108,3 +127,116 @@ TEST_F(RetryingRequestChannelTest, retry) {
   EXPECT_EQ(client.sync_echoInt(2), 2);
   EXPECT_EQ(client.sync_echoInt(3), 3);
 }
+
+// Exposes the latency window for testing.
+class HedgingAccess : public RetryingRequestChannel {
+ public:
+  using RetryingRequestChannel::LatencyWindow;
+};
+
+class HedgingTest : public RetryingRequestChannelTest {
+ public:
+  RetryingRequestChannel::UniquePtr newHedgingChannel(
+      RetryingRequestChannel::HedgingOptions options) {
+    return RetryingRequestChannel::newHedgingChannel(
+        *eb,
+        0,
+        HeaderClientChannel::newChannel(
+            TAsyncSocket::newSocket(eb, slow.getAddress())),
+        HeaderClientChannel::newChannel(
+            TAsyncSocket::newSocket(eb, fast.getAddress())),
+        options);
+  }
+
+  ScopedServerInterfaceThread slow{
+      std::make_shared<SlowNegativesHandler>(std::chrono::milliseconds(200))};
+  ScopedServerInterfaceThread fast{
+      std::make_shared<SlowNegativesHandler>(std::chrono::milliseconds(0))};
+};
+
+TEST_F(HedgingTest, backupWins) {
+  RetryingRequestChannel::HedgingOptions options;
+  options.methods = {"TestService.echoInt"};
+  options.minSamples = 10;
+  options.budget = 1;
+  auto channel = newHedgingChannel(options);
+  auto* hedging = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, client.sync_echoInt(i));
+  }
+  EXPECT_EQ(0, hedging->getHedgeCount());
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(-1, client.sync_echoInt(-1));
+  EXPECT_LT(
+      std::chrono::steady_clock::now() - start,
+      std::chrono::milliseconds(200));
+  EXPECT_EQ(1, hedging->getHedgeCount());
+}
+
+TEST_F(HedgingTest, noHedgeBeforeMinSamples) {
+  RetryingRequestChannel::HedgingOptions options;
+  options.methods = {"TestService.echoInt"};
+  options.minSamples = 100;
+  options.budget = 1;
+  auto channel = newHedgingChannel(options);
+  auto* hedging = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(-1, client.sync_echoInt(-1));
+  }
+  EXPECT_EQ(0, hedging->getHedgeCount());
+}
+
+TEST_F(HedgingTest, budget) {
+  RetryingRequestChannel::HedgingOptions options;
+  options.methods = {"TestService.echoInt"};
+  options.minSamples = 10;
+  options.budget = 0.1;
+  options.maxBurst = 1;
+  auto channel = newHedgingChannel(options);
+  auto* hedging = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, client.sync_echoInt(i));
+  }
+  // The budget is capped at one hedge, and five requests only earn half of
+  // another one.
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(-1, client.sync_echoInt(-1));
+  }
+  EXPECT_EQ(1, hedging->getHedgeCount());
+}
+
+TEST_F(HedgingTest, onlyListedMethods) {
+  RetryingRequestChannel::HedgingOptions options;
+  options.minSamples = 10;
+  options.budget = 1;
+  auto channel = newHedgingChannel(options);
+  auto* hedging = channel.get();
+  TestServiceAsyncClient client(std::move(channel));
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, client.sync_echoInt(i));
+  }
+  EXPECT_EQ(-1, client.sync_echoInt(-1));
+  EXPECT_EQ(0, hedging->getHedgeCount());
+}
+
+TEST(LatencyWindowTest, percentileBounds) {
+  // A window caches its percentile, so each one is asked once.
+  auto percentile = [](double p) {
+    HedgingAccess::LatencyWindow window;
+    for (int64_t latency : {30, 10, 40, 20}) {
+      window.add(std::chrono::microseconds(latency), 10);
+    }
+    return *window.percentile(p, 1);
+  };
+  EXPECT_EQ(std::chrono::microseconds(10), percentile(0));
+  EXPECT_EQ(std::chrono::microseconds(20), percentile(0.5));
+  EXPECT_EQ(std::chrono::microseconds(40), percentile(1));
+}
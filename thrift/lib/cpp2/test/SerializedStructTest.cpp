@@ -0,0 +1,157 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <folly/portability/GTest.h>
+
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/SerializedStructs_types.h>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+
+namespace {
+
+Item makeItem(const std::string& name, int64_t count = 100) {
+  Item item;
+  item.name = name;
+  for (int64_t i = 0; i < count; ++i) {
+    item.values.push_back(i * i);
+  }
+  return item;
+}
+
+Response makeResponse() {
+  Response response;
+  response.id = 42;
+  response.item = makeItem("item");
+  response.done = true;
+  return response;
+}
+
+template <class S, class W>
+struct Protocol {
+  using Serializer = S;
+  using Writer = W;
+};
+
+template <typename P>
+class SerializedStructTest : public testing::Test {
+ protected:
+  using Serializer = typename P::Serializer;
+
+  CachedResponse makeCached() {
+    CachedResponse cached;
+    cached.id = 42;
+    cached.item =
+        SerializedStruct<Item>::template serialize<typename P::Writer>(
+            makeItem("item"));
+    cached.done = true;
+    return cached;
+  }
+};
+
+using Protocols = testing::Types<
+    Protocol<CompactSerializer, CompactProtocolWriter>,
+    Protocol<BinarySerializer, BinaryProtocolWriter>>;
+
+} // namespace
+
+TYPED_TEST_CASE(SerializedStructTest, Protocols);
+
+TYPED_TEST(SerializedStructTest, writesSameBytes) {
+  using S = typename TestFixture::Serializer;
+  EXPECT_EQ(
+      S::template serialize<std::string>(makeResponse()),
+      S::template serialize<std::string>(this->makeCached()));
+}
+
+TYPED_TEST(SerializedStructTest, splicesByReference) {
+  using S = typename TestFixture::Serializer;
+  // Small buffers may get packed into the output instead.
+  CachedResponse cached;
+  cached.item = SerializedStruct<Item>::template serialize<
+      typename TypeParam::Writer>(makeItem("item", 10000));
+  const auto& data = cached.item.data();
+
+  folly::IOBufQueue queue;
+  S::serialize(cached, &queue);
+  auto out = queue.move();
+  bool shared = false;
+  for (const auto& range : *out) {
+    shared |= range.begin() == data->data();
+  }
+  EXPECT_TRUE(shared);
+}
+
+TYPED_TEST(SerializedStructTest, readKeepsBytes) {
+  using S = typename TestFixture::Serializer;
+  auto serialized = S::template serialize<std::string>(makeResponse());
+  auto cached = S::template deserialize<CachedResponse>(serialized);
+  EXPECT_EQ(42, cached.id);
+  EXPECT_TRUE(cached.done);
+  EXPECT_EQ(makeItem("item"), cached.item.deserialize());
+  EXPECT_EQ(serialized, S::template serialize<std::string>(cached));
+}
+
+TYPED_TEST(SerializedStructTest, writesToOtherProtocols) {
+  auto cached = this->makeCached();
+  EXPECT_EQ(
+      JSONSerializer::serialize<std::string>(makeResponse()),
+      JSONSerializer::serialize<std::string>(cached));
+  EXPECT_EQ(
+      CompactSerializer::serialize<std::string>(makeResponse()),
+      CompactSerializer::serialize<std::string>(cached));
+  EXPECT_EQ(
+      BinarySerializer::serialize<std::string>(makeResponse()),
+      BinarySerializer::serialize<std::string>(cached));
+}
+
+TYPED_TEST(SerializedStructTest, empty) {
+  using S = typename TestFixture::Serializer;
+  EXPECT_EQ(
+      S::template serialize<std::string>(Response()),
+      S::template serialize<std::string>(CachedResponse()));
+}
+
+TEST(SerializedStructTest, compactBoolField) {
+  // A bool field's value lives in the Compact field header.
+  auto write = [](bool spliced) {
+    folly::IOBufQueue queue;
+    CompactProtocolWriter writer;
+    writer.setOutput(&queue);
+    writer.writeStructBegin("");
+    writer.writeFieldBegin("a", protocol::T_I32, 1);
+    writer.writeI32(7);
+    writer.writeFieldEnd();
+    writer.writeFieldBegin("b", protocol::T_BOOL, 3);
+    if (spliced) {
+      folly::IOBufQueue value;
+      CompactProtocolWriter valueWriter;
+      valueWriter.setOutput(&value);
+      valueWriter.writeBool(true);
+      writer.writeSerializedData(value.move());
+    } else {
+      writer.writeBool(true);
+    }
+    writer.writeFieldEnd();
+    writer.writeFieldBegin("c", protocol::T_I32, 4);
+    writer.writeI32(9);
+    writer.writeFieldEnd();
+    writer.writeFieldStop();
+    writer.writeStructEnd();
+    return queue.move()->moveToFbString().toStdString();
+  };
+  EXPECT_EQ(write(false), write(true));
+}
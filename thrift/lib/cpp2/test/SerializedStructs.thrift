@@ -0,0 +1,41 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+cpp_include "<thrift/lib/cpp2/protocol/SerializedStruct.h>"
+
+namespace cpp2 apache.thrift.test
+
+struct Item {
+  1: string name;
+  2: list<i64> values;
+}
+
+typedef Item (
+  cpp.type = "::apache::thrift::SerializedStruct<::apache::thrift::test::Item>"
+) CachedItem
+
+struct CachedResponse {
+  1: i64 id;
+  2: CachedItem item;
+  3: bool done;
+}
+
+// Same wire format as CachedResponse.
+struct Response {
+  1: i64 id;
+  2: Item item;
+  3: bool done;
+}
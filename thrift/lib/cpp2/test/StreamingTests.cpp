@@ -14,9 +14,14 @@
  * limitations under the License.
  */
 
+#include <numeric>
+#include <vector>
+
 #include <folly/portability/GTest.h>
 
 #include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/synchronization/Baton.h>
+#include <thrift/lib/cpp2/async/BatchedStreamPublisher.h>
 #include <thrift/lib/cpp2/async/StreamPublisher.h>
 #include <thrift/lib/cpp2/test/gen-cpp2/DiffTypesStreamingService.h>
 #include <thrift/lib/cpp2/transport/rsocket/YarplStreamImpl.h>
@@ -133,3 +138,163 @@ TEST(StreamingTest, StreamPublisherNoSubscription) {
   std::exchange(streamAndPublisher.first, apache::thrift::Stream<int>());
   std::move(streamAndPublisher.second).complete();
 }
+
+TEST(StreamingTest, BatchedStreamPublisherOrderingAndCompletion) {
+  folly::ScopedEventBaseThread executor;
+
+  folly::Baton<> onCompleteOrCanceled;
+  auto streamAndPublisher = apache::thrift::BatchedStreamPublisher<int>::create(
+      folly::getKeepAliveToken(executor.getEventBase()),
+      [&] { onCompleteOrCanceled.post(); },
+      apache::thrift::BatchedStreamPublisher<int>::kNoLimit,
+      8 /* maxBatchSize */);
+
+  constexpr int kNumThreads = 4;
+  constexpr int kPerThread = 1000;
+  std::vector<int> lastSeen(kNumThreads, -1);
+  int count = 0;
+  bool completed = false;
+
+  auto subscription =
+      std::move(streamAndPublisher.first)
+          .subscribe(
+              [&](int value) {
+                auto thread = value / kPerThread;
+                EXPECT_LT(lastSeen[thread], value % kPerThread);
+                lastSeen[thread] = value % kPerThread;
+                ++count;
+              },
+              [](folly::exception_wrapper ew) { FAIL() << ew.what(); },
+              [&] { completed = true; },
+              16);
+
+  std::vector<std::thread> publishers;
+  for (int t = 0; t < kNumThreads; ++t) {
+    publishers.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        streamAndPublisher.second.next(t * kPerThread + i);
+      }
+    });
+  }
+  for (auto& publisher : publishers) {
+    publisher.join();
+  }
+  // Does not wait for the subscriber to catch up.
+  std::move(streamAndPublisher.second).complete();
+
+  std::move(subscription).join();
+  EXPECT_TRUE(onCompleteOrCanceled.try_wait_for(std::chrono::seconds{1}));
+  EXPECT_TRUE(completed);
+  EXPECT_EQ(kNumThreads * kPerThread, count);
+}
+
+TEST(StreamingTest, BatchedStreamPublisherError) {
+  folly::ScopedEventBaseThread executor;
+
+  auto streamAndPublisher = apache::thrift::BatchedStreamPublisher<int>::create(
+      folly::getKeepAliveToken(executor.getEventBase()), [] {});
+
+  int count = 0;
+  folly::exception_wrapper error;
+  auto subscription =
+      std::move(streamAndPublisher.first)
+          .subscribe(
+              [&](int) { ++count; },
+              [&](folly::exception_wrapper ew) { error = std::move(ew); });
+
+  streamAndPublisher.second.next(1);
+  streamAndPublisher.second.next(2);
+  std::move(streamAndPublisher.second)
+      .complete(std::runtime_error("publisher error"));
+
+  std::move(subscription).join();
+  EXPECT_EQ(2, count);
+  EXPECT_TRUE(error.is_compatible_with<std::runtime_error>());
+}
+
+TEST(StreamingTest, BatchedStreamPublisherBufferLimit) {
+  folly::ScopedEventBaseThread executor;
+
+  auto streamAndPublisher = apache::thrift::BatchedStreamPublisher<int>::create(
+      folly::getKeepAliveToken(executor.getEventBase()), [] {}, 10);
+
+  folly::Baton<> started;
+  folly::Baton<> unblock;
+  std::vector<int> received;
+  bool failed = false;
+  auto subscription =
+      std::move(streamAndPublisher.first)
+          .subscribe(
+              [&](int value) {
+                EXPECT_FALSE(failed);
+                received.push_back(value);
+                if (value == 0) {
+                  started.post();
+                  unblock.wait();
+                }
+              },
+              [&](folly::exception_wrapper) { failed = true; },
+              1);
+
+  streamAndPublisher.second.next(0);
+  started.wait();
+  // 0 is out of the buffer, 1 to 10 fill it, 11 overflows and everything
+  // after it is dropped.
+  for (int i = 1; i < 20; ++i) {
+    streamAndPublisher.second.next(i);
+  }
+  unblock.post();
+
+  std::move(subscription).join();
+  EXPECT_TRUE(failed);
+  std::vector<int> expected(11);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(expected, received);
+  std::move(streamAndPublisher.second).complete();
+}
+
+TEST(StreamingTest, BatchedStreamPublisherCancellation) {
+  folly::ScopedEventBaseThread executor;
+
+  folly::Baton<> onCompleteOrCanceled;
+  auto streamAndPublisher = apache::thrift::BatchedStreamPublisher<int>::create(
+      folly::getKeepAliveToken(executor.getEventBase()),
+      [&] { onCompleteOrCanceled.post(); });
+
+  std::atomic<int> count{0};
+  auto subscription =
+      std::move(streamAndPublisher.first)
+          .subscribe(
+              [&count](int) { ++count; },
+              apache::thrift::Stream<int>::kNoFlowControl);
+
+  std::atomic<bool> stop{false};
+  std::thread publisherThread([&] {
+    for (int i = 0; !stop; ++i) {
+      streamAndPublisher.second.next(i);
+    }
+  });
+
+  while (count == 0) {
+    std::this_thread::yield();
+  }
+  subscription.cancel();
+  EXPECT_TRUE(onCompleteOrCanceled.try_wait_for(std::chrono::seconds{1}));
+  stop = true;
+  publisherThread.join();
+
+  std::move(subscription).join();
+  EXPECT_GT(count, 0);
+}
+
+TEST(StreamingTest, BatchedStreamPublisherNoSubscription) {
+  folly::ScopedEventBaseThread executor;
+
+  folly::Baton<> onCompleteOrCanceled;
+  auto streamAndPublisher = apache::thrift::BatchedStreamPublisher<int>::create(
+      folly::getKeepAliveToken(executor.getEventBase()),
+      [&] { onCompleteOrCanceled.post(); });
+  std::exchange(streamAndPublisher.first, apache::thrift::Stream<int>());
+  EXPECT_TRUE(onCompleteOrCanceled.try_wait_for(std::chrono::seconds{1}));
+  std::move(streamAndPublisher.second).complete();
+}
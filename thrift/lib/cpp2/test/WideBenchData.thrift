@@ -0,0 +1,229 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ProtocolBench's Wide: 200 fields, of which readers typically need only a
+// few, repeating a five field pattern. Every field has a default so that a
+// default-constructed Wide serializes all of them.
+
+struct WideNested {
+  1: i32 int32;
+  2: i64 int64;
+  3: bool b;
+  4: string str;
+}
+
+struct Wide {
+  1: i64 f1 = 1234567890123;
+  2: string f2 = "a moderately long string value";
+  3: list<i32> f3 = [1, 2, 3, 4, 5, 6, 7, 8];
+  4: double f4 = 3.14159;
+  5: WideNested f5 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  6: i64 f6 = 1234567890123;
+  7: string f7 = "a moderately long string value";
+  8: list<i32> f8 = [1, 2, 3, 4, 5, 6, 7, 8];
+  9: double f9 = 3.14159;
+  10: WideNested f10 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  11: i64 f11 = 1234567890123;
+  12: string f12 = "a moderately long string value";
+  13: list<i32> f13 = [1, 2, 3, 4, 5, 6, 7, 8];
+  14: double f14 = 3.14159;
+  15: WideNested f15 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  16: i64 f16 = 1234567890123;
+  17: string f17 = "a moderately long string value";
+  18: list<i32> f18 = [1, 2, 3, 4, 5, 6, 7, 8];
+  19: double f19 = 3.14159;
+  20: WideNested f20 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  21: i64 f21 = 1234567890123;
+  22: string f22 = "a moderately long string value";
+  23: list<i32> f23 = [1, 2, 3, 4, 5, 6, 7, 8];
+  24: double f24 = 3.14159;
+  25: WideNested f25 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  26: i64 f26 = 1234567890123;
+  27: string f27 = "a moderately long string value";
+  28: list<i32> f28 = [1, 2, 3, 4, 5, 6, 7, 8];
+  29: double f29 = 3.14159;
+  30: WideNested f30 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  31: i64 f31 = 1234567890123;
+  32: string f32 = "a moderately long string value";
+  33: list<i32> f33 = [1, 2, 3, 4, 5, 6, 7, 8];
+  34: double f34 = 3.14159;
+  35: WideNested f35 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  36: i64 f36 = 1234567890123;
+  37: string f37 = "a moderately long string value";
+  38: list<i32> f38 = [1, 2, 3, 4, 5, 6, 7, 8];
+  39: double f39 = 3.14159;
+  40: WideNested f40 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  41: i64 f41 = 1234567890123;
+  42: string f42 = "a moderately long string value";
+  43: list<i32> f43 = [1, 2, 3, 4, 5, 6, 7, 8];
+  44: double f44 = 3.14159;
+  45: WideNested f45 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  46: i64 f46 = 1234567890123;
+  47: string f47 = "a moderately long string value";
+  48: list<i32> f48 = [1, 2, 3, 4, 5, 6, 7, 8];
+  49: double f49 = 3.14159;
+  50: WideNested f50 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  51: i64 f51 = 1234567890123;
+  52: string f52 = "a moderately long string value";
+  53: list<i32> f53 = [1, 2, 3, 4, 5, 6, 7, 8];
+  54: double f54 = 3.14159;
+  55: WideNested f55 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  56: i64 f56 = 1234567890123;
+  57: string f57 = "a moderately long string value";
+  58: list<i32> f58 = [1, 2, 3, 4, 5, 6, 7, 8];
+  59: double f59 = 3.14159;
+  60: WideNested f60 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  61: i64 f61 = 1234567890123;
+  62: string f62 = "a moderately long string value";
+  63: list<i32> f63 = [1, 2, 3, 4, 5, 6, 7, 8];
+  64: double f64 = 3.14159;
+  65: WideNested f65 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  66: i64 f66 = 1234567890123;
+  67: string f67 = "a moderately long string value";
+  68: list<i32> f68 = [1, 2, 3, 4, 5, 6, 7, 8];
+  69: double f69 = 3.14159;
+  70: WideNested f70 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  71: i64 f71 = 1234567890123;
+  72: string f72 = "a moderately long string value";
+  73: list<i32> f73 = [1, 2, 3, 4, 5, 6, 7, 8];
+  74: double f74 = 3.14159;
+  75: WideNested f75 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  76: i64 f76 = 1234567890123;
+  77: string f77 = "a moderately long string value";
+  78: list<i32> f78 = [1, 2, 3, 4, 5, 6, 7, 8];
+  79: double f79 = 3.14159;
+  80: WideNested f80 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  81: i64 f81 = 1234567890123;
+  82: string f82 = "a moderately long string value";
+  83: list<i32> f83 = [1, 2, 3, 4, 5, 6, 7, 8];
+  84: double f84 = 3.14159;
+  85: WideNested f85 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  86: i64 f86 = 1234567890123;
+  87: string f87 = "a moderately long string value";
+  88: list<i32> f88 = [1, 2, 3, 4, 5, 6, 7, 8];
+  89: double f89 = 3.14159;
+  90: WideNested f90 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  91: i64 f91 = 1234567890123;
+  92: string f92 = "a moderately long string value";
+  93: list<i32> f93 = [1, 2, 3, 4, 5, 6, 7, 8];
+  94: double f94 = 3.14159;
+  95: WideNested f95 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  96: i64 f96 = 1234567890123;
+  97: string f97 = "a moderately long string value";
+  98: list<i32> f98 = [1, 2, 3, 4, 5, 6, 7, 8];
+  99: double f99 = 3.14159;
+  100: WideNested f100 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  101: i64 f101 = 1234567890123;
+  102: string f102 = "a moderately long string value";
+  103: list<i32> f103 = [1, 2, 3, 4, 5, 6, 7, 8];
+  104: double f104 = 3.14159;
+  105: WideNested f105 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  106: i64 f106 = 1234567890123;
+  107: string f107 = "a moderately long string value";
+  108: list<i32> f108 = [1, 2, 3, 4, 5, 6, 7, 8];
+  109: double f109 = 3.14159;
+  110: WideNested f110 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  111: i64 f111 = 1234567890123;
+  112: string f112 = "a moderately long string value";
+  113: list<i32> f113 = [1, 2, 3, 4, 5, 6, 7, 8];
+  114: double f114 = 3.14159;
+  115: WideNested f115 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  116: i64 f116 = 1234567890123;
+  117: string f117 = "a moderately long string value";
+  118: list<i32> f118 = [1, 2, 3, 4, 5, 6, 7, 8];
+  119: double f119 = 3.14159;
+  120: WideNested f120 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  121: i64 f121 = 1234567890123;
+  122: string f122 = "a moderately long string value";
+  123: list<i32> f123 = [1, 2, 3, 4, 5, 6, 7, 8];
+  124: double f124 = 3.14159;
+  125: WideNested f125 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  126: i64 f126 = 1234567890123;
+  127: string f127 = "a moderately long string value";
+  128: list<i32> f128 = [1, 2, 3, 4, 5, 6, 7, 8];
+  129: double f129 = 3.14159;
+  130: WideNested f130 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  131: i64 f131 = 1234567890123;
+  132: string f132 = "a moderately long string value";
+  133: list<i32> f133 = [1, 2, 3, 4, 5, 6, 7, 8];
+  134: double f134 = 3.14159;
+  135: WideNested f135 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  136: i64 f136 = 1234567890123;
+  137: string f137 = "a moderately long string value";
+  138: list<i32> f138 = [1, 2, 3, 4, 5, 6, 7, 8];
+  139: double f139 = 3.14159;
+  140: WideNested f140 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  141: i64 f141 = 1234567890123;
+  142: string f142 = "a moderately long string value";
+  143: list<i32> f143 = [1, 2, 3, 4, 5, 6, 7, 8];
+  144: double f144 = 3.14159;
+  145: WideNested f145 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  146: i64 f146 = 1234567890123;
+  147: string f147 = "a moderately long string value";
+  148: list<i32> f148 = [1, 2, 3, 4, 5, 6, 7, 8];
+  149: double f149 = 3.14159;
+  150: WideNested f150 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  151: i64 f151 = 1234567890123;
+  152: string f152 = "a moderately long string value";
+  153: list<i32> f153 = [1, 2, 3, 4, 5, 6, 7, 8];
+  154: double f154 = 3.14159;
+  155: WideNested f155 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  156: i64 f156 = 1234567890123;
+  157: string f157 = "a moderately long string value";
+  158: list<i32> f158 = [1, 2, 3, 4, 5, 6, 7, 8];
+  159: double f159 = 3.14159;
+  160: WideNested f160 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  161: i64 f161 = 1234567890123;
+  162: string f162 = "a moderately long string value";
+  163: list<i32> f163 = [1, 2, 3, 4, 5, 6, 7, 8];
+  164: double f164 = 3.14159;
+  165: WideNested f165 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  166: i64 f166 = 1234567890123;
+  167: string f167 = "a moderately long string value";
+  168: list<i32> f168 = [1, 2, 3, 4, 5, 6, 7, 8];
+  169: double f169 = 3.14159;
+  170: WideNested f170 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  171: i64 f171 = 1234567890123;
+  172: string f172 = "a moderately long string value";
+  173: list<i32> f173 = [1, 2, 3, 4, 5, 6, 7, 8];
+  174: double f174 = 3.14159;
+  175: WideNested f175 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  176: i64 f176 = 1234567890123;
+  177: string f177 = "a moderately long string value";
+  178: list<i32> f178 = [1, 2, 3, 4, 5, 6, 7, 8];
+  179: double f179 = 3.14159;
+  180: WideNested f180 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  181: i64 f181 = 1234567890123;
+  182: string f182 = "a moderately long string value";
+  183: list<i32> f183 = [1, 2, 3, 4, 5, 6, 7, 8];
+  184: double f184 = 3.14159;
+  185: WideNested f185 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  186: i64 f186 = 1234567890123;
+  187: string f187 = "a moderately long string value";
+  188: list<i32> f188 = [1, 2, 3, 4, 5, 6, 7, 8];
+  189: double f189 = 3.14159;
+  190: WideNested f190 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  191: i64 f191 = 1234567890123;
+  192: string f192 = "a moderately long string value";
+  193: list<i32> f193 = [1, 2, 3, 4, 5, 6, 7, 8];
+  194: double f194 = 3.14159;
+  195: WideNested f195 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+  196: i64 f196 = 1234567890123;
+  197: string f197 = "a moderately long string value";
+  198: list<i32> f198 = [1, 2, 3, 4, 5, 6, 7, 8];
+  199: double f199 = 3.14159;
+  200: WideNested f200 = {"int32": 5, "int64": 12345, "b": 1, "str": "hello"};
+}
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <functional>
+#include <map>
 #include <memory>
 
 #include <boost/cast.hpp>
@@ -34,13 +37,17 @@
 #include <wangle/acceptor/ServerSocketConfig.h>
 
 #include <proxygen/httpserver/HTTPServerOptions.h>
+#include <thrift/lib/cpp/async/TAsyncSSLSocket.h>
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 #include <thrift/lib/cpp/transport/THeader.h>
 #include <thrift/lib/cpp2/async/HTTPClientChannel.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 #include <thrift/lib/cpp2/async/RequestChannel.h>
+#include <thrift/lib/cpp2/security/KTLS.h>
 #include <thrift/lib/cpp2/server/Cpp2Connection.h>
+#include <thrift/lib/cpp2/server/Cpp2Worker.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
+#include <thrift/lib/cpp2/test/gen-cpp2/Raiser.h>
 #include <thrift/lib/cpp2/test/gen-cpp2/TestService.h>
 #include <thrift/lib/cpp2/test/util/TestHeaderClientChannelFactory.h>
 #include <thrift/lib/cpp2/test/util/TestInterface.h>
@@ -539,6 +546,299 @@ TEST(ThriftServer, LatencyHeader_QueueTimeout) {
       rpcOptions.getReadHeaders(), LatencyHeaderStatus::EXPECTED);
 }
 
+TEST(ThriftServer, MethodStats_RequestSuccess) {
+  ScopedServerInterfaceThread runner(std::make_shared<TestInterface>());
+  folly::EventBase base;
+  auto client = runner.newClient<TestServiceAsyncClient>(&base);
+
+  std::string response;
+  for (int i = 0; i < 3; ++i) {
+    // Sleep 2ms in the handler
+    client->sync_sendResponse(response, 2000);
+  }
+  client->sync_voidResponse();
+
+  auto stats = runner.getThriftServer().getMethodStats();
+  ASSERT_EQ(1, stats.count("sendResponse"));
+  ASSERT_EQ(1, stats.count("voidResponse"));
+
+  const auto& sendResponse = stats["sendResponse"];
+  EXPECT_EQ(3, sendResponse.handlerTimeUs.count);
+  EXPECT_GE(sendResponse.handlerTimeUs.sum, 3 * 2000);
+  EXPECT_EQ(3, sendResponse.queueTimeUs.count);
+  EXPECT_EQ(3, sendResponse.serializationTimeUs.count);
+  EXPECT_GT(sendResponse.bytesIn.sum, 0);
+  EXPECT_GT(sendResponse.bytesOut.sum, 0);
+  EXPECT_EQ(0, sendResponse.errors);
+  // CPU time is opt-in
+  EXPECT_EQ(0, sendResponse.cpuTimeUs.count);
+
+  EXPECT_EQ(1, stats["voidResponse"].handlerTimeUs.count);
+}
+
+TEST(ThriftServer, MethodStats_RequestFailed) {
+  ScopedServerInterfaceThread runner(std::make_shared<TestInterface>());
+  folly::EventBase base;
+  auto client = runner.newClient<TestServiceAsyncClient>(&base);
+
+  EXPECT_ANY_THROW(client->sync_throwsHandlerException());
+
+  auto stats = runner.getThriftServer().getMethodStats();
+  ASSERT_EQ(1, stats.count("throwsHandlerException"));
+  EXPECT_EQ(1, stats["throwsHandlerException"].errors);
+}
+
+TEST(ThriftServer, MethodStats_ResponseTooBig) {
+  ScopedServerInterfaceThread runner(std::make_shared<TestInterface>());
+  runner.getThriftServer().setMaxResponseSize(1);
+  folly::EventBase base;
+  auto client = runner.newClient<TestServiceAsyncClient>(&base);
+
+  std::string response;
+  EXPECT_ANY_THROW(client->sync_sendResponse(response, 10));
+
+  auto stats = runner.getThriftServer().getMethodStats();
+  ASSERT_EQ(1, stats.count("sendResponse"));
+  EXPECT_EQ(1, stats["sendResponse"].errors);
+  EXPECT_EQ(1, stats["sendResponse"].handlerTimeUs.count);
+}
+
+TEST(ThriftServer, MethodStats_RetiredThreads) {
+  ServerMethodStats registry;
+  CallStats call;
+  call.bytesIn = 10;
+  for (int i = 0; i < 3; ++i) {
+    auto thread = registry.addThread();
+    thread->get("method").record(call);
+  }
+  auto live = registry.addThread();
+  live->get("method").record(call);
+
+  auto stats = registry.aggregate();
+  EXPECT_EQ(4, stats["method"].bytesIn.count);
+  EXPECT_EQ(40, stats["method"].bytesIn.sum);
+
+  // The stats may outlive their registry.
+  std::shared_ptr<ThreadMethodStats> orphan;
+  {
+    ServerMethodStats other;
+    orphan = other.addThread();
+  }
+  orphan->get("method").record(call);
+}
+
+TEST(ThriftServer, MethodStats_BoundedMethodNames) {
+  ServerMethodStats registry;
+  auto thread = registry.addThread();
+  CallStats call;
+  const auto kMax = ThreadMethodStats::kMaxMethods;
+  for (size_t i = 0; i < kMax + 10; ++i) {
+    thread->get(folly::to<std::string>("method", i)).record(call);
+  }
+  thread->get("method0").record(call);
+
+  auto stats = registry.aggregate();
+  EXPECT_EQ(kMax + 1, stats.size());
+  EXPECT_EQ(2, stats["method0"].bytesIn.count);
+  EXPECT_EQ(0, stats.count(folly::to<std::string>("method", kMax)));
+  EXPECT_EQ(10, stats[ThreadMethodStats::kUnknownMethod].bytesIn.count);
+}
+
+TEST(ThriftServer, MethodStats_UnknownMethods) {
+  // A TestService client talking to a Raiser server only calls methods the
+  // server doesn't know.
+  class RaiserHandler : public RaiserSvIf {};
+  ScopedServerInterfaceThread runner(std::make_shared<RaiserHandler>());
+  folly::EventBase base;
+  auto client = runner.newClient<TestServiceAsyncClient>(&base);
+
+  EXPECT_ANY_THROW(client->sync_voidResponse());
+  EXPECT_ANY_THROW(client->sync_echoInt(1));
+
+  auto stats = runner.getThriftServer().getMethodStats();
+  ASSERT_EQ(1, stats.size());
+  EXPECT_EQ(2, stats[ThreadMethodStats::kUnknownMethod].errors);
+}
+
+TEST(ThriftServer, MethodStats_CpuTime) {
+  ScopedServerInterfaceThread runner(std::make_shared<TestInterface>());
+  runner.getThriftServer().setMethodStatsCpuTimeEnabled(true);
+  folly::EventBase base;
+  auto client = runner.newClient<TestServiceAsyncClient>(&base);
+
+  std::string request(1 << 20, 'a');
+  std::string response;
+  client->sync_echoRequest(response, request);
+
+  auto stats = runner.getThriftServer().getMethodStats();
+  EXPECT_EQ(1, stats["echoRequest"].cpuTimeUs.count);
+  EXPECT_GE(stats["echoRequest"].bytesIn.sum, request.size());
+  EXPECT_GE(stats["echoRequest"].bytesOut.sum, request.size());
+}
+
+TEST(ThriftServer, MethodStats_Disabled) {
+  ScopedServerInterfaceThread runner(std::make_shared<TestInterface>());
+  runner.getThriftServer().setMethodStatsEnabled(false);
+  folly::EventBase base;
+  auto client = runner.newClient<TestServiceAsyncClient>(&base);
+
+  client->sync_voidResponse();
+  EXPECT_TRUE(runner.getThriftServer().getMethodStats().empty());
+}
+
+namespace {
+class EventBaseIdInterface : public TestServiceSvIf {
+  void async_eb_eventBaseAsync(
+      std::unique_ptr<HandlerCallback<std::unique_ptr<std::string>>> callback)
+      override {
+    callback->result(std::make_unique<std::string>(folly::to<std::string>(
+        reinterpret_cast<uintptr_t>(callback->getEventBase()))));
+  }
+};
+
+std::string ioThreadOf(TestServiceAsyncClient& client) {
+  std::string evb;
+  client.sync_eventBaseAsync(evb);
+  return evb;
+}
+
+std::map<std::string, Cpp2Worker*> getWorkers(ThriftServer& server) {
+  std::map<std::string, Cpp2Worker*> workers;
+  server.forEachWorker([&](wangle::Acceptor* acceptor) {
+    auto worker = dynamic_cast<Cpp2Worker*>(acceptor);
+    workers[folly::to<std::string>(
+        reinterpret_cast<uintptr_t>(worker->getEventBase()))] = worker;
+  });
+  return workers;
+}
+} // namespace
+
+TEST(ThriftServer, ConnectionRebalancing) {
+  ScopedServerInterfaceThread runner(
+      std::make_shared<EventBaseIdInterface>(),
+      "::1",
+      0,
+      [](ThriftServer& server) { server.setNumIOWorkerThreads(2); });
+  auto& server = dynamic_cast<ThriftServer&>(runner.getThriftServer());
+  auto workers = getWorkers(server);
+  ASSERT_EQ(2, workers.size());
+
+  // Connections are spread round-robin, so out of three at least two share
+  // an IO thread. Make those two the heavy ones.
+  folly::EventBase base;
+  std::vector<std::unique_ptr<TestServiceAsyncClient>> clients;
+  std::map<std::string, std::vector<TestServiceAsyncClient*>> byIOThread;
+  for (int i = 0; i < 3; ++i) {
+    clients.push_back(runner.newClient<TestServiceAsyncClient>(&base));
+    byIOThread[ioThreadOf(*clients.back())].push_back(clients.back().get());
+  }
+  std::string busy;
+  std::vector<TestServiceAsyncClient*> heavy;
+  for (auto& entry : byIOThread) {
+    if (entry.second.size() >= 2) {
+      busy = entry.first;
+      heavy = {entry.second[0], entry.second[1]};
+    }
+  }
+  ASSERT_EQ(2, heavy.size());
+
+  // Feed the workers fixed utilizations, rather than their CPU time, so that
+  // the outcome doesn't depend on timing. Every sample also starts a new
+  // request count for each connection.
+  auto sample = [&](std::function<double(const std::string&)> utilization) {
+    for (auto& entry : workers) {
+      auto worker = entry.second;
+      auto value = utilization(entry.first);
+      worker->getEventBase()->runInEventBaseThreadAndWait(
+          [&] { worker->sampleLoad(value); });
+    }
+  };
+  auto sampleFixed = [&](double busyUtilization, double idleUtilization) {
+    sample([&](const std::string& evb) {
+      return evb == busy ? busyUtilization : idleUtilization;
+    });
+  };
+  // Has the heavy clients send the same number of requests, then samples
+  // each IO thread's share of them as its utilization.
+  auto sampleHeavyLoad = [&] {
+    std::map<std::string, int> served;
+    constexpr int kRounds = 10;
+    for (int i = 0; i < kRounds; ++i) {
+      for (auto client : heavy) {
+        ++served[ioThreadOf(*client)];
+      }
+    }
+    sample([&](const std::string& evb) {
+      return double(served[evb]) / (kRounds * heavy.size());
+    });
+  };
+  // The migration is posted to the busy worker, which posts the connection
+  // to the idle one; both are done once both IO threads went around once.
+  auto waitForMigration = [&] {
+    for (auto& entry : workers) {
+      entry.second->getEventBase()->runInEventBaseThreadAndWait([] {});
+    }
+    for (auto& entry : workers) {
+      entry.second->getEventBase()->runInEventBaseThreadAndWait([] {});
+    }
+  };
+
+  // Below the threshold, or too close together.
+  sampleFixed(0.5, 0.45);
+  EXPECT_FALSE(server.migrateSampledConnection());
+  sampleFixed(0.6, 0.5);
+  EXPECT_FALSE(server.migrateSampledConnection());
+
+  sampleHeavyLoad();
+  auto utilization = server.getIOWorkerUtilization();
+  ASSERT_EQ(2, utilization.size());
+  std::sort(utilization.begin(), utilization.end());
+  EXPECT_DOUBLE_EQ(0, utilization[0]);
+  EXPECT_DOUBLE_EQ(1, utilization[1]);
+  EXPECT_TRUE(server.migrateSampledConnection());
+  waitForMigration();
+  EXPECT_NE(ioThreadOf(*heavy[0]), ioThreadOf(*heavy[1]));
+
+  // The same load is now spread evenly, and stays where it is.
+  sampleHeavyLoad();
+  for (auto value : server.getIOWorkerUtilization()) {
+    EXPECT_DOUBLE_EQ(0.5, value);
+  }
+  EXPECT_FALSE(server.migrateSampledConnection());
+  for (auto& client : clients) {
+    ioThreadOf(*client);
+  }
+}
+
+TEST(ThriftServer, ConnectionRebalancingDoesNotWaitForIOThreads) {
+  ScopedServerInterfaceThread runner(
+      std::make_shared<EventBaseIdInterface>(),
+      "::1",
+      0,
+      [](ThriftServer& server) { server.setNumIOWorkerThreads(2); });
+  auto& server = dynamic_cast<ThriftServer&>(runner.getThriftServer());
+  auto workers = getWorkers(server);
+  ASSERT_EQ(2, workers.size());
+
+  // Block one IO thread; this deadlocks if rebalancing waits for it.
+  folly::Baton<> blocked, release;
+  auto stuck = workers.begin()->second->getEventBase();
+  stuck->runInEventBaseThread([&] {
+    blocked.post();
+    release.wait();
+  });
+  blocked.wait();
+
+  server.rebalanceConnections();
+  // Still waiting for the stuck thread's sample, so this round is skipped.
+  server.rebalanceConnections();
+
+  release.post();
+  for (auto& entry : workers) {
+    entry.second->getEventBase()->runInEventBaseThreadAndWait([] {});
+  }
+}
+
 TEST(ThriftServer, ClientTimeoutTest) {
   TestThriftServerFactory<TestInterface> factory;
   auto server = factory.create();
@@ -1202,3 +1502,77 @@ TEST(ThriftServer, BadRequestHeaderNoDuplexSsl) {
 TEST(ThriftServer, BadRequestHeaderDuplexSsl) {
   doBadRequestHeaderTest(true /* duplex */, true /* secure */);
 }
+
+namespace {
+std::shared_ptr<ThriftServer> makeKtlsServer() {
+  auto server = std::static_pointer_cast<ThriftServer>(
+      TestThriftServerFactory<TestInterface>().create());
+  auto sslConfig = std::make_shared<wangle::SSLContextConfig>();
+  sslConfig->setCertificate(folly::kTestCert, folly::kTestKey, "");
+  sslConfig->sessionContext = "ThriftServerTest";
+  server->setSSLConfig(sslConfig);
+  server->setUseKtls(true);
+  return server;
+}
+
+// kTLS is only used for TLS 1.2 sessions.
+std::shared_ptr<folly::SSLContext> makeTls12ClientContext(
+    const std::string& ciphers) {
+  auto ctx = std::make_shared<folly::SSLContext>();
+  ctx->ciphers(ciphers);
+  SSL_CTX_set_max_proto_version(ctx->getSSLCtx(), TLS1_2_VERSION);
+  return ctx;
+}
+
+void doKtlsRequests(std::shared_ptr<TAsyncSocket> socket) {
+  TestServiceAsyncClient client(HeaderClientChannel::newChannel(socket));
+  std::string response;
+  client.sync_sendResponse(response, 64);
+  EXPECT_EQ("test64", response);
+
+  // Spans several TLS records each way.
+  std::string request(100000, 'a');
+  client.sync_echoRequest(response, request);
+  EXPECT_EQ(request + kEchoSuffix, response);
+}
+} // namespace
+
+TEST(ThriftServer, KtlsOffload) {
+  ScopedServerThread sst(makeKtlsServer());
+  folly::EventBase base;
+  auto sslSocket = TAsyncSSLSocket::newSocket(
+      makeTls12ClientContext("ECDHE-RSA-AES128-GCM-SHA256"), &base);
+  sslSocket->connect(nullptr, *sst.getAddress());
+  base.loop();
+  ASSERT_TRUE(sslSocket->good());
+  EXPECT_TRUE(KTLS::isEligible(sslSocket->getSSL()));
+
+  auto fd = sslSocket->getFd();
+  auto socket = KTLS::offloadClient(sslSocket);
+  ASSERT_TRUE(socket);
+  if (socket != sslSocket) {
+    EXPECT_EQ(fd, socket->getFd());
+    EXPECT_TRUE(KTLS::hasTlsUlp(socket->getFd()));
+  } else if (!KTLS::hasTlsUlp(fd)) {
+    LOG(WARNING) << "Skipping KtlsOffload: the kernel has no tls ULP";
+    return;
+  }
+  // If the kernel has the ULP but not TLS_RX, the connection stayed in
+  // userspace, and the server falls back in the same way.
+  doKtlsRequests(std::move(socket));
+}
+
+TEST(ThriftServer, KtlsUnsupportedCipher) {
+  ScopedServerThread sst(makeKtlsServer());
+  folly::EventBase base;
+  auto sslSocket = TAsyncSSLSocket::newSocket(
+      makeTls12ClientContext("ECDHE-RSA-AES128-SHA256"), &base);
+  sslSocket->connect(nullptr, *sst.getAddress());
+  base.loop();
+  ASSERT_TRUE(sslSocket->good());
+  EXPECT_FALSE(KTLS::isEligible(sslSocket->getSSL()));
+  EXPECT_EQ(nullptr, KTLS::offload(*sslSocket));
+  EXPECT_FALSE(KTLS::hasTlsUlp(sslSocket->getFd()));
+  EXPECT_EQ(sslSocket, KTLS::offloadClient(sslSocket));
+  doKtlsRequests(std::move(sslSocket));
+}
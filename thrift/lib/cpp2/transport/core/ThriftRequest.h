@@ -133,6 +133,22 @@ class ThriftRequestCore : public ResponseChannelRequest {
     return &reqContext_;
   }
 
+  /**
+   * Record the request's timings and sizes in the given per-method stats of
+   * its IO thread once it is answered. Call on the IO thread, before the
+   * request is processed.
+   */
+  void enableMethodStats(
+      std::shared_ptr<ThreadMethodStats> stats,
+      uint64_t bytesIn,
+      bool trackCpuTime) {
+    methodStats_ = std::move(stats);
+    auto& timings = reqContext_.getTimings();
+    timings.received = std::chrono::steady_clock::now();
+    timings.bytesIn = bytesIn;
+    timings.trackCpuTime = trackCpuTime;
+  }
+
   void sendReply(
       std::unique_ptr<folly::IOBuf>&& buf,
       apache::thrift::MessageChannel::SendCallback* cb = nullptr) final {
@@ -213,6 +229,7 @@ class ThriftRequestCore : public ResponseChannelRequest {
       std::unique_ptr<folly::IOBuf> buf,
       apache::thrift::MessageChannel::SendCallback* cb = nullptr) {
     if (checkResponseSize(*buf)) {
+      recordMethodStats(*buf);
       sendThriftResponse(createMetadata(), std::move(buf));
     } else {
       sendErrorWrappedInternal(
@@ -229,6 +246,7 @@ class ThriftRequestCore : public ResponseChannelRequest {
       apache::thrift::SemiStream<std::unique_ptr<folly::IOBuf>> stream,
       apache::thrift::MessageChannel::SendCallback* cb = nullptr) {
     if (checkResponseSize(*buf)) {
+      recordMethodStats(*buf);
       sendStreamThriftResponse(
           createMetadata(), std::move(buf), std::move(stream));
     } else {
@@ -262,7 +280,10 @@ class ThriftRequestCore : public ResponseChannelRequest {
       apache::thrift::MessageChannel::SendCallback* /*cb*/) {
     DCHECK(ew.is_compatible_with<TApplicationException>());
     header_.setHeader("ex", exCode);
+    errorResponse_ = true;
     ew.with_exception([&](TApplicationException& tae) {
+      unknownMethod_ = tae.getType() ==
+          TApplicationException::TApplicationExceptionType::UNKNOWN_METHOD;
       std::unique_ptr<folly::IOBuf> exbuf;
       auto proto = header_.getProtocolId();
       try {
@@ -281,6 +302,22 @@ class ThriftRequestCore : public ResponseChannelRequest {
     });
   }
 
+  // Called once per request, right before the response is handed to the
+  // transport: errors (including timeouts and responses that were too big)
+  // go through sendErrorWrappedInternal first.
+  void recordMethodStats(const folly::IOBuf& response) {
+    const auto& timings = reqContext_.getTimings();
+    if (!methodStats_ || !timings.enabled()) {
+      return;
+    }
+    auto& stats = unknownMethod_
+        ? methodStats_->get(ThreadMethodStats::kUnknownMethod)
+        : methodStats_->get(name_);
+    stats.record(timings.toCallStats(
+        response.computeChainDataLength(), errorResponse_));
+    methodStats_.reset();
+  }
+
   void cancelTimeout() {
     queueTimeout_.canceled_ = true;
     taskTimeout_.canceled_ = true;
@@ -370,6 +407,9 @@ class ThriftRequestCore : public ResponseChannelRequest {
   std::chrono::milliseconds clientQueueTimeout_{0};
   std::chrono::milliseconds clientTimeout_{0};
   bool responseSizeChecked_{false};
+  bool errorResponse_{false};
+  bool unknownMethod_{false};
+  std::shared_ptr<ThreadMethodStats> methodStats_;
 };
 
 class ThriftRequest final : public ThriftRequestCore {
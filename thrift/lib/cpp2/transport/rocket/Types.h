@@ -153,6 +153,14 @@ class Payload {
         metadata_(folly::IOBuf::copyBuffer(metadata)) {}
 };
 
+// Limits for writing the frames a client schedules during one loop, e.g. a
+// burst of oneway requests, to the socket together. A write holds at most
+// maxFrames frames, and no frames are added once it holds maxBytes bytes.
+struct WriteBatchingOptions {
+  size_t maxFrames{64};
+  size_t maxBytes{64 * 1024};
+};
+
 } // namespace rocket
 } // namespace thrift
 } // namespace apache
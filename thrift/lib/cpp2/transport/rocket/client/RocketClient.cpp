@@ -292,14 +292,34 @@ void RocketClient::WriteLoopCallback::runLoopCallback() noexcept {
 void RocketClient::writeScheduledRequestsToSocket() noexcept {
   DestructorGuard dg(this);
 
+  const size_t maxFrames = writeBatching_ ? writeBatching_->maxFrames : 1;
+  const size_t maxBytes = writeBatching_ ? writeBatching_->maxBytes : 0;
   for (size_t reqsToWrite = queue_.scheduledWriteQueueSize();
        reqsToWrite != 0 && state_ == ConnectionState::CONNECTED;) {
-    auto& req = queue_.markNextScheduledWriteAsSending();
-    auto iobufChain = req.serializedChain();
+    std::unique_ptr<folly::IOBuf> batch;
+    size_t batchFrames = 0;
+    size_t batchBytes = 0;
+    do {
+      auto& req = queue_.markNextScheduledWriteAsSending();
+      auto iobufChain = req.serializedChain();
+      if (writeBatching_) {
+        batchBytes += iobufChain->computeChainDataLength();
+      }
+      if (batch) {
+        batch->prependChain(std::move(iobufChain));
+      } else {
+        batch = std::move(iobufChain);
+      }
+      ++batchFrames;
+    } while (--reqsToWrite != 0 && batchFrames < maxFrames &&
+             batchBytes < maxBytes);
+
+    // writeChain() may fail the write inline, so the size goes first.
+    writeBatchSizes_.push_back(batchFrames);
     socket_->writeChain(
         this,
-        std::move(iobufChain),
-        --reqsToWrite ? folly::WriteFlags::CORK : folly::WriteFlags::NONE);
+        std::move(batch),
+        reqsToWrite ? folly::WriteFlags::CORK : folly::WriteFlags::NONE);
   }
 
   notifyIfDetachable();
@@ -309,11 +329,13 @@ void RocketClient::writeSuccess() noexcept {
   DestructorGuard dg(this);
   DCHECK(state_ != ConnectionState::CLOSED);
 
-  auto& req = queue_.markNextSendingAsSent();
-  if (req.isRequestResponse()) {
-    req.scheduleTimeoutForResponse();
-  } else {
-    queue_.markAsResponded(req);
+  for (auto batchSize = popWriteBatchSize(); batchSize != 0; --batchSize) {
+    auto& req = queue_.markNextSendingAsSent();
+    if (req.isRequestResponse()) {
+      req.scheduleTimeoutForResponse();
+    } else {
+      queue_.markAsResponded(req);
+    }
   }
 
   // In some cases, a successful write may happen after writeErr() has been
@@ -331,7 +353,11 @@ void RocketClient::writeErr(
   DestructorGuard dg(this);
   DCHECK(state_ != ConnectionState::CLOSED);
 
-  queue_.markNextSendingAsSent();
+  // Every frame of the failed write is done sending, or close() would wait
+  // for the rest of them forever.
+  for (auto batchSize = popWriteBatchSize(); batchSize != 0; --batchSize) {
+    queue_.markNextSendingAsSent();
+  }
 
   close(folly::make_exception_wrapper<std::runtime_error>(folly::sformat(
       "Failed to write to remote endpoint. Wrote {} bytes."
@@ -340,6 +366,13 @@ void RocketClient::writeErr(
       ex.what())));
 }
 
+size_t RocketClient::popWriteBatchSize() noexcept {
+  DCHECK(!writeBatchSizes_.empty());
+  auto batchSize = writeBatchSizes_.front();
+  writeBatchSizes_.pop_front();
+  return batchSize;
+}
+
 void RocketClient::closeNow(folly::exception_wrapper ew) noexcept {
   DestructorGuard dg(this);
 
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -25,6 +26,7 @@
 #include <glog/logging.h>
 
 #include <folly/ExceptionWrapper.h>
+#include <folly/Optional.h>
 #include <folly/SocketAddress.h>
 #include <folly/Try.h>
 #include <folly/io/async/AsyncSocket.h>
@@ -81,6 +83,13 @@ class RocketClient : public folly::DelayedDestruction,
 
   void scheduleWrite(RequestContext& ctx);
 
+  // Write the frames scheduled during one loop in as few writes as the
+  // options allow, instead of one corked write each. folly::none, the
+  // default, writes every frame on its own.
+  void setWriteBatching(folly::Optional<WriteBatchingOptions> options) {
+    writeBatching_ = std::move(options);
+  }
+
   // WriteCallback implementation
   void writeSuccess() noexcept final;
   void writeErr(
@@ -171,6 +180,9 @@ class RocketClient : public folly::DelayedDestruction,
   ConnectionState state_{ConnectionState::CONNECTED};
 
   RequestContextQueue queue_;
+  folly::Optional<WriteBatchingOptions> writeBatching_;
+  // Number of frames in each write passed to the socket, in order.
+  std::deque<size_t> writeBatchSizes_;
 
   struct StreamWrapper {
     StreamWrapper(
@@ -228,6 +240,7 @@ class RocketClient : public folly::DelayedDestruction,
       std::unique_ptr<folly::IOBuf> frame);
 
   void writeScheduledRequestsToSocket() noexcept;
+  size_t popWriteBatchSize() noexcept;
 
   template <class T>
   friend class Parser;
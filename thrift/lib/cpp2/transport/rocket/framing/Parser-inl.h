@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <stdexcept>
 
 #include <folly/io/Cursor.h>
@@ -29,6 +30,7 @@
 #include <thrift/lib/cpp2/transport/rocket/framing/FrameType.h>
 #include <thrift/lib/cpp2/transport/rocket/framing/Serializer.h>
 #include <thrift/lib/cpp2/transport/rocket/framing/Util.h>
+#include <thrift/lib/cpp2/util/IOBufPool.h>
 
 namespace apache {
 namespace thrift {
@@ -39,16 +41,38 @@ void Parser<T>::getReadBuffer(void** bufout, size_t* lenout) {
   DCHECK(!readBuffer_.isChained());
 
   resizeBuffer();
-  readBuffer_.unshareOne();
+  if (readBuffer_.isSharedOne()) {
+    // Frames cloned from the buffer are still alive: carry the unparsed
+    // bytes over to a fresh buffer from the pool instead of copying them to
+    // a new allocation.
+    auto buffer = IOBufPool::allocate(
+        std::max(bufferSize_, readBuffer_.length()));
+    std::memcpy(
+        buffer->writableTail(), readBuffer_.data(), readBuffer_.length());
+    buffer->append(readBuffer_.length());
+    readBuffer_ = std::move(*buffer);
+  }
 
   if (readBuffer_.length() == 0) {
     DCHECK(readBuffer_.capacity() > 0);
+    if (readBuffer_.capacity() >= 2 * bufferSize_) {
+      // The buffer shrank since the last burst: give back its storage while
+      // there is nothing to carry over. Not from the pool, whose smallest
+      // buffers are larger than kMinBufferSize.
+      readBuffer_ = folly::IOBuf(folly::IOBuf::CreateOp(), bufferSize_);
+    }
     // If we read everything, reset pointers to 0 and reuse the buffer
     readBuffer_.clear();
   } else if (readBuffer_.headroom() > 0) {
     // Move partially read data to the beginning
     readBuffer_.retreat(readBuffer_.headroom());
   }
+  if (readBuffer_.length() + readBuffer_.tailroom() < bufferSize_) {
+    readBuffer_.reserve(
+        0 /* minHeadroom */,
+        bufferSize_ - readBuffer_.length() /* minTailroom */);
+  }
+  lastReadBufferLength_ = readBuffer_.tailroom();
 
   *bufout = readBuffer_.writableTail();
   *lenout = readBuffer_.tailroom();
@@ -62,6 +86,25 @@ void Parser<T>::readDataAvailable(size_t nbytes) noexcept {
 
   readBuffer_.append(nbytes);
 
+  // A read that filled the whole buffer likely left more data in the socket.
+  // Grow the buffer so pipelined small frames are drained with fewer reads,
+  // and halve it again once a run of reads would have fit in a quarter.
+  if (nbytes == lastReadBufferLength_) {
+    shortReads_ = 0;
+    if (bufferSize_ < kMaxBufferSize) {
+      bufferSize_ = std::min(bufferSize_ * 2, kMaxBufferSize);
+    }
+  } else if (
+      bufferSize_ > kMinBufferSize && bufferSize_ <= kMaxBufferSize &&
+      nbytes <= bufferSize_ / 4) {
+    if (++shortReads_ == kShrinkAfterShortReads) {
+      shortReads_ = 0;
+      bufferSize_ = std::max(bufferSize_ / 2, kMinBufferSize);
+    }
+  } else {
+    shortReads_ = 0;
+  }
+
   while (!readBuffer_.empty()) {
     if (readBuffer_.length() < Serializer::kBytesForFrameOrMetadataLength) {
       return;
@@ -91,8 +134,6 @@ void Parser<T>::readDataAvailable(size_t nbytes) noexcept {
     owner_.handleFrame(std::move(frame));
     readBuffer_.trimStart(totalFrameSize);
   }
-
-  // TODO Periodically shrink the buffer back to kMaxBufferSize
 }
 
 template <class T>
@@ -140,6 +181,8 @@ constexpr size_t Parser<T>::kMinBufferSize;
 template <class T>
 constexpr size_t Parser<T>::kMaxBufferSize;
 template <class T>
+constexpr size_t Parser<T>::kShrinkAfterShortReads;
+template <class T>
 constexpr std::chrono::milliseconds Parser<T>::kDefaultBufferResizeInterval;
 
 } // namespace rocket
@@ -64,6 +64,9 @@ class Parser final : public folly::AsyncTransportWrapper::ReadCallback {
 
   static constexpr size_t kMinBufferSize{256};
   static constexpr size_t kMaxBufferSize{4096};
+  // Consecutive reads of at most a quarter of the buffer after which it is
+  // halved again.
+  static constexpr size_t kShrinkAfterShortReads{16};
 
  private:
   static constexpr std::chrono::milliseconds kDefaultBufferResizeInterval{
@@ -71,6 +74,8 @@ class Parser final : public folly::AsyncTransportWrapper::ReadCallback {
 
   T& owner_;
   size_t bufferSize_{kMinBufferSize};
+  size_t lastReadBufferLength_{0};
+  size_t shortReads_{0};
   folly::IOBuf readBuffer_{folly::IOBuf::CreateOp(), bufferSize_};
   std::chrono::steady_clock::time_point resizeBufferTimer_{
       std::chrono::steady_clock::now()};
@@ -59,6 +59,107 @@ TEST(ParserTest, noResizeBufferTest) {
   EXPECT_EQ(parser.getReadBufferSize(), Parser<FakeOwner>::kMaxBufferSize * 2);
 }
 
+TEST(ParserTest, growBufferOnFullReadTest) {
+  FakeOwner owner;
+  Parser<FakeOwner> parser(owner);
+
+  void* buf;
+  size_t len;
+  parser.getReadBuffer(&buf, &len);
+  EXPECT_EQ(Parser<FakeOwner>::kMinBufferSize, len);
+
+  // Fill the whole buffer with empty frames
+  memset(buf, 0, len);
+  parser.readDataAvailable(len);
+  EXPECT_EQ(Parser<FakeOwner>::kMinBufferSize * 2, parser.getReadBufferSize());
+
+  parser.getReadBuffer(&buf, &len);
+  EXPECT_GE(len, Parser<FakeOwner>::kMinBufferSize * 2 - 3);
+
+  // A short read leaves the size alone
+  memset(buf, 0, 3);
+  parser.readDataAvailable(3);
+  EXPECT_EQ(Parser<FakeOwner>::kMinBufferSize * 2, parser.getReadBufferSize());
+}
+
+TEST(ParserTest, growBufferCappedTest) {
+  FakeOwner owner;
+  Parser<FakeOwner> parser(owner);
+
+  for (int i = 0; i < 10; ++i) {
+    void* buf;
+    size_t len;
+    parser.getReadBuffer(&buf, &len);
+    memset(buf, 0, len);
+    parser.readDataAvailable(len);
+  }
+  EXPECT_EQ(Parser<FakeOwner>::kMaxBufferSize, parser.getReadBufferSize());
+}
+
+namespace {
+void fillBuffer(Parser<FakeOwner>& parser) {
+  for (int i = 0; i < 10; ++i) {
+    void* buf;
+    size_t len;
+    parser.getReadBuffer(&buf, &len);
+    memset(buf, 0, len);
+    parser.readDataAvailable(len);
+  }
+}
+
+// Completes any partial frame and reads one more empty frame, leaving the
+// read buffer empty.
+void shortRead(Parser<FakeOwner>& parser) {
+  const size_t n = 3 + (3 - parser.getReadBuffer().length()) % 3;
+  void* buf;
+  size_t len;
+  parser.getReadBuffer(&buf, &len);
+  memset(buf, 0, n);
+  parser.readDataAvailable(n);
+}
+} // namespace
+
+TEST(ParserTest, shrinkBufferAfterShortReadsTest) {
+  using P = Parser<FakeOwner>;
+  FakeOwner owner;
+  P parser(owner);
+  fillBuffer(parser);
+  ASSERT_EQ(P::kMaxBufferSize, parser.getReadBufferSize());
+
+  for (size_t i = 0; i < P::kShrinkAfterShortReads - 1; ++i) {
+    shortRead(parser);
+  }
+  EXPECT_EQ(P::kMaxBufferSize, parser.getReadBufferSize());
+  shortRead(parser);
+  EXPECT_EQ(P::kMaxBufferSize / 2, parser.getReadBufferSize());
+
+  for (size_t i = 0; i < 3 * P::kShrinkAfterShortReads; ++i) {
+    shortRead(parser);
+  }
+  EXPECT_EQ(P::kMinBufferSize, parser.getReadBufferSize());
+
+  void* buf;
+  size_t len;
+  parser.getReadBuffer(&buf, &len);
+  EXPECT_LT(parser.getReadBuffer().capacity(), P::kMaxBufferSize);
+}
+
+TEST(ParserTest, fullReadResetsShortReadsTest) {
+  using P = Parser<FakeOwner>;
+  FakeOwner owner;
+  P parser(owner);
+  fillBuffer(parser);
+
+  for (size_t i = 0; i < P::kShrinkAfterShortReads - 1; ++i) {
+    shortRead(parser);
+  }
+  fillBuffer(parser);
+  for (size_t i = 0; i < P::kShrinkAfterShortReads - 1; ++i) {
+    shortRead(parser);
+  }
+  EXPECT_EQ(P::kMaxBufferSize, parser.getReadBufferSize());
+}
+
 } // namespace rocket
 } // namespace thrift
 } // namespace apache
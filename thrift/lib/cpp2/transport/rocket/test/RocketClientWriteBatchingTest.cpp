@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+#include <folly/Range.h>
+#include <folly/fibers/FiberManagerMap.h>
+#include <folly/io/async/AsyncSocketException.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/test/MockAsyncTransport.h>
+
+#include <thrift/lib/cpp2/transport/rocket/Types.h>
+#include <thrift/lib/cpp2/transport/rocket/client/RocketClient.h>
+
+using namespace apache::thrift::rocket;
+using folly::AsyncTransportWrapper;
+using testing::_;
+
+namespace {
+
+class RocketClientWriteBatchingTest : public testing::Test {
+ public:
+  struct Write {
+    AsyncTransportWrapper::WriteCallback* callback;
+    folly::WriteFlags flags;
+  };
+
+  RocketClientWriteBatchingTest() {
+    auto transport = new testing::NiceMock<folly::test::MockAsyncTransport>();
+    ON_CALL(*transport, writeChain(_, _, _))
+        .WillByDefault(testing::Invoke(
+            [this](
+                AsyncTransportWrapper::WriteCallback* callback,
+                std::shared_ptr<folly::IOBuf>,
+                folly::WriteFlags flags) {
+              writes.push_back(Write{callback, flags});
+            }));
+    client = RocketClient::create(
+        evb, AsyncTransportWrapper::UniquePtr(transport));
+  }
+
+  // Sends "n" oneway requests from fibers, which counts how they end.
+  void sendFnf(size_t n) {
+    auto& fm = folly::fibers::getFiberManager(evb);
+    for (size_t i = 0; i < n; ++i) {
+      fm.addTask([this] {
+        try {
+          client->sendRequestFnfSync(
+              Payload::makeFromData(folly::StringPiece("request")));
+          ++succeeded;
+        } catch (const std::exception&) {
+          ++failed;
+        }
+      });
+    }
+    loop();
+  }
+
+  void loop() {
+    for (int i = 0; i < 3; ++i) {
+      evb.loopOnce(EVLOOP_NONBLOCK);
+    }
+  }
+
+  folly::AsyncSocketException writeError() {
+    return folly::AsyncSocketException(
+        folly::AsyncSocketException::INTERNAL_ERROR, "write failed");
+  }
+
+  folly::EventBase evb;
+  std::shared_ptr<RocketClient> client;
+  std::vector<Write> writes;
+  size_t succeeded{0};
+  size_t failed{0};
+};
+
+} // namespace
+
+TEST_F(RocketClientWriteBatchingTest, writesEachFrameByDefault) {
+  sendFnf(3);
+  ASSERT_EQ(3, writes.size());
+  EXPECT_EQ(folly::WriteFlags::CORK, writes[0].flags);
+  EXPECT_EQ(folly::WriteFlags::NONE, writes[2].flags);
+
+  for (auto& write : writes) {
+    write.callback->writeSuccess();
+  }
+  loop();
+  EXPECT_EQ(3, succeeded);
+}
+
+TEST_F(RocketClientWriteBatchingTest, batchesUpToMaxFrames) {
+  WriteBatchingOptions options;
+  options.maxFrames = 3;
+  client->setWriteBatching(options);
+
+  sendFnf(5);
+  ASSERT_EQ(2, writes.size());
+  EXPECT_EQ(folly::WriteFlags::CORK, writes[0].flags);
+  EXPECT_EQ(folly::WriteFlags::NONE, writes[1].flags);
+
+  writes[0].callback->writeSuccess();
+  loop();
+  EXPECT_EQ(3, succeeded);
+  writes[1].callback->writeSuccess();
+  loop();
+  EXPECT_EQ(5, succeeded);
+}
+
+TEST_F(RocketClientWriteBatchingTest, batchesUpToMaxBytes) {
+  WriteBatchingOptions options;
+  options.maxBytes = 1;
+  client->setWriteBatching(options);
+
+  // Every frame fills a write on its own.
+  sendFnf(3);
+  ASSERT_EQ(3, writes.size());
+
+  for (auto& write : writes) {
+    write.callback->writeSuccess();
+  }
+  loop();
+  EXPECT_EQ(3, succeeded);
+}
+
+TEST_F(RocketClientWriteBatchingTest, writeErrFailsWholeBatch) {
+  WriteBatchingOptions options;
+  options.maxFrames = 2;
+  client->setWriteBatching(options);
+
+  sendFnf(5);
+  ASSERT_EQ(3, writes.size());
+
+  writes[0].callback->writeSuccess();
+  // The socket fails the second write and, once closed, the third.
+  writes[1].callback->writeErr(0, writeError());
+  EXPECT_FALSE(client->isAlive());
+  writes[2].callback->writeErr(0, writeError());
+  loop();
+
+  EXPECT_EQ(2, succeeded);
+  EXPECT_EQ(3, failed);
+}
@@ -69,6 +69,14 @@ void RSResponder::onThriftRequest(
     return;
   }
 
+  auto server = worker_->getServer();
+  if (server->getMethodStatsEnabled() && !request->isOneway()) {
+    request->enableMethodStats(
+        worker_->getMethodStats(),
+        buf ? buf->computeChainDataLength() : 0,
+        server->getMethodStatsCpuTimeEnabled());
+  }
+
   auto protoId = request->getProtoId();
   auto reqContext = request->getRequestContext();
   cpp2Processor_->process(
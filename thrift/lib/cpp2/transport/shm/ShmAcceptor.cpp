@@ -0,0 +1,160 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/transport/shm/ShmAcceptor.h>
+
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/File.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventHandler.h>
+
+namespace apache {
+namespace thrift {
+
+namespace {
+constexpr std::chrono::milliseconds kHandshakeTimeout{5000};
+} // namespace
+
+// An accepted Unix socket, until the client's handshake arrives.
+class ShmAcceptor::Handshake : public folly::EventHandler,
+                               public folly::AsyncTimeout {
+ public:
+  Handshake(ShmAcceptor& acceptor, folly::EventBase* evb, folly::File socket)
+      : folly::EventHandler(evb, socket.fd()),
+        folly::AsyncTimeout(evb),
+        acceptor_(acceptor),
+        socket_(std::move(socket)) {}
+
+  folly::File takeSocket() {
+    return std::move(socket_);
+  }
+
+  void handlerReady(uint16_t) noexcept override {
+    acceptor_.handshakeReady(this);
+  }
+
+  void timeoutExpired() noexcept override {
+    acceptor_.handshakeTimedOut(this);
+  }
+
+ private:
+  ShmAcceptor& acceptor_;
+  folly::File socket_;
+};
+
+ShmAcceptor::ShmAcceptor(
+    std::shared_ptr<AsyncProcessorFactory> pFac,
+    const apache::thrift::server::ServerConfigs& serverConfigs,
+    const std::string& path,
+    size_t numCpuThreads,
+    const ShmSession::Options& options)
+    : path_(path), options_(options) {
+  CHECK_GT(numCpuThreads, 0);
+  threadManager_ =
+      concurrency::PriorityThreadManager::newPriorityThreadManager(
+          numCpuThreads);
+  threadManager_->start();
+  processor_ = std::make_unique<ThriftProcessor>(serverConfigs);
+  processor_->setCpp2Processor(pFac->getProcessor());
+  processor_->setThreadManager(threadManager_.get());
+
+  folly::exception_wrapper error;
+  auto evb = getEventBase();
+  evb->runInEventBaseThreadAndWait([&] {
+    try {
+      // Left behind by an acceptor which didn't shut down cleanly.
+      ::unlink(path_.c_str());
+      socket_.reset(new folly::AsyncServerSocket(evb));
+      socket_->bind(folly::SocketAddress::makeFromPath(path_));
+      socket_->listen(1024);
+      socket_->addAcceptCallback(this, nullptr);
+      socket_->startAccepting();
+    } catch (const std::exception& ex) {
+      error = folly::exception_wrapper(std::current_exception(), ex);
+      socket_.reset();
+    }
+  });
+  if (error) {
+    threadManager_->join();
+    error.throw_exception();
+  }
+}
+
+ShmAcceptor::~ShmAcceptor() {
+  auto evb = getEventBase();
+  evb->runInEventBaseThreadAndWait([&] {
+    socket_.reset();
+    handshakes_.clear();
+    auto channels = std::move(channels_);
+    channels_.clear();
+    for (auto& channel : channels) {
+      channel.second->closeNow();
+    }
+  });
+  threadManager_->join();
+  // Drop the responses of the last requests while the EventBase runs.
+  evb->runInEventBaseThreadAndWait([] {});
+  ::unlink(path_.c_str());
+}
+
+void ShmAcceptor::connectionAccepted(
+    int fd,
+    const folly::SocketAddress&) noexcept {
+  auto handshake = std::make_unique<Handshake>(
+      *this, getEventBase(), folly::File(fd, true));
+  handshake->registerHandler(folly::EventHandler::READ);
+  handshake->scheduleTimeout(kHandshakeTimeout.count());
+  auto ptr = handshake.get();
+  handshakes_.emplace(ptr, std::move(handshake));
+}
+
+void ShmAcceptor::acceptError(const std::exception& ex) noexcept {
+  LOG(ERROR) << "Shared memory acceptor failed to accept: " << ex.what();
+}
+
+void ShmAcceptor::handshakeReady(Handshake* handshake) {
+  auto it = handshakes_.find(handshake);
+  DCHECK(it != handshakes_.end());
+  auto owned = std::move(it->second);
+  handshakes_.erase(it);
+  owned->unregisterHandler();
+  owned->cancelTimeout();
+
+  try {
+    auto session =
+        ShmSession::accept(getEventBase(), owned->takeSocket(), options_);
+    auto channel = std::make_shared<ShmServerChannel>(
+        std::move(session),
+        processor_.get(),
+        [this](ShmServerChannel* closed) { channels_.erase(closed); });
+    channels_.emplace(channel.get(), channel);
+    channel->start();
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Shared memory handshake failed: " << ex.what();
+  }
+}
+
+void ShmAcceptor::handshakeTimedOut(Handshake* handshake) {
+  LOG(WARNING) << "Shared memory handshake timed out";
+  handshakes_.erase(handshake);
+}
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <thrift/lib/cpp/concurrency/ThreadManager.h>
+#include <thrift/lib/cpp2/async/AsyncProcessor.h>
+#include <thrift/lib/cpp2/transport/core/ThriftProcessor.h>
+#include <thrift/lib/cpp2/transport/shm/ShmServerChannel.h>
+#include <thrift/lib/cpp2/transport/shm/ShmSession.h>
+
+namespace apache {
+namespace thrift {
+
+// Serves the clients of ShmClientConnection. Listens on a Unix socket at
+// "path", on which each client passes the shared memory of its session.
+// All sessions run on one IO thread; handlers run on a thread manager with
+// numCpuThreads threads, as with InMemoryConnection.
+class ShmAcceptor : private folly::AsyncServerSocket::AcceptCallback {
+ public:
+  ShmAcceptor(
+      std::shared_ptr<AsyncProcessorFactory> pFac,
+      const apache::thrift::server::ServerConfigs& serverConfigs,
+      const std::string& path,
+      size_t numCpuThreads = 1,
+      const ShmSession::Options& options = ShmSession::Options());
+  ~ShmAcceptor() override;
+
+  ShmAcceptor(const ShmAcceptor&) = delete;
+  ShmAcceptor& operator=(const ShmAcceptor&) = delete;
+
+  folly::EventBase* getEventBase() const {
+    return runner_.getEventBase();
+  }
+
+ private:
+  class Handshake;
+
+  void connectionAccepted(
+      int fd,
+      const folly::SocketAddress& clientAddr) noexcept override;
+  void acceptError(const std::exception& ex) noexcept override;
+
+  // The client's half of the handshake is readable, or it timed out.
+  void handshakeReady(Handshake* handshake);
+  void handshakeTimedOut(Handshake* handshake);
+
+  folly::ScopedEventBaseThread runner_;
+  std::shared_ptr<concurrency::ThreadManager> threadManager_;
+  std::unique_ptr<ThriftProcessor> processor_;
+  const std::string path_;
+  const ShmSession::Options options_;
+  folly::AsyncServerSocket::UniquePtr socket_;
+  std::unordered_map<Handshake*, std::unique_ptr<Handshake>> handshakes_;
+  std::unordered_map<ShmServerChannel*, std::shared_ptr<ShmServerChannel>>
+      channels_;
+};
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/transport/shm/ShmClientChannel.h>
+
+#include <glog/logging.h>
+
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/transport/shm/ShmFrame.h>
+
+namespace apache {
+namespace thrift {
+
+using apache::thrift::transport::TTransportException;
+
+namespace {
+// Calls "fn" with the callback on its event base, which owns it from then on.
+template <typename F>
+void runOnCallbackEvb(std::unique_ptr<ThriftClientCallback> callback, F&& fn) {
+  auto evb = callback->getEventBase();
+  if (evb->isInEventBaseThread()) {
+    fn(*callback);
+    return;
+  }
+  evb->runInEventBaseThread(
+      [callback = std::move(callback), fn = std::forward<F>(fn)]() mutable {
+        fn(*callback);
+      });
+}
+
+void failRequest(
+    std::unique_ptr<ThriftClientCallback> callback,
+    TTransportException ex) {
+  runOnCallbackEvb(
+      std::move(callback), [ex = std::move(ex)](ThriftClientCallback& cb) {
+        cb.onError(folly::make_exception_wrapper<TTransportException>(ex));
+      });
+}
+} // namespace
+
+ShmClientChannel::ShmClientChannel(ShmSession::UniquePtr session)
+    : evb_(session->getEventBase()), session_(std::move(session)) {
+  session_->setCallback(this);
+}
+
+ShmClientChannel::~ShmClientChannel() {
+  failPendingRequests();
+  if (session_ && !evb_->isInEventBaseThread()) {
+    evb_->runInEventBaseThread([session = std::move(session_)] {});
+  }
+}
+
+void ShmClientChannel::sendThriftRequest(
+    std::unique_ptr<RequestRpcMetadata> metadata,
+    std::unique_ptr<folly::IOBuf> payload,
+    std::unique_ptr<ThriftClientCallback> callback) noexcept {
+  DCHECK(evb_->isInEventBaseThread());
+  DCHECK(metadata->__isset.kind);
+  if (!good()) {
+    failRequest(
+        std::move(callback),
+        TTransportException(
+            TTransportException::NOT_OPEN, "Shared memory session is closed"));
+    return;
+  }
+  if (metadata->kind != RpcKind::SINGLE_REQUEST_SINGLE_RESPONSE &&
+      metadata->kind != RpcKind::SINGLE_REQUEST_NO_RESPONSE) {
+    failRequest(
+        std::move(callback),
+        TTransportException(
+            TTransportException::NOT_SUPPORTED,
+            "Shared memory transport doesn't support streaming"));
+    return;
+  }
+  bool oneway = metadata->kind == RpcKind::SINGLE_REQUEST_NO_RESPONSE;
+  if (!oneway && pendingRequests_.size() >= maxPendingRequests_) {
+    TTransportException ex(
+        TTransportException::NETWORK_ERROR,
+        "Too many active requests on connection");
+    ex.setOptions(TTransportException::CHANNEL_IS_VALID);
+    failRequest(std::move(callback), std::move(ex));
+    return;
+  }
+
+  auto seqId = nextSeqId_++;
+  metadata->seqId = seqId;
+  metadata->__isset.seqId = true;
+  session_->send(shm::encodeFrame(*metadata, std::move(payload)));
+
+  if (oneway) {
+    runOnCallbackEvb(std::move(callback), [](ThriftClientCallback& cb) {
+      cb.onThriftRequestSent();
+    });
+    return;
+  }
+
+  // The callback stays here until the response, so only its address goes
+  // to its event base. It gets there before the response does.
+  auto cb = callback.get();
+  callback->setTimedOut([self = std::weak_ptr<ThriftChannelIf>(
+                             shared_from_this()),
+                         evb = evb_,
+                         seqId] {
+    evb->runInEventBaseThread([self, seqId] {
+      auto channel = self.lock();
+      if (!channel) {
+        return;
+      }
+      auto& pending =
+          static_cast<ShmClientChannel&>(*channel).pendingRequests_;
+      auto it = pending.find(seqId);
+      if (it == pending.end()) {
+        return;
+      }
+      auto callback = std::move(it->second);
+      pending.erase(it);
+      // Destroyed on its own event base, like when it gets a response.
+      runOnCallbackEvb(std::move(callback), [](ThriftClientCallback&) {});
+    });
+  });
+  pendingRequests_.emplace(seqId, std::move(callback));
+  auto cbEvb = cb->getEventBase();
+  if (cbEvb->isInEventBaseThread()) {
+    cb->onThriftRequestSent();
+  } else {
+    cbEvb->runInEventBaseThread([cb] { cb->onThriftRequestSent(); });
+  }
+}
+
+void ShmClientChannel::messageReceived(std::unique_ptr<folly::IOBuf> message) {
+  std::unique_ptr<folly::IOBuf> payload;
+  std::unique_ptr<ResponseRpcMetadata> metadata;
+  try {
+    metadata =
+        shm::decodeFrame<ResponseRpcMetadata>(std::move(message), payload);
+  } catch (const TTransportException& ex) {
+    LOG(ERROR) << ex.what();
+    session_->close();
+    return;
+  }
+  auto it = pendingRequests_.find(metadata->seqId);
+  if (it == pendingRequests_.end()) {
+    // Timed out.
+    return;
+  }
+  auto callback = std::move(it->second);
+  pendingRequests_.erase(it);
+  runOnCallbackEvb(
+      std::move(callback),
+      [metadata = std::move(metadata),
+       payload = std::move(payload)](ThriftClientCallback& cb) mutable {
+        cb.onThriftResponse(std::move(metadata), std::move(payload));
+      });
+}
+
+void ShmClientChannel::sessionClosed() {
+  failPendingRequests();
+  auto closeCallbacks = std::move(closeCallbacks_);
+  closeCallbacks_.clear();
+  for (auto& cb : closeCallbacks) {
+    cb.second->channelClosed();
+  }
+}
+
+bool ShmClientChannel::good() const {
+  return session_ && session_->good();
+}
+
+void ShmClientChannel::closeNow() {
+  DCHECK(evb_->isInEventBaseThread());
+  if (session_) {
+    session_->close();
+  }
+}
+
+void ShmClientChannel::setCloseCallback(
+    ThriftClient* client,
+    CloseCallback* cb) {
+  if (cb == nullptr) {
+    closeCallbacks_.erase(client);
+  } else {
+    closeCallbacks_[client] = cb;
+  }
+}
+
+void ShmClientChannel::failPendingRequests() {
+  auto pendingRequests = std::move(pendingRequests_);
+  pendingRequests_.clear();
+  for (auto& request : pendingRequests) {
+    failRequest(
+        std::move(request.second),
+        TTransportException(
+            TTransportException::END_OF_FILE,
+            "Shared memory session closed"));
+  }
+}
+
+} // namespace thrift
+} // namespace apache
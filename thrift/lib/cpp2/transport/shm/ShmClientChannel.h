@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <limits>
+#include <unordered_map>
+
+#include <thrift/lib/cpp2/async/ClientChannel.h>
+#include <thrift/lib/cpp2/transport/core/ThriftChannelIf.h>
+#include <thrift/lib/cpp2/transport/core/ThriftClientCallback.h>
+#include <thrift/lib/cpp2/transport/shm/ShmSession.h>
+
+namespace apache {
+namespace thrift {
+
+class ThriftClient;
+
+// Client side of a ShmSession. Unlike the channels of the other transports,
+// one object carries all the RPCs of the connection, which are matched to
+// their responses by sequence id.
+class ShmClientChannel : public ThriftChannelIf, public ShmSession::Callback {
+ public:
+  explicit ShmClientChannel(ShmSession::UniquePtr session);
+  ~ShmClientChannel() override;
+
+  void sendThriftRequest(
+      std::unique_ptr<RequestRpcMetadata> metadata,
+      std::unique_ptr<folly::IOBuf> payload,
+      std::unique_ptr<ThriftClientCallback> callback) noexcept override;
+
+  void sendThriftResponse(
+      std::unique_ptr<ResponseRpcMetadata>,
+      std::unique_ptr<folly::IOBuf>) noexcept override {
+    LOG(FATAL) << "Client channel";
+  }
+
+  void sendStreamThriftResponse(
+      std::unique_ptr<ResponseRpcMetadata>,
+      std::unique_ptr<folly::IOBuf>,
+      apache::thrift::SemiStream<
+          std::unique_ptr<folly::IOBuf>>) noexcept override {
+    LOG(FATAL) << "Client channel";
+  }
+
+  folly::EventBase* getEventBase() noexcept override {
+    return evb_;
+  }
+
+  bool good() const;
+  void closeNow();
+  void setCloseCallback(ThriftClient* client, CloseCallback* cb);
+  void setMaxPendingRequests(uint32_t num) {
+    maxPendingRequests_ = num;
+  }
+  ClientChannel::SaturationStatus getSaturationStatus() const {
+    return ClientChannel::SaturationStatus(
+        pendingRequests_.size(), maxPendingRequests_);
+  }
+
+ private:
+  void messageReceived(std::unique_ptr<folly::IOBuf> message) override;
+  void sessionClosed() override;
+
+  void failPendingRequests();
+
+  folly::EventBase* evb_;
+  ShmSession::UniquePtr session_;
+  std::unordered_map<int32_t, std::unique_ptr<ThriftClientCallback>>
+      pendingRequests_;
+  int32_t nextSeqId_{0};
+  uint32_t maxPendingRequests_{std::numeric_limits<uint32_t>::max()};
+  std::unordered_map<ThriftClient*, CloseCallback*> closeCallbacks_;
+};
+
+} // namespace thrift
+} // namespace apache
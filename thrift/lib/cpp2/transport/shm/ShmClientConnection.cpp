@@ -0,0 +1,113 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/transport/shm/ShmClientConnection.h>
+
+#include <glog/logging.h>
+
+#include <thrift/lib/cpp/transport/TTransportException.h>
+
+namespace apache {
+namespace thrift {
+
+using apache::thrift::async::TAsyncTransport;
+using apache::thrift::transport::TTransportException;
+
+std::unique_ptr<ClientConnectionIf> ShmClientConnection::newConnection(
+    folly::EventBase* evb,
+    const std::string& path,
+    const ShmSession::Options& options) {
+  return std::unique_ptr<ClientConnectionIf>(new ShmClientConnection(
+      evb, ShmSession::connect(evb, path, options)));
+}
+
+ShmClientConnection::ShmClientConnection(
+    folly::EventBase* evb,
+    ShmSession::UniquePtr session)
+    : evb_(evb),
+      channel_(std::make_shared<ShmClientChannel>(std::move(session))) {}
+
+ShmClientConnection::~ShmClientConnection() {
+  closeNow();
+}
+
+std::shared_ptr<ThriftChannelIf> ShmClientConnection::getChannel() {
+  if (!channel_->good()) {
+    throw TTransportException(
+        TTransportException::NOT_OPEN, "Shared memory session is closed");
+  }
+  return channel_;
+}
+
+void ShmClientConnection::setMaxPendingRequests(uint32_t num) {
+  channel_->setMaxPendingRequests(num);
+}
+
+void ShmClientConnection::setCloseCallback(
+    ThriftClient* client,
+    CloseCallback* cb) {
+  channel_->setCloseCallback(client, cb);
+}
+
+folly::EventBase* ShmClientConnection::getEventBase() const {
+  return evb_;
+}
+
+TAsyncTransport* ShmClientConnection::getTransport() {
+  return nullptr;
+}
+
+bool ShmClientConnection::good() {
+  DCHECK(evb_->isInEventBaseThread());
+  return channel_->good();
+}
+
+ClientChannel::SaturationStatus ShmClientConnection::getSaturationStatus() {
+  DCHECK(evb_->isInEventBaseThread());
+  return channel_->getSaturationStatus();
+}
+
+void ShmClientConnection::attachEventBase(folly::EventBase*) {
+  LOG(FATAL) << "Shared memory connections can't change their EventBase";
+}
+
+void ShmClientConnection::detachEventBase() {
+  LOG(FATAL) << "Shared memory connections can't change their EventBase";
+}
+
+bool ShmClientConnection::isDetachable() {
+  return false;
+}
+
+uint32_t ShmClientConnection::getTimeout() {
+  return timeout_.count();
+}
+
+void ShmClientConnection::setTimeout(uint32_t ms) {
+  // Each request carries its own timeout.
+  timeout_ = std::chrono::milliseconds(ms);
+}
+
+void ShmClientConnection::closeNow() {
+  channel_->closeNow();
+}
+
+CLIENT_TYPE ShmClientConnection::getClientType() {
+  return THRIFT_HTTP_CLIENT_TYPE;
+}
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include <thrift/lib/cpp2/transport/core/ClientConnectionIf.h>
+#include <thrift/lib/cpp2/transport/shm/ShmClientChannel.h>
+#include <thrift/lib/cpp2/transport/shm/ShmSession.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * Shared memory implementation of ClientConnectionIf, for a server in
+ * another process on the same host which listens with a ShmAcceptor.
+ *
+ * Like H2ClientConnection, it does not reconnect: once the session is
+ * closed, all requests fail and a new connection has to be created.
+ * Streaming RPCs are not supported. Create and destroy it on the thread of
+ * its EventBase.
+ */
+class ShmClientConnection : public ClientConnectionIf {
+ public:
+  // Blocks for the handshake. Throws TTransportException.
+  static std::unique_ptr<ClientConnectionIf> newConnection(
+      folly::EventBase* evb,
+      const std::string& path,
+      const ShmSession::Options& options = ShmSession::Options());
+
+  ~ShmClientConnection() override;
+
+  ShmClientConnection(const ShmClientConnection&) = delete;
+  ShmClientConnection& operator=(const ShmClientConnection&) = delete;
+
+  std::shared_ptr<ThriftChannelIf> getChannel() override;
+  void setMaxPendingRequests(uint32_t num) override;
+  void setCloseCallback(ThriftClient* client, CloseCallback* cb) override;
+  folly::EventBase* getEventBase() const override;
+
+  apache::thrift::async::TAsyncTransport* getTransport() override;
+  bool good() override;
+  ClientChannel::SaturationStatus getSaturationStatus() override;
+  void attachEventBase(folly::EventBase* evb) override;
+  void detachEventBase() override;
+  bool isDetachable() override;
+  uint32_t getTimeout() override;
+  void setTimeout(uint32_t ms) override;
+  void closeNow() override;
+  CLIENT_TYPE getClientType() override;
+
+ private:
+  ShmClientConnection(folly::EventBase* evb, ShmSession::UniquePtr session);
+
+  folly::EventBase* evb_;
+  std::shared_ptr<ShmClientChannel> channel_;
+  std::chrono::milliseconds timeout_{0};
+};
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/protocol/CompactProtocol.h>
+
+namespace apache {
+namespace thrift {
+namespace shm {
+
+// A message of a ShmSession is the length of the Compact serialized
+// metadata, the metadata, and the payload.
+template <typename Metadata>
+std::unique_ptr<folly::IOBuf> encodeFrame(
+    const Metadata& metadata,
+    std::unique_ptr<folly::IOBuf> payload) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  queue.preallocate(sizeof(uint32_t), 256);
+  queue.postallocate(sizeof(uint32_t));
+  CompactProtocolWriter writer;
+  writer.setOutput(&queue);
+  metadata.write(&writer);
+  auto frame = queue.move();
+  uint32_t size = frame->computeChainDataLength() - sizeof(uint32_t);
+  folly::io::RWPrivateCursor(frame.get()).writeBE<uint32_t>(size);
+  if (payload) {
+    frame->prependChain(std::move(payload));
+  }
+  return frame;
+}
+
+// Throws TTransportException if the frame is invalid.
+template <typename Metadata>
+std::unique_ptr<Metadata> decodeFrame(
+    std::unique_ptr<folly::IOBuf> frame,
+    std::unique_ptr<folly::IOBuf>& payload) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  queue.append(std::move(frame));
+  auto metadata = std::make_unique<Metadata>();
+  try {
+    if (queue.chainLength() < sizeof(uint32_t)) {
+      throw std::out_of_range("frame is too short");
+    }
+    uint32_t size = folly::io::Cursor(queue.front()).readBE<uint32_t>();
+    queue.trimStart(sizeof(uint32_t));
+    auto serialized = queue.split(size);
+    CompactProtocolReader reader;
+    reader.setInput(serialized.get());
+    metadata->read(&reader);
+  } catch (const std::exception& ex) {
+    throw transport::TTransportException(
+        transport::TTransportException::CORRUPTED_DATA,
+        std::string("Invalid shared memory frame: ") + ex.what());
+  }
+  payload = queue.move();
+  if (!payload) {
+    payload = folly::IOBuf::create(0);
+  }
+  return metadata;
+}
+
+} // namespace shm
+} // namespace thrift
+} // namespace apache
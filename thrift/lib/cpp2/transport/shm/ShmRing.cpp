@@ -0,0 +1,141 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/transport/shm/ShmRing.h>
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include <thrift/lib/cpp/transport/TTransportException.h>
+
+namespace apache {
+namespace thrift {
+
+namespace {
+// Every record starts with this, at a multiple of 8 bytes.
+struct RecordHeader {
+  uint32_t size;
+  uint32_t flags;
+};
+
+constexpr uint32_t kMore = 1 << 0;
+// Skip to the start of the ring.
+constexpr uint32_t kWrap = 1 << 1;
+
+size_t align(size_t size) {
+  return (size + 7) & ~size_t(7);
+}
+} // namespace
+
+ShmRing::ShmRing(void* region, size_t capacity, bool init)
+    : control_(static_cast<Control*>(region)),
+      data_(static_cast<uint8_t*>(region) + sizeof(Control)),
+      capacity_(capacity) {
+  CHECK_EQ(0, capacity & (capacity - 1)) << "Capacity must be a power of 2";
+  CHECK_GE(capacity, 4 * sizeof(RecordHeader));
+  if (init) {
+    new (control_) Control();
+    control_->head.store(0, std::memory_order_relaxed);
+    control_->tail.store(0, std::memory_order_relaxed);
+    control_->consumerWaiting.store(0, std::memory_order_relaxed);
+    control_->producerWaiting.store(0, std::memory_order_release);
+  }
+}
+
+bool ShmRing::write(const folly::IOBuf& data, bool more) {
+  auto size = data.computeChainDataLength();
+  DCHECK_LE(size, maxRecordSize());
+  auto recordSize = sizeof(RecordHeader) + align(size);
+
+  auto head = control_->head.load(std::memory_order_relaxed);
+  auto tail = control_->tail.load(std::memory_order_seq_cst);
+  auto offset = head & (capacity_ - 1);
+  // A record that doesn't fit before the end starts over at the beginning.
+  size_t skip = offset + recordSize > capacity_ ? capacity_ - offset : 0;
+  if (capacity_ - (head - tail) < skip + recordSize) {
+    return false;
+  }
+
+  if (skip) {
+    RecordHeader wrap{0, kWrap};
+    std::memcpy(data_ + offset, &wrap, sizeof(wrap));
+    offset = 0;
+  }
+  RecordHeader header{static_cast<uint32_t>(size), more ? kMore : 0};
+  std::memcpy(data_ + offset, &header, sizeof(header));
+  auto p = data_ + offset + sizeof(header);
+  for (const auto& range : data) {
+    std::memcpy(p, range.data(), range.size());
+    p += range.size();
+  }
+  control_->head.store(head + skip + recordSize, std::memory_order_seq_cst);
+  return true;
+}
+
+bool ShmRing::read(std::unique_ptr<folly::IOBuf>& data, bool& more) {
+  auto tail = control_->tail.load(std::memory_order_relaxed);
+  auto head = control_->head.load(std::memory_order_seq_cst);
+  if (tail == head) {
+    return false;
+  }
+
+  auto offset = tail & (capacity_ - 1);
+  RecordHeader header;
+  std::memcpy(&header, data_ + offset, sizeof(header));
+  if (header.flags & kWrap) {
+    tail += capacity_ - offset;
+    offset = 0;
+    std::memcpy(&header, data_, sizeof(header));
+  }
+  // The peer can write anything to the shared memory, so don't trust it.
+  if (head - tail > capacity_ || header.size > maxRecordSize() ||
+      offset + sizeof(header) + header.size > capacity_) {
+    throw transport::TTransportException(
+        transport::TTransportException::CORRUPTED_DATA,
+        "Invalid record in shared memory ring");
+  }
+  data = folly::IOBuf::copyBuffer(
+      data_ + offset + sizeof(header), header.size);
+  more = header.flags & kMore;
+  control_->tail.store(
+      tail + sizeof(header) + align(header.size), std::memory_order_seq_cst);
+  return true;
+}
+
+bool ShmRing::empty() const {
+  return control_->head.load(std::memory_order_seq_cst) ==
+      control_->tail.load(std::memory_order_relaxed);
+}
+
+void ShmRing::setConsumerWaiting(bool waiting) {
+  control_->consumerWaiting.store(waiting, std::memory_order_seq_cst);
+}
+
+void ShmRing::setProducerWaiting(bool waiting) {
+  control_->producerWaiting.store(waiting, std::memory_order_seq_cst);
+}
+
+bool ShmRing::consumerWaiting() const {
+  return control_->consumerWaiting.load(std::memory_order_seq_cst);
+}
+
+bool ShmRing::producerWaiting() const {
+  return control_->producerWaiting.load(std::memory_order_seq_cst);
+}
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include <folly/io/IOBuf.h>
+
+namespace apache {
+namespace thrift {
+
+// Single producer, single consumer ring of records in memory shared by two
+// processes. A record holds at most maxRecordSize() bytes and is never split
+// across the end of the ring, so that the consumer can copy it out in one
+// go.
+//
+// Besides the read and write positions, the ring keeps a flag for each side
+// that is set before it goes to sleep. The other side checks the flag after
+// it has moved its own position, and wakes the sleeper if it is set.
+class ShmRing {
+ public:
+  // Layout of the shared region: the control block followed by the data.
+  struct Control {
+    // Written by the producer.
+    alignas(64) std::atomic<uint64_t> head;
+    // Written by the consumer.
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> consumerWaiting;
+    std::atomic<uint32_t> producerWaiting;
+  };
+
+  static_assert(
+      std::atomic<uint64_t>::is_always_lock_free,
+      "Shared memory positions must be lock free");
+
+  // capacity must be a power of two.
+  static size_t regionSize(size_t capacity) {
+    return sizeof(Control) + capacity;
+  }
+
+  // Uses the region at "region", of regionSize(capacity) bytes. Exactly one
+  // of the two processes initializes it.
+  ShmRing(void* region, size_t capacity, bool init);
+
+  ShmRing(const ShmRing&) = delete;
+  ShmRing& operator=(const ShmRing&) = delete;
+
+  size_t maxRecordSize() const {
+    return capacity_ / 4;
+  }
+
+  // Producer side. Appends the chain as one record with the given flag,
+  // unless there is not enough room. The chain is at most maxRecordSize().
+  bool write(const folly::IOBuf& data, bool more);
+
+  // Consumer side. Copies the next record into "data", or returns false if
+  // the ring is empty. Throws TTransportException if the record is invalid.
+  bool read(std::unique_ptr<folly::IOBuf>& data, bool& more);
+  bool empty() const;
+
+  // Sets the flag of the calling side before it waits. The caller must
+  // check the ring again afterwards and clear the flag if it doesn't wait.
+  void setConsumerWaiting(bool waiting);
+  void setProducerWaiting(bool waiting);
+
+  // Whether the other side waits for what the caller just did.
+  bool consumerWaiting() const;
+  bool producerWaiting() const;
+
+ private:
+  Control* control_;
+  uint8_t* data_;
+  const size_t capacity_;
+};
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/transport/shm/ShmServerChannel.h>
+
+#include <glog/logging.h>
+
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/transport/core/EnvelopeUtil.h>
+#include <thrift/lib/cpp2/transport/shm/ShmFrame.h>
+
+namespace apache {
+namespace thrift {
+
+using apache::thrift::transport::TTransportException;
+
+ShmServerChannel::ShmServerChannel(
+    ShmSession::UniquePtr session,
+    ThriftProcessor* processor,
+    folly::Function<void(ShmServerChannel*)> onClose)
+    : evb_(session->getEventBase()),
+      session_(std::move(session)),
+      processor_(processor),
+      onClose_(std::move(onClose)) {}
+
+ShmServerChannel::~ShmServerChannel() {
+  // The last request may complete on a worker thread.
+  if (session_ && !evb_->isInEventBaseThread()) {
+    evb_->runInEventBaseThread([session = std::move(session_)] {});
+  }
+}
+
+void ShmServerChannel::start() {
+  session_->setCallback(this);
+}
+
+void ShmServerChannel::closeNow() {
+  DCHECK(evb_->isInEventBaseThread());
+  session_->close();
+}
+
+void ShmServerChannel::sendThriftResponse(
+    std::unique_ptr<ResponseRpcMetadata> metadata,
+    std::unique_ptr<folly::IOBuf> payload) noexcept {
+  DCHECK(evb_->isInEventBaseThread());
+  DCHECK(metadata->__isset.seqId);
+  // The client is gone.
+  if (!session_->good()) {
+    return;
+  }
+  session_->send(shm::encodeFrame(*metadata, std::move(payload)));
+}
+
+void ShmServerChannel::messageReceived(std::unique_ptr<folly::IOBuf> message) {
+  std::unique_ptr<folly::IOBuf> payload;
+  std::unique_ptr<RequestRpcMetadata> metadata;
+  try {
+    metadata =
+        shm::decodeFrame<RequestRpcMetadata>(std::move(message), payload);
+  } catch (const TTransportException& ex) {
+    LOG(ERROR) << ex.what();
+    session_->close();
+    return;
+  }
+  if (!metadata->__isset.kind || !metadata->__isset.seqId ||
+      !EnvelopeUtil::stripEnvelope(metadata.get(), payload)) {
+    LOG(ERROR) << "Invalid request on shared memory session";
+    session_->close();
+    return;
+  }
+  processor_->onThriftRequest(
+      std::move(metadata), std::move(payload), shared_from_this());
+}
+
+void ShmServerChannel::sessionClosed() {
+  if (auto onClose = std::move(onClose_)) {
+    onClose(this);
+  }
+}
+
+} // namespace thrift
+} // namespace apache
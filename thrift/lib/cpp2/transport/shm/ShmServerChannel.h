@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Function.h>
+#include <thrift/lib/cpp2/transport/core/ThriftChannelIf.h>
+#include <thrift/lib/cpp2/transport/core/ThriftProcessor.h>
+#include <thrift/lib/cpp2/transport/shm/ShmSession.h>
+
+namespace apache {
+namespace thrift {
+
+// Server side of a ShmSession: hands the requests to the processor, and
+// sends back their responses. The processor keeps the channel alive while
+// it has requests, after the session may have closed.
+class ShmServerChannel : public ThriftChannelIf, public ShmSession::Callback {
+ public:
+  ShmServerChannel(
+      ShmSession::UniquePtr session,
+      ThriftProcessor* processor,
+      folly::Function<void(ShmServerChannel*)> onClose);
+  ~ShmServerChannel() override;
+
+  // Starts reading requests.
+  void start();
+  void closeNow();
+
+  void sendThriftResponse(
+      std::unique_ptr<ResponseRpcMetadata> metadata,
+      std::unique_ptr<folly::IOBuf> payload) noexcept override;
+
+  void sendStreamThriftResponse(
+      std::unique_ptr<ResponseRpcMetadata>,
+      std::unique_ptr<folly::IOBuf>,
+      apache::thrift::SemiStream<
+          std::unique_ptr<folly::IOBuf>>) noexcept override {
+    LOG(FATAL) << "Shared memory transport doesn't support streaming yet";
+  }
+
+  void sendThriftRequest(
+      std::unique_ptr<RequestRpcMetadata>,
+      std::unique_ptr<folly::IOBuf>,
+      std::unique_ptr<ThriftClientCallback>) noexcept override {
+    LOG(FATAL) << "Server channel";
+  }
+
+  folly::EventBase* getEventBase() noexcept override {
+    return evb_;
+  }
+
+ private:
+  void messageReceived(std::unique_ptr<folly::IOBuf> message) override;
+  void sessionClosed() override;
+
+  folly::EventBase* evb_;
+  ShmSession::UniquePtr session_;
+  // Owned by ShmAcceptor.
+  ThriftProcessor* processor_;
+  folly::Function<void(ShmServerChannel*)> onClose_;
+};
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,518 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/transport/shm/ShmSession.h>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include <folly/Portability.h>
+#include <folly/ScopeGuard.h>
+
+#include <thrift/lib/cpp/transport/TTransportException.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+namespace apache {
+namespace thrift {
+
+using apache::thrift::transport::TTransportException;
+
+namespace {
+constexpr uint32_t kMagic = 0x54534d31;
+constexpr uint32_t kVersion = 1;
+constexpr size_t kMinRingSize = 4096;
+constexpr size_t kMaxRingSize = size_t(1) << 30;
+constexpr size_t kNumFds = 3;
+constexpr time_t kHandshakeTimeoutSec = 5;
+// The client keeps the memfd, so its size has to be sealed: truncating it
+// would make the server fault on its next access to the rings.
+constexpr int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+// Messages delivered per EventBase callback, before the session lets the
+// other handlers of the EventBase run.
+constexpr size_t kMaxMessagesPerPoll = 64;
+
+// Sent by the client along with the memfd of the rings, the server's eventfd
+// and the client's eventfd. The server answers with a zero byte.
+struct Hello {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ringSize;
+};
+
+bool validRingSize(size_t size) {
+  return size >= kMinRingSize && size <= kMaxRingSize &&
+      (size & (size - 1)) == 0;
+}
+
+size_t segmentSize(size_t ringSize) {
+  return 2 * ShmRing::regionSize(ringSize);
+}
+
+[[noreturn]] void throwError(const char* what, int err = errno) {
+  throw TTransportException(TTransportException::NOT_OPEN, what, err);
+}
+
+folly::File makeEventFd() {
+  int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    throwError("eventfd failed");
+  }
+  return folly::File(fd, true);
+}
+
+void* mapSegment(int fd, size_t size) {
+  void* segment =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (segment == MAP_FAILED) {
+    throwError("mmap failed");
+  }
+  return segment;
+}
+
+void sendHello(int sock, const Hello& hello, const int (&fds)[kNumFds]) {
+  iovec iov{const_cast<Hello*>(&hello), sizeof(hello)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+  std::memset(control, 0, sizeof(control));
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  if (::sendmsg(sock, &msg, MSG_NOSIGNAL) != sizeof(hello)) {
+    throwError("Failed to send the shared memory handshake");
+  }
+}
+
+void recvHello(int sock, Hello& hello, folly::File (&fds)[kNumFds]) {
+  iovec iov{&hello, sizeof(hello)};
+  alignas(cmsghdr) char control[CMSG_SPACE(kNumFds * sizeof(int))];
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  auto n = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  if (n < 0) {
+    throwError("Failed to receive the shared memory handshake");
+  }
+
+  // Take ownership of whatever was passed before validating anything.
+  size_t numFds = 0;
+  for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for (size_t i = 0; i < count; ++i) {
+      int fd;
+      std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+      folly::File file(fd, true);
+      if (numFds < kNumFds) {
+        fds[numFds] = std::move(file);
+      }
+      ++numFds;
+    }
+  }
+  if (n != sizeof(hello) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+      numFds != kNumFds || hello.magic != kMagic ||
+      hello.version != kVersion || !validRingSize(hello.ringSize)) {
+    throw TTransportException(
+        TTransportException::CORRUPTED_DATA,
+        "Invalid shared memory handshake");
+  }
+}
+} // namespace
+
+ShmSession::UniquePtr ShmSession::connect(
+    folly::EventBase* evb,
+    const std::string& path,
+    const Options& options) {
+  if (!validRingSize(options.ringSize)) {
+    throw TTransportException(
+        TTransportException::BAD_ARGS,
+        "Ring size must be a power of two between 4KB and 1GB");
+  }
+
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw TTransportException(
+        TTransportException::BAD_ARGS, "Unix socket path is too long");
+  }
+  std::memcpy(addr.sun_path, path.data(), path.size());
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throwError("socket failed");
+  }
+  folly::File socket(fd, true);
+  timeval timeout{kHandshakeTimeoutSec, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    throwError("Failed to connect to the shared memory acceptor");
+  }
+
+  auto size = segmentSize(options.ringSize);
+  int memfd = ::syscall(
+      SYS_memfd_create, "thrift-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0) {
+    throwError("memfd_create failed");
+  }
+  folly::File segmentFile(memfd, true);
+  if (::ftruncate(memfd, size) != 0) {
+    throwError("ftruncate failed");
+  }
+  if (::fcntl(memfd, F_ADD_SEALS, kRequiredSeals) != 0) {
+    throwError("Failed to seal the shared memory segment");
+  }
+  void* segment = mapSegment(memfd, size);
+  auto unmap = folly::makeGuard([&] { ::munmap(segment, size); });
+  // The server maps the rings after it received the handshake.
+  auto region = ShmRing::regionSize(options.ringSize);
+  ShmRing toServer(segment, options.ringSize, true);
+  ShmRing toClient(
+      static_cast<uint8_t*>(segment) + region, options.ringSize, true);
+
+  auto serverNotify = makeEventFd();
+  auto clientNotify = makeEventFd();
+  Hello hello{kMagic, kVersion, options.ringSize};
+  int fds[kNumFds] = {memfd, serverNotify.fd(), clientNotify.fd()};
+  sendHello(fd, hello, fds);
+
+  uint8_t ack;
+  auto n = ::recv(fd, &ack, 1, 0);
+  if (n < 0) {
+    throwError("Failed to receive the shared memory handshake");
+  }
+  if (n != 1 || ack != 0) {
+    throw TTransportException(
+        TTransportException::NOT_OPEN, "Shared memory handshake refused");
+  }
+  if (::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+    throwError("fcntl failed");
+  }
+
+  unmap.dismiss();
+  return UniquePtr(new ShmSession(
+      evb,
+      std::move(socket),
+      std::move(clientNotify),
+      std::move(serverNotify),
+      segment,
+      true,
+      options));
+}
+
+ShmSession::UniquePtr ShmSession::accept(
+    folly::EventBase* evb,
+    folly::File socket,
+    const Options& options) {
+  Hello hello;
+  folly::File fds[kNumFds];
+  recvHello(socket.fd(), hello, fds);
+
+  auto size = segmentSize(hello.ringSize);
+  // Fails for anything but a memfd created with MFD_ALLOW_SEALING.
+  int seals = ::fcntl(fds[0].fd(), F_GET_SEALS);
+  if (seals < 0 || (seals & kRequiredSeals) != kRequiredSeals) {
+    throw TTransportException(
+        TTransportException::CORRUPTED_DATA,
+        "Shared memory segment is not sealed");
+  }
+  struct stat st;
+  if (::fstat(fds[0].fd(), &st) != 0) {
+    throwError("fstat failed");
+  }
+  // Mapping beyond the end of the memfd would fault on access.
+  if (static_cast<size_t>(st.st_size) < size) {
+    throw TTransportException(
+        TTransportException::CORRUPTED_DATA,
+        "Shared memory segment is too small");
+  }
+  void* segment = mapSegment(fds[0].fd(), size);
+  auto unmap = folly::makeGuard([&] { ::munmap(segment, size); });
+
+  uint8_t ack = 0;
+  if (::send(socket.fd(), &ack, 1, MSG_NOSIGNAL) != 1) {
+    throwError("Failed to answer the shared memory handshake");
+  }
+
+  auto sessionOptions = options;
+  sessionOptions.ringSize = hello.ringSize;
+  unmap.dismiss();
+  return UniquePtr(new ShmSession(
+      evb,
+      std::move(socket),
+      std::move(fds[1]),
+      std::move(fds[2]),
+      segment,
+      false,
+      sessionOptions));
+}
+
+ShmSession::ShmSession(
+    folly::EventBase* evb,
+    folly::File socket,
+    folly::File notify,
+    folly::File peerNotify,
+    void* segment,
+    bool client,
+    const Options& options)
+    : evb_(evb),
+      socket_(std::move(socket)),
+      notify_(std::move(notify)),
+      peerNotify_(std::move(peerNotify)),
+      segment_(segment),
+      segmentSize_(segmentSize(options.ringSize)),
+      notifyHandler_(*this, evb, notify_.fd()),
+      socketHandler_(*this, evb, socket_.fd()),
+      maxSpin_(options.maxSpin),
+      spin_(options.maxSpin) {
+  // The first ring carries the client's messages.
+  auto toServer = static_cast<uint8_t*>(segment_);
+  auto toClient = toServer + ShmRing::regionSize(options.ringSize);
+  tx_ = std::make_unique<ShmRing>(
+      client ? toServer : toClient, options.ringSize, false);
+  rx_ = std::make_unique<ShmRing>(
+      client ? toClient : toServer, options.ringSize, false);
+}
+
+ShmSession::~ShmSession() {
+  ::munmap(segment_, segmentSize_);
+}
+
+void ShmSession::destroy() {
+  callback_ = nullptr;
+  close();
+  folly::DelayedDestruction::destroy();
+}
+
+void ShmSession::setCallback(Callback* callback) {
+  DCHECK(evb_->isInEventBaseThread());
+  callback_ = callback;
+  if (closed_ || !callback_) {
+    return;
+  }
+  notifyHandler_.registerHandler(
+      folly::EventHandler::READ | folly::EventHandler::PERSIST);
+  socketHandler_.registerHandler(
+      folly::EventHandler::READ | folly::EventHandler::PERSIST);
+  // Messages may have arrived before the handler was registered.
+  schedulePoll();
+}
+
+void ShmSession::send(std::unique_ptr<folly::IOBuf> message) {
+  DCHECK(evb_->isInEventBaseThread());
+  if (closed_) {
+    return;
+  }
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  queue.append(std::move(message));
+  while (!queue.empty()) {
+    auto size = std::min(tx_->maxRecordSize(), queue.chainLength());
+    auto part = queue.split(size);
+    pending_.emplace_back(std::move(part), !queue.empty());
+  }
+  flush();
+}
+
+void ShmSession::close() {
+  if (closed_) {
+    return;
+  }
+  DestructorGuard dg(this);
+  closed_ = true;
+  notifyHandler_.unregisterHandler();
+  socketHandler_.unregisterHandler();
+  // The peer sees the end of the Unix socket.
+  ::shutdown(socket_.fd(), SHUT_RDWR);
+  pending_.clear();
+  if (auto callback = std::exchange(callback_, nullptr)) {
+    callback->sessionClosed();
+  }
+}
+
+void ShmSession::Handler::handlerReady(uint16_t) noexcept {
+  if (this == &session_.notifyHandler_) {
+    session_.onNotify();
+  } else {
+    session_.onSocketReadable();
+  }
+}
+
+void ShmSession::onNotify() {
+  uint64_t count;
+  if (::read(notify_.fd(), &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    PLOG(ERROR) << "Failed to read the shared memory eventfd";
+  }
+  poll();
+}
+
+void ShmSession::onSocketReadable() {
+  // The peer sends nothing after the handshake, so this is its end.
+  uint8_t byte;
+  auto n = ::recv(socket_.fd(), &byte, 1, 0);
+  if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return;
+  }
+  close();
+}
+
+void ShmSession::poll() {
+  DestructorGuard dg(this);
+  rx_->setConsumerWaiting(false);
+  size_t budget = kMaxMessagesPerPoll;
+  bool spun = false;
+  while (!closed_) {
+    flush();
+    budget -= drain(budget);
+    if (closed_) {
+      return;
+    }
+    if (budget == 0 || spun) {
+      // Let the other sessions and callbacks of the EventBase run, among
+      // them the responses to the requests just delivered, and carry on in
+      // the next loop iteration. The peer needs no notification meanwhile.
+      schedulePoll();
+      return;
+    }
+    if (spin()) {
+      spun = true;
+      continue;
+    }
+    // Sleep until the peer notifies, unless it added a message after the
+    // last check.
+    rx_->setConsumerWaiting(true);
+    if (rx_->empty()) {
+      return;
+    }
+    rx_->setConsumerWaiting(false);
+    spun = true;
+  }
+}
+
+void ShmSession::schedulePoll() {
+  if (pollScheduled_) {
+    return;
+  }
+  pollScheduled_ = true;
+  evb_->runInLoop([this, guard = DestructorGuard(this)] {
+    pollScheduled_ = false;
+    if (!closed_ && callback_) {
+      poll();
+    }
+  });
+}
+
+bool ShmSession::spin() {
+  auto deadline = std::chrono::steady_clock::now() + spin_;
+  while (rx_->empty()) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      spin_ = std::max(
+          spin_ / 2, std::min(maxSpin_, std::chrono::microseconds(1)));
+      return false;
+    }
+    folly::asm_volatile_pause();
+  }
+  spin_ = std::min(maxSpin_, spin_ * 2);
+  return true;
+}
+
+size_t ShmSession::drain(size_t maxMessages) {
+  size_t delivered = 0;
+  std::unique_ptr<folly::IOBuf> part;
+  bool more;
+  try {
+    while (!closed_ && callback_ && delivered < maxMessages &&
+           rx_->read(part, more)) {
+      partial_.append(std::move(part));
+      if (!more) {
+        ++delivered;
+        callback_->messageReceived(partial_.move());
+      }
+    }
+  } catch (const TTransportException& ex) {
+    LOG(ERROR) << "Closing shared memory session: " << ex.what();
+    close();
+    return delivered;
+  }
+  if (!closed_ && rx_->producerWaiting()) {
+    rx_->setProducerWaiting(false);
+    notifyPeer();
+  }
+  return delivered;
+}
+
+void ShmSession::flush() {
+  bool sent = false;
+  while (!pending_.empty()) {
+    auto& part = pending_.front();
+    if (!tx_->write(*part.first, part.second)) {
+      // Wait until the peer makes room, unless it just did.
+      tx_->setProducerWaiting(true);
+      if (!tx_->write(*part.first, part.second)) {
+        break;
+      }
+      tx_->setProducerWaiting(false);
+    }
+    pending_.pop_front();
+    sent = true;
+  }
+  if (sent && tx_->consumerWaiting()) {
+    notifyPeer();
+  }
+}
+
+void ShmSession::notifyPeer() {
+  uint64_t one = 1;
+  if (::write(peerNotify_.fd(), &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    PLOG(ERROR) << "Failed to write the shared memory eventfd";
+  }
+}
+
+} // namespace thrift
+} // namespace apache
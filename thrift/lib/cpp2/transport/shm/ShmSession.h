@@ -0,0 +1,166 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <folly/File.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/DelayedDestruction.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
+
+#include <thrift/lib/cpp2/transport/shm/ShmRing.h>
+
+namespace apache {
+namespace thrift {
+
+// A message pipe between two processes on the same host, made of a shared
+// memory ring per direction. Each side has an eventfd which the other side
+// writes to when it added a message while this side was asleep, or freed
+// room this side was waiting for. After it has handled the messages that
+// woke it up, a side keeps polling its ring for a while before it goes back
+// to sleep; the time adapts to how often that finds more messages.
+//
+// The two sides set up the session over a Unix socket, which passes the
+// memfd of the rings and the eventfds, and afterwards tells either side
+// when the other one is gone. The client seals the size of the memfd, and
+// the server refuses segments that aren't sealed.
+//
+// Linux only. All methods must be called from the EventBase thread.
+class ShmSession : public folly::DelayedDestruction {
+ public:
+  using UniquePtr =
+      std::unique_ptr<ShmSession, folly::DelayedDestruction::Destructor>;
+
+  struct Options {
+    // Size of each ring, a power of two. Larger messages are sent in parts.
+    size_t ringSize{1 << 20};
+    // Upper bound of the time spent polling for messages before sleeping.
+    std::chrono::microseconds maxSpin{50};
+  };
+
+  class Callback {
+   public:
+    virtual ~Callback() = default;
+
+    virtual void messageReceived(std::unique_ptr<folly::IOBuf> message) = 0;
+    // The session is closed, by either side.
+    virtual void sessionClosed() = 0;
+  };
+
+  // Creates the rings, and hands them to the ShmAcceptor listening on
+  // "path". Blocks until it has answered. Throws TTransportException.
+  static UniquePtr connect(
+      folly::EventBase* evb,
+      const std::string& path,
+      const Options& options);
+
+  // Completes the handshake of a connection accepted on a Unix socket,
+  // once the client's request is readable. Throws TTransportException.
+  static UniquePtr accept(
+      folly::EventBase* evb,
+      folly::File socket,
+      const Options& options);
+
+  // Starts delivering messages.
+  void setCallback(Callback* callback);
+
+  // Queues the message if the ring is full.
+  void send(std::unique_ptr<folly::IOBuf> message);
+
+  void close();
+
+  // Closes the session without calling back.
+  void destroy() override;
+
+  bool good() const {
+    return !closed_;
+  }
+
+  folly::EventBase* getEventBase() const {
+    return evb_;
+  }
+
+ protected:
+  ~ShmSession() override;
+
+ private:
+  class Handler : public folly::EventHandler {
+   public:
+    Handler(ShmSession& session, folly::EventBase* evb, int fd)
+        : folly::EventHandler(evb, fd), session_(session) {}
+
+    void handlerReady(uint16_t events) noexcept override;
+
+   private:
+    ShmSession& session_;
+  };
+
+  ShmSession(
+      folly::EventBase* evb,
+      folly::File socket,
+      folly::File notify,
+      folly::File peerNotify,
+      void* segment,
+      bool client,
+      const Options& options);
+
+  void onNotify();
+  void onSocketReadable();
+  // Flushes the queued messages and reads from the ring until it stays empty
+  // for the spin time. Delivers a bounded number of messages and spins at
+  // most once per call, then continues in the next loop iteration, so that
+  // a busy peer doesn't starve the rest of the EventBase.
+  void poll();
+  void schedulePoll();
+  // Waits up to the spin time for a message, and adapts the spin time to
+  // whether one arrived.
+  bool spin();
+  // Delivers up to maxMessages messages, and returns how many it did.
+  size_t drain(size_t maxMessages);
+  void flush();
+  void notifyPeer();
+
+  folly::EventBase* evb_;
+  folly::File socket_;
+  folly::File notify_;
+  folly::File peerNotify_;
+  void* segment_;
+  size_t segmentSize_;
+  std::unique_ptr<ShmRing> tx_;
+  std::unique_ptr<ShmRing> rx_;
+  Handler notifyHandler_;
+  Handler socketHandler_;
+  const std::chrono::microseconds maxSpin_;
+  std::chrono::microseconds spin_;
+
+  Callback* callback_{nullptr};
+  // Parts of a message not yet fully sent or received.
+  std::deque<std::pair<std::unique_ptr<folly::IOBuf>, bool>> pending_;
+  folly::IOBufQueue partial_{folly::IOBufQueue::cacheChainLength()};
+  bool closed_{false};
+  bool pollScheduled_{false};
+};
+
+} // namespace thrift
+} // namespace apache
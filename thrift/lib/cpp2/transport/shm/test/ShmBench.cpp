@@ -0,0 +1,143 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/portability/GFlags.h>
+
+#include <thrift/lib/cpp/async/TAsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <thrift/lib/cpp2/server/BaseThriftServer.h>
+#include <thrift/lib/cpp2/transport/core/ThriftClient.h>
+#include <thrift/lib/cpp2/transport/core/testutil/ServerConfigsMock.h>
+#include <thrift/lib/cpp2/transport/core/testutil/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/transport/shm/ShmAcceptor.h>
+#include <thrift/lib/cpp2/transport/shm/ShmClientConnection.h>
+#include <thrift/lib/cpp2/util/ScopedServerInterfaceThread.h>
+
+using namespace apache::thrift;
+using apache::thrift::async::TAsyncSocket;
+using testutil::testservice::TestServiceAsyncClient;
+using testutil::testservice::TestServiceSvIf;
+
+// Sequential echo requests, over TCP loopback with the Header transport and
+// over a shared memory session. The shared memory client hops to the IO
+// thread of its connection for every request, the TCP client sends from the
+// benchmark thread.
+DEFINE_int32(small_size, 16, "Payload size of the small requests");
+DEFINE_int32(large_size, 1 << 20, "Payload size of the large requests");
+
+namespace {
+class EchoHandler : public TestServiceSvIf {
+ public:
+  void hello(std::string& result, std::unique_ptr<std::string> name) override {
+    result = std::move(*name);
+  }
+};
+
+struct Servers {
+  Servers()
+      : handler(std::make_shared<EchoHandler>()),
+        tcp(handler),
+        shm(std::make_shared<ThriftServerAsyncProcessorFactory<EchoHandler>>(
+                handler),
+            serverConfigs,
+            path) {}
+
+  std::shared_ptr<EchoHandler> handler;
+  apache::thrift::server::ServerConfigsMock serverConfigs;
+  folly::test::TemporaryDirectory dir;
+  std::string path{(dir.path() / "shm.sock").string()};
+  ScopedServerInterfaceThread tcp;
+  ShmAcceptor shm;
+};
+
+Servers& getServers() {
+  static Servers servers;
+  return servers;
+}
+
+void runTcp(size_t iters, size_t size) {
+  folly::BenchmarkSuspender braces;
+  folly::EventBase eb;
+  TestServiceAsyncClient client(HeaderClientChannel::newChannel(
+      TAsyncSocket::newSocket(&eb, getServers().tcp.getAddress())));
+  std::string name(size, 'x');
+  std::string result;
+  client.sync_hello(result, name);
+
+  braces.dismissing([&] {
+    while (iters--) {
+      client.sync_hello(result, name);
+    }
+  });
+}
+
+void runShm(size_t iters, size_t size) {
+  folly::BenchmarkSuspender braces;
+  folly::ScopedEventBaseThread thread;
+  auto evb = thread.getEventBase();
+  std::unique_ptr<ClientConnectionIf> connection;
+  evb->runInEventBaseThreadAndWait([&] {
+    connection =
+        ShmClientConnection::newConnection(evb, getServers().path);
+  });
+  std::shared_ptr<ClientConnectionIf> shared(
+      connection.release(), [evb](ClientConnectionIf* conn) {
+        evb->runImmediatelyOrRunInEventBaseThreadAndWait(
+            [conn] { delete conn; });
+      });
+  auto thriftClient = ThriftClient::Ptr(new ThriftClient(std::move(shared)));
+  thriftClient->setProtocolId(apache::thrift::protocol::T_COMPACT_PROTOCOL);
+  TestServiceAsyncClient client(std::move(thriftClient));
+  std::string name(size, 'x');
+  std::string result;
+  client.sync_hello(result, name);
+
+  braces.dismissing([&] {
+    while (iters--) {
+      client.sync_hello(result, name);
+    }
+  });
+}
+} // namespace
+
+BENCHMARK(TcpSmall, iters) {
+  runTcp(iters, FLAGS_small_size);
+}
+
+BENCHMARK_RELATIVE(ShmSmall, iters) {
+  runShm(iters, FLAGS_small_size);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(TcpLarge, iters) {
+  runTcp(iters, FLAGS_large_size);
+}
+
+BENCHMARK_RELATIVE(ShmLarge, iters) {
+  runShm(iters, FLAGS_large_size);
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv, true);
+  getServers();
+  folly::runBenchmarks();
+  return 0;
+}
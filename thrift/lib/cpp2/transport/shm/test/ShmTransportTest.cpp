@@ -0,0 +1,370 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include <folly/portability/GTest.h>
+#include <folly/portability/Sockets.h>
+
+#include <folly/ScopeGuard.h>
+#include <folly/SocketAddress.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <thrift/lib/cpp/transport/TTransportException.h>
+#include <thrift/lib/cpp2/server/BaseThriftServer.h>
+#include <thrift/lib/cpp2/transport/core/ThriftClient.h>
+#include <thrift/lib/cpp2/transport/core/testutil/ServerConfigsMock.h>
+#include <thrift/lib/cpp2/transport/core/testutil/gen-cpp2/TestService.h>
+#include <thrift/lib/cpp2/transport/shm/ShmAcceptor.h>
+#include <thrift/lib/cpp2/transport/shm/ShmClientConnection.h>
+
+namespace apache {
+namespace thrift {
+
+using apache::thrift::transport::TTransportException;
+using testutil::testservice::TestServiceAsyncClient;
+using testutil::testservice::TestServiceSvIf;
+
+class EchoHandler : public TestServiceSvIf {
+ public:
+  int32_t sumTwoNumbers(int32_t x, int32_t y) override {
+    return x + y;
+  }
+
+  void hello(std::string& result, std::unique_ptr<std::string> name) override {
+    result = std::move(*name);
+  }
+};
+
+class ShmTransportTest : public testing::Test {
+ public:
+  void startServer() {
+    auto handler = std::make_shared<EchoHandler>();
+    acceptor = std::make_unique<ShmAcceptor>(
+        std::make_shared<ThriftServerAsyncProcessorFactory<EchoHandler>>(
+            handler),
+        serverConfigs,
+        path);
+  }
+
+  std::unique_ptr<TestServiceAsyncClient> newClient(
+      ShmSession::Options options = ShmSession::Options()) {
+    auto evb = clientThread.getEventBase();
+    std::unique_ptr<ClientConnectionIf> connection;
+    folly::exception_wrapper error;
+    evb->runInEventBaseThreadAndWait([&] {
+      try {
+        connection = ShmClientConnection::newConnection(evb, path, options);
+      } catch (const std::exception& ex) {
+        error = folly::exception_wrapper(std::current_exception(), ex);
+      }
+    });
+    if (error) {
+      error.throw_exception();
+    }
+    // The connection must be destroyed on its EventBase.
+    std::shared_ptr<ClientConnectionIf> shared(
+        connection.release(), [evb](ClientConnectionIf* conn) {
+          evb->runImmediatelyOrRunInEventBaseThreadAndWait(
+              [conn] { delete conn; });
+        });
+    auto client = ThriftClient::Ptr(new ThriftClient(std::move(shared)));
+    client->setProtocolId(apache::thrift::protocol::T_COMPACT_PROTOCOL);
+    return std::make_unique<TestServiceAsyncClient>(std::move(client));
+  }
+
+  apache::thrift::server::ServerConfigsMock serverConfigs;
+  folly::test::TemporaryDirectory dir;
+  std::string path{(dir.path() / "shm.sock").string()};
+  folly::ScopedEventBaseThread clientThread;
+  std::unique_ptr<ShmAcceptor> acceptor;
+};
+
+TEST_F(ShmTransportTest, RoundTrip) {
+  startServer();
+  auto client = newClient();
+  EXPECT_EQ(3, client->sync_sumTwoNumbers(1, 2));
+  std::string result;
+  client->sync_hello(result, "world");
+  EXPECT_EQ("world", result);
+}
+
+TEST_F(ShmTransportTest, MessageLargerThanRing) {
+  startServer();
+  ShmSession::Options options;
+  options.ringSize = 16 << 10;
+  auto client = newClient(options);
+
+  std::string name(3 << 20, 0);
+  for (size_t i = 0; i < name.size(); ++i) {
+    name[i] = 'a' + i % 26;
+  }
+  std::string result;
+  client->sync_hello(result, name);
+  EXPECT_EQ(name, result);
+}
+
+TEST_F(ShmTransportTest, FullRing) {
+  startServer();
+  ShmSession::Options options;
+  options.ringSize = 4096;
+  auto client = newClient(options);
+
+  std::vector<folly::Future<int32_t>> futures;
+  for (int i = 0; i < 1000; ++i) {
+    futures.push_back(client->future_sumTwoNumbers(i, 1));
+  }
+  auto results = folly::collectAll(futures).get();
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i + 1, results[i].value());
+  }
+}
+
+TEST_F(ShmTransportTest, ServerGone) {
+  startServer();
+  auto client = newClient();
+  EXPECT_EQ(3, client->sync_sumTwoNumbers(1, 2));
+  acceptor.reset();
+  EXPECT_THROW(client->sync_sumTwoNumbers(1, 2), TTransportException);
+}
+
+TEST_F(ShmTransportTest, NoAcceptor) {
+  EXPECT_THROW(newClient(), TTransportException);
+}
+
+namespace {
+folly::File listenAt(const std::string& path) {
+  auto address = folly::SocketAddress::makeFromPath(path);
+  sockaddr_storage addr;
+  address.getAddress(&addr);
+  folly::File listener(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0), true);
+  EXPECT_EQ(
+      0,
+      ::bind(
+          listener.fd(),
+          reinterpret_cast<sockaddr*>(&addr),
+          address.getActualSize()));
+  EXPECT_EQ(0, ::listen(listener.fd(), 1));
+  return listener;
+}
+
+// The client side of the handshake done by hand, by a client that keeps the
+// memfd of the rings. Mirrors Hello in ShmSession.cpp.
+struct RawClient {
+  static constexpr size_t kRingSize = 4096;
+
+  RawClient(const std::string& path, bool seal) {
+    auto address = folly::SocketAddress::makeFromPath(path);
+    sockaddr_storage addr;
+    address.getAddress(&addr);
+    socket =
+        folly::File(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0), true);
+    EXPECT_EQ(
+        0,
+        ::connect(
+            socket.fd(),
+            reinterpret_cast<sockaddr*>(&addr),
+            address.getActualSize()));
+
+    memfd = folly::File(
+        ::syscall(
+            SYS_memfd_create, "test", MFD_CLOEXEC | MFD_ALLOW_SEALING),
+        true);
+    EXPECT_EQ(0, ::ftruncate(memfd.fd(), size));
+    segment = ::mmap(
+        nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd.fd(), 0);
+    EXPECT_NE(MAP_FAILED, segment);
+    ShmRing toServer(segment, kRingSize, true);
+    ShmRing toClient(this->toClient(), kRingSize, true);
+    if (seal) {
+      EXPECT_EQ(
+          0,
+          ::fcntl(
+              memfd.fd(),
+              F_ADD_SEALS,
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+    }
+
+    struct {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t ringSize;
+    } hello{0x54534d31, 1, kRingSize};
+    folly::File serverNotify(::eventfd(0, EFD_CLOEXEC), true);
+    folly::File clientNotify(::eventfd(0, EFD_CLOEXEC), true);
+    int fds[] = {memfd.fd(), serverNotify.fd(), clientNotify.fd()};
+    iovec iov{&hello, sizeof(hello)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    EXPECT_EQ(ssize_t(sizeof(hello)), ::sendmsg(socket.fd(), &msg, 0));
+  }
+
+  ~RawClient() {
+    ::munmap(segment, size);
+  }
+
+  void* toClient() {
+    return static_cast<uint8_t*>(segment) + ShmRing::regionSize(kRingSize);
+  }
+
+  const size_t size{2 * ShmRing::regionSize(kRingSize)};
+  folly::File socket;
+  folly::File memfd;
+  void* segment{nullptr};
+};
+
+ShmSession::UniquePtr acceptOn(folly::EventBase* evb, int listener) {
+  folly::File accepted(::accept(listener, nullptr, nullptr), true);
+  ShmSession::UniquePtr session;
+  folly::exception_wrapper error;
+  evb->runInEventBaseThreadAndWait([&] {
+    try {
+      session =
+          ShmSession::accept(evb, std::move(accepted), ShmSession::Options());
+    } catch (const std::exception& ex) {
+      error = folly::exception_wrapper(std::current_exception(), ex);
+    }
+  });
+  if (error) {
+    error.throw_exception();
+  }
+  return session;
+}
+} // namespace
+
+TEST(ShmSessionTest, SegmentCannotBeResized) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "shm.sock").string();
+  auto listener = listenAt(path);
+  RawClient client(path, true);
+
+  folly::ScopedEventBaseThread serverThread;
+  auto evb = serverThread.getEventBase();
+  auto server = acceptOn(evb, listener.fd());
+  SCOPE_EXIT {
+    evb->runInEventBaseThreadAndWait([&] { server.reset(); });
+  };
+
+  // Would make the server fault on its next access to the rings.
+  EXPECT_EQ(-1, ::ftruncate(client.memfd.fd(), 0));
+  EXPECT_EQ(EPERM, errno);
+  EXPECT_EQ(-1, ::ftruncate(client.memfd.fd(), 2 * client.size));
+  EXPECT_EQ(-1, ::fcntl(client.memfd.fd(), F_ADD_SEALS, 0));
+
+  evb->runInEventBaseThreadAndWait(
+      [&] { server->send(folly::IOBuf::copyBuffer("x")); });
+  ShmRing toClient(client.toClient(), RawClient::kRingSize, false);
+  std::unique_ptr<folly::IOBuf> data;
+  bool more;
+  EXPECT_TRUE(toClient.read(data, more));
+}
+
+TEST(ShmSessionTest, UnsealedSegmentRefused) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "shm.sock").string();
+  auto listener = listenAt(path);
+  RawClient client(path, false);
+
+  folly::ScopedEventBaseThread serverThread;
+  try {
+    acceptOn(serverThread.getEventBase(), listener.fd());
+    ADD_FAILURE() << "Accepted an unsealed segment";
+  } catch (const TTransportException& ex) {
+    EXPECT_EQ(TTransportException::CORRUPTED_DATA, ex.getType());
+  }
+}
+
+TEST(ShmSessionTest, BusyPeerDoesNotStarveEventBase) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "shm.sock").string();
+  auto listener = listenAt(path);
+
+  folly::ScopedEventBaseThread serverThread;
+  folly::ScopedEventBaseThread clientThread;
+  auto serverEvb = serverThread.getEventBase();
+  auto clientEvb = clientThread.getEventBase();
+  ShmSession::UniquePtr server;
+  ShmSession::UniquePtr client;
+  std::thread connector([&] {
+    clientEvb->runInEventBaseThreadAndWait([&] {
+      client = ShmSession::connect(clientEvb, path, ShmSession::Options());
+    });
+  });
+  folly::File accepted(::accept(listener.fd(), nullptr, nullptr), true);
+  serverEvb->runInEventBaseThreadAndWait([&] {
+    server = ShmSession::accept(
+        serverEvb, std::move(accepted), ShmSession::Options());
+  });
+  connector.join();
+
+  // All the messages are in the ring before the server starts reading.
+  constexpr size_t kMessages = 1000;
+  clientEvb->runInEventBaseThreadAndWait([&] {
+    for (size_t i = 0; i < kMessages; ++i) {
+      client->send(folly::IOBuf::copyBuffer("x"));
+    }
+  });
+
+  struct Counter : ShmSession::Callback {
+    void messageReceived(std::unique_ptr<folly::IOBuf>) override {
+      ++received;
+    }
+    void sessionClosed() override {}
+
+    size_t received{0};
+  } counter;
+  size_t receivedBeforeOtherCallback = 0;
+  serverEvb->runInEventBaseThreadAndWait([&] {
+    server->setCallback(&counter);
+    serverEvb->runInEventBaseThread(
+        [&] { receivedBeforeOtherCallback = counter.received; });
+  });
+
+  size_t received = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (received < kMessages && std::chrono::steady_clock::now() < deadline) {
+    serverEvb->runInEventBaseThreadAndWait(
+        [&] { received = counter.received; });
+  }
+  EXPECT_EQ(kMessages, received);
+  EXPECT_GT(receivedBeforeOtherCallback, 0);
+  EXPECT_LT(receivedBeforeOtherCallback, kMessages);
+
+  serverEvb->runInEventBaseThreadAndWait([&] { server.reset(); });
+  clientEvb->runInEventBaseThreadAndWait([&] { client.reset(); });
+}
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/util/IOBufPool.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/Bits.h>
+#include <folly/ConstexprMath.h>
+#include <folly/Indestructible.h>
+#include <folly/Likely.h>
+
+DEFINE_bool(
+    thrift_iobuf_pool,
+    false,
+    "Allocate transport read buffers and serialized responses from "
+    "per-thread pools");
+
+namespace apache {
+namespace thrift {
+
+constexpr size_t IOBufPool::kMinPooledSize;
+constexpr size_t IOBufPool::kMaxPooledSize;
+constexpr size_t IOBufPool::kMaxCachedBytes;
+
+namespace {
+
+constexpr size_t kMinShift = folly::constexpr_log2(IOBufPool::kMinPooledSize);
+constexpr size_t kNumClasses =
+    folly::constexpr_log2(IOBufPool::kMaxPooledSize) - kMinShift + 1;
+
+size_t sizeClass(size_t size) {
+  size = std::max(size, IOBufPool::kMinPooledSize);
+  return folly::findLastSet(size - 1) - kMinShift;
+}
+
+size_t classSize(size_t sizeClass) {
+  return IOBufPool::kMinPooledSize << sizeClass;
+}
+
+size_t maxCached(size_t sizeClass) {
+  return IOBufPool::kMaxCachedBytes / classSize(sizeClass);
+}
+
+struct Pool;
+
+// Precedes the data of every pooled buffer, and is the IOBuf's userData.
+struct alignas(std::max_align_t) BufferHeader {
+  Pool* pool;
+  size_t sizeClass;
+};
+
+using FreeLists = std::array<std::vector<BufferHeader*>, kNumClasses>;
+
+struct Pool {
+  // Held by the owning thread, and by every buffer allocated from the pool.
+  std::atomic<size_t> refs{1};
+  FreeLists local;
+
+  std::mutex remoteMutex;
+  FreeLists remote;
+  bool orphaned{false};
+  std::atomic<bool> hasRemote{false};
+
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> remoteFrees{0};
+  std::atomic<uint64_t> oversized{0};
+
+  void release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+};
+
+void freeAll(FreeLists& lists) {
+  for (auto& list : lists) {
+    for (auto* header : list) {
+      std::free(header);
+    }
+    list.clear();
+  }
+}
+
+void addStats(IOBufPool::Stats& stats, const Pool& pool) {
+  stats.hits += pool.hits.load(std::memory_order_relaxed);
+  stats.misses += pool.misses.load(std::memory_order_relaxed);
+  stats.remoteFrees += pool.remoteFrees.load(std::memory_order_relaxed);
+  stats.oversized += pool.oversized.load(std::memory_order_relaxed);
+}
+
+// Live pools, and the stats of the ones whose thread has exited.
+struct Registry {
+  std::mutex mutex;
+  std::unordered_set<Pool*> pools;
+  IOBufPool::Stats retired;
+};
+
+Registry& registry() {
+  static folly::Indestructible<Registry> registry;
+  return *registry;
+}
+
+thread_local Pool* tlsPool{nullptr};
+// Set once the thread's pool is gone, for allocations made while the other
+// thread locals are destroyed.
+thread_local bool tlsExited{false};
+
+struct ThreadPool {
+  ThreadPool() : pool(new Pool) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.pools.insert(pool);
+  }
+
+  ~ThreadPool() {
+    tlsPool = nullptr;
+    tlsExited = true;
+    {
+      auto& r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.pools.erase(pool);
+      addStats(r.retired, *pool);
+    }
+    freeAll(pool->local);
+    {
+      // Buffers still out are freed to the allocator from now on.
+      std::lock_guard<std::mutex> lock(pool->remoteMutex);
+      pool->orphaned = true;
+      freeAll(pool->remote);
+    }
+    pool->release();
+  }
+
+  Pool* const pool;
+};
+
+Pool* localPool() {
+  if (LIKELY(tlsPool != nullptr) || tlsExited) {
+    return tlsPool;
+  }
+  static thread_local ThreadPool threadPool;
+  tlsPool = threadPool.pool;
+  return tlsPool;
+}
+
+void freeBuffer(void* /* buf */, void* userData) {
+  auto* header = static_cast<BufferHeader*>(userData);
+  auto* pool = header->pool;
+  auto cls = header->sizeClass;
+
+  if (pool == tlsPool) {
+    auto& list = pool->local[cls];
+    if (list.size() < maxCached(cls)) {
+      list.push_back(header);
+    } else {
+      std::free(header);
+    }
+  } else {
+    std::unique_lock<std::mutex> lock(pool->remoteMutex);
+    auto& list = pool->remote[cls];
+    if (!pool->orphaned && list.size() < maxCached(cls)) {
+      list.push_back(header);
+      pool->hasRemote.store(true, std::memory_order_release);
+    } else {
+      std::free(header);
+    }
+    lock.unlock();
+    pool->remoteFrees.fetch_add(1, std::memory_order_relaxed);
+  }
+  pool->release();
+}
+
+BufferHeader* takeCached(Pool& pool, size_t cls) {
+  auto& list = pool.local[cls];
+  if (list.empty() && pool.hasRemote.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(pool.remoteMutex);
+    pool.hasRemote.store(false, std::memory_order_relaxed);
+    for (size_t i = 0; i < kNumClasses; ++i) {
+      auto& from = pool.remote[i];
+      auto& to = pool.local[i];
+      while (!from.empty() && to.size() < maxCached(i)) {
+        to.push_back(from.back());
+        from.pop_back();
+      }
+      for (auto* header : from) {
+        std::free(header);
+      }
+      from.clear();
+    }
+  }
+  if (list.empty()) {
+    return nullptr;
+  }
+  auto* header = list.back();
+  list.pop_back();
+  return header;
+}
+
+} // namespace
+
+std::unique_ptr<folly::IOBuf> IOBufPool::allocate(size_t minCapacity) {
+  auto* pool = FLAGS_thrift_iobuf_pool ? localPool() : nullptr;
+  if (!pool || minCapacity > kMaxPooledSize) {
+    if (pool) {
+      pool->oversized.fetch_add(1, std::memory_order_relaxed);
+    }
+    return folly::IOBuf::create(minCapacity);
+  }
+
+  auto cls = sizeClass(minCapacity);
+  auto* header = takeCached(*pool, cls);
+  if (header) {
+    pool->hits.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    pool->misses.fetch_add(1, std::memory_order_relaxed);
+    header = static_cast<BufferHeader*>(
+        std::malloc(sizeof(BufferHeader) + classSize(cls)));
+    if (!header) {
+      throw std::bad_alloc();
+    }
+    header->pool = pool;
+    header->sizeClass = cls;
+  }
+  pool->refs.fetch_add(1, std::memory_order_relaxed);
+  return folly::IOBuf::takeOwnership(
+      header + 1, classSize(cls), 0, freeBuffer, header);
+}
+
+void IOBufPool::reserve(
+    folly::IOBufQueue& queue,
+    size_t minTailroom,
+    size_t newAllocationSize) {
+  const folly::IOBuf* head = queue.front();
+  if (head && head->prev()->tailroom() >= minTailroom &&
+      !head->prev()->isSharedOne()) {
+    return;
+  }
+  queue.append(allocate(std::max(minTailroom, newAllocationSize)));
+}
+
+IOBufPool::Stats IOBufPool::getStats() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto stats = r.retired;
+  for (auto* pool : r.pools) {
+    addStats(stats, *pool);
+  }
+  return stats;
+}
+
+} // namespace thrift
+} // namespace apache
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GFlags.h>
+
+DECLARE_bool(thrift_iobuf_pool);
+
+namespace apache {
+namespace thrift {
+
+/**
+ * Per-thread pools of IOBuf backing buffers, in power of two size classes
+ * from kMinPooledSize to kMaxPooledSize. Off unless --thrift_iobuf_pool is
+ * set; only the transport read buffers (header and rocket) and
+ * GeneratedAsyncProcessor::serializeResponse() allocate from it, so
+ * Serializer and the protocol writers are unaffected.
+ *
+ * A buffer comes from the pool of the thread that allocates it (i.e. of the
+ * IO thread for read buffers), and goes back to that pool when its last
+ * IOBuf is freed, from whichever thread that happens on. Buffers freed on
+ * other threads are handed back through a list guarded by the owner's
+ * mutex, which the owner picks up once its own list is empty.
+ *
+ * Costs: each of the 6 size classes keeps at most kMaxCachedBytes per
+ * thread, so a thread holds up to 6MB of idle buffers, and as much again in
+ * remote frees it has not picked up yet. A pooled buffer still needs an
+ * IOBuf and a SharedInfo from the allocator (takeOwnership()); the pool
+ * only saves the allocation of the data itself.
+ *
+ * Larger requests, and every request while the flag is off, go to the
+ * allocator as with IOBuf::create().
+ */
+class IOBufPool {
+ public:
+  static constexpr size_t kMinPooledSize = 2 * 1024;
+  static constexpr size_t kMaxPooledSize = 64 * 1024;
+  static constexpr size_t kMaxCachedBytes = 1024 * 1024;
+
+  // An empty IOBuf with at least minCapacity bytes of tailroom.
+  static std::unique_ptr<folly::IOBuf> allocate(size_t minCapacity);
+
+  // Appends an allocate(max(minTailroom, newAllocationSize)) buffer to the
+  // queue, unless its last buffer has minTailroom bytes available already.
+  // Call it before preallocate() or before handing the queue to a
+  // QueueAppender to have their first allocation come from the pool.
+  static void reserve(
+      folly::IOBufQueue& queue,
+      size_t minTailroom,
+      size_t newAllocationSize);
+
+  struct Stats {
+    // Allocations served from a pool, and pooled allocations which had to
+    // go to the allocator because the pool was empty.
+    uint64_t hits{0};
+    uint64_t misses{0};
+    // Pooled buffers freed on a thread other than their owner.
+    uint64_t remoteFrees{0};
+    // Allocations larger than kMaxPooledSize.
+    uint64_t oversized{0};
+
+    double hitRate() const {
+      return hits + misses == 0 ? 0 : double(hits) / (hits + misses);
+    }
+  };
+
+  // Totals over all threads, including those which have exited.
+  static Stats getStats();
+};
+
+} // namespace thrift
+} // namespace apache
@@ -17,6 +17,7 @@
 #include <Python.h>
 
 #include <stdint.h>
+#include <string.h>
 #include <type_traits>
 
 #include <thrift/lib/cpp2/protocol/BinaryProtocol.h>
@@ -45,6 +46,9 @@ using apache::thrift::CompactProtocolWriter;
 static PyTypeObject* BytesIOType;
 #endif
 
+// array.array, used for decoding with typed_arrays.
+static PyObject* ArrayType;
+
 // Stolen from cStringIO.c and also works for Python 3
 
 
@@ -138,6 +142,7 @@ typedef struct {
   PyObject* spec;
   bool isunion;
   bool forward_compatibility;
+  bool typed_arrays;
 } StructTypeArgs;
 
 typedef struct {
@@ -200,7 +205,8 @@ parse_map_args(MapTypeArgs* dest, PyObject* typeargs) {
 static bool parse_struct_args(
     StructTypeArgs* dest,
     PyObject* typeargs,
-    bool forward_compatibility = false) {
+    bool forward_compatibility = false,
+    bool typed_arrays = false) {
   if (PyList_Size(typeargs) != 3) {
     PyErr_SetString(PyExc_TypeError,
         "expecting list of size 3 for struct args");
@@ -211,6 +217,7 @@ static bool parse_struct_args(
   dest->spec = PyList_GET_ITEM(typeargs, 1);
   dest->isunion = (PyObject_IsTrue(PyList_GET_ITEM(typeargs, 2)) == 1);
   dest->forward_compatibility = forward_compatibility;
+  dest->typed_arrays = typed_arrays;
 
   return true;
 }
@@ -283,6 +290,260 @@ parse_pyfloat(PyObject *o, double *ret) {
   return true;
 }
 
+/**
+ * Lists of fixed-width numbers can be decoded into (and encoded from) an
+ * array.array instead of a list of Python objects. Returns the array
+ * typecode for the element type, or 0 if the type has no compact form.
+ */
+static char typed_array_code(TType type) {
+  static_assert(sizeof(int) == sizeof(int32_t), "'i' must be 32 bits");
+  switch (type) {
+    case TType::T_I08:
+      return 'b';
+    case TType::T_I16:
+      return 'h';
+    case TType::T_I32:
+      return 'i';
+    case TType::T_I64:
+#if PY_MAJOR_VERSION >= 3
+      return 'q';
+#else
+      // Python 2 arrays have no 'q'.
+      return sizeof(long) == sizeof(int64_t) ? 'l' : 0;
+#endif
+    case TType::T_DOUBLE:
+      return 'd';
+    case TType::T_FLOAT:
+      return 'f';
+    default:
+      return 0;
+  }
+}
+
+template <typename Reader>
+inline void read_typed(Reader* reader, int8_t& v) {
+  reader->readByte(v);
+}
+template <typename Reader>
+inline void read_typed(Reader* reader, int16_t& v) {
+  reader->readI16(v);
+}
+template <typename Reader>
+inline void read_typed(Reader* reader, int32_t& v) {
+  reader->readI32(v);
+}
+template <typename Reader>
+inline void read_typed(Reader* reader, int64_t& v) {
+  reader->readI64(v);
+}
+template <typename Reader>
+inline void read_typed(Reader* reader, double& v) {
+  reader->readDouble(v);
+}
+template <typename Reader>
+inline void read_typed(Reader* reader, float& v) {
+  reader->readFloat(v);
+}
+
+template <typename T, typename Reader>
+static PyObject* decode_typed_array_impl(
+    Reader* reader,
+    const char* typecode,
+    uint32_t len) {
+  // Size the array up front, as array(typecode, [0]) * len, and decode
+  // straight into its buffer.
+  PyObject* zero =
+      PyObject_CallFunction(ArrayType, (char*)"s[i]", typecode, 0);
+  if (!zero) {
+    return nullptr;
+  }
+  PyObject* array = PySequence_Repeat(zero, len);
+  Py_DECREF(zero);
+  if (!array) {
+    return nullptr;
+  }
+  auto guard = folly::makeGuard([&] { Py_DECREF(array); });
+
+#if PY_MAJOR_VERSION >= 3
+  Py_buffer view;
+  if (PyObject_GetBuffer(array, &view, PyBUF_WRITABLE) == -1) {
+    return nullptr;
+  }
+  SCOPE_EXIT {
+    PyBuffer_Release(&view);
+  };
+  char* out = static_cast<char*>(view.buf);
+#else
+  void* buf;
+  Py_ssize_t size;
+  if (PyObject_AsWriteBuffer(array, &buf, &size) == -1) {
+    return nullptr;
+  }
+  char* out = static_cast<char*>(buf);
+#endif
+  for (uint32_t i = 0; i < len; i++) {
+    T v;
+    read_typed(reader, v);
+    memcpy(out + i * sizeof(T), &v, sizeof(T));
+  }
+
+  guard.dismiss();
+  return array;
+}
+
+template <typename Reader>
+static PyObject*
+decode_typed_array(Reader* reader, TType type, char code, uint32_t len) {
+  const char typecode[] = {code, '\0'};
+  switch (type) {
+    case TType::T_I08:
+      return decode_typed_array_impl<int8_t>(reader, typecode, len);
+    case TType::T_I16:
+      return decode_typed_array_impl<int16_t>(reader, typecode, len);
+    case TType::T_I32:
+      return decode_typed_array_impl<int32_t>(reader, typecode, len);
+    case TType::T_I64:
+      return decode_typed_array_impl<int64_t>(reader, typecode, len);
+    case TType::T_DOUBLE:
+      return decode_typed_array_impl<double>(reader, typecode, len);
+    case TType::T_FLOAT:
+      return decode_typed_array_impl<float>(reader, typecode, len);
+    default:
+      PyErr_SetString(PyExc_TypeError, "Unexpected TType");
+      return nullptr;
+  }
+}
+
+#if PY_MAJOR_VERSION >= 3
+template <typename Writer>
+inline void write_typed(Writer* writer, int8_t v) {
+  writer->writeByte(v);
+}
+template <typename Writer>
+inline void write_typed(Writer* writer, int16_t v) {
+  writer->writeI16(v);
+}
+template <typename Writer>
+inline void write_typed(Writer* writer, int32_t v) {
+  writer->writeI32(v);
+}
+template <typename Writer>
+inline void write_typed(Writer* writer, int64_t v) {
+  writer->writeI64(v);
+}
+template <typename Writer>
+inline void write_typed(Writer* writer, double v) {
+  writer->writeDouble(v);
+}
+template <typename Writer>
+inline void write_typed(Writer* writer, float v) {
+  writer->writeFloat(v);
+}
+
+template <typename T, typename Writer>
+static void
+encode_typed_array_impl(Writer* writer, const Py_buffer& view) {
+  const char* in = static_cast<const char*>(view.buf);
+  for (Py_ssize_t i = 0; i < view.len; i += sizeof(T)) {
+    T v;
+    memcpy(&v, in + i, sizeof(T));
+    write_typed(writer, v);
+  }
+}
+
+static Py_ssize_t typed_array_width(char typecode) {
+  switch (typecode) {
+    case 'b':
+      return 1;
+    case 'h':
+      return 2;
+    case 'i':
+    case 'f':
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+static bool
+buffer_matches(const Py_buffer& view, char typecode, Py_ssize_t len) {
+  if (view.ndim != 1 || view.itemsize != typed_array_width(typecode) ||
+      view.len != len * view.itemsize || view.format == nullptr) {
+    return false;
+  }
+  // Only native byte order and alignment.
+  const char* format = view.format;
+  if (*format == '@') {
+    format++;
+  }
+  if (format[0] == '\0' || format[1] != '\0') {
+    return false;
+  }
+  if (typecode == 'd' || typecode == 'f') {
+    return format[0] == typecode;
+  }
+  // Any signed integer format of the right width, e.g. numpy's int64 is 'l'
+  // while array's is 'q'.
+  return strchr("bhilq", format[0]) != nullptr;
+}
+
+/**
+ * Writes the elements of a list straight from a buffer-protocol object
+ * (array.array, numpy arrays, memoryview) whose items already have the
+ * element type's width and format. Returns false, without an error set, if
+ * value has to go through the generic per-item path instead.
+ */
+template <typename Writer>
+static bool encode_typed_array(
+    Writer* writer,
+    PyObject* value,
+    TType type,
+    Py_ssize_t len) {
+  char typecode = typed_array_code(type);
+  if (!typecode || PyBytes_Check(value) || !PyObject_CheckBuffer(value)) {
+    return false;
+  }
+
+  Py_buffer view;
+  if (PyObject_GetBuffer(value, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) ==
+      -1) {
+    PyErr_Clear();
+    return false;
+  }
+  SCOPE_EXIT {
+    PyBuffer_Release(&view);
+  };
+
+  if (!buffer_matches(view, typecode, len)) {
+    return false;
+  }
+
+  switch (type) {
+    case TType::T_I08:
+      encode_typed_array_impl<int8_t>(writer, view);
+      break;
+    case TType::T_I16:
+      encode_typed_array_impl<int16_t>(writer, view);
+      break;
+    case TType::T_I32:
+      encode_typed_array_impl<int32_t>(writer, view);
+      break;
+    case TType::T_I64:
+      encode_typed_array_impl<int64_t>(writer, view);
+      break;
+    case TType::T_DOUBLE:
+      encode_typed_array_impl<double>(writer, view);
+      break;
+    case TType::T_FLOAT:
+      encode_typed_array_impl<float>(writer, view);
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+#endif
+
 /**
  * Main loop for reading a struct and serializing fields.
  */
@@ -413,6 +674,13 @@ static bool encode_impl(
       }
 
       writer->writeListBegin(parsedargs.element_type, (uint32_t)len);
+#if PY_MAJOR_VERSION >= 3
+      if (type == TType::T_LIST &&
+          encode_typed_array(writer, value, parsedargs.element_type, len)) {
+        writer->writeListEnd();
+        break;
+      }
+#endif
       iterator = PyObject_GetIter(value);
       if (iterator == nullptr) {
         return false;
@@ -813,6 +1081,18 @@ static PyObject* decode_val(
         return nullptr;
       }
 
+      if (type == TType::T_LIST && args->typed_arrays) {
+        char typecode = typed_array_code(parsedargs.element_type);
+        if (typecode) {
+          PyObject* ret = decode_typed_array(
+              reader, parsedargs.element_type, typecode, len);
+          if (ret) {
+            reader->readListEnd();
+          }
+          return ret;
+        }
+      }
+
       PyObject *ret = PyList_New(len);
       if (!ret) {
         return nullptr;
@@ -902,7 +1182,10 @@ static PyObject* decode_val(
       PyObject *ret;
 
       if (!parse_struct_args(
-              &parsedargs, typeargs, args->forward_compatibility)) {
+              &parsedargs,
+              typeargs,
+              args->forward_compatibility,
+              args->typed_arrays)) {
         return nullptr;
       }
 
@@ -1049,6 +1332,7 @@ decode(PyObject* /*self*/, PyObject *args, PyObject *kws) {
   int utf8strings = 0;
   int protoid = 0;
   int forward_compatibility = 0;
+  int typed_arrays = 0;
   StructTypeArgs parsedargs;
   DecodeBuffer input = {};
 
@@ -1058,23 +1342,26 @@ decode(PyObject* /*self*/, PyObject *args, PyObject *kws) {
                            (char*)"utf8strings",
                            (char*)"protoid",
                            (char*)"forward_compatibility",
+                           (char*)"typed_arrays",
                            nullptr};
 
   if (!PyArg_ParseTupleAndKeywords(
           args,
           kws,
-          "OOO|iii",
+          "OOO|iiii",
           kwlist,
           &dec_obj,
           &transport,
           &spec,
           &utf8strings,
           &protoid,
-          &forward_compatibility)) {
+          &forward_compatibility,
+          &typed_arrays)) {
     return nullptr;
   }
 
-  if (!parse_struct_args(&parsedargs, spec, forward_compatibility)) {
+  if (!parse_struct_args(
+          &parsedargs, spec, forward_compatibility, typed_arrays)) {
     return nullptr;
   }
 
@@ -1211,6 +1498,16 @@ initfastproto(void)
   INIT_INTERN_STRING(cstringio_refill);
 #undef INIT_INTERN_STRING
 
+  PyObject *arraymodule = PyImport_ImportModule("array");
+  if (arraymodule == nullptr) {
+    INITERROR;
+  }
+  ArrayType = PyObject_GetAttrString(arraymodule, "array");
+  Py_DECREF(arraymodule);
+  if (ArrayType == nullptr) {
+    INITERROR;
+  }
+
 #if PY_MAJOR_VERSION >= 3
   return module;
 #endif
@@ -13,7 +13,13 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <thread>
 
 #include <glog/logging.h>
 
@@ -194,6 +200,252 @@ private:
   object observer_;
 };
 
+// Aggregates server events in C++ and hands them to a Python observer in
+// one reportStats() call per interval, rather than taking the GIL for every
+// event. Counters and duration histograms are striped across threads and
+// updated with relaxed atomics; the flusher thread swaps them out.
+//
+// reportStats() gets a dict with the count of each event since the last
+// call, the last queuedRequests and activeRequests values, and for
+// readTime, processTime, writeTime and totalTime of completed calls a list
+// of (upper bound in microseconds, count) pairs for the non-empty
+// power-of-two buckets.
+class BatchedCppServerObserver : public TServerObserver {
+public:
+  BatchedCppServerObserver(
+      object serverObserver,
+      std::chrono::milliseconds interval,
+      uint32_t sampleRate)
+    : TServerObserver(sampleRate),
+      observer_(std::make_unique<object>(serverObserver)),
+      interval_(interval),
+      stripes_(new Stripe[kStripes]()),
+      flusher_([this] { run(); }) {}
+
+  // The last reference may be dropped with or without the GIL, e.g. by
+  // setObserver() from Python or by a server thread.
+  ~BatchedCppServerObserver() override {
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      stopping_ = true;
+    }
+    stopped_.notify_one();
+    if (holdsGil()) {
+      // The flusher may be waiting for the GIL.
+      PyThreadState* save_state = PyEval_SaveThread();
+      flusher_.join();
+      PyEval_RestoreThread(save_state);
+    } else {
+      flusher_.join();
+    }
+
+    if (!Py_IsInitialized()) {
+      // Too late to report anything, or to drop the reference.
+      observer_.release();
+      return;
+    }
+    // Report the events since the last interval.
+    flush();
+    PyGILState_STATE state = PyGILState_Ensure();
+    SCOPE_EXIT { PyGILState_Release(state); };
+    observer_.reset();
+  }
+
+  void connAccepted() override { count(kConnAccepted); }
+  void connDropped() override { count(kConnDropped); }
+  void connRejected() override { count(kConnRejected); }
+  void tlsError() override { count(kTlsError); }
+  void tlsComplete() override { count(kTlsComplete); }
+  void tlsFallback() override { count(kTlsFallback); }
+  void tlsResumption() override { count(kTlsResumption); }
+  void taskKilled() override { count(kTaskKilled); }
+  void taskTimeout() override { count(kTaskTimeout); }
+  void serverOverloaded() override { count(kServerOverloaded); }
+  void receivedRequest() override { count(kReceivedRequest); }
+  void queuedRequests(int32_t n) override {
+    queuedRequests_.store(n, std::memory_order_relaxed);
+  }
+  void queueTimeout() override { count(kQueueTimeout); }
+  void sentReply() override { count(kSentReply); }
+  void activeRequests(int32_t n) override {
+    activeRequests_.store(n, std::memory_order_relaxed);
+  }
+  void callCompleted(const CallTimestamps& runtimes) override {
+    auto& stripe = this->stripe();
+    stripe.counters[kCallCompleted].fetch_add(1, std::memory_order_relaxed);
+    record(stripe, kReadTime, runtimes.readBegin, runtimes.readEnd);
+    record(stripe, kProcessTime, runtimes.processBegin, runtimes.processEnd);
+    record(stripe, kWriteTime, runtimes.writeBegin, runtimes.writeEnd);
+    record(stripe, kTotalTime, runtimes.readBegin, runtimes.writeEnd);
+  }
+
+private:
+  enum Counter {
+    kConnAccepted,
+    kConnDropped,
+    kConnRejected,
+    kTlsError,
+    kTlsComplete,
+    kTlsFallback,
+    kTlsResumption,
+    kTaskKilled,
+    kTaskTimeout,
+    kServerOverloaded,
+    kReceivedRequest,
+    kQueueTimeout,
+    kSentReply,
+    kCallCompleted,
+    kNumCounters,
+  };
+
+  enum Time {
+    kReadTime,
+    kProcessTime,
+    kWriteTime,
+    kTotalTime,
+    kNumTimes,
+  };
+
+  static constexpr size_t kStripes = 16;
+  // Bucket i counts durations below 2^i microseconds.
+  static constexpr size_t kBuckets = 32;
+
+  struct Stripe {
+    std::array<std::atomic<uint64_t>, kNumCounters> counters{};
+    std::array<std::array<std::atomic<uint64_t>, kBuckets>, kNumTimes>
+        histograms{};
+  };
+
+  struct Snapshot {
+    std::array<uint64_t, kNumCounters> counters{};
+    std::array<std::array<uint64_t, kBuckets>, kNumTimes> histograms{};
+  };
+
+  Stripe& stripe() {
+    static std::atomic<size_t> nextStripe{0};
+    thread_local size_t index =
+        nextStripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    return stripes_[index];
+  }
+
+  void count(Counter counter) {
+    stripe().counters[counter].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static bool holdsGil() {
+#if PY_MAJOR_VERSION == 2
+    auto* tstate = PyGILState_GetThisThreadState();
+    return tstate != nullptr && tstate == _PyThreadState_Current;
+#else
+    return PyGILState_Check();
+#endif
+  }
+
+  static void record(Stripe& stripe, Time time, uint64_t begin, uint64_t end) {
+    if (begin == 0 || end < begin) {
+      return;
+    }
+    size_t bucket = 0;
+    for (auto us = end - begin; us != 0 && bucket < kBuckets - 1; us >>= 1) {
+      ++bucket;
+    }
+    stripe.histograms[time][bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopped_.wait_for(lock, interval_, [this] { return stopping_; })) {
+      lock.unlock();
+      flush();
+      lock.lock();
+    }
+  }
+
+  Snapshot collect() {
+    Snapshot snapshot;
+    for (size_t s = 0; s < kStripes; ++s) {
+      auto& stripe = stripes_[s];
+      for (size_t i = 0; i < kNumCounters; ++i) {
+        snapshot.counters[i] +=
+            stripe.counters[i].exchange(0, std::memory_order_relaxed);
+      }
+      for (size_t t = 0; t < kNumTimes; ++t) {
+        for (size_t b = 0; b < kBuckets; ++b) {
+          snapshot.histograms[t][b] +=
+              stripe.histograms[t][b].exchange(0, std::memory_order_relaxed);
+        }
+      }
+    }
+    return snapshot;
+  }
+
+  void flush() {
+    static const char* const kCounterNames[kNumCounters] = {
+        "connAccepted",
+        "connDropped",
+        "connRejected",
+        "tlsError",
+        "tlsComplete",
+        "tlsFallback",
+        "tlsResumption",
+        "taskKilled",
+        "taskTimeout",
+        "serverOverloaded",
+        "receivedRequest",
+        "queueTimeout",
+        "sentReply",
+        "callCompleted",
+    };
+    static const char* const kTimeNames[kNumTimes] = {
+        "readTime", "processTime", "writeTime", "totalTime"};
+
+    auto snapshot = collect();
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    SCOPE_EXIT { PyGILState_Release(state); };
+
+    if (!PyObject_HasAttrString(observer_->ptr(), "reportStats")) {
+      return;
+    }
+
+    try {
+      dict stats;
+      for (size_t i = 0; i < kNumCounters; ++i) {
+        stats[kCounterNames[i]] = snapshot.counters[i];
+      }
+      stats["queuedRequests"] = queuedRequests_.load(std::memory_order_relaxed);
+      stats["activeRequests"] = activeRequests_.load(std::memory_order_relaxed);
+      for (size_t t = 0; t < kNumTimes; ++t) {
+        list buckets;
+        for (size_t b = 0; b < kBuckets; ++b) {
+          if (snapshot.histograms[t][b] != 0) {
+            buckets.append(
+                make_tuple(uint64_t(1) << b, snapshot.histograms[t][b]));
+          }
+        }
+        stats[kTimeNames[t]] = buckets;
+      }
+      (void)observer_->attr("reportStats")(stats);
+    } catch (const error_already_set&) {
+      // see CppServerObserver::call()
+      PyErr_Print();
+    }
+  }
+
+  // Only released with the GIL held, see the destructor.
+  std::unique_ptr<object> observer_;
+  const std::chrono::milliseconds interval_;
+  std::unique_ptr<Stripe[]> stripes_;
+  std::atomic<int32_t> queuedRequests_{0};
+  std::atomic<int32_t> activeRequests_{0};
+
+  std::mutex mutex_;
+  std::condition_variable stopped_;
+  bool stopping_{false};
+  // Started last, once everything it uses is initialized.
+  std::thread flusher_;
+};
+
 class PythonAsyncProcessor : public AsyncProcessor {
 public:
   explicit PythonAsyncProcessor(std::shared_ptr<object> adapter)
@@ -485,6 +737,22 @@ public:
     setObserver(std::make_shared<CppServerObserver>(observer));
   }
 
+  void setBatchedObserver(
+      object observer,
+      int intervalMs,
+      uint32_t sampleRate) {
+    setObserver(std::make_shared<BatchedCppServerObserver>(
+        observer, std::chrono::milliseconds(intervalMs), sampleRate));
+  }
+
+  // Lets the Python processor adapter report the calls it times to the
+  // current observer without going through Python.
+  void recordCallCompleted(const TServerObserver::CallTimestamps& timestamps) {
+    if (const auto& observer = getObserver()) {
+      observer->callCompleted(timestamps);
+    }
+  }
+
   object getAddress() {
     return makePythonAddress(ThriftServer::getAddress());
   }
@@ -720,6 +988,11 @@ BOOST_PYTHON_MODULE(CppServerWrapper) {
           static_cast<void (CppServerWrapper::*)(std::string const&, uint16_t)>(
               &CppServerWrapper::setAddress))
       .def("setObserver", &CppServerWrapper::setObserverFromPython)
+      .def(
+          "setBatchedObserver",
+          &CppServerWrapper::setBatchedObserver,
+          (arg("observer"), arg("intervalMs") = 1000, arg("sampleRate") = 0))
+      .def("recordCallCompleted", &CppServerWrapper::recordCallCompleted)
       .def("setIdleTimeout", &CppServerWrapper::setIdleTimeout)
       .def("setTaskExpireTime", &CppServerWrapper::setTaskExpireTime)
       .def("getAddress", &CppServerWrapper::getAddress)
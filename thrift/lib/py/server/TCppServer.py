@@ -6,6 +6,7 @@ from __future__ import unicode_literals
 import sys
 import threading
 import traceback
+import weakref
 
 from thrift.protocol.THeaderProtocol import THeaderProtocol
 from thrift.server.TServer import TServer, TConnectionContext
@@ -165,6 +166,19 @@ class _ProcessorAdapter(object):
             return TPriority.NORMAL
 
 
+class _BatchedCallRecorder(object):
+    """Reports the calls timed by _ProcessorAdapter to the server's batched
+    observer, which aggregates them in C++."""
+
+    def __init__(self, server):
+        self.server = weakref.ref(server)
+
+    def callCompleted(self, timestamps):
+        server = self.server()
+        if server is not None:
+            server.recordCallCompleted(timestamps)
+
+
 class TSSLConfig(object):
     def __init__(self):
         self.cert_path = ''
@@ -233,6 +247,16 @@ class TCppServer(CppServerWrapper, TServer):
         self.processorAdapter.setObserver(observer)
         CppServerWrapper.setObserver(self, observer)
 
+    def setBatchedObserver(self, observer, interval_ms=1000, sample_rate=0):
+        """Like setObserver(), but events are aggregated in C++ and delivered
+        every interval_ms through one observer.reportStats(stats) call, so
+        request threads don't contend for the GIL. See
+        BatchedCppServerObserver in CppServerWrapper.cpp for the contents of
+        stats."""
+        self.processorAdapter.setObserver(_BatchedCallRecorder(self))
+        CppServerWrapper.setBatchedObserver(
+            self, observer, interval_ms, sample_rate)
+
     def setServerEventHandler(self, handler):
         TServer.setServerEventHandler(self, handler)
         handler.CONTEXT_DATA = CppContextData
@@ -5,7 +5,7 @@ from folly cimport (
     cFollyTry
 )
 from libc.stdint cimport uint16_t, uint32_t, int64_t
-from libcpp.memory cimport shared_ptr
+from libcpp.memory cimport shared_ptr, unique_ptr
 from libcpp.string cimport string
 from libcpp.typeinfo cimport type_info
 from libcpp.map cimport map
@@ -70,16 +70,26 @@ cdef extern from "thrift/lib/py3/client.h" namespace "thrift::py3":
     cdef void destroyInEventBaseThread(cRequestChannel_ptr)
     cdef shared_ptr[U] makeClientWrapper[T, U](cRequestChannel_ptr channel)
 
+cdef extern from "thrift/lib/py3/clientcallbacks.h" namespace "thrift::py3":
+    cdef cppclass cCompletionQueue "thrift::py3::CompletionQueue"(cFollyExecutor):
+        int fd()
+        void drain()
+
 cdef extern from "<utility>" namespace "std" nogil:
     cdef cRequestChannel_ptr move(cRequestChannel_ptr)
     cdef string move_string "std::move"(string)
 
+cdef class CompletionQueue:
+    cdef unique_ptr[cCompletionQueue] _cpp_obj
+
 cdef class Client:
     cdef object __weakref__
     cdef object _context_entered
     cdef object _connect_future
     cdef object _deferred_headers
     cdef cFollyExecutor* _executor
+    # Keeps the queue behind _executor alive.
+    cdef object _completion_queue
     cdef inline _check_connect_future(self):
         if not self._connect_future.done():
             # This is actually using the import in the generated client
@@ -5,14 +5,15 @@ from libcpp.string cimport string
 from cython.operator cimport dereference as deref
 from folly.futures cimport bridgeFutureWith
 from folly cimport cFollyTry, cFollyPromise
-from folly.executor cimport get_executor
 from cpython.ref cimport PyObject
 from libcpp cimport nullptr
 import asyncio
 import os
 from socket import SocketKind
+import weakref
 
 cdef object proxy_factory = None
+cdef object completion_queues = weakref.WeakKeyDictionary()
 
 
 cpdef object get_proxy_factory():
@@ -24,13 +25,39 @@ def install_proxy_factory(factory):
     proxy_factory = factory
 
 
+@cython.auto_pickle(False)
+cdef class CompletionQueue:
+    """
+    Delivers the results of client calls to an asyncio loop in batches,
+    see thrift::py3::CompletionQueue.
+    """
+    def __cinit__(CompletionQueue self, loop):
+        self._cpp_obj.reset(new cCompletionQueue())
+        # The queue must not refer to the loop, which completion_queues
+        # only holds weakly.
+        loop.add_reader(deref(self._cpp_obj).fd(), self._drain)
+
+    def _drain(CompletionQueue self):
+        deref(self._cpp_obj).drain()
+
+
+cdef CompletionQueue get_completion_queue():
+    loop = asyncio.get_event_loop()
+    queue = completion_queues.get(loop)
+    if queue is None:
+        queue = completion_queues[loop] = CompletionQueue(loop)
+    return queue
+
+
 @cython.auto_pickle(False)
 cdef class Client:
     """
     Base class for all thrift clients
     """
     def __cinit__(Client self):
-        self._executor = get_executor()
+        cdef CompletionQueue queue = get_completion_queue()
+        self._completion_queue = queue
+        self._executor = queue._cpp_obj.get()
 
     cdef const type_info* _typeid(self):
         return NULL
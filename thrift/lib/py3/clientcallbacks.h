@@ -14,11 +14,91 @@
  * limitations under the License.
  */
 #pragma once
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <vector>
+
+#include <folly/Exception.h>
+#include <folly/ExceptionString.h>
+#include <folly/Executor.h>
+#include <folly/FileUtil.h>
+#include <glog/logging.h>
 #include <thrift/lib/cpp2/async/FutureRequest.h>
 #include <thrift/lib/cpp2/async/RequestChannel.h>
 
 namespace thrift {
 namespace py3 {
+
+/**
+ * Runs the continuations of client calls on an asyncio loop in batches.
+ *
+ * add() is called by whichever thread completes a call, usually the IO
+ * thread, and only signals the eventfd if the queue was empty. The loop
+ * watches fd() and calls drain() with the GIL held, which runs everything
+ * queued so far. A burst of completions thus costs one loop wakeup and one
+ * GIL acquisition.
+ */
+class CompletionQueue : public folly::Executor {
+ public:
+  CompletionQueue() : fd_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    folly::checkUnixError(fd_, "eventfd");
+  }
+
+  ~CompletionQueue() override {
+    ::close(fd_);
+  }
+
+  int fd() const {
+    return fd_;
+  }
+
+  void add(folly::Func func) override {
+    bool wasEmpty;
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      wasEmpty = pending_.empty();
+      pending_.push_back(std::move(func));
+    }
+    if (wasEmpty) {
+      uint64_t one = 1;
+      folly::writeNoInt(fd_, &one, sizeof(one));
+    }
+  }
+
+  // Only called on the loop thread.
+  void drain() {
+    // Reset the eventfd before taking the batch, so that a completion added
+    // meanwhile signals it again.
+    uint64_t signals;
+    folly::readNoInt(fd_, &signals, sizeof(signals));
+    {
+      std::lock_guard<std::mutex> g(mutex_);
+      draining_.swap(pending_);
+    }
+    // Continuations scheduled by futures already complete their own future
+    // with whatever they throw, so anything caught here has no future to
+    // fail. It must not unwind into the loop either.
+    for (auto& func : draining_) {
+      try {
+        func();
+      } catch (...) {
+        LOG(ERROR) << "Exception in client completion: "
+                   << folly::exceptionStr(std::current_exception());
+      }
+    }
+    draining_.clear();
+  }
+
+ private:
+  const int fd_;
+  std::mutex mutex_;
+  std::vector<folly::Func> pending_;
+  // Kept to reuse its capacity.
+  std::vector<folly::Func> draining_;
+};
+
 template <typename Result>
 class FutureCallback : public apache::thrift::FutureCallbackBase<Result> {
  private:
@@ -27,14 +27,11 @@
 #include <thrift/lib/cpp2/async/HTTPClientChannel.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 #include <thrift/lib/cpp2/async/RequestChannel.h>
+#include <thrift/lib/cpp2/security/KTLS.h>
 #include <thrift/perf/cpp/ClientLoadConfig.h>
 
 #include <gflags/gflags.h>
 
-#ifdef HAVE_FB_KTLS
-#include <openssl/ssl_fb.h>
-#endif
-
 #include <queue>
 
 DECLARE_bool(enable_ktls);
@@ -179,26 +176,19 @@ LoadTestClientPtr AsyncClientWorker2::createConnection() {
       session_.reset(sslSocket->getSSLSession());
     }
 
-#ifdef HAVE_FB_KTLS
     if (FLAGS_enable_ktls) {
-        SSL* s = const_cast<SSL*>(sslSocket->getSSL());
-        int rc = SSL_fb_configure_ktls(s);
-        if (rc != 1) {
-            LOG(ERROR) << "SSL_fb_configure_ktls failure in createConnection(). return code" << rc;
-        } else {
-            auto evb = sslSocket->getEventBase();
-            auto zc = sslSocket->getZeroCopyBufId();
-            auto fd = sslSocket->detachFd();
-            socket.reset(new TAsyncSocket(folly::AsyncSocket::UniquePtr(
-                new folly::AsyncSocket(evb, fd, zc))));
-            LOG_EVERY_N(INFO, 10000) << "(sampled) successfully configured ktls on connection";
-        }
+      socket = KTLS::offloadClient(sslSocket);
+      if (socket == sslSocket) {
+        LOG_EVERY_N(WARNING, 10000)
+            << "(sampled) kTLS not configured, using userspace TLS";
+      } else if (!socket) {
+        // Closed by the failed offload; its requests fail like those of
+        // any dropped connection.
+        socket = std::move(sslSocket);
+      }
     } else {
-#endif
-    socket = std::move(sslSocket);
-#ifdef HAVE_FB_KTLS
+      socket = std::move(sslSocket);
     }
-#endif
   } else {
     socket = TAsyncSocket::newSocket(&eb_, *config->getAddress(), kTimeout);
   }
@@ -71,7 +71,10 @@ DEFINE_string(ecc_curve, "prime256v1",
     "The ECC curve to use for EC handshakes");
 DEFINE_bool(enable_tfo, true, "Enable TFO");
 DEFINE_int32(tfo_queue_size, 1000, "TFO queue size");
-DEFINE_bool(enable_ktls, false, "(experimental) enable kTLS support");
+DEFINE_bool(
+    enable_ktls,
+    false,
+    "(experimental) offload TLS 1.2 AES-GCM connections to the kernel");
 
 void setTunables(ThriftServer* server) {
   if (FLAGS_idle_timeout > 0) {
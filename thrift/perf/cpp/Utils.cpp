@@ -3,6 +3,7 @@
 #include <sys/utsname.h>
 #include <folly/Conv.h>
 #include <folly/String.h>
+#include <cstring>
 #include <fstream>
 #include <string>
 
@@ -53,7 +54,7 @@ void verify_ktls_compatibility() {
   while (f.good()) {
     char buf[64];
     f.getline(buf, sizeof(buf));
-    if (std::memcmp(buf, "tls", 3)) {
+    if (std::strncmp(buf, "tls ", 4) == 0) {
         found = true;
         break;
     }
@@ -1,7 +1,6 @@
 #pragma once
 
 namespace loadgen_utils {
-#ifdef HAVE_FB_KTLS
-    void verify_ktls_compatibility();
-#endif
+// Warns if the running kernel can't offload TLS to kTLS.
+void verify_ktls_compatibility();
 }
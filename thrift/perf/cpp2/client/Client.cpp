@@ -47,9 +47,15 @@ DEFINE_int32(timeout_weight, 0, "Test for timeout functionality");
 DEFINE_int32(download_weight, 0, "Test for download functionality");
 DEFINE_int32(upload_weight, 0, "Test for upload functionality");
 DEFINE_int32(stream_weight, 0, "Test stream download functionality");
+DEFINE_int32(publisher_weight, 0, "Test StreamPublisher download");
+DEFINE_int32(
+    batched_publisher_weight,
+    0,
+    "Test BatchedStreamPublisher download");
 
 DEFINE_uint32(chunk_size, 1024, "Number of bytes per chunk");
 DEFINE_uint32(batch_size, 16, "Flow control batch size");
+DEFINE_int32(publisher_count, 100000, "Elements per publisher stream");
 
 /*
  * This starts num_clients threads with a unique client in each thread.
@@ -85,7 +91,9 @@ int main(int argc, char** argv) {
                                           FLAGS_timeout_weight,
                                           FLAGS_download_weight,
                                           FLAGS_upload_weight,
-                                          FLAGS_stream_weight};
+                                          FLAGS_stream_weight,
+                                          FLAGS_publisher_weight,
+                                          FLAGS_batched_publisher_weight};
       int32_t sum = std::accumulate(weights.begin(), weights.end(), 0);
       if (sum == 0) {
         weights[0] = 1;
@@ -27,4 +27,9 @@ service StreamBenchmark extends Api.Benchmark {
   void upload(1: ApiBase.Chunk2 chunk);
 
   stream ApiBase.Chunk2 streamDownload();
+
+  // Pushes `count` chunks through a StreamPublisher (or a
+  // BatchedStreamPublisher when `batched` is set). Each chunk header carries
+  // the server's steady_clock time at publish in nanoseconds.
+  stream ApiBase.Chunk2 publisherDownload(1: bool batched, 2: i32 count);
 }
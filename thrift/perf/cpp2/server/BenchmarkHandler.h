@@ -16,8 +16,14 @@
 
 #pragma once
 
+#include <list>
+#include <mutex>
+#include <thread>
+
 #include <folly/system/ThreadName.h>
 #include <rsocket/internal/ScheduledSubscriber.h>
+#include <thrift/lib/cpp2/async/BatchedStreamPublisher.h>
+#include <thrift/lib/cpp2/async/StreamPublisher.h>
 #include <thrift/lib/cpp2/transport/rsocket/YarplStreamImpl.h>
 #include <thrift/perf/cpp2/if/gen-cpp2/StreamBenchmark.h>
 #include <thrift/perf/cpp2/util/QPSStats.h>
@@ -29,10 +35,12 @@ namespace facebook {
 namespace thrift {
 namespace benchmarks {
 
+using apache::thrift::BatchedStreamPublisher;
 using apache::thrift::HandlerCallback;
 using apache::thrift::HandlerCallbackBase;
 using apache::thrift::SemiStream;
 using apache::thrift::Stream;
+using apache::thrift::StreamPublisher;
 using apache::thrift::toStream;
 
 class BenchmarkHandler : virtual public StreamBenchmarkSvIf {
@@ -45,6 +53,7 @@ class BenchmarkHandler : virtual public StreamBenchmarkSvIf {
     stats->registerCounter(kUpload_);
     stats_->registerCounter(ks_Download_);
     stats_->registerCounter(ks_Upload_);
+    stats_->registerCounter(ks_Publish_);
 
     chunk_.data.unshare();
     chunk_.data.reserve(0, FLAGS_chunk_size);
@@ -57,6 +66,13 @@ class BenchmarkHandler : virtual public StreamBenchmarkSvIf {
     chunk_.data.append(FLAGS_chunk_size);
   }
 
+  ~BenchmarkHandler() override {
+    std::lock_guard<std::mutex> lock(publishersMutex_);
+    for (auto& publisher : publishers_) {
+      publisher.thread.join();
+    }
+  }
+
   void async_eb_noop(std::unique_ptr<HandlerCallback<void>> callback) override {
     stats_->add(kNoop_);
     callback->done();
@@ -144,7 +160,59 @@ class BenchmarkHandler : virtual public StreamBenchmarkSvIf {
         folly::EventBaseManager::get()->getEventBase());
   }
 
+  Stream<Chunk2> publisherDownload(bool batched, int32_t count) override {
+    auto evb = folly::EventBaseManager::get()->getEventBase();
+    folly::Executor::KeepAlive<folly::SequencedExecutor> executor =
+        folly::getKeepAliveToken(evb);
+    if (batched) {
+      auto streamAndPublisher =
+          BatchedStreamPublisher<Chunk2>::create(std::move(executor), [] {});
+      publish(std::move(streamAndPublisher.second), count);
+      return std::move(streamAndPublisher.first);
+    }
+    auto streamAndPublisher =
+        StreamPublisher<Chunk2>::create(std::move(executor), [] {});
+    publish(std::move(streamAndPublisher.second), count);
+    return std::move(streamAndPublisher.first);
+  }
+
  private:
+  struct PublisherThread {
+    std::thread thread;
+    std::atomic<bool> done{false};
+  };
+
+  // Every publisher runs on its own thread, joined once it is done (by the
+  // next publish() call) or when the handler is destroyed.
+  template <typename Publisher>
+  void publish(Publisher publisher, int32_t count) {
+    std::lock_guard<std::mutex> lock(publishersMutex_);
+    for (auto it = publishers_.begin(); it != publishers_.end();) {
+      if (it->done.load()) {
+        it->thread.join();
+        it = publishers_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    publishers_.emplace_back();
+    auto& entry = publishers_.back();
+    entry.thread = std::thread(
+        [this, count, publisher = std::move(publisher), &entry]() mutable {
+          for (int32_t i = 0; i < count; ++i) {
+            auto chunk = chunk_;
+            auto now =
+                std::chrono::steady_clock::now().time_since_epoch().count();
+            chunk.header.assign(
+                reinterpret_cast<const char*>(&now), sizeof(now));
+            publisher.next(std::move(chunk));
+            stats_->add(ks_Publish_);
+          }
+          std::move(publisher).complete();
+          entry.done = true;
+        });
+  }
+
   QPSStats* stats_;
   std::string kNoop_ = "noop";
   std::string kSum_ = "sum";
@@ -153,7 +221,10 @@ class BenchmarkHandler : virtual public StreamBenchmarkSvIf {
   std::string kUpload_ = "upload";
   std::string ks_Download_ = "s_download";
   std::string ks_Upload_ = "s_upload";
+  std::string ks_Publish_ = "s_publish";
   Chunk2 chunk_;
+  std::mutex publishersMutex_;
+  std::list<PublisherThread> publishers_;
 };
 
 } // namespace benchmarks
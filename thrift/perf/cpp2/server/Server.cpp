@@ -17,12 +17,14 @@
 
 #include <folly/init/Init.h>
 #include <folly/portability/GFlags.h>
+#include <folly/portability/SysResource.h>
 
 #include <proxygen/httpserver/HTTPServerOptions.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 #include <thrift/lib/cpp2/server/admission_strategy/GlobalAdmissionStrategy.h>
 #include <thrift/lib/cpp2/transport/http2/common/HTTP2RoutingHandler.h>
 #include <thrift/lib/cpp2/transport/rsocket/server/RSRoutingHandler.h>
+#include <thrift/lib/cpp2/util/IOBufPool.h>
 #include <thrift/perf/cpp2/server/BenchmarkHandler.h>
 #include <thrift/perf/cpp2/util/QPSStats.h>
 
@@ -38,6 +40,7 @@ DEFINE_bool(use_admission_control, false, "Enable admission control");
 
 using apache::thrift::GlobalAdmissionStrategy;
 using apache::thrift::HTTP2RoutingHandler;
+using apache::thrift::IOBufPool;
 using apache::thrift::ThriftServer;
 using apache::thrift::ThriftServerAsyncProcessorFactory;
 using facebook::thrift::benchmarks::BenchmarkHandler;
@@ -57,6 +60,25 @@ std::unique_ptr<HTTP2RoutingHandler> createHTTP2RoutingHandler(
       std::move(h2_options), server->getThriftProcessor(), *server);
 }
 
+// User + system CPU time of the process, in microseconds.
+double cpuTimeUs() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+      usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// Run with and without --thrift_iobuf_pool to compare the CPU per request.
+void printIOBufPoolStats(double qps, double secs, double cpuUs) {
+  auto pool = IOBufPool::getStats();
+  LOG(INFO) << std::fixed << " | IOBufPool hit rate: " << pool.hitRate()
+            << " | Misses: " << pool.misses
+            << " | Remote frees: " << pool.remoteFrees
+            << " | Oversized: " << pool.oversized
+            << " | CPU us per request: "
+            << (qps > 0 ? cpuUs / (qps * secs) : 0);
+}
+
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
 
@@ -99,12 +121,16 @@ int main(int argc, char** argv) {
       // Essentially infinite time.
       FLAGS_terminate_sec = 100000000;
     }
+    auto cpuUs = cpuTimeUs();
     for (;;) {
       int32_t sleepTimeSec = std::min(
           FLAGS_terminate_sec - elapsedTimeSec, FLAGS_stats_interval_sec);
       /* sleep override */
       std::this_thread::sleep_for(std::chrono::seconds(sleepTimeSec));
-      stats.printStats(sleepTimeSec);
+      auto qps = stats.printStats(sleepTimeSec);
+      auto now = cpuTimeUs();
+      printIOBufPoolStats(qps, sleepTimeSec, now - cpuUs);
+      cpuUs = now;
       elapsedTimeSec += sleepTimeSec;
       if (elapsedTimeSec >= FLAGS_terminate_sec) {
         server->stop();
@@ -40,6 +40,8 @@ enum OP_TYPE {
   DOWNLOAD = 4,
   UPLOAD = 5,
   STREAM = 6,
+  STREAM_PUBLISHER = 7,
+  STREAM_BATCHED_PUBLISHER = 8,
 };
 
 template <typename AsyncClient>
@@ -56,7 +58,13 @@ class Operation {
         upload_(std::make_unique<Upload<AsyncClient>>(stats, FLAGS_chunk_size)),
         stream_(std::make_unique<StreamDownload<AsyncClient>>(
             stats,
-            FLAGS_chunk_size))
+            FLAGS_chunk_size)),
+        publisher_(std::make_unique<PublisherDownload<AsyncClient>>(
+            stats,
+            false)),
+        batchedPublisher_(std::make_unique<PublisherDownload<AsyncClient>>(
+            stats,
+            true))
 #endif
   {
   }
@@ -92,6 +100,13 @@ class Operation {
       case STREAM:
         stream_->async(client_.get(), std::move(cb), outstanding_ops_);
         break;
+      case STREAM_PUBLISHER:
+        publisher_->async(client_.get(), std::move(cb), outstanding_ops_);
+        break;
+      case STREAM_BATCHED_PUBLISHER:
+        batchedPublisher_->async(
+            client_.get(), std::move(cb), outstanding_ops_);
+        break;
 #endif
       default:
         break;
@@ -175,6 +190,8 @@ class Operation {
   std::unique_ptr<Download<AsyncClient>> download_;
   std::unique_ptr<Upload<AsyncClient>> upload_;
   std::unique_ptr<StreamDownload<AsyncClient>> stream_;
+  std::unique_ptr<PublisherDownload<AsyncClient>> publisher_;
+  std::unique_ptr<PublisherDownload<AsyncClient>> batchedPublisher_;
 #endif
 
   int32_t outstanding_ops_{0};
@@ -30,12 +30,14 @@ namespace benchmarks {
 
 class QPSStats {
  public:
-  void printStats(double secsSinceLastPrint) {
+  // Returns the total QPS.
+  double printStats(double secsSinceLastPrint) {
     double totalQPS = 0;
     for (auto& pair : counters_) {
       totalQPS += pair.second->print(secsSinceLastPrint);
     }
     LOG(INFO) << std::scientific << " | TOTAL QPS: " << totalQPS;
+    return totalQPS;
   }
 
   void registerCounter(std::string name) {
@@ -27,6 +27,7 @@
 
 DECLARE_uint32(chunk_size);
 DECLARE_uint32(batch_size);
+DECLARE_int32(publisher_count);
 
 using apache::thrift::ClientReceiveState;
 using apache::thrift::RequestCallback;
@@ -233,3 +234,77 @@ class StreamDownload {
   std::string fatal_ = "fatal";
   Chunk2 chunk_;
 };
+
+// Measures a StreamPublisher (or BatchedStreamPublisher) driven stream.
+// "s_publisher_latency_us" accumulates the publish-to-receive latency of
+// every element, so its rate divided by the element rate is the average
+// per-element latency. It is only meaningful when the client and the server
+// share a host, as it compares steady_clock readings of both.
+template <typename AsyncClient>
+class PublisherDownload {
+ public:
+  PublisherDownload(QPSStats* stats, bool batched)
+      : stats_(stats), batched_(batched) {
+    if (batched_) {
+      download_ = "s_batched_publisher_download";
+      latency_ = "s_batched_publisher_latency_us";
+    }
+    stats_->registerCounter(download_);
+    stats_->registerCounter(latency_);
+    stats_->registerCounter(error_);
+    stats_->registerCounter(fatal_);
+  }
+  ~PublisherDownload() = default;
+
+  void async(
+      AsyncClient* client,
+      std::unique_ptr<RequestCallback>,
+      int32_t& outstandingOps) {
+    apache::thrift::RpcOptions rpcOptions;
+    rpcOptions.setQueueTimeout(std::chrono::seconds(10));
+    rpcOptions.setTimeout(std::chrono::seconds(10));
+
+    auto output = client->sync_publisherDownload(
+        rpcOptions, batched_, FLAGS_publisher_count);
+    apache::thrift::toFlowable(
+        std::move(output).via(folly::EventBaseManager::get()->getEventBase()))
+        ->subscribe(
+            // next
+            [this](const Chunk2& chunk) {
+              stats_->add(download_);
+              int64_t published;
+              if (chunk.header.size() == sizeof(published)) {
+                memcpy(&published, chunk.header.data(), sizeof(published));
+                int64_t now =
+                    std::chrono::steady_clock::now().time_since_epoch().count();
+                auto latencyNs = std::max<int64_t>(now - published, 0);
+                stats_->add(latency_, latencyNs / 1000);
+              }
+            },
+            // error
+            [this, &outstandingOps](const auto&) mutable {
+              stats_->add(fatal_);
+              --outstandingOps;
+            },
+            // complete
+            [&outstandingOps]() mutable { --outstandingOps; },
+            FLAGS_batch_size);
+  }
+
+  void asyncReceived(AsyncClient*, ClientReceiveState&&) {}
+
+  void error(AsyncClient*, ClientReceiveState&& state) {
+    if (state.isException()) {
+      FB_LOG_EVERY_MS(INFO, 1000) << "Error is: " << state.exception().what();
+    }
+    stats_->add(error_);
+  }
+
+ private:
+  QPSStats* stats_;
+  bool batched_;
+  std::string download_ = "s_publisher_download";
+  std::string latency_ = "s_publisher_latency_us";
+  std::string error_ = "error";
+  std::string fatal_ = "fatal";
+};
@@ -32,6 +32,33 @@ from thrift.transport import TSocket, TSSLSocket
 from thrift.transport import TTransport
 from thrift.server import TServer, TNonblockingServer, TCppServer
 
+
+class CountingObserver(object):
+    """Counts server events, as a metrics exporter would."""
+
+    def __init__(self):
+        self.counts = {}
+
+    def _count(self, name, n=1):
+        self.counts[name] = self.counts.get(name, 0) + n
+
+    def receivedRequest(self):
+        self._count('receivedRequest')
+
+    def sentReply(self):
+        self._count('sentReply')
+
+    def activeRequests(self, n):
+        self.counts['activeRequests'] = n
+
+    def callCompleted(self, timestamps):
+        self._count('callCompleted')
+
+    def reportStats(self, stats):
+        for name in ('receivedRequest', 'sentReply', 'callCompleted'):
+            self._count(name, stats[name])
+        self.counts['activeRequests'] = stats['activeRequests']
+
 def main():
     op = optparse.OptionParser(usage='%prog [options]', add_help_option=False)
     op.add_option('-p', '--port',
@@ -47,6 +74,15 @@ def main():
     op.add_option('-Q', '--max_queue_size',
                   action='store', type='int', dest='max_queue_size', default=0,
                   help='Max queue size, passed to TNonblockingServer')
+    op.add_option('-o', '--observer',
+                  action='store', type='choice', dest='observer',
+                  choices=['none', 'python', 'batched'], default='none',
+                  help='TCppServer observer: none, python (one call per '
+                  'event) or batched (aggregated in C++)')
+    op.add_option('-i', '--observer_interval_ms',
+                  action='store', type='int', dest='observer_interval_ms',
+                  default=1000,
+                  help='Reporting interval of the batched observer')
     op.add_option('-h', '--header',
                   action='store_true', help='Use the generated ContextIface')
     op.add_option('-?', '--help',
@@ -95,6 +131,11 @@ def main():
         server.setPort(options.port)
         print 'Worker threads: ' + str(options.workers)
         server.setNumIOWorkerThreads(options.workers)
+        if options.observer == 'python':
+            server.setObserver(CountingObserver())
+        elif options.observer == 'batched':
+            server.setBatchedObserver(
+                CountingObserver(), options.observer_interval_ms)
     else:
         transport = TSocket.TServerSocket(options.port)
         tfactory = TTransport.TBufferedTransportFactory()
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements. See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership. The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License. You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#
+from argparse import ArgumentParser
+import asyncio
+import sys
+import time
+
+from thrift.py3 import get_client
+from thrift.perf.load.clients import LoadTest
+
+
+async def worker(client, deadline):
+    calls = 0
+    while time.monotonic() < deadline:
+        await client.noop()
+        calls += 1
+    return calls
+
+
+async def run(options):
+    async with get_client(
+        LoadTest, host=options.host, port=options.port
+    ) as client:
+        deadline = time.monotonic() + options.duration
+        start = time.monotonic()
+        calls = await asyncio.gather(
+            *(worker(client, deadline) for _ in range(options.concurrency))
+        )
+        elapsed = time.monotonic() - start
+    total = sum(calls)
+    print("{} calls in {:.2f}s with {} in flight: {:.0f} QPS".format(
+        total, elapsed, options.concurrency, total / elapsed))
+
+
+def main():
+    parser = ArgumentParser(
+        description='Measures py3 client QPS with many concurrent calls')
+    parser.add_argument('--host', default='::1', help='Server host')
+    parser.add_argument('--port', default=1234, type=int, help='Server port')
+    parser.add_argument(
+        '--concurrency',
+        default=1000,
+        type=int,
+        help='Number of calls in flight'
+    )
+    parser.add_argument(
+        '--duration',
+        default=10,
+        type=float,
+        help='Seconds to run for'
+    )
+    options = parser.parse_args()
+    asyncio.get_event_loop().run_until_complete(run(options))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -41,3 +41,15 @@ struct NegativeFieldId {
   0: string aString,
   5: double aDouble,
 }
+
+struct NumberLists {
+  1: list<byte> aByteList,
+  2: list<i16> anInteger16List,
+  3: list<i32> anInteger32List,
+  4: list<i64> anInteger64List,
+  5: list<double> aDoubleList,
+  6: list<float> aFloatList,
+  7: set<i32> anInteger32Set,
+  8: list<AStruct> aStructList,
+  9: NegativeFieldId aNested,
+}
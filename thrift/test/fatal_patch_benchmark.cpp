@@ -0,0 +1,110 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <folly/init/Init.h>
+#include <folly/Benchmark.h>
+
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/lib/cpp2/reflection/patch.h>
+#include <thrift/test/gen-cpp2/fatal_merge_types.h>
+#include <thrift/test/gen-cpp2/fatal_merge_fatal_types.h>
+
+#include <folly/portability/GFlags.h>
+
+#include <iostream>
+
+using namespace apache::thrift;
+using namespace apache::thrift::test;
+
+DEFINE_int32(entries, 10000, "Number of map entries in the benchmarked struct");
+
+namespace {
+
+// A large map in which a single entry changes.
+struct harness {
+  BasicMap from;
+  BasicMap to;
+
+  harness() {
+    for (int i = 0; i < FLAGS_entries; ++i) {
+      auto& value = from.l[std::to_string(i)];
+      value.b = "value " + std::to_string(i);
+      value.b_req = "required";
+    }
+    to = from;
+    to.l["0"].b = "changed";
+  }
+};
+
+const harness& get_harness() {
+  static const harness h;
+  return h;
+}
+
+} // namespace
+
+BENCHMARK(FullSerialization_Write, iters) {
+  const auto& h = get_harness();
+  while (iters--) {
+    auto buf = CompactSerializer::serialize<folly::IOBufQueue>(h.to);
+    folly::doNotOptimizeAway(buf);
+  }
+}
+
+BENCHMARK_RELATIVE(Patch_Write, iters) {
+  const auto& h = get_harness();
+  while (iters--) {
+    auto patch = make_patch(h.from, h.to);
+    folly::doNotOptimizeAway(patch);
+  }
+}
+
+BENCHMARK(FullSerialization_Apply, iters) {
+  folly::BenchmarkSuspender braces;
+  const auto& h = get_harness();
+  auto buf = CompactSerializer::serialize<std::string>(h.to);
+
+  while (iters--) {
+    BasicMap value;
+    braces.dismissing([&] { CompactSerializer::deserialize(buf, value); });
+  }
+}
+
+BENCHMARK_RELATIVE(Patch_Apply, iters) {
+  folly::BenchmarkSuspender braces;
+  const auto& h = get_harness();
+  auto patch = make_patch(h.from, h.to);
+
+  while (iters--) {
+    // applying requires a copy of the old value, which is not timed
+    auto value = h.from;
+    braces.dismissing([&] { apply_patch(*patch, value); });
+  }
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv, true);
+
+  const auto& h = get_harness();
+  std::cout << "full serialization: "
+            << CompactSerializer::serialize<std::string>(h.to).size()
+            << " bytes, patch: "
+            << make_patch(h.from, h.to)->computeChainDataLength() << " bytes"
+            << std::endl;
+
+  folly::runBenchmarks();
+
+  return 0;
+}
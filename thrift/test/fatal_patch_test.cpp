@@ -0,0 +1,197 @@
+/*
+ * Copyright 2018-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thrift/lib/cpp2/reflection/debug.h>
+#include <thrift/lib/cpp2/reflection/patch.h>
+
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/test/gen-cpp2/fatal_merge_types.h>
+#include <thrift/test/gen-cpp2/fatal_merge_fatal_types.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace apache::thrift::test;
+using apache::thrift::debug_equals;
+using apache::thrift::make_debug_output_callback;
+
+namespace {
+
+class FatalPatchTest : public testing::Test {};
+
+Basic makeBasic(std::string b) {
+  Basic value;
+  value.b = std::move(b);
+  return value;
+}
+
+// Patches a copy of `from` into `to` and returns the patch size.
+template <typename T>
+std::size_t expectPatches(const T& from, const T& to) {
+  auto patch = apache::thrift::make_patch(from, to);
+  auto value = from;
+  apache::thrift::apply_patch(*patch, value);
+  EXPECT_TRUE(
+      debug_equals(to, value, make_debug_output_callback(LOG(ERROR))));
+  return patch->computeChainDataLength();
+}
+
+template <typename T>
+std::size_t serializedSize(const T& value) {
+  return apache::thrift::CompactSerializer::serialize<std::string>(value)
+      .size();
+}
+
+} // namespace
+
+TEST_F(FatalPatchTest, unchanged) {
+  Nested value;
+  value.a = makeBasic("hello");
+  value.c = "foo";
+  EXPECT_EQ(1, expectPatches(value, value));
+}
+
+TEST_F(FatalPatchTest, structure) {
+  Basic from = makeBasic("hello");
+  from.b_req = "required";
+  Basic to = from;
+  to.b = "world";
+  expectPatches(from, to);
+}
+
+TEST_F(FatalPatchTest, optional) {
+  Basic from = makeBasic("hello");
+  Basic to = from;
+  to.b_opt = "set";
+  to.__isset.b_opt = true;
+  expectPatches(from, to);
+  expectPatches(to, from);
+}
+
+TEST_F(FatalPatchTest, nested_structure) {
+  Nested from;
+  from.a = makeBasic(std::string(1000, 'a'));
+  from.b = makeBasic("hello");
+  from.d = std::string(1000, 'd');
+  Nested to = from;
+  to.b.b = "world";
+  EXPECT_LT(expectPatches(from, to), serializedSize(to) / 10);
+}
+
+TEST_F(FatalPatchTest, list_elements) {
+  BasicList from;
+  for (int i = 0; i < 100; ++i) {
+    from.l.push_back(makeBasic(std::to_string(i)));
+  }
+  BasicList to = from;
+  to.l[3].b = "three";
+  to.l[50].b_opt = "fifty";
+  to.l[50].__isset.b_opt = true;
+  EXPECT_LT(expectPatches(from, to), serializedSize(to) / 10);
+}
+
+TEST_F(FatalPatchTest, list_splice) {
+  BasicList from;
+  for (int i = 0; i < 100; ++i) {
+    from.l.push_back(makeBasic(std::to_string(i)));
+  }
+  BasicList inserted = from;
+  inserted.l.insert(inserted.l.begin() + 10, makeBasic("new"));
+  EXPECT_LT(expectPatches(from, inserted), serializedSize(inserted) / 10);
+
+  BasicList removed = from;
+  removed.l.erase(removed.l.begin() + 20, removed.l.begin() + 30);
+  EXPECT_LT(expectPatches(from, removed), serializedSize(removed) / 10);
+
+  expectPatches(from, BasicList());
+  expectPatches(BasicList(), from);
+}
+
+TEST_F(FatalPatchTest, set) {
+  BasicSet from;
+  for (int i = 0; i < 100; ++i) {
+    from.l.insert(makeBasic(std::to_string(i)));
+  }
+  BasicSet to = from;
+  to.l.erase(makeBasic("7"));
+  to.l.insert(makeBasic("new"));
+  EXPECT_LT(expectPatches(from, to), serializedSize(to) / 10);
+}
+
+TEST_F(FatalPatchTest, map) {
+  BasicMap from;
+  for (int i = 0; i < 100; ++i) {
+    from.l[std::to_string(i)] = makeBasic(std::to_string(i));
+  }
+  BasicMap to = from;
+  to.l.erase("7");
+  to.l["new"] = makeBasic("new");
+  to.l["42"].b = "changed";
+  EXPECT_LT(expectPatches(from, to), serializedSize(to) / 10);
+}
+
+TEST_F(FatalPatchTest, nested_map) {
+  NestedMap from;
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      from.l[std::to_string(i)][std::to_string(j)] =
+          makeBasic(std::to_string(i * j));
+    }
+  }
+  NestedMap to = from;
+  to.l["3"]["4"].b = "changed";
+  to.l["5"].erase("6");
+  EXPECT_LT(expectPatches(from, to), serializedSize(to) / 10);
+}
+
+TEST_F(FatalPatchTest, nested_ref_unique) {
+  NestedRefUnique from;
+  from.a = std::make_unique<Basic>(makeBasic("hello"));
+  from.c = "foo";
+  NestedRefUnique to;
+  to.b = std::make_unique<Basic>(makeBasic("world"));
+  to.c = "foo";
+  expectPatches(from, to);
+  expectPatches(to, from);
+}
+
+TEST_F(FatalPatchTest, nested_ref_shared) {
+  NestedRefShared from;
+  from.a = std::make_shared<Basic>(makeBasic("hello"));
+  NestedRefShared to = from;
+  to.a = std::make_shared<Basic>(makeBasic("world"));
+  to.d = "bar";
+  expectPatches(from, to);
+}
+
+TEST_F(FatalPatchTest, nested_ref_shared_const) {
+  NestedRefSharedConst from;
+  from.b = std::make_shared<const Basic>(makeBasic("hello"));
+  NestedRefSharedConst to;
+  to.a = std::make_shared<const Basic>(makeBasic("world"));
+  expectPatches(from, to);
+}
+
+TEST_F(FatalPatchTest, mismatched_value) {
+  BasicList from;
+  from.l.push_back(makeBasic("hello"));
+  BasicList to = from;
+  to.l[0].b = "world";
+  auto patch = apache::thrift::make_patch(from, to);
+  BasicList other;
+  EXPECT_THROW(
+      apache::thrift::apply_patch(*patch, other),
+      apache::thrift::protocol::TProtocolException);
+}
@@ -17,7 +17,7 @@ try:
 except ImportError:
     hpy = None
 
-from FastProto.ttypes import AStruct, OneOfEach
+from FastProto.ttypes import AStruct, NumberLists, OneOfEach
 
 ooe = OneOfEach()
 ooe.aBool = True
@@ -43,6 +43,20 @@ proto = TCompactProtocol.TCompactProtocol(trans)
 ooe.write(proto)
 compact_buf = trans.getvalue()
 
+nl = NumberLists()
+nl.aDoubleList = [i * 1.5 for i in range(1000000)]
+nl.anInteger64List = list(range(1000000))
+
+trans = TTransport.TMemoryBuffer()
+proto = TBinaryProtocol.TBinaryProtocol(trans)
+nl.write(proto)
+binary_lists_buf = trans.getvalue()
+
+trans = TTransport.TMemoryBuffer()
+proto = TCompactProtocol.TCompactProtocol(trans)
+nl.write(proto)
+compact_lists_buf = trans.getvalue()
+
 class TDevNullTransport(TTransport.TTransportBase):
     def __init__(self):
         pass
@@ -94,6 +108,42 @@ def doReadCompact():
     print("Fastproto compact read = {}".format(
         timeit.Timer("doReadCompact()", setup_read).timeit(number=iters)))
 
+def benchmark_typed_arrays():
+    """1M element list<double> and list<i64>, decoded into lists of Python
+    objects versus into array.array, and encoded back from each."""
+    list_iters = 10
+    setup = """
+from __main__ import binary_lists_buf, compact_lists_buf
+from FastProto.ttypes import NumberLists
+from thrift.protocol import fastproto
+from thrift.transport import TTransport
+
+spec = [NumberLists, NumberLists.thrift_spec, False]
+
+def doRead(typed_arrays):
+    trans = TTransport.TMemoryBuffer(
+        binary_lists_buf if {0} == 0 else compact_lists_buf)
+    nl = NumberLists()
+    fastproto.decode(nl, trans, spec, utf8strings=0, protoid={0},
+        typed_arrays=typed_arrays)
+    return nl
+
+lists = doRead(0)
+arrays = doRead(1)
+
+def doWrite(nl):
+    fastproto.encode(nl, spec, utf8strings=0, protoid={0})
+"""
+    for protoid, name in ((0, "binary"), (2, "compact")):
+        for stmt, desc in (("doRead(0)", "read list"),
+                           ("doRead(1)", "read typed_arrays"),
+                           ("doWrite(lists)", "write list"),
+                           ("doWrite(arrays)", "write typed_arrays")):
+            print("Fastproto {} {} = {}".format(
+                name, desc,
+                timeit.Timer(stmt, setup.format(protoid))
+                    .timeit(number=list_iters)))
+
 def fastproto_encode(q, protoid):
     hp = hpy()
     trans = TDevNullTransport()
@@ -162,5 +212,6 @@ def memory_usage_fastproto():
 if __name__ == "__main__":
     print("Starting Benchmarks")
     benchmark_fastproto()
+    benchmark_typed_arrays()
     if hpy is not None:
         memory_usage_fastproto()
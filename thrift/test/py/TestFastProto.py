@@ -3,6 +3,7 @@ from __future__ import division
 from __future__ import print_function
 from __future__ import unicode_literals
 
+import array
 import unittest
 
 import sys
@@ -17,7 +18,7 @@ from thrift.protocol import fastproto, TBinaryProtocol, TCompactProtocol, \
 from thrift.transport.TTransport import TMemoryBuffer
 
 from FastProto.ttypes import AStruct, OneOfEach, TestUnion, StructWithUnion, \
-    NegativeFieldId, Required
+    NegativeFieldId, Required, NumberLists
 
 from forward_compatibility_fastproto.ttypes import \
     OldStructure, NewStructure, \
@@ -180,6 +181,72 @@ class AbstractTest():
             required = Required(aStruct=aStruct)
             self.encode_and_decode(required)
 
+    def buildNumberLists(self):
+        return NumberLists(
+            aByteList=[-128, 0, 127],
+            anInteger16List=[-32768, 1, 32767],
+            anInteger32List=[-2147483648, 12, 2147483647],
+            anInteger64List=[-9223372036854775808, 34, 9223372036854775807],
+            aDoubleList=[-1.5, 0.0, 1234567.901],
+            aFloatList=[-1.5, 0.0, 12345.0],
+            anInteger32Set=set([1, 2, 3]),
+            aStructList=[AStruct(aString=b"str", anInteger=109)],
+            aNested=NegativeFieldId(anInteger=20))
+
+    def decode_typed_arrays(self, obj, split=1.0):
+        trans = TMemoryBuffer()
+        obj.write(self.createProto(trans))
+        index = int(split * len(trans.getvalue()))
+        trans = ReadOnlyBufferWithRefill(index, trans.getvalue())
+        obj_new = obj.__class__()
+        fastproto.decode(obj_new, trans, [obj.__class__, obj.thrift_spec,
+                                          obj.isUnion()], utf8strings=0,
+                         protoid=self.PROTO, typed_arrays=1)
+        self.assertEqual(len(trans._readBuffer.read()), 0)
+        return obj_new
+
+    def test_decode_typed_arrays(self):
+        obj = self.buildNumberLists()
+        for split in (1.0, 0.5, 0.1):
+            obj_new = self.decode_typed_arrays(obj, split)
+            for name in ("aByteList", "anInteger16List", "anInteger32List",
+                         "anInteger64List", "aDoubleList", "aFloatList"):
+                value = getattr(obj_new, name)
+                self.assertIsInstance(value, array.array)
+                self.assertEqual(list(value), getattr(obj, name))
+            # Sets and lists of non-numeric types are not affected.
+            self.assertEqual(obj.anInteger32Set, obj_new.anInteger32Set)
+            self.assertEqual(obj.aStructList, obj_new.aStructList)
+            self.assertEqual(obj.aNested, obj_new.aNested)
+
+    def test_decode_typed_arrays_empty(self):
+        obj_new = self.decode_typed_arrays(NumberLists(aDoubleList=[]))
+        self.assertIsInstance(obj_new.aDoubleList, array.array)
+        self.assertEqual(len(obj_new.aDoubleList), 0)
+
+    @unittest.skipIf(sys.version_info[0] < 3, "buffer encoding is py3 only")
+    def test_encode_typed_arrays(self):
+        obj = self.buildNumberLists()
+        spec = [NumberLists, NumberLists.thrift_spec, False]
+        expected = fastproto.encode(obj, spec, utf8strings=0,
+                                    protoid=self.PROTO)
+        typed = self.decode_typed_arrays(obj)
+        self.assertEqual(
+            expected,
+            fastproto.encode(typed, spec, utf8strings=0, protoid=self.PROTO))
+
+        # Buffers of a different width or signedness go through the
+        # per-item path and are range checked as usual.
+        self.assertEqual(
+            fastproto.encode(NumberLists(anInteger32List=[1, -2, 3]), spec,
+                             utf8strings=0, protoid=self.PROTO),
+            fastproto.encode(
+                NumberLists(anInteger32List=array.array('h', [1, -2, 3])),
+                spec, utf8strings=0, protoid=self.PROTO))
+        obj = NumberLists(aByteList=array.array('B', [255]))
+        with self.assertRaises(OverflowError):
+            fastproto.encode(obj, spec, utf8strings=0, protoid=self.PROTO)
+
     def createProto(self, trans):
         if self.PROTO == 0:
             return TBinaryProtocol.TBinaryProtocol(trans)